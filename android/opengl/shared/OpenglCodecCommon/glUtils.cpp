@@ -374,6 +374,12 @@ int glUtilsPixelBitSize(GLenum format, GLenum type)
     int components = 0;
     int componentsize = 0;
     int pixelsize = 0;
+
+    // Full resolution luma plus a quarter resolution sample for each chroma
+    if (format == GL_YV12_ANBOX || format == GL_NV21_ANBOX) {
+        return 12;
+    }
+
     switch(type) {
     case GL_BYTE:
     case GL_UNSIGNED_BYTE:
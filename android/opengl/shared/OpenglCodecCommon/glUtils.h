@@ -42,6 +42,11 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+// Color buffer formats for YUV 4:2:0 frames, the host converts them to RGB.
+// The values are FourCC codes and must match the host's YUVConverter.h.
+#define GL_YV12_ANBOX 0x32315659
+#define GL_NV21_ANBOX 0x3132564e
+
 #ifdef __cplusplus
 extern "C" {
 #endif
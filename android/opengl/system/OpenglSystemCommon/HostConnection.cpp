@@ -21,10 +21,16 @@
 #include "GLEncoder.h"
 #include "GL2Encoder.h"
 #include <memory>
+#include <pthread.h>
+#include <unistd.h>
 
 #define STREAM_BUFFER_SIZE  4*1024*1024
 #define STREAM_PORT_NUM     22468
 
+static const char kAsyncFrameCommands[] = "ANDROID_EMU_async_frame_commands";
+static const char kProcessTracking[] = "ANDROID_EMU_process_tracking";
+static const char kYUVColorBuffers[] = "ANDROID_EMU_yuv_color_buffers";
+
 /* Set to 1 to use a QEMU pipe, or 0 for a TCP connection */
 #define  USE_QEMU_PIPE  1
 
@@ -33,7 +39,10 @@ HostConnection::HostConnection() :
     m_glEnc(NULL),
     m_gl2Enc(NULL),
     m_rcEnc(NULL),
-    m_checksumHelper()
+    m_checksumHelper(),
+    m_asyncFrameCommands(false),
+    m_processTracking(false),
+    m_yuvColorBuffers(false)
 {
 }
 
@@ -45,11 +54,52 @@ HostConnection::~HostConnection()
     delete m_rcEnc;
 }
 
-HostConnection *HostConnection::get()
+IOStream *HostConnection::openStream(unsigned int clientFlags, size_t bufferSize)
 {
     /* TODO: Make this configurable with a system property */
     const int useQemuPipe = USE_QEMU_PIPE;
 
+    IOStream *result = NULL;
+    if (useQemuPipe) {
+        QemuPipeStream *stream = new QemuPipeStream(bufferSize);
+        if (!stream) {
+            ALOGE("Failed to create QemuPipeStream for host connection!!!\n");
+            return NULL;
+        }
+        if (stream->connect() < 0) {
+            ALOGE("Failed to connect to host (QemuPipeStream)!!!\n");
+            delete stream;
+            return NULL;
+        }
+        result = stream;
+    }
+    else /* !useQemuPipe */
+    {
+        TcpStream *stream = new TcpStream(bufferSize);
+        if (!stream) {
+            ALOGE("Failed to create TcpStream for host connection!!!\n");
+            return NULL;
+        }
+
+        if (stream->connect("10.0.2.2", STREAM_PORT_NUM) < 0) {
+            ALOGE("Failed to connect to host (TcpStream)!!!\n");
+            delete stream;
+            return NULL;
+        }
+        result = stream;
+    }
+
+    // send the 'clientFlags' to the host.
+    unsigned int *pClientFlags =
+            (unsigned int *)result->allocBuffer(sizeof(unsigned int));
+    *pClientFlags = clientFlags;
+    result->commitBuffer(sizeof(unsigned int));
+
+    return result;
+}
+
+HostConnection *HostConnection::get()
+{
     // Get thread info
     EGLThreadInfo *tinfo = getEGLThreadInfo();
     if (!tinfo) {
@@ -62,45 +112,12 @@ HostConnection *HostConnection::get()
             return NULL;
         }
 
-        if (useQemuPipe) {
-            QemuPipeStream *stream = new QemuPipeStream(STREAM_BUFFER_SIZE);
-            if (!stream) {
-                ALOGE("Failed to create QemuPipeStream for host connection!!!\n");
-                delete con;
-                return NULL;
-            }
-            if (stream->connect() < 0) {
-                ALOGE("Failed to connect to host (QemuPipeStream)!!!\n");
-                delete stream;
-                delete con;
-                return NULL;
-            }
-            con->m_stream = stream;
-        }
-        else /* !useQemuPipe */
-        {
-            TcpStream *stream = new TcpStream(STREAM_BUFFER_SIZE);
-            if (!stream) {
-                ALOGE("Failed to create TcpStream for host connection!!!\n");
-                delete con;
-                return NULL;
-            }
-
-            if (stream->connect("10.0.2.2", STREAM_PORT_NUM) < 0) {
-                ALOGE("Failed to connect to host (TcpStream)!!!\n");
-                delete stream;
-                delete con;
-                return NULL;
-            }
-            con->m_stream = stream;
+        con->m_stream = openStream(0, STREAM_BUFFER_SIZE);
+        if (!con->m_stream) {
+            delete con;
+            return NULL;
         }
 
-        // send zero 'clientFlags' to the host.
-        unsigned int *pClientFlags =
-                (unsigned int *)con->m_stream->allocBuffer(sizeof(unsigned int));
-        *pClientFlags = 0;
-        con->m_stream->commitBuffer(sizeof(unsigned int));
-
         ALOGD("HostConnection::get() New Host Connection established %p, tid %d\n", con, gettid());
         tinfo->hostConn = con;
     }
@@ -135,10 +152,49 @@ renderControl_encoder_context_t *HostConnection::rcEncoder()
         // TODO: disable checksum as a workaround in a glTexSubImage2D problem
         // Uncomment the following line when the root cause is solved
         //setChecksumHelper(m_rcEnc);
+        queryFeatures(m_rcEnc);
+        if (m_processTracking) {
+            uint32_t processId = getProcessId();
+            if (processId) {
+                m_rcEnc->rcSetProcessId(m_rcEnc, processId);
+            }
+        }
     }
     return m_rcEnc;
 }
 
+uint32_t HostConnection::getProcessId()
+{
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static pid_t processPid = 0;
+    static uint32_t processId = 0;
+
+    pthread_mutex_lock(&lock);
+    // A forked child must not report its resources as the parent's.
+    if (processPid != getpid()) {
+        processPid = getpid();
+        processId = 0;
+        // The host attributes the resources of this process to a
+        // sentinel connection which is never closed. Once the process dies
+        // the kernel closes it and the host reclaims whatever we leaked.
+        // The host only replies with our id on it and runs no decoder for
+        // it, so a buffer for the flags is all we need.
+        IOStream *stream = openStream(IOSTREAM_CLIENT_PROCESS_SENTINEL, sizeof(unsigned int));
+        if (stream) {
+            uint32_t id = 0;
+            if (stream->readFully(&id, sizeof(id))) {
+                processId = id;
+            } else {
+                ALOGE("Failed to register process with the host\n");
+                delete stream;
+            }
+        }
+    }
+    uint32_t result = processId;
+    pthread_mutex_unlock(&lock);
+    return result;
+}
+
 gl_client_context_t *HostConnection::s_getGLContext()
 {
     EGLThreadInfo *ti = getEGLThreadInfo();
@@ -184,3 +240,20 @@ void HostConnection::setChecksumHelper(renderControl_encoder_context_t *rcEnc) {
         m_checksumHelper.setVersion(checksumVersion);
     }
 }
+
+void HostConnection::queryFeatures(renderControl_encoder_context_t *rcEnc) {
+    // Hosts which don't know about a feature simply don't list it, which
+    // keeps older hosts working with newer system images and vice versa.
+    int extensionSize = rcEnc->rcGetGLString(rcEnc, GL_EXTENSIONS, NULL, 0);
+    if (extensionSize >= 0) {
+        return;
+    }
+    std::unique_ptr<char[]> glExtensions(new char[-extensionSize]);
+    extensionSize = rcEnc->rcGetGLString(rcEnc, GL_EXTENSIONS, glExtensions.get(), -extensionSize);
+    if (extensionSize <= 0) {
+        return;
+    }
+    m_asyncFrameCommands = strstr(glExtensions.get(), kAsyncFrameCommands) != NULL;
+    m_processTracking = strstr(glExtensions.get(), kProcessTracking) != NULL;
+    m_yuvColorBuffers = strstr(glExtensions.get(), kYUVColorBuffers) != NULL;
+}
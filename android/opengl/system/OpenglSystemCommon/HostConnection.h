@@ -35,6 +35,10 @@ public:
     GL2Encoder *gl2Encoder();
     renderControl_encoder_context_t *rcEncoder();
     ChecksumCalculator *checksumHelper() { return &m_checksumHelper; }
+    // True if the host doesn't need a round trip for every frame
+    bool hasAsyncFrameCommands() const { return m_asyncFrameCommands; }
+    // True if the host takes YV12 and NV21 frames as color buffer content
+    bool hasYUVColorBuffers() const { return m_yuvColorBuffers; }
 
     void flush() {
         if (m_stream) {
@@ -44,11 +48,19 @@ public:
 
 private:
     HostConnection();
+    // openStream connects to the host and sends the client flags
+    static IOStream *openStream(unsigned int clientFlags, size_t bufferSize);
+    // getProcessId returns the id the host knows this process by, the
+    // first call registers the process with the host
+    static uint32_t getProcessId();
     static gl_client_context_t  *s_getGLContext();
     static gl2_client_context_t *s_getGL2Context();
     // setProtocol initilizes GL communication protocol for checksums
     // should be called when m_rcEnc is created
     void setChecksumHelper(renderControl_encoder_context_t *rcEnc);
+    // queryFeatures checks which optional renderControl calls the host
+    // supports, should be called when m_rcEnc is created
+    void queryFeatures(renderControl_encoder_context_t *rcEnc);
 
 private:
     IOStream *m_stream;
@@ -56,6 +68,9 @@ private:
     GL2Encoder  *m_gl2Enc;
     renderControl_encoder_context_t *m_rcEnc;
     ChecksumCalculator m_checksumHelper;
+    bool m_asyncFrameCommands;
+    bool m_processTracking;
+    bool m_yuvColorBuffers;
 };
 
 #endif
@@ -118,6 +118,10 @@ const char *  eglStrError(EGLint err)
         return ret; \
     }
 
+// Number of frames after which a window surface with asynchronous flushes
+// does a synchronous one to collect errors from the host.
+#define ASYNC_FLUSH_CHECK_INTERVAL 60
+
 #define VALIDATE_CONTEXT_RETURN(context,ret)        \
     if (!context) {                                    \
         RETURN_ERROR(ret,EGL_BAD_CONTEXT);    \
@@ -247,6 +251,7 @@ private:
 
     ANativeWindow*              nativeWindow;
     android_native_buffer_t*    buffer;
+    uint32_t                    frameCount;
 };
 
 egl_window_surface_t::egl_window_surface_t (
@@ -254,7 +259,8 @@ egl_window_surface_t::egl_window_surface_t (
         ANativeWindow* window)
 :   egl_surface_t(dpy, config, surfType),
     nativeWindow(window),
-    buffer(NULL)
+    buffer(NULL),
+    frameCount(0)
 {
     // keep a reference on the window
     nativeWindow->common.incRef(&nativeWindow->common);
@@ -314,7 +320,19 @@ EGLBoolean egl_window_surface_t::swapBuffers()
 {
     DEFINE_AND_VALIDATE_HOST_CONNECTION(EGL_FALSE);
 
-    rcEnc->rcFlushWindowColorBuffer(rcEnc, rcSurface);
+    // When the host supports it we don't wait for it to finish the flush.
+    // The host takes care that the buffer isn't composed before the flush
+    // is done. Every ASYNC_FLUSH_CHECK_INTERVAL frames we still do a round
+    // trip to pick up errors of the asynchronous flushes.
+    if (hostCon->hasAsyncFrameCommands() &&
+        (++frameCount % ASYNC_FLUSH_CHECK_INTERVAL) != 0) {
+        rcEnc->rcFlushWindowColorBufferAsync(rcEnc, rcSurface);
+        // The call is only buffered so far, get it on its way to the host
+        // before the buffer is handed to the compositor.
+        hostCon->flush();
+    } else if (rcEnc->rcFlushWindowColorBuffer(rcEnc, rcSurface) < 0) {
+        ALOGE("egl: Failed to flush window surface %u\n", rcSurface);
+    }
 
     nativeWindow->queueBuffer_DEPRECATED(nativeWindow, buffer);
     if (nativeWindow->dequeueBuffer_DEPRECATED(nativeWindow, &buffer)) {
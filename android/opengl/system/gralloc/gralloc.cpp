@@ -102,6 +102,46 @@ static int map_buffer(cb_handle_t *cb, void **vaddr)
     return 0;
 }
 
+static bool is_yuv_color_buffer(const cb_handle_t *cb)
+{
+    return cb->glFormat == GL_YV12_ANBOX || cb->glFormat == GL_NV21_ANBOX;
+}
+
+//
+// Copies the frame of a YUV buffer from its layout in guest memory, where
+// YV12 rows are 16 byte aligned, into the tightly packed layout the host
+// takes. Returns NULL if the frame already is tightly packed.
+//
+static char *pack_yuv_frame(const cb_handle_t *cb, const char *src)
+{
+    if (cb->glFormat != GL_YV12_ANBOX) {
+        return NULL;
+    }
+
+    size_t yStride = (cb->width + 15) & ~15;
+    size_t uvStride = (yStride / 2 + 15) & ~15;
+    size_t uvWidth = cb->width / 2;
+    size_t uvHeight = cb->height / 2;
+    if (yStride == (size_t)cb->width && uvStride == uvWidth) {
+        return NULL;
+    }
+
+    char *packed = new char[cb->width * cb->height + 2 * uvWidth * uvHeight];
+    char *dst = packed;
+    for (int y = 0; y < cb->height; y++) {
+        memcpy(dst, src, cb->width);
+        src += yStride;
+        dst += cb->width;
+    }
+    // V plane followed by the U plane
+    for (size_t y = 0; y < 2 * uvHeight; y++) {
+        memcpy(dst, src, uvWidth);
+        src += uvStride;
+        dst += uvWidth;
+    }
+    return packed;
+}
+
 #define DEFINE_HOST_CONNECTION \
     HostConnection *hostCon = HostConnection::get(); \
     renderControl_encoder_context_t *rcEnc = (hostCon ? hostCon->rcEncoder() : NULL)
@@ -237,13 +277,17 @@ static int gralloc_alloc(alloc_device_t* dev,
             align = 1;
             bpp = 1; // per-channel bpp
             yuv_format = true;
-            // Not expecting to actually create any GL surfaces for this
+            // Only sampled on the host, which converts the planes to RGB
+            glFormat = GL_NV21_ANBOX;
+            glType = GL_UNSIGNED_BYTE;
             break;
         case HAL_PIXEL_FORMAT_YV12:
             align = 16;
             bpp = 1; // per-channel bpp
             yuv_format = true;
-            // Not expecting to actually create any GL surfaces for this
+            // Only sampled on the host, which converts the planes to RGB
+            glFormat = GL_YV12_ANBOX;
+            glType = GL_UNSIGNED_BYTE;
             break;
         default:
             ALOGE("gralloc_alloc: Unknown format %d", format);
@@ -316,11 +360,21 @@ static int gralloc_alloc(alloc_device_t* dev,
     // rendering will still happen on the host but we also need to be able to
     // read back from the color buffer, which requires that there is a buffer
     //
-    if (usage & (GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_RENDER |
+    // YUV buffers are never rendered to and their CPU copy is the one in
+    // guest memory, so they only need a host buffer to be sampled from.
+    //
+    int hostUsage = GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_RENDER |
                     GRALLOC_USAGE_HW_2D | GRALLOC_USAGE_HW_COMPOSER |
-                    GRALLOC_USAGE_HW_FB | GRALLOC_USAGE_SW_READ_MASK) ) {
+                    GRALLOC_USAGE_HW_FB | GRALLOC_USAGE_SW_READ_MASK;
+    if (yuv_format) {
+        hostUsage = GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_2D |
+                    GRALLOC_USAGE_HW_COMPOSER;
+    }
+    if (usage & hostUsage) {
         DEFINE_HOST_CONNECTION;
-        if (hostCon && rcEnc) {
+        if (hostCon && rcEnc &&
+                (!yuv_format ||
+                 (hostCon->hasYUVColorBuffers() && !(w & 1) && !(h & 1)))) {
             cb->hostHandle = rcEnc->rcCreateColorBuffer(rcEnc, w, h, glFormat);
             D("Created host ColorBuffer 0x%x\n", cb->hostHandle);
         }
@@ -685,7 +739,8 @@ static int gralloc_lock(gralloc_module_t const* module,
             return -EBUSY;
         }
 
-        if (sw_read) {
+        // The host only has the RGB conversion of YUV buffers
+        if (sw_read && !is_yuv_color_buffer(cb)) {
             D("gralloc_lock read back color buffer %d %d\n", cb->width, cb->height);
             rcEnc->rcReadColorBuffer(rcEnc, cb->hostHandle,
                     0, 0, cb->width, cb->height, GL_RGBA, GL_UNSIGNED_BYTE, cpu_addr);
@@ -745,7 +800,19 @@ static int gralloc_unlock(gralloc_module_t const* module,
             cpu_addr = (void *)(cb->ashmemBase);
         }
 
-        if (cb->lockedWidth < cb->width || cb->lockedHeight < cb->height) {
+        if (is_yuv_color_buffer(cb)) {
+            // The host converts complete frames only, so the size of the
+            // locked region doesn't matter as long as it was written to.
+            if (cb->lockedWidth > 0 && cb->lockedHeight > 0) {
+                char *packed = pack_yuv_frame(cb, (char *)cpu_addr);
+                rcEnc->rcUpdateColorBuffer(rcEnc, cb->hostHandle, 0, 0,
+                                           cb->width, cb->height,
+                                           cb->glFormat, cb->glType,
+                                           packed ? packed : cpu_addr);
+                delete [] packed;
+            }
+        }
+        else if (cb->lockedWidth < cb->width || cb->lockedHeight < cb->height) {
             int bpp = glUtilsPixelBitSize(cb->glFormat, cb->glType) >> 3;
             char *tmpBuf = new char[cb->lockedWidth * cb->lockedHeight * bpp];
 
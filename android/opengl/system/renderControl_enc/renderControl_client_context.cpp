@@ -47,6 +47,8 @@ int renderControl_client_context_t::initDispatchByName(void *(*getProc)(const ch
 	rcGetDisplayVsyncPeriod = (rcGetDisplayVsyncPeriod_client_proc_t) getProc("rcGetDisplayVsyncPeriod", userData);
 	rcPostLayer = (rcPostLayer_client_proc_t) getProc("rcPostLayer", userData);
 	rcPostAllLayersDone = (rcPostAllLayersDone_client_proc_t) getProc("rcPostAllLayersDone", userData);
+	rcFlushWindowColorBufferAsync = (rcFlushWindowColorBufferAsync_client_proc_t) getProc("rcFlushWindowColorBufferAsync", userData);
+	rcSetProcessId = (rcSetProcessId_client_proc_t) getProc("rcSetProcessId", userData);
 	return 0;
 }
 
@@ -47,6 +47,8 @@ struct renderControl_client_context_t {
 	rcGetDisplayVsyncPeriod_client_proc_t rcGetDisplayVsyncPeriod;
 	rcPostLayer_client_proc_t rcPostLayer;
 	rcPostAllLayersDone_client_proc_t rcPostAllLayersDone;
+	rcFlushWindowColorBufferAsync_client_proc_t rcFlushWindowColorBufferAsync;
+	rcSetProcessId_client_proc_t rcSetProcessId;
 	 virtual ~renderControl_client_context_t() {}
 
 	typedef renderControl_client_context_t *CONTEXT_ACCESSOR_TYPE(void);
@@ -46,6 +46,8 @@ typedef int (renderControl_APIENTRY *rcGetDisplayDpiY_client_proc_t) (void * ctx
 typedef int (renderControl_APIENTRY *rcGetDisplayVsyncPeriod_client_proc_t) (void * ctx, uint32_t);
 typedef void (renderControl_APIENTRY *rcPostLayer_client_proc_t) (void * ctx, const char*, uint32_t, float, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t);
 typedef void (renderControl_APIENTRY *rcPostAllLayersDone_client_proc_t) (void * ctx);
+typedef void (renderControl_APIENTRY *rcFlushWindowColorBufferAsync_client_proc_t) (void * ctx, uint32_t);
+typedef void (renderControl_APIENTRY *rcSetProcessId_client_proc_t) (void * ctx, uint32_t);
 
 
 #endif
@@ -43,6 +43,8 @@ extern "C" {
 	int rcGetDisplayVsyncPeriod(uint32_t displayId);
 	void rcPostLayer(const char* name, uint32_t colorBuffer, float alpha, int32_t sourceCropLeft, int32_t sourceCropTop, int32_t sourceCropRight, int32_t sourceCropBottom, int32_t displayFrameLeft, int32_t displayFrameTop, int32_t displayFrameRight, int32_t displayFrameBottom);
 	void rcPostAllLayersDone();
+	void rcFlushWindowColorBufferAsync(uint32_t windowSurface);
+	void rcSetProcessId(uint32_t processId);
 };
 
 #endif
@@ -274,3 +276,15 @@ void rcPostAllLayersDone()
 	ctx->rcPostAllLayersDone(ctx);
 }
 
+void rcFlushWindowColorBufferAsync(uint32_t windowSurface)
+{
+	GET_CONTEXT;
+	ctx->rcFlushWindowColorBufferAsync(ctx, windowSurface);
+}
+
+void rcSetProcessId(uint32_t processId)
+{
+	GET_CONTEXT;
+	ctx->rcSetProcessId(ctx, processId);
+}
+
@@ -45,6 +45,8 @@ static const struct _renderControl_funcs_by_name {
 	{"rcGetDisplayVsyncPeriod", (void*)rcGetDisplayVsyncPeriod},
 	{"rcPostLayer", (void*)rcPostLayer},
 	{"rcPostAllLayersDone", (void*)rcPostAllLayersDone},
+	{"rcFlushWindowColorBufferAsync", (void*)rcFlushWindowColorBufferAsync},
+	{"rcSetProcessId", (void*)rcSetProcessId},
 };
 static const int renderControl_num_funcs = sizeof(renderControl_funcs_by_name) / sizeof(struct _renderControl_funcs_by_name);
 
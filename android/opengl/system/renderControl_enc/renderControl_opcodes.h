@@ -40,7 +40,9 @@
 #define OP_rcGetDisplayVsyncPeriod 					10034
 #define OP_rcPostLayer 					10035
 #define OP_rcPostAllLayersDone 					10036
-#define OP_last 					10037
+#define OP_rcFlushWindowColorBufferAsync 					10037
+#define OP_rcSetProcessId 					10038
+#define OP_last 					10039
 
 
 #endif
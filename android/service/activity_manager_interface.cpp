@@ -19,6 +19,8 @@
 
 #include "android/service/activity_manager_interface.h"
 
+#include <string>
+
 namespace android {
 BpActivityManager::BpActivityManager(const sp<IBinder> &binder) :
     BpInterface<IActivityManager>(binder) {
@@ -50,5 +52,31 @@ status_t BpActivityManager::resizeTask(int32_t id, const anbox::graphics::Rect &
   return remote()->transact(IActivityManager::RESIZE_TASK, data, &reply);
 }
 
+status_t BpActivityManager::killAllBackgroundProcesses() {
+    Parcel data, reply;
+    data.writeInterfaceToken(IActivityManager::getInterfaceDescriptor());
+    const auto status = remote()->transact(IActivityManager::KILL_ALL_BACKGROUND_PROCESSES, data, &reply);
+    if (status != NO_ERROR)
+        return status;
+    return reply.readExceptionCode() == 0 ? NO_ERROR : PERMISSION_DENIED;
+}
+
+status_t BpActivityManager::setProcessMemoryTrimLevel(pid_t pid, int32_t level) {
+    Parcel data, reply;
+    data.writeInterfaceToken(IActivityManager::getInterfaceDescriptor());
+    // The activity manager takes a process name or, as we do, a pid.
+    data.writeString16(String16(std::to_string(pid).c_str()));
+    // UserHandle.USER_CURRENT, only used to look up process names.
+    data.writeInt32(-2);
+    data.writeInt32(level);
+    const auto status = remote()->transact(IActivityManager::SET_PROCESS_MEMORY_TRIM, data, &reply);
+    if (status != NO_ERROR)
+        return status;
+    if (reply.readExceptionCode() != 0)
+        return PERMISSION_DENIED;
+    // False if the process is gone or can't be trimmed to the level.
+    return reply.readInt32() ? NO_ERROR : BAD_VALUE;
+}
+
 IMPLEMENT_META_INTERFACE(ActivityManager, "android.app.IActivityManager");
 } // namespace android
@@ -27,6 +27,8 @@
 
 #include <cstdint>
 
+#include <sys/types.h>
+
 #include "anbox/graphics/rect.h"
 
 namespace android {
@@ -38,12 +40,17 @@ public:
         // This needs to stay synchronized with frameworks/base/core/java/android/app/IActivityManager.java
         SET_FOCUSED_TASK = IBinder::FIRST_CALL_TRANSACTION + 130,
         REMOVE_TASK = IBinder::FIRST_CALL_TRANSACTION + 131,
+        KILL_ALL_BACKGROUND_PROCESSES = IBinder::FIRST_CALL_TRANSACTION + 139,
+        SET_PROCESS_MEMORY_TRIM = IBinder::FIRST_CALL_TRANSACTION + 186,
         RESIZE_TASK = IBinder::FIRST_CALL_TRANSACTION + 285,
     };
 
     virtual status_t setFocusedTask(int32_t id) = 0;
     virtual status_t removeTask(int32_t id) = 0;
     virtual status_t resizeTask(int32_t id, const anbox::graphics::Rect &rect, int resize_mode) = 0;
+    virtual status_t killAllBackgroundProcesses() = 0;
+    // |level| is one of the ComponentCallbacks2.TRIM_MEMORY_* values.
+    virtual status_t setProcessMemoryTrimLevel(pid_t pid, int32_t level) = 0;
 };
 
 class BpActivityManager : public BpInterface<IActivityManager> {
@@ -53,6 +60,8 @@ public:
     status_t setFocusedTask(int32_t id) override;
     status_t removeTask(int32_t id) override;
     status_t resizeTask(int32_t id, const anbox::graphics::Rect &rect, int resize_mode);
+    status_t killAllBackgroundProcesses() override;
+    status_t setProcessMemoryTrimLevel(pid_t pid, int32_t level) override;
 };
 } // namespace android
 #endif
@@ -18,6 +18,7 @@
 #define LOG_TAG "Anboxd"
 
 #include "android/service/android_api_skeleton.h"
+#include "android/service/platform_api_stub.h"
 
 #include "anbox_rpc.pb.h"
 #include "anbox_bridge.pb.h"
@@ -27,14 +28,63 @@
 
 #include <binder/IServiceManager.h>
 
+#include <cutils/log.h>
+
+#include <dirent.h>
+
+#include <cstdlib>
+#include <fstream>
 #include <string>
 #include <sstream>
+#include <thread>
 
 namespace {
 std::map<std::string,std::string> common_env = {
     {"ANDROID_DATA", "/data"},
     {"ANDROID_ROOT", "/system"},
 };
+
+// Same as AID_APP, the first uid handed out to applications.
+constexpr const long first_application_uid{10000};
+
+// Names and ComponentCallbacks2.TRIM_MEMORY_* values of the trim levels,
+// indexed by MemoryPressureEvent::Level.
+const char *trim_level_names[] = {
+    nullptr,
+    "RUNNING_MODERATE",
+    "RUNNING_LOW",
+    "RUNNING_CRITICAL",
+};
+const int32_t trim_levels[] = {0, 5, 10, 15};
+
+// Returns the ids of all processes which belong to an application.
+std::vector<pid_t> find_application_processes() {
+    std::vector<pid_t> pids;
+    auto dir = opendir("/proc");
+    if (!dir)
+        return pids;
+
+    while (auto entry = readdir(dir)) {
+        char *end = nullptr;
+        const auto pid = std::strtol(entry->d_name, &end, 10);
+        if (pid <= 0 || *end != '\0')
+            continue;
+
+        std::ifstream status(std::string("/proc/") + entry->d_name + "/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 4, "Uid:") != 0)
+                continue;
+            const auto uid = std::strtol(line.c_str() + 4, nullptr, 10);
+            if (uid >= first_application_uid)
+                pids.push_back(static_cast<pid_t>(pid));
+            break;
+        }
+    }
+
+    closedir(dir);
+    return pids;
+}
 }
 
 namespace anbox {
@@ -42,6 +92,17 @@ AndroidApiSkeleton::AndroidApiSkeleton() {
 }
 
 AndroidApiSkeleton::~AndroidApiSkeleton() {
+    {
+        std::lock_guard<std::mutex> l(trim_mutex_);
+        stopping_ = true;
+    }
+    trim_changed_.notify_all();
+    if (trim_worker_.joinable())
+        trim_worker_.join();
+}
+
+void AndroidApiSkeleton::set_platform_api_stub(const std::shared_ptr<PlatformApiStub> &platform_api_stub) {
+    platform_api_stub_ = platform_api_stub;
 }
 
 void AndroidApiSkeleton::wait_for_process(core::posix::ChildProcess &process,
@@ -55,12 +116,15 @@ void AndroidApiSkeleton::wait_for_process(core::posix::ChildProcess &process,
     }
 }
 
-void AndroidApiSkeleton::connect_services() {
+android::sp<android::BpActivityManager> AndroidApiSkeleton::activity_manager() {
+    // Also used by the trim worker.
+    std::lock_guard<std::mutex> l(services_mutex_);
     if (!activity_manager_.get()) {
         auto am = android::defaultServiceManager()->getService(android::String16("activity"));
         if (am.get())
             activity_manager_ = new android::BpActivityManager(am);
     }
+    return activity_manager_;
 }
 
 void AndroidApiSkeleton::launch_application(anbox::protobuf::bridge::LaunchApplication const *request,
@@ -133,10 +197,9 @@ void AndroidApiSkeleton::launch_application(anbox::protobuf::bridge::LaunchAppli
 void AndroidApiSkeleton::set_focused_task(anbox::protobuf::bridge::SetFocusedTask const *request,
                                           anbox::protobuf::rpc::Void *response,
                                           google::protobuf::Closure *done) {
-    connect_services();
-
-    if (activity_manager_.get())
-        activity_manager_->setFocusedTask(request->id());
+    auto am = activity_manager();
+    if (am.get())
+        am->setFocusedTask(request->id());
     else
         response->set_error("ActivityManager is not available");
 
@@ -146,10 +209,9 @@ void AndroidApiSkeleton::set_focused_task(anbox::protobuf::bridge::SetFocusedTas
 void AndroidApiSkeleton::remove_task(anbox::protobuf::bridge::RemoveTask const *request,
                                      anbox::protobuf::rpc::Void *response,
                                      google::protobuf::Closure *done) {
-  connect_services();
-
-  if (activity_manager_.get())
-    activity_manager_->removeTask(request->id());
+  auto am = activity_manager();
+  if (am.get())
+    am->removeTask(request->id());
   else
     response->set_error("ActivityManager is not available");
 
@@ -160,17 +222,85 @@ void AndroidApiSkeleton::remove_task(anbox::protobuf::bridge::RemoveTask const *
 void AndroidApiSkeleton::resize_task(anbox::protobuf::bridge::ResizeTask const *request,
                                      anbox::protobuf::rpc::Void *response,
                                      google::protobuf::Closure *done) {
-  connect_services();
-
-  if (activity_manager_.get()) {
+  auto am = activity_manager();
+  if (am.get()) {
     auto r = request->rect();
-    activity_manager_->resizeTask(request->id(),
-                                  anbox::graphics::Rect{r.left(), r.top(), r.right(), r.bottom()},
-                                  request->resize_mode());
+    am->resizeTask(request->id(),
+                   anbox::graphics::Rect{r.left(), r.top(), r.right(), r.bottom()},
+                   request->resize_mode());
   } else {
     response->set_error("ActivityManager is not available");
   }
 
   done->Run();
 }
+
+void AndroidApiSkeleton::handle_memory_pressure(anbox::protobuf::bridge::MemoryPressureEvent const &event) {
+    // Trimming every application takes a while so we must not block the
+    // bridge with it. Only the latest level is of interest if several
+    // events arrive while we're busy.
+    {
+        std::lock_guard<std::mutex> l(trim_mutex_);
+        pending_trim_level_ = event.level();
+        if (!trim_worker_.joinable())
+            trim_worker_ = std::thread(&AndroidApiSkeleton::run_trim_worker, this);
+    }
+    trim_changed_.notify_all();
+}
+
+void AndroidApiSkeleton::run_trim_worker() {
+    std::unique_lock<std::mutex> l(trim_mutex_);
+    while (true) {
+        trim_changed_.wait(l, [this]() { return stopping_ || pending_trim_level_ >= 0; });
+        if (stopping_)
+            return;
+
+        const auto level = pending_trim_level_;
+        pending_trim_level_ = -1;
+        l.unlock();
+        trim_memory(level);
+        l.lock();
+    }
+}
+
+void AndroidApiSkeleton::handle_clipboard_update(anbox::protobuf::bridge::ClipboardData const &data) {
+    if (platform_api_stub_)
+        platform_api_stub_->host_clipboard_changed(PlatformApiStub::ClipboardData{data.text()});
+}
+
+void AndroidApiSkeleton::trim_memory(int level) {
+    if (level <= anbox::protobuf::bridge::MemoryPressureEvent::NONE ||
+        level > anbox::protobuf::bridge::MemoryPressureEvent::CRITICAL) {
+        trimmed_processes_.clear();
+        return;
+    }
+
+    ALOGI("Host memory pressure changed, trimming applications to %s", trim_level_names[level]);
+
+    auto am = activity_manager();
+    if (!am.get()) {
+        ALOGW("ActivityManager is not available, can't trim applications");
+        return;
+    }
+
+    // Under critical pressure cached and empty processes have to go
+    // before the host starts to swap them out.
+    if (level == anbox::protobuf::bridge::MemoryPressureEvent::CRITICAL &&
+        am->killAllBackgroundProcesses() != android::NO_ERROR)
+        ALOGW("Failed to kill background processes");
+
+    std::map<pid_t, int> trimmed;
+    for (const auto &pid : find_application_processes()) {
+        auto t = trimmed_processes_.find(pid);
+        if (t != trimmed_processes_.end() && t->second >= level) {
+            trimmed.insert(*t);
+            continue;
+        }
+
+        if (am->setProcessMemoryTrimLevel(pid, trim_levels[level]) == android::NO_ERROR)
+            trimmed.insert({pid, level});
+    }
+    // Processes which are gone are dropped so their ids can be reused.
+    trimmed_processes_.swap(trimmed);
+}
 } // namespace anbox
@@ -20,6 +20,14 @@
 
 #include "android/service/activity_manager_interface.h"
 
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace google {
 namespace protobuf {
 class Closure;
@@ -35,8 +43,10 @@ class ChildProcess;
 namespace anbox {
 namespace protobuf {
 namespace bridge {
+class ClipboardData;
 class InstallApplication;
 class LaunchApplication;
+class MemoryPressureEvent;
 class SetDnsServers;
 class SetFocusedTask;
 class RemoveTask;
@@ -46,11 +56,16 @@ namespace rpc {
 class Void;
 } // namespace rpc
 } // namespace protobuf
+class PlatformApiStub;
 class AndroidApiSkeleton {
 public:
     AndroidApiSkeleton();
     ~AndroidApiSkeleton();
 
+    // Receives the clipboard updates the host pushes. Has to be set before
+    // any event is processed.
+    void set_platform_api_stub(const std::shared_ptr<PlatformApiStub> &platform_api_stub);
+
     void launch_application(anbox::protobuf::bridge::LaunchApplication const *request,
                             anbox::protobuf::rpc::Void *response,
                             google::protobuf::Closure *done);
@@ -67,13 +82,40 @@ public:
                      anbox::protobuf::rpc::Void *response,
                      google::protobuf::Closure *done);
 
+    // Asks the applications to trim their memory according to the memory
+    // pressure on the host. Returns right away, the work is done on a
+    // worker thread which is stopped on destruction.
+    void handle_memory_pressure(anbox::protobuf::bridge::MemoryPressureEvent const &event);
+
+    // Keeps the host clipboard the host sent us so Android's reads don't
+    // have to ask for it.
+    void handle_clipboard_update(anbox::protobuf::bridge::ClipboardData const &data);
+
 private:
     void wait_for_process(core::posix::ChildProcess &process,
                           anbox::protobuf::rpc::Void *response);
 
-    void connect_services();
+    // Connects to the activity manager if not done yet. Returns a null
+    // pointer if it is not available.
+    android::sp<android::BpActivityManager> activity_manager();
 
+    void run_trim_worker();
+    void trim_memory(int level);
+
+    std::shared_ptr<PlatformApiStub> platform_api_stub_;
+
+    std::mutex services_mutex_;
     android::sp<android::BpActivityManager> activity_manager_;
+
+    std::mutex trim_mutex_;
+    std::condition_variable trim_changed_;
+    int pending_trim_level_ = -1;
+    bool stopping_ = false;
+    std::thread trim_worker_;
+    // Level every application process was trimmed to already so that
+    // repeated events only reach processes started meanwhile. Only used
+    // by the worker.
+    std::map<pid_t, int> trimmed_processes_;
 };
 } // namespace anbox
 
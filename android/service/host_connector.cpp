@@ -25,6 +25,14 @@
 
 #include <functional>
 #include <array>
+#include <chrono>
+
+#define LOG_TAG "Anboxd"
+#include <cutils/log.h>
+
+namespace {
+const std::chrono::milliseconds reconnect_interval{500};
+}
 
 namespace anbox {
 HostConnector::HostConnector() :
@@ -35,6 +43,7 @@ HostConnector::HostConnector() :
     rpc_channel_(std::make_shared<rpc::Channel>(pending_calls_, socket_)),
     platform_api_stub_(std::make_shared<PlatformApiStub>(rpc_channel_)),
     running_(false) {
+    android_api_skeleton_->set_platform_api_stub(platform_api_stub_);
 }
 
 HostConnector::~HostConnector() {
@@ -59,8 +68,14 @@ void HostConnector::main_loop() {
     while (running_) {
         std::array<std::uint8_t, 8192> buffer;
         const auto bytes_read = socket_->read_all(buffer.data(), buffer.size());
-        if (bytes_read == 0)
-            break;
+        if (bytes_read <= 0) {
+            // The host side went away, for example because the session
+            // manager got restarted. We keep running and wait for a new one
+            // to show up so Android doesn't have to be booted again.
+            if (!reconnect())
+                break;
+            continue;
+        }
 
         // MessageProcessor wants an vector so give it what it wants until
         // we refactor this.
@@ -73,6 +88,28 @@ void HostConnector::main_loop() {
     }
 }
 
+bool HostConnector::reconnect() {
+    ALOGI("Lost connection to host, waiting for it to come back");
+
+    // Nobody will answer calls we sent to the old host.
+    pending_calls_->force_completion();
+
+    while (running_) {
+        std::this_thread::sleep_for(reconnect_interval);
+        if (!socket_->reconnect())
+            continue;
+
+        // Drop whatever was left over from a partially received message.
+        message_processor_ = std::make_shared<MessageProcessor>(socket_, pending_calls_, android_api_skeleton_);
+
+        ALOGI("Reconnected to host");
+        platform_api_stub_->resync();
+        return true;
+    }
+
+    return false;
+}
+
 std::shared_ptr<anbox::PlatformApiStub> HostConnector::platform_api_stub() const {
     return platform_api_stub_;
 }
@@ -43,6 +43,7 @@ public:
 
 private:
     void main_loop();
+    bool reconnect();
 
     std::shared_ptr<LocalSocketConnection> socket_;
     std::shared_ptr<rpc::PendingCallCache> pending_calls_;
@@ -18,6 +18,7 @@
 #ifndef ANBOX_ANDROID_LOCAL_SOCKET_CONNECTION_H_
 #define ANBOX_ANDROID_LOCAL_SOCKET_CONNECTION_H_
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -30,11 +31,20 @@ public:
     LocalSocketConnection(const std::string &path);
     ~LocalSocketConnection();
 
+    // Replaces the current connection with a new one to the same path.
+    // Returns false if the server isn't reachable.
+    bool reconnect();
+
     ssize_t read_all(std::uint8_t *buffer, const size_t &size);
     void send(char const* data, size_t length) override;
     ssize_t send_raw(char const* data, size_t length) override;
 
 private:
+    Fd connect_socket() const;
+    Fd fd() const;
+
+    std::string path_;
+    mutable std::mutex fd_lock_;
     Fd fd_;
 };
 } // namespace anbox
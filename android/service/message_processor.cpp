@@ -25,6 +25,8 @@
 #include "anbox_rpc.pb.h"
 #include "anbox_bridge.pb.h"
 
+#include <cutils/log.h>
+
 namespace anbox {
 MessageProcessor::MessageProcessor(const std::shared_ptr<network::MessageSender> &sender,
                                    const std::shared_ptr<rpc::PendingCallCache> &pending_calls,
@@ -47,6 +49,17 @@ void MessageProcessor::dispatch(rpc::Invocation const& invocation) {
     invoke(this, platform_api_.get(), &AndroidApiSkeleton::resize_task, invocation);
 }
 
-void MessageProcessor::process_event_sequence(const std::string&) {
+void MessageProcessor::process_event_sequence(const std::string &event) {
+    anbox::protobuf::bridge::EventSequence seq;
+    if (!seq.ParseFromString(event)) {
+        ALOGW("Failed to parse events from host");
+        return;
+    }
+
+    if (seq.has_memory_pressure())
+        platform_api_->handle_memory_pressure(seq.memory_pressure());
+
+    if (seq.has_clipboard_update())
+        platform_api_->handle_clipboard_update(seq.clipboard_update());
 }
 } // namespace network
@@ -21,6 +21,7 @@
 #include "anbox_rpc.pb.h"
 #include "anbox_bridge.pb.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include <sys/stat.h>
@@ -38,19 +39,124 @@ PlatformApiStub::PlatformApiStub(const std::shared_ptr<rpc::Channel> &rpc_channe
 }
 
 void PlatformApiStub::boot_finished() {
-    protobuf::bridge::EventSequence seq;
-    auto event = seq.mutable_boot_finished();
+    bool first_boot_done = false;
 
     struct stat st;
     if (stat(first_boot_marker_path, &st) != 0) {
-      event->set_first_boot_done(true);
+      first_boot_done = true;
       std::ofstream marker(first_boot_marker_path);
     }
 
-    rpc_channel_->send_event(seq);
+    std::lock_guard<decltype(state_mutex_)> lock(state_mutex_);
+    boot_finished_ = true;
+    send_boot_finished(first_boot_done);
 }
 
 void PlatformApiStub::update_window_state(const WindowStateUpdate &state) {
+    std::lock_guard<decltype(state_mutex_)> lock(state_mutex_);
+
+    auto same_window = [](const WindowStateUpdate::Window &a, const WindowStateUpdate::Window &b) {
+        return a.display_id == b.display_id &&
+               a.task_id == b.task_id &&
+               a.package_name == b.package_name;
+    };
+
+    for (const auto &window : state.updated_windows) {
+        auto known = std::find_if(windows_.begin(), windows_.end(),
+                                  [&](const WindowStateUpdate::Window &w) { return same_window(w, window); });
+        if (known != windows_.end())
+            *known = window;
+        else
+            windows_.push_back(window);
+    }
+
+    for (const auto &window : state.removed_windows) {
+        windows_.erase(std::remove_if(windows_.begin(), windows_.end(),
+                                      [&](const WindowStateUpdate::Window &w) {
+                                          return w.task_id == window.task_id &&
+                                                 w.package_name == window.package_name;
+                                      }),
+                       windows_.end());
+    }
+
+    send_window_state(state);
+}
+
+void PlatformApiStub::update_application_list(const ApplicationListUpdate &update) {
+    std::lock_guard<decltype(state_mutex_)> lock(state_mutex_);
+
+    for (const auto &a : update.applications) {
+        auto &known = applications_[a.package];
+        // Icons are only sent when they changed so keep the one we have.
+        auto icon = std::move(known.icon);
+        known = a;
+        if (known.icon.empty())
+            known.icon = std::move(icon);
+    }
+
+    for (const auto &package : update.removed_applications)
+        applications_.erase(package);
+
+    send_application_list(update);
+}
+
+void PlatformApiStub::resync() {
+    {
+        // The new host pushes its own clipboard.
+        std::lock_guard<decltype(mutex_)> lock(mutex_);
+        host_clipboard_known_ = false;
+    }
+
+    std::lock_guard<decltype(state_mutex_)> lock(state_mutex_);
+
+    // Before Android finished booting the host gets everything through
+    // the regular updates.
+    if (!boot_finished_)
+        return;
+
+    ALOGI("Resyncing state with host (%zu windows, %zu applications)",
+          windows_.size(), applications_.size());
+
+    send_boot_finished(false);
+
+    WindowStateUpdate state;
+    state.updated_windows = windows_;
+    send_window_state(state);
+
+    // Same as PlatformService does: updates with icons are sent one by one
+    // to not overflow protobuf.
+    ApplicationListUpdate update;
+    for (const auto &a : applications_) {
+        if (a.second.icon.size() > 0) {
+            ApplicationListUpdate with_icon_update;
+            with_icon_update.applications.push_back(a.second);
+            send_application_list(with_icon_update);
+        } else {
+            update.applications.push_back(a.second);
+        }
+    }
+    send_application_list(update);
+}
+
+void PlatformApiStub::send_event(const protobuf::bridge::EventSequence &seq) {
+    try {
+        rpc_channel_->send_event(seq);
+    } catch (std::exception &err) {
+        // We're not connected to the host at the moment. Everything it needs
+        // is sent again with resync() once it is back.
+        ALOGW("Failed to send event to host: %s", err.what());
+    }
+}
+
+void PlatformApiStub::send_boot_finished(bool first_boot_done) {
+    protobuf::bridge::EventSequence seq;
+    auto event = seq.mutable_boot_finished();
+    if (first_boot_done)
+        event->set_first_boot_done(true);
+    send_event(seq);
+}
+
+void PlatformApiStub::send_window_state(const WindowStateUpdate &state) {
     protobuf::bridge::EventSequence seq;
     auto event = seq.mutable_window_state_update();
 
@@ -76,10 +182,10 @@ void PlatformApiStub::update_window_state(const WindowStateUpdate &state) {
         convert_window(window, w);
     }
 
-    rpc_channel_->send_event(seq);
+    send_event(seq);
 }
 
-void PlatformApiStub::update_application_list(const ApplicationListUpdate &update) {
+void PlatformApiStub::send_application_list(const ApplicationListUpdate &update) {
     protobuf::bridge::EventSequence seq;
     auto event = seq.mutable_application_list_update();
 
@@ -109,7 +215,7 @@ void PlatformApiStub::update_application_list(const ApplicationListUpdate &updat
       app->set_package(package);
     }
 
-    rpc_channel_->send_event(seq);
+    send_event(seq);
 }
 
 void PlatformApiStub::on_clipboard_data_set(Request<protobuf::rpc::Void> *request) {
@@ -134,6 +240,10 @@ void PlatformApiStub::set_clipboard_data(const ClipboardData &data) {
     c->wh.wait_for_all();
 
     if (c->response->has_error()) throw std::runtime_error(c->response->error());
+
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    if (host_clipboard_known_)
+        host_clipboard_ = data;
 }
 
 void PlatformApiStub::on_clipboard_data_get(Request<protobuf::bridge::ClipboardData> *request) {
@@ -141,6 +251,12 @@ void PlatformApiStub::on_clipboard_data_get(Request<protobuf::bridge::ClipboardD
 }
 
 PlatformApiStub::ClipboardData PlatformApiStub::get_clipboard_data() {
+    {
+        std::lock_guard<decltype(mutex_)> lock(mutex_);
+        if (host_clipboard_known_)
+            return host_clipboard_;
+    }
+
     auto c = std::make_shared<Request<protobuf::bridge::ClipboardData>>();
 
     protobuf::rpc::Void message;
@@ -162,4 +278,10 @@ PlatformApiStub::ClipboardData PlatformApiStub::get_clipboard_data() {
 
     return ClipboardData{c->response->text()};
 }
+
+void PlatformApiStub::host_clipboard_changed(const ClipboardData &data) {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    host_clipboard_known_ = true;
+    host_clipboard_ = data;
+}
 } // namespace anbox
@@ -20,7 +20,9 @@
 
 #include "anbox/common/wait_handle.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -31,6 +33,7 @@ class Void;
 } // namespace rpc
 namespace bridge {
 class ClipboardData;
+class EventSequence;
 } // namespace bridge
 } // namespace protobuf
 namespace rpc {
@@ -89,9 +92,22 @@ public:
     };
 
     void set_clipboard_data(const ClipboardData &data);
+    // Answered without asking the host once it told us its clipboard.
     ClipboardData get_clipboard_data();
 
+    // Stores the clipboard the host pushed to us.
+    void host_clipboard_changed(const ClipboardData &data);
+
+    // Sends the complete state we know about again. Used after we got
+    // connected to a new host which starts with no knowledge about us.
+    void resync();
+
 private:
+    void send_event(const protobuf::bridge::EventSequence &seq);
+    void send_boot_finished(bool first_boot_done);
+    void send_window_state(const WindowStateUpdate &state);
+    void send_application_list(const ApplicationListUpdate &update);
+
     template<typename Response>
     struct Request {
         Request() : response(std::make_shared<Response>()), success(true) { }
@@ -107,6 +123,18 @@ private:
     std::shared_ptr<rpc::Channel> rpc_channel_;
 
     ClipboardData received_clipboard_data_;
+    // What the host last told us about its clipboard. Forgotten when we
+    // connect to a new host.
+    bool host_clipboard_known_ = false;
+    ClipboardData host_clipboard_;
+
+    // Everything the host has to know about us after it reconnected. Also
+    // serializes sending of events so a resync can't interleave with an
+    // update coming in at the same time.
+    std::mutex state_mutex_;
+    bool boot_finished_ = false;
+    std::vector<WindowStateUpdate::Window> windows_;
+    std::map<std::string, ApplicationListUpdate::Application> applications_;
 };
 } // namespace anbox
 
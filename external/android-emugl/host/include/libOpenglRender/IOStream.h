@@ -77,9 +77,13 @@ private:
 // When a client opens a connection to the renderer, it should
 // send unsigned int value indicating the "clientFlags".
 // The following are the bitmask of the clientFlags.
-// currently only one bit is used which flags the server
-// it should exit.
+// IOSTREAM_CLIENT_EXIT_SERVER flags the server it should exit.
+// IOSTREAM_CLIENT_PROCESS_SENTINEL asks the server to register the
+// client's process and to reply with its id as an unsigned int. Nothing
+// else is sent over such a connection, the client keeps it open until
+// the process dies.
 //
 #define IOSTREAM_CLIENT_EXIT_SERVER      1
+#define IOSTREAM_CLIENT_PROCESS_SENTINEL 2
 
 #endif
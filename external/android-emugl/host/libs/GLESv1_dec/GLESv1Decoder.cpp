@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <mutex>
+
 static inline void* SafePointerFromUInt(GLuint value) {
   return (void*)(uintptr_t)value;
 }
@@ -41,9 +43,30 @@ GLESv1Decoder::~GLESv1Decoder()
 }
 
 
+// Resolving every entry point by name takes much longer than copying the
+// table and every connection needs one, so the first decoder fills this
+// process wide table and all later ones copy it.
+static std::mutex s_dispatchLock;
+static gles1_server_context_t s_dispatch;
+static GLESv1Decoder::get_proc_func_t s_dispatchGetProcFunc = NULL;
+static void *s_dispatchGetProcFuncData = NULL;
+
 int GLESv1Decoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
 {
-    this->initDispatchByName(getProcFunc, getProcFuncData);
+    {
+        std::lock_guard<std::mutex> lock(s_dispatchLock);
+        if (s_dispatchGetProcFunc == NULL) {
+            s_dispatch.initDispatchByName(getProcFunc, getProcFuncData);
+            s_dispatchGetProcFunc = getProcFunc;
+            s_dispatchGetProcFuncData = getProcFuncData;
+        }
+        if (s_dispatchGetProcFunc == getProcFunc &&
+                s_dispatchGetProcFuncData == getProcFuncData) {
+            static_cast<gles1_server_context_t&>(*this) = s_dispatch;
+        } else {
+            this->initDispatchByName(getProcFunc, getProcFuncData);
+        }
+    }
 
     glGetCompressedTextureFormats = s_glGetCompressedTextureFormats;
     glVertexPointerOffset = s_glVertexPointerOffset;
@@ -127,10 +150,27 @@ void GLESv1Decoder::s_glMatrixIndexPointerOffset(void * self, GLint size, GLenum
         return; \
     }
 
+// Streams the client array data into the context's buffer ring and sets
+// up the pointer with an offset into it. Falls through to the copying
+// path below when the data can't be streamed. The encoder unbinds
+// GL_ARRAY_BUFFER before sending client array data, so that's the
+// binding we restore.
+#define STREAM_POINTER_DATA(setPointer)    \
+    do { \
+        GLuint offset = 0; \
+        if (ctx->m_contextData != NULL && \
+            ctx->m_contextData->streamPointerData(ctx, GL_ARRAY_BUFFER, data, datalen, &offset)) { \
+            setPointer; \
+            ctx->glBindBuffer(GL_ARRAY_BUFFER, 0); \
+            return; \
+        } \
+    } while (0)
+
 void GLESv1Decoder::s_glVertexPointerData(void *self, GLint size, GLenum type, GLsizei stride, void *data, GLuint datalen)
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
 
+    STREAM_POINTER_DATA(ctx->glVertexPointer(size, type, 0, SafePointerFromUInt(offset)));
     STORE_POINTER_DATA_OR_ABORT(GLDecoderContextData::VERTEX_LOCATION);
 
     ctx->glVertexPointer(size, type, 0, ctx->m_contextData->pointerData(GLDecoderContextData::VERTEX_LOCATION));
@@ -140,6 +180,7 @@ void GLESv1Decoder::s_glColorPointerData(void *self, GLint size, GLenum type, GL
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
 
+    STREAM_POINTER_DATA(ctx->glColorPointer(size, type, 0, SafePointerFromUInt(offset)));
     STORE_POINTER_DATA_OR_ABORT(GLDecoderContextData::COLOR_LOCATION);
 
     ctx->glColorPointer(size, type, 0, ctx->m_contextData->pointerData(GLDecoderContextData::COLOR_LOCATION));
@@ -148,6 +189,7 @@ void GLESv1Decoder::s_glColorPointerData(void *self, GLint size, GLenum type, GL
 void GLESv1Decoder::s_glTexCoordPointerData(void *self, GLint unit, GLint size, GLenum type, GLsizei stride, void *data, GLuint datalen)
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    STREAM_POINTER_DATA(ctx->glTexCoordPointer(size, type, 0, SafePointerFromUInt(offset)));
     STORE_POINTER_DATA_OR_ABORT((GLDecoderContextData::PointerDataLocation)
                                 (GLDecoderContextData::TEXCOORD0_LOCATION + unit));
 
@@ -160,6 +202,7 @@ void GLESv1Decoder::s_glNormalPointerData(void *self, GLenum type, GLsizei strid
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
 
+    STREAM_POINTER_DATA(ctx->glNormalPointer(type, 0, SafePointerFromUInt(offset)));
     STORE_POINTER_DATA_OR_ABORT(GLDecoderContextData::NORMAL_LOCATION);
 
     ctx->glNormalPointer(type, 0, ctx->m_contextData->pointerData(GLDecoderContextData::NORMAL_LOCATION));
@@ -169,6 +212,7 @@ void GLESv1Decoder::s_glPointSizePointerData(void *self, GLenum type, GLsizei st
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
 
+    STREAM_POINTER_DATA(ctx->glPointSizePointerOES(type, 0, SafePointerFromUInt(offset)));
     STORE_POINTER_DATA_OR_ABORT(GLDecoderContextData::POINTSIZE_LOCATION);
 
     ctx->glPointSizePointerOES(type, 0, ctx->m_contextData->pointerData(GLDecoderContextData::POINTSIZE_LOCATION));
@@ -178,6 +222,7 @@ void GLESv1Decoder::s_glWeightPointerData(void * self, GLint size, GLenum type,
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
 
+    STREAM_POINTER_DATA(ctx->glWeightPointerOES(size, type, 0, SafePointerFromUInt(offset)));
     STORE_POINTER_DATA_OR_ABORT(GLDecoderContextData::WEIGHT_LOCATION);
 
     ctx->glWeightPointerOES(size, type, 0, ctx->m_contextData->pointerData(GLDecoderContextData::WEIGHT_LOCATION));
@@ -187,6 +232,7 @@ void GLESv1Decoder::s_glMatrixIndexPointerData(void * self, GLint size, GLenum t
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
 
+    STREAM_POINTER_DATA(ctx->glMatrixIndexPointerOES(size, type, 0, SafePointerFromUInt(offset)));
     STORE_POINTER_DATA_OR_ABORT(GLDecoderContextData::MATRIXINDEX_LOCATION);
 
     ctx->glMatrixIndexPointerOES(size, type, 0, ctx->m_contextData->pointerData(GLDecoderContextData::MATRIXINDEX_LOCATION));
@@ -201,6 +247,14 @@ void GLESv1Decoder::s_glDrawElementsOffset(void *self, GLenum mode, GLsizei coun
 void GLESv1Decoder::s_glDrawElementsData(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen)
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    GLuint offset = 0;
+    if (ctx->m_contextData != NULL &&
+        ctx->m_contextData->streamPointerData(ctx, GL_ELEMENT_ARRAY_BUFFER, data, datalen, &offset)) {
+        ctx->glDrawElements(mode, count, type, SafePointerFromUInt(offset));
+        // Immediate indices are only sent with no index buffer bound.
+        ctx->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        return;
+    }
     ctx->glDrawElements(mode, count, type, data);
 }
 
@@ -28,6 +28,8 @@ public:
 
     GLESv1Decoder();
     ~GLESv1Decoder();
+    // Entry points are only resolved by name the first time, later calls
+    // with the same lookup function copy the table resolved then.
     int initGL(get_proc_func_t getProcFunc, void *getProcFuncData);
     void setContextData(GLDecoderContextData *contextData) { m_contextData = contextData; }
 
@@ -20,6 +20,8 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+#include <mutex>
+
 static inline void* SafePointerFromUInt(GLuint value) {
   return (void*)(uintptr_t)value;
 }
@@ -53,9 +55,30 @@ void *GLESv2Decoder::s_getProc(const char *name, void *userData)
     return func;
 }
 
+// Resolving every entry point by name takes much longer than copying the
+// table and every connection needs one, so the first decoder fills this
+// process wide table and all later ones copy it.
+static std::mutex s_dispatchLock;
+static gles2_server_context_t s_dispatch;
+static GLESv2Decoder::get_proc_func_t s_dispatchGetProcFunc = NULL;
+static void *s_dispatchGetProcFuncData = NULL;
+
 int GLESv2Decoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
 {
-    this->initDispatchByName(getProcFunc, getProcFuncData);
+    {
+        std::lock_guard<std::mutex> lock(s_dispatchLock);
+        if (s_dispatchGetProcFunc == NULL) {
+            s_dispatch.initDispatchByName(getProcFunc, getProcFuncData);
+            s_dispatchGetProcFunc = getProcFunc;
+            s_dispatchGetProcFuncData = getProcFuncData;
+        }
+        if (s_dispatchGetProcFunc == getProcFunc &&
+                s_dispatchGetProcFuncData == getProcFuncData) {
+            static_cast<gles2_server_context_t&>(*this) = s_dispatch;
+        } else {
+            this->initDispatchByName(getProcFunc, getProcFuncData);
+        }
+    }
 
     glGetCompressedTextureFormats = s_glGetCompressedTextureFormats;
     glVertexAttribPointerData = s_glVertexAttribPointerData;
@@ -94,9 +117,17 @@ void GLESv2Decoder::s_glVertexAttribPointerData(void *self, GLuint indx, GLint s
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *) self;
     if (ctx->m_contextData != NULL) {
-        ctx->m_contextData->storePointerData(indx, data, datalen);
         // note - the stride of the data is always zero when it comes out of the codec.
         // See gl2.attrib for the packing function call.
+        GLuint offset = 0;
+        if (ctx->m_contextData->streamPointerData(ctx, GL_ARRAY_BUFFER, data, datalen, &offset)) {
+            ctx->glVertexAttribPointer(indx, size, type, normalized, 0, SafePointerFromUInt(offset));
+            // The encoder unbinds GL_ARRAY_BUFFER before sending client
+            // array data, so that's the binding we have to restore.
+            ctx->glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return;
+        }
+        ctx->m_contextData->storePointerData(indx, data, datalen);
         ctx->glVertexAttribPointer(indx, size, type, normalized, 0, ctx->m_contextData->pointerData(indx));
     }
 }
@@ -112,6 +143,14 @@ void GLESv2Decoder::s_glVertexAttribPointerOffset(void *self, GLuint indx, GLint
 void GLESv2Decoder::s_glDrawElementsData(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen)
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    GLuint offset = 0;
+    if (ctx->m_contextData != NULL &&
+        ctx->m_contextData->streamPointerData(ctx, GL_ELEMENT_ARRAY_BUFFER, data, datalen, &offset)) {
+        ctx->glDrawElements(mode, count, type, SafePointerFromUInt(offset));
+        // Immediate indices are only sent with no index buffer bound.
+        ctx->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        return;
+    }
     ctx->glDrawElements(mode, count, type, data);
 }
 
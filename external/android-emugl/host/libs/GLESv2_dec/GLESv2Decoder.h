@@ -27,6 +27,8 @@ public:
     typedef void *(*get_proc_func_t)(const char *name, void *userData);
     GLESv2Decoder();
     ~GLESv2Decoder();
+    // Entry points are only resolved by name the first time, later calls
+    // with the same lookup function copy the table resolved then.
     int initGL(get_proc_func_t getProcFunc, void *getProcFuncData);
     void setContextData(GLDecoderContextData *contextData) { m_contextData = contextData; }
 private:
@@ -15,12 +15,18 @@
 */
 #pragma once
 
+#include "gl_base_types.h"
+
 #include <vector>
 #include <string>
 
 #include <assert.h>
 #include <string.h>
 
+#ifndef GL_DYNAMIC_DRAW
+#define GL_DYNAMIC_DRAW                   0x88E8
+#endif
+
 // Convenient class used to hold the common context data shared
 // by both the GLESv1 and GLESv2 decoders. This corresponds to
 // vertex attribute buffers.
@@ -53,6 +59,74 @@ public:
         mPointerData.resize(mNumLocations);
     }
 
+    // Enable or disable streaming client array data through buffer
+    // objects. When disabled streamPointerData() always fails and the
+    // decoders fall back to sourcing draws from decoder memory.
+    void setStreamingEnabled(bool enabled) { mStreamingEnabled = enabled; }
+
+    // Upload |len| bytes from |data| into the ring of host buffer objects
+    // owned by this context and leave the used buffer bound to |target|.
+    // On success |offset| is the location of the data inside that buffer
+    // and can be passed to the GL instead of a client pointer. Returns
+    // false if the data is too large to be streamed, in which case the
+    // caller has to use storePointerData() instead. |gl| is the decoder
+    // dispatch and the context this data belongs to must be current.
+    template <typename Dispatch>
+    bool streamPointerData(Dispatch* gl, GLenum target, const void* data,
+                           size_t len, GLuint* offset) {
+        if (!mStreamingEnabled || len == 0 || len > kMaxStreamChunk) {
+            return false;
+        }
+
+        size_t start = (mStreamOffset + kStreamAlignment - 1) &
+                       ~(kStreamAlignment - 1);
+        if (mStreamBuffers[mStreamIndex] == 0 || start + len > kStreamBufferSize) {
+            // Move on to the next buffer and orphan its storage so we
+            // never have to wait for draws still reading from it.
+            if (mStreamBuffers[mStreamIndex] != 0) {
+                mStreamIndex = (mStreamIndex + 1) % kStreamBufferCount;
+            }
+            if (mStreamBuffers[mStreamIndex] == 0) {
+                gl->glGenBuffers(1, &mStreamBuffers[mStreamIndex]);
+            }
+            gl->glBindBuffer(target, mStreamBuffers[mStreamIndex]);
+            gl->glBufferData(target, kStreamBufferSize, NULL, GL_DYNAMIC_DRAW);
+            start = 0;
+        } else {
+            gl->glBindBuffer(target, mStreamBuffers[mStreamIndex]);
+        }
+
+        gl->glBufferSubData(target, start, len, data);
+        mStreamOffset = start + len;
+        *offset = start;
+        return true;
+    }
+
+    // Delete the ring of buffer objects, the next streamed draw creates
+    // it again. |gl| is a dispatch and the context this data belongs to
+    // must be current.
+    template <typename Dispatch>
+    void releaseStreamBuffers(Dispatch* gl) {
+        for (size_t n = 0; n < kStreamBufferCount; n++) {
+            if (mStreamBuffers[n] != 0) {
+                gl->glDeleteBuffers(1, &mStreamBuffers[n]);
+                mStreamBuffers[n] = 0;
+            }
+        }
+        mStreamIndex = 0;
+        mStreamOffset = 0;
+    }
+
+    // Return true if any of the ring buffers was created.
+    bool hasStreamBuffers() const {
+        for (size_t n = 0; n < kStreamBufferCount; n++) {
+            if (mStreamBuffers[n] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     // Store |len| bytes from |data| into the buffer associated with
     // vertex attribute index |loc|.
     void storePointerData(unsigned int loc, void *data, size_t len) {
@@ -77,6 +151,24 @@ public:
 private:
     static const int kMaxVertexAttributes = 64;
 
+    // A single draw streams at most one chunk per attribute plus its
+    // indices. Keeping that below the size of all but one ring buffer
+    // guarantees a draw never wraps around onto its own data.
+    static const size_t kStreamBufferCount = 4;
+    static const size_t kStreamBufferSize = 512 * 1024;
+    static const size_t kMaxStreamChunk = 16 * 1024;
+    static const size_t kStreamAlignment = 16;
+    static_assert((kMaxVertexAttributes + 1) * (kMaxStreamChunk + kStreamAlignment) <=
+                  (kStreamBufferCount - 1) * (kStreamBufferSize - kMaxStreamChunk),
+                  "a single draw must not wrap the stream ring");
+
     std::vector<std::string> mPointerData;
     unsigned mNumLocations = 0;
+
+    // The ring buffers belong to the context's share group which can
+    // outlive the context, its RenderContext releases them.
+    bool mStreamingEnabled = true;
+    GLuint mStreamBuffers[kStreamBufferCount] = {};
+    size_t mStreamIndex = 0;
+    size_t mStreamOffset = 0;
 };
@@ -20,12 +20,29 @@
 #include "anbox/system_configuration.h"
 #include "anbox/logger.h"
 
+namespace {
+std::size_t memory_size(const anbox::application::Database::Item &item) {
+  const auto &intent = item.launch_intent;
+  auto size = item.name.capacity() + item.package.capacity() + item.icon.capacity() +
+              intent.action.capacity() + intent.uri.capacity() + intent.type.capacity() +
+              intent.package.capacity() + intent.component.capacity();
+  for (const auto &category : intent.categories)
+    size += category.capacity();
+  return size;
+}
+}  // namespace
+
 namespace anbox {
 namespace application {
 const Database::Item Database::Unknown{};
 
 Database::Database() :
-  storage_(std::make_shared<LauncherStorage>(SystemConfiguration::instance().application_item_dir())) {}
+  Database(SystemConfiguration::instance().application_item_dir()) {}
+
+Database::Database(const std::string &storage_dir) :
+  storage_(std::make_shared<LauncherStorage>(storage_dir)),
+  account_(common::MemoryAccounting::Subsystem::ApplicationDatabase,
+           common::MemoryAccounting::next_owner("applications")) {}
 
 Database::~Database() {}
 
@@ -35,11 +52,16 @@ void Database::store_or_update(const Item &item) {
     done_reset = true;
   }
   storage_->add_or_update(item);
-  items_[item.package] = item;
+
+  auto &stored = items_[item.package];
+  account_.remove(memory_size(stored));
+  stored = item;
 
   // We don't need to store the icon data anymore at this point as the
   // launcher is already stored it on the disk.
-  items_[item.package].icon.clear();
+  stored.icon.clear();
+  stored.icon.shrink_to_fit();
+  account_.add(memory_size(stored));
 }
 
 void Database::remove(const Item &item) {
@@ -47,6 +69,7 @@ void Database::remove(const Item &item) {
   if (iter == items_.end())
     return;
   storage_->remove(item);
+  account_.remove(memory_size(iter->second));
   items_.erase(iter);
 }
 
@@ -19,6 +19,7 @@
 #define ANBOX_APPLICATION_DATABASE_H_
 
 #include "anbox/android/intent.h"
+#include "anbox/common/memory_accounting.h"
 
 #include <string>
 #include <map>
@@ -41,6 +42,9 @@ class Database {
   static const Item Unknown;
 
   Database();
+  // Stores launchers in |storage_dir| instead of the users application
+  // directory.
+  explicit Database(const std::string &storage_dir);
   ~Database();
 
   void store_or_update(const Item &item);
@@ -52,6 +56,7 @@ class Database {
   std::shared_ptr<LauncherStorage> storage_;
   std::map<std::string,Item> items_;
   bool done_reset = false;
+  common::MemoryAccounting::Account account_;
 };
 }  // namespace application
 }  // namespace anbox
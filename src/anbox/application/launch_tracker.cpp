@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/application/launch_tracker.h"
+#include "anbox/logger.h"
+
+#include <algorithm>
+#include <ostream>
+
+namespace {
+std::chrono::microseconds since(const anbox::application::LaunchTracker::Clock::time_point &start,
+                                const anbox::application::LaunchTracker::Clock::time_point &end) {
+  // A layer for an already existing window can be posted before the
+  // launch was even requested.
+  if (end < start)
+    return std::chrono::microseconds{0};
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+}
+
+long long to_ms(const std::chrono::microseconds &us) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(us).count();
+}
+}  // namespace
+
+namespace anbox {
+namespace application {
+constexpr const std::size_t LaunchTracker::max_reports;
+constexpr const std::chrono::seconds LaunchTracker::launch_timeout;
+
+LaunchTracker::LaunchTracker() {}
+
+LaunchTracker::~LaunchTracker() {}
+
+LaunchTracker::Id LaunchTracker::launch_requested(const std::string &package) {
+  std::vector<Report> finished;
+  Id id = 0;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    const auto now = Clock::now();
+    expire(now, finished);
+
+    PendingLaunch launch;
+    launch.report.id = id = next_id_++;
+    launch.report.package = package;
+    launch.requested = now;
+    pending_.push_back(launch);
+    num_pending_ = pending_.size();
+  }
+  report_finished(finished);
+  return id;
+}
+
+void LaunchTracker::intent_delivered(const Id &id, const std::string &error) {
+  std::vector<Report> finished;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    const auto now = Clock::now();
+    auto iter = std::find_if(pending_.begin(), pending_.end(), [&](const PendingLaunch &launch) {
+      return launch.report.id == id;
+    });
+    if (iter != pending_.end()) {
+      iter->report.intent_delivered = since(iter->requested, now);
+      if (!error.empty())
+        finish(iter, error, finished);
+    }
+    expire(now, finished);
+  }
+  report_finished(finished);
+}
+
+void LaunchTracker::window_state_updated(const std::string &package, const wm::Task::Id &task) {
+  if (!has_pending_launches())
+    return;
+
+  std::vector<Report> finished;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    const auto now = Clock::now();
+    expire(now, finished);
+
+    // A task can only belong to a single launch.
+    if (find_pending_for_task(task))
+      return;
+
+    // Launches of the same package are assigned to tasks in the order they
+    // were requested.
+    for (auto &launch : pending_) {
+      if (launch.report.task != wm::Task::Invalid || launch.report.package != package)
+        continue;
+      launch.report.task = task;
+      launch.report.window_created = since(launch.requested, now);
+      break;
+    }
+  }
+  report_finished(finished);
+}
+
+void LaunchTracker::layer_posted(const wm::Task::Id &task, const Clock::time_point &posted) {
+  if (!has_pending_launches())
+    return;
+
+  std::vector<Report> finished;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    // Launches which never get a window would otherwise only time out with
+    // the next launch or window update and keep the composer tracking.
+    expire(posted, finished);
+
+    auto launch = find_pending_for_task(task);
+    if (launch && launch->report.first_layer_posted.count() < 0)
+      launch->report.first_layer_posted = since(launch->requested, posted);
+  }
+  report_finished(finished);
+}
+
+void LaunchTracker::frame_presented(const wm::Task::Id &task, const Clock::time_point &presented) {
+  if (!has_pending_launches())
+    return;
+
+  std::vector<Report> finished;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    expire(presented, finished);
+
+    auto iter = std::find_if(pending_.begin(), pending_.end(), [&](const PendingLaunch &launch) {
+      return launch.report.task == task && launch.report.first_layer_posted.count() >= 0;
+    });
+    if (iter != pending_.end()) {
+      iter->report.first_frame_presented = since(iter->requested, presented);
+      finish(iter, std::string{}, finished);
+    }
+  }
+  report_finished(finished);
+}
+
+std::vector<LaunchTracker::Report> LaunchTracker::reports() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return std::vector<Report>(reports_.begin(), reports_.end());
+}
+
+core::Signal<LaunchTracker::Report>& LaunchTracker::launch_finished() {
+  return launch_finished_;
+}
+
+LaunchTracker::PendingLaunch* LaunchTracker::find_pending_for_task(const wm::Task::Id &task) {
+  for (auto &launch : pending_) {
+    if (launch.report.task == task)
+      return &launch;
+  }
+  return nullptr;
+}
+
+void LaunchTracker::finish(std::deque<PendingLaunch>::iterator iter, const std::string &error,
+                           std::vector<Report> &finished) {
+  auto report = iter->report;
+  report.error = error;
+  pending_.erase(iter);
+  num_pending_ = pending_.size();
+
+  reports_.push_back(report);
+  if (reports_.size() > max_reports)
+    reports_.pop_front();
+
+  finished.push_back(report);
+}
+
+void LaunchTracker::expire(const Clock::time_point &now, std::vector<Report> &finished) {
+  while (!pending_.empty() && now - pending_.front().requested >= launch_timeout)
+    finish(pending_.begin(), "Timed out waiting for the first frame", finished);
+}
+
+void LaunchTracker::report_finished(const std::vector<Report> &finished) {
+  for (const auto &report : finished) {
+    if (report.error.empty())
+      INFO("%s", report);
+    else
+      WARNING("%s", report);
+    launch_finished_(report);
+  }
+}
+
+std::ostream& operator<<(std::ostream &out, const LaunchTracker::Report &report) {
+  out << "Launch of " << report.package;
+  if (report.task != wm::Task::Invalid)
+    out << " (task " << report.task << ")";
+
+  if (report.error.empty())
+    out << " showed its first frame after " << to_ms(report.first_frame_presented) << " ms:";
+  else
+    out << " failed: " << report.error << ";";
+
+  const std::pair<const char*, std::chrono::microseconds> phases[] = {
+    {"intent delivered", report.intent_delivered},
+    {"window created", report.window_created},
+    {"first layer posted", report.first_layer_posted},
+    {"first frame presented", report.first_frame_presented},
+  };
+  const char *separator = "";
+  for (const auto &phase : phases) {
+    out << separator << " " << phase.first << " ";
+    separator = ",";
+    if (phase.second.count() < 0)
+      out << "never";
+    else
+      out << "+" << to_ms(phase.second) << " ms";
+  }
+  return out;
+}
+}  // namespace application
+}  // namespace anbox
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_APPLICATION_LAUNCH_TRACKER_H_
+#define ANBOX_APPLICATION_LAUNCH_TRACKER_H_
+
+#include "anbox/wm/task.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <core/signal.h>
+
+namespace anbox {
+namespace application {
+// Follows application launches from the request until the first frame of
+// the launched task is on screen. Every launch goes through the following
+// phases:
+//
+//  1. The intent was delivered to Android and acknowledged.
+//  2. The window manager received window state for a task of the package.
+//  3. Android posted the first layer for that task.
+//  4. The first frame for that task was presented.
+//
+// A launch which doesn't reach the last phase within launch_timeout is
+// reported as failed.
+class LaunchTracker {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::uint64_t Id;
+
+  static constexpr const std::size_t max_reports{32};
+  static constexpr const std::chrono::seconds launch_timeout{30};
+
+  struct Report {
+    Id id = 0;
+    std::string package;
+    wm::Task::Id task = wm::Task::Invalid;
+    // Empty if the launch succeeded.
+    std::string error;
+    // Time from the launch request until each phase was reached or -1 if
+    // it never was.
+    std::chrono::microseconds intent_delivered{-1};
+    std::chrono::microseconds window_created{-1};
+    std::chrono::microseconds first_layer_posted{-1};
+    std::chrono::microseconds first_frame_presented{-1};
+  };
+
+  LaunchTracker();
+  ~LaunchTracker();
+
+  Id launch_requested(const std::string &package);
+  void intent_delivered(const Id &id, const std::string &error = std::string{});
+  void window_state_updated(const std::string &package, const wm::Task::Id &task);
+  void layer_posted(const wm::Task::Id &task, const Clock::time_point &posted);
+  void frame_presented(const wm::Task::Id &task, const Clock::time_point &presented);
+
+  // Cheap check for the composer to skip all tracking while no launch is
+  // in flight.
+  bool has_pending_launches() const { return num_pending_ > 0; }
+
+  // The most recently finished launches, oldest first.
+  std::vector<Report> reports() const;
+
+  core::Signal<Report>& launch_finished();
+
+ private:
+  struct PendingLaunch {
+    Report report;
+    Clock::time_point requested;
+  };
+
+  PendingLaunch* find_pending_for_task(const wm::Task::Id &task);
+  void finish(std::deque<PendingLaunch>::iterator iter, const std::string &error,
+              std::vector<Report> &finished);
+  void expire(const Clock::time_point &now, std::vector<Report> &finished);
+  void report_finished(const std::vector<Report> &finished);
+
+  mutable std::mutex mutex_;
+  Id next_id_ = 0;
+  std::deque<PendingLaunch> pending_;
+  std::atomic<std::size_t> num_pending_{0};
+  std::deque<Report> reports_;
+  core::Signal<Report> launch_finished_;
+};
+
+std::ostream& operator<<(std::ostream &out, const LaunchTracker::Report &report);
+}  // namespace application
+}  // namespace anbox
+
+#endif
@@ -23,6 +23,9 @@
 #include "anbox/graphics/rect.h"
 #include "anbox/wm/stack.h"
 
+#include <functional>
+#include <memory>
+#include <stdexcept>
 #include <string>
 
 #include <core/property.h>
@@ -31,10 +34,30 @@ namespace anbox {
 namespace application {
 class Manager : public DoNotCopyOrMove {
  public:
+  // Called once a launch has finished. An empty error string means the
+  // launch succeeded.
+  typedef std::function<void(const std::string &error)> LaunchCallback;
+
   virtual void launch(const android::Intent &intent,
                       const graphics::Rect &launch_bounds = graphics::Rect::Invalid,
                       const wm::Stack::Id &stack = wm::Stack::Id::Default) = 0;
 
+  // Starts a launch without blocking the caller until it has finished. The
+  // default implementation falls back to the synchronous launch and is meant
+  // to be overridden by managers which can have several launches in flight.
+  virtual void launch_async(const android::Intent &intent,
+                            const graphics::Rect &launch_bounds,
+                            const wm::Stack::Id &stack,
+                            const LaunchCallback &done) {
+    try {
+      launch(intent, launch_bounds, stack);
+    } catch (std::exception &err) {
+      done(err.what());
+      return;
+    }
+    done(std::string{});
+  }
+
   virtual core::Property<bool>& ready() = 0;
 };
 
@@ -59,6 +82,16 @@ class RestrictedManager : public Manager {
     other_->launch(intent, launch_bounds, selected_stack);
   }
 
+  void launch_async(const android::Intent &intent,
+                    const graphics::Rect &launch_bounds,
+                    const wm::Stack::Id &stack,
+                    const LaunchCallback &done) override {
+    auto selected_stack = stack;
+    if (launch_stack_ != wm::Stack::Id::Invalid)
+      selected_stack = launch_stack_;
+    other_->launch_async(intent, launch_bounds, selected_stack, done);
+  }
+
   core::Property<bool>& ready() override { return other_->ready(); }
 
  private:
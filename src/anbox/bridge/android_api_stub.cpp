@@ -16,6 +16,7 @@
  */
 
 #include "anbox/bridge/android_api_stub.h"
+#include "anbox/application/launch_tracker.h"
 #include "anbox/system_configuration.h"
 #include "anbox/logger.h"
 #include "anbox/rpc/channel.h"
@@ -35,16 +36,34 @@ constexpr const std::chrono::milliseconds default_rpc_call_timeout{30000};
 
 namespace anbox {
 namespace bridge {
-AndroidApiStub::AndroidApiStub() {}
+AndroidApiStub::AndroidApiStub() : launch_timeout(default_rpc_call_timeout) {}
 
 AndroidApiStub::~AndroidApiStub() {}
 
 void AndroidApiStub::set_rpc_channel(
     const std::shared_ptr<rpc::Channel> &channel) {
+  std::lock_guard<decltype(mutex_)> lock(mutex_);
   channel_ = channel;
 }
 
-void AndroidApiStub::reset_rpc_channel() { channel_.reset(); }
+void AndroidApiStub::reset_rpc_channel() {
+  decltype(pending_launches_) pending_launches;
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    channel_.reset();
+    pending_launches.swap(pending_launches_);
+  }
+
+  // Nobody is left who could answer these so fail them right away instead
+  // of letting the callers wait forever.
+  for (const auto &launch : pending_launches)
+    launch.second->done("Remote client disconnected");
+}
+
+void AndroidApiStub::set_launch_tracker(const std::shared_ptr<application::LaunchTracker> &tracker) {
+  std::lock_guard<decltype(mutex_)> lock(mutex_);
+  launch_tracker_ = tracker;
+}
 
 void AndroidApiStub::ensure_rpc_channel() {
   if (!channel_) throw std::runtime_error("No remote client connected");
@@ -53,16 +72,128 @@ void AndroidApiStub::ensure_rpc_channel() {
 void AndroidApiStub::launch(const android::Intent &intent,
                             const graphics::Rect &launch_bounds,
                             const wm::Stack::Id &stack) {
-  ensure_rpc_channel();
+  auto wait_handle = std::make_shared<common::WaitHandle>();
+  auto error = std::make_shared<std::string>();
 
-  auto c = std::make_shared<Request<protobuf::rpc::Void>>();
+  wait_handle->expect_result();
+
+  auto launch = start_launch(intent, launch_bounds, stack, [wait_handle, error](const std::string &err) {
+    *error = err;
+    wait_handle->result_received();
+  });
+
+  wait_handle->wait_for_pending(launch_timeout);
+  if (!wait_handle->has_result()) {
+    // Nobody waits for the answer anymore so don't keep the launch around
+    // until the channel goes away.
+    abandon_launch(launch);
+    throw std::runtime_error("RPC call timed out");
+  }
+
+  if (!error->empty()) throw std::runtime_error(*error);
+}
+
+void AndroidApiStub::launch_async(const android::Intent &intent,
+                                  const graphics::Rect &launch_bounds,
+                                  const wm::Stack::Id &stack,
+                                  const LaunchCallback &done) {
+  start_launch(intent, launch_bounds, stack, done);
+}
+
+std::shared_ptr<AndroidApiStub::PendingLaunch> AndroidApiStub::start_launch(
+    const android::Intent &intent, const graphics::Rect &launch_bounds,
+    const wm::Stack::Id &stack, const LaunchCallback &done) {
   protobuf::bridge::LaunchApplication message;
+  fill_launch_message(intent, launch_bounds, stack, message);
+
+  std::shared_ptr<application::LaunchTracker> tracker;
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    tracker = launch_tracker_;
+  }
+
+  auto launch = std::make_shared<PendingLaunch>();
+  launch->response = std::make_shared<protobuf::rpc::Void>();
+  launch->done = done;
+
+  // The tracker follows the launch from here until its first frame is on
+  // screen, the intent being delivered is only the first step.
+  if (tracker) {
+    const auto id = tracker->launch_requested(intent.package);
+    launch->done = [tracker, id, done](const std::string &error) {
+      tracker->intent_delivered(id, error);
+      done(error);
+    };
+  }
+
+  std::shared_ptr<rpc::Channel> channel;
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    channel = channel_;
+    if (channel) {
+      launch->id = next_launch_id_++;
+      pending_launches_.insert({launch->id, launch});
+    }
+  }
+
+  if (!channel) {
+    launch->done("No remote client connected");
+    return launch;
+  }
+
+  try {
+    // The closure keeps the launch and with that the response message alive
+    // until it runs, even if the launch was failed in the meantime.
+    channel->call_method(
+        "launch_application", &message, launch->response.get(),
+        google::protobuf::NewCallback(this, &AndroidApiStub::application_launched,
+                                      launch));
+  } catch (std::exception &err) {
+    {
+      std::lock_guard<decltype(mutex_)> lock(mutex_);
+      if (pending_launches_.erase(launch->id) == 0)
+        return launch;
+    }
+    launch->done(err.what());
+    return launch;
+  }
+
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    auto iter = pending_launches_.find(launch->id);
+    if (iter == pending_launches_.end())
+      return launch;
+
+    if (!launch->completed) {
+      launch->sent = true;
+      return launch;
+    }
+
+    pending_launches_.erase(iter);
+  }
+
+  finish_launch(launch);
+  return launch;
+}
 
+void AndroidApiStub::abandon_launch(const std::shared_ptr<PendingLaunch> &launch) {
   {
     std::lock_guard<decltype(mutex_)> lock(mutex_);
-    launch_wait_handle_.expect_result();
+    auto iter = pending_launches_.find(launch->id);
+    // Completed or failed in the meantime.
+    if (iter == pending_launches_.end() || iter->second != launch)
+      return;
+    pending_launches_.erase(iter);
   }
 
+  // A late answer finds no entry anymore and is dropped.
+  launch->done("RPC call timed out");
+}
+
+void AndroidApiStub::fill_launch_message(const android::Intent &intent,
+                                         const graphics::Rect &launch_bounds,
+                                         const wm::Stack::Id &stack,
+                                         protobuf::bridge::LaunchApplication &message) {
   switch (stack) {
   case wm::Stack::Id::Default:
     message.set_stack(::anbox::protobuf::bridge::LaunchApplication_Stack_DEFAULT);
@@ -79,10 +210,10 @@ void AndroidApiStub::launch(const android::Intent &intent,
 
   if (launch_bounds != graphics::Rect::Invalid) {
     auto rect = message.mutable_launch_bounds();
-    rect->set_left(launch_bounds_.left());
-    rect->set_top(launch_bounds_.top());
-    rect->set_right(launch_bounds_.right());
-    rect->set_bottom(launch_bounds_.bottom());
+    rect->set_left(launch_bounds.left());
+    rect->set_top(launch_bounds.top());
+    rect->set_right(launch_bounds.right());
+    rect->set_bottom(launch_bounds.bottom());
   }
 
   auto launch_intent = message.mutable_intent();
@@ -101,27 +232,41 @@ void AndroidApiStub::launch(const android::Intent &intent,
     auto c = launch_intent->add_categories();
     *c = category;
   }
+}
 
-  channel_->call_method(
-      "launch_application", &message, c->response.get(),
-      google::protobuf::NewCallback(this, &AndroidApiStub::application_launched,
-                                    c.get()));
-
-  launch_wait_handle_.wait_for_pending(default_rpc_call_timeout);
-  if (!launch_wait_handle_.has_result())
-    throw std::runtime_error("RPC call timed out");
-
-  if (c->response->has_error()) throw std::runtime_error(c->response->error());
+void AndroidApiStub::finish_launch(const std::shared_ptr<PendingLaunch> &launch) {
+  if (launch->response->has_error())
+    launch->done(launch->response->error());
+  else
+    launch->done(std::string{});
 }
 
 core::Property<bool>& AndroidApiStub::ready() {
   return ready_;
 }
 
-void AndroidApiStub::application_launched(
-    Request<protobuf::rpc::Void> *request) {
-  (void)request;
-  launch_wait_handle_.result_received();
+std::size_t AndroidApiStub::num_pending_launches() const {
+  std::lock_guard<decltype(mutex_)> lock(mutex_);
+  return pending_launches_.size();
+}
+
+void AndroidApiStub::application_launched(std::shared_ptr<PendingLaunch> launch) {
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    auto iter = pending_launches_.find(launch->id);
+    // Already failed because the channel went away.
+    if (iter == pending_launches_.end())
+      return;
+
+    if (!launch->sent) {
+      launch->completed = true;
+      return;
+    }
+
+    pending_launches_.erase(iter);
+  }
+
+  finish_launch(launch);
 }
 
 void AndroidApiStub::set_focused_task(const std::int32_t &id) {
@@ -219,5 +364,54 @@ void AndroidApiStub::task_resized(Request<protobuf::rpc::Void> *request) {
   (void)request;
   resize_task_handle_.result_received();
 }
+
+void AndroidApiStub::set_memory_pressure(const common::MemoryPressureLevel &level) {
+  std::shared_ptr<rpc::Channel> channel;
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    channel = channel_;
+  }
+
+  if (!channel) {
+    DEBUG("Not forwarding memory pressure as Android isn't connected");
+    return;
+  }
+
+  auto event_level = protobuf::bridge::MemoryPressureEvent::NONE;
+  switch (level) {
+  case common::MemoryPressureLevel::Moderate:
+    event_level = protobuf::bridge::MemoryPressureEvent::MODERATE;
+    break;
+  case common::MemoryPressureLevel::Low:
+    event_level = protobuf::bridge::MemoryPressureEvent::LOW;
+    break;
+  case common::MemoryPressureLevel::Critical:
+    event_level = protobuf::bridge::MemoryPressureEvent::CRITICAL;
+    break;
+  default:
+    break;
+  }
+
+  // An event as we don't want to wait for Android to answer while the
+  // host is short on memory.
+  protobuf::bridge::EventSequence seq;
+  seq.mutable_memory_pressure()->set_level(event_level);
+  channel->send_event(seq);
+}
+
+void AndroidApiStub::set_clipboard_text(const std::string &text) {
+  std::shared_ptr<rpc::Channel> channel;
+  {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    channel = channel_;
+  }
+
+  if (!channel)
+    return;
+
+  protobuf::bridge::EventSequence seq;
+  seq.mutable_clipboard_update()->set_text(text);
+  channel->send_event(seq);
+}
 }  // namespace bridge
 }  // namespace anbox
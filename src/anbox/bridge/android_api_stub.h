@@ -19,17 +19,26 @@
 #define ANBOX_BRIDGE_ANDROID_API_STUB_H_
 
 #include "anbox/application/manager.h"
+#include "anbox/common/memory_pressure.h"
 #include "anbox/common/wait_handle.h"
 #include "anbox/graphics/rect.h"
 
+#include <chrono>
+#include <map>
 #include <memory>
 #include <vector>
 
 namespace anbox {
+namespace application {
+class LaunchTracker;
+}  // namespace application
 namespace protobuf {
+namespace bridge {
+class LaunchApplication;
+}  // namespace bridge
 namespace rpc {
 class Void;
-}  // namespace bridge
+}  // namespace rpc
 }  // namespace protobuf
 namespace rpc {
 class Channel;
@@ -43,17 +52,38 @@ class AndroidApiStub : public anbox::application::Manager {
   void set_rpc_channel(const std::shared_ptr<rpc::Channel> &channel);
   void reset_rpc_channel();
 
+  void set_launch_tracker(const std::shared_ptr<application::LaunchTracker> &tracker);
+
   void set_focused_task(const std::int32_t &id);
   void remove_task(const std::int32_t &id);
   void resize_task(const std::int32_t &id, const anbox::graphics::Rect &rect,
                    const std::int32_t &resize_mode);
 
+  // Tells Android about the memory pressure on the host so that it trims
+  // its applications. Dropped when Android isn't connected.
+  void set_memory_pressure(const common::MemoryPressureLevel &level);
+
+  // Hands the host clipboard to Android so that it doesn't have to ask
+  // for it. Dropped when Android isn't connected.
+  void set_clipboard_text(const std::string &text);
+
   void launch(const android::Intent &intent,
               const graphics::Rect &launch_bounds = graphics::Rect::Invalid,
               const wm::Stack::Id &stack = wm::Stack::Id::Default) override;
 
+  void launch_async(const android::Intent &intent,
+                    const graphics::Rect &launch_bounds,
+                    const wm::Stack::Id &stack,
+                    const LaunchCallback &done) override;
+
   core::Property<bool>& ready() override;
 
+  // Number of launches still waiting for an answer from Android.
+  std::size_t num_pending_launches() const;
+
+  // How long launch() waits for Android before it gives up on a launch.
+  std::chrono::milliseconds launch_timeout;
+
  private:
   void ensure_rpc_channel();
 
@@ -64,18 +94,42 @@ class AndroidApiStub : public anbox::application::Manager {
     bool success;
   };
 
-  void application_launched(Request<protobuf::rpc::Void> *request);
+  // Every launch gets its own entry so that several of them can be in
+  // flight at the same time and each one is completed with its own result.
+  struct PendingLaunch {
+    std::uint64_t id = 0;
+    std::shared_ptr<protobuf::rpc::Void> response;
+    LaunchCallback done;
+    // Set once call_method has returned. A response which arrives before
+    // that is only recorded and reported by the launching thread.
+    bool sent = false;
+    bool completed = false;
+  };
+
+  void fill_launch_message(const android::Intent &intent,
+                           const graphics::Rect &launch_bounds,
+                           const wm::Stack::Id &stack,
+                           protobuf::bridge::LaunchApplication &message);
+  std::shared_ptr<PendingLaunch> start_launch(const android::Intent &intent,
+                                             const graphics::Rect &launch_bounds,
+                                             const wm::Stack::Id &stack,
+                                             const LaunchCallback &done);
+  void abandon_launch(const std::shared_ptr<PendingLaunch> &launch);
+  void finish_launch(const std::shared_ptr<PendingLaunch> &launch);
+
+  void application_launched(std::shared_ptr<PendingLaunch> launch);
   void focused_task_set(Request<protobuf::rpc::Void> *request);
   void task_removed(Request<protobuf::rpc::Void> *request);
   void task_resized(Request<protobuf::rpc::Void> *request);
 
   mutable std::mutex mutex_;
   std::shared_ptr<rpc::Channel> channel_;
-  common::WaitHandle launch_wait_handle_;
+  std::shared_ptr<application::LaunchTracker> launch_tracker_;
+  std::uint64_t next_launch_id_ = 0;
+  std::map<std::uint64_t, std::shared_ptr<PendingLaunch>> pending_launches_;
   common::WaitHandle set_focused_task_handle_;
   common::WaitHandle remove_task_handle_;
   common::WaitHandle resize_task_handle_;
-  graphics::Rect launch_bounds_ = graphics::Rect::Invalid;
   core::Property<bool> ready_;
 };
 }  // namespace bridge
@@ -84,16 +84,14 @@ void PlatformApiSkeleton::handle_window_state_update_event(const anbox::protobuf
   };
 
   wm::WindowState::List updated;
-  for (int n = 0; n < event.windows_size(); n++) {
-    const auto window = event.windows(n);
-    updated.push_back(convert_window_state(window));
-  }
+  updated.reserve(event.windows_size());
+  for (int n = 0; n < event.windows_size(); n++)
+    updated.push_back(convert_window_state(event.windows(n)));
 
   wm::WindowState::List removed;
-  for (int n = 0; n < event.removed_windows_size(); n++) {
-    const auto window = event.removed_windows(n);
-    removed.push_back(convert_window_state(window));
-  }
+  removed.reserve(event.removed_windows_size());
+  for (int n = 0; n < event.removed_windows_size(); n++)
+    removed.push_back(convert_window_state(event.removed_windows(n)));
 
   window_manager_->apply_window_state_update(updated, removed);
 }
@@ -102,7 +100,7 @@ void PlatformApiSkeleton::handle_application_list_update_event(const anbox::prot
   for (int n = 0; n < event.removed_applications_size(); n++) {
     application::Database::Item item;
 
-    const auto app = event.removed_applications(n);
+    const auto &app = event.removed_applications(n);
     item.package = app.package();
 
     if (item.package.empty())
@@ -114,11 +112,11 @@ void PlatformApiSkeleton::handle_application_list_update_event(const anbox::prot
   for (int n = 0; n < event.applications_size(); n++) {
     application::Database::Item item;
 
-    const auto app = event.applications(n);
+    const auto &app = event.applications(n);
     item.name = app.name();
     item.package = app.package();
 
-    const auto li = app.launch_intent();
+    const auto &li = app.launch_intent();
     item.launch_intent.action = li.action();
     item.launch_intent.uri = li.uri();
     item.launch_intent.type = li.uri();
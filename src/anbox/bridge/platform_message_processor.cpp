@@ -28,7 +28,8 @@ PlatformMessageProcessor::PlatformMessageProcessor(
     const std::shared_ptr<network::MessageSender> &sender,
     const std::shared_ptr<PlatformApiSkeleton> &server,
     const std::shared_ptr<rpc::PendingCallCache> &pending_calls)
-    : rpc::MessageProcessor(sender, pending_calls), server_(server) {}
+    : rpc::MessageProcessor(sender, pending_calls), server_(server),
+      events_(new anbox::protobuf::bridge::EventSequence) {}
 
 PlatformMessageProcessor::~PlatformMessageProcessor() {}
 
@@ -41,7 +42,7 @@ void PlatformMessageProcessor::dispatch(rpc::Invocation const &invocation) {
 
 void PlatformMessageProcessor::process_event_sequence(
     const std::string &raw_events) {
-  anbox::protobuf::bridge::EventSequence seq;
+  auto &seq = *events_;
   if (!seq.ParseFromString(raw_events)) {
     WARNING("Failed to parse events from raw string");
     return;
@@ -21,6 +21,11 @@
 #include "anbox/rpc/message_processor.h"
 
 namespace anbox {
+namespace protobuf {
+namespace bridge {
+class EventSequence;
+}  // namespace bridge
+}  // namespace protobuf
 namespace bridge {
 class PlatformApiSkeleton;
 class PlatformMessageProcessor : public rpc::MessageProcessor {
@@ -36,6 +41,8 @@ class PlatformMessageProcessor : public rpc::MessageProcessor {
 
  private:
   std::shared_ptr<PlatformApiSkeleton> server_;
+  // Reused for every event sequence we receive on this connection.
+  std::unique_ptr<anbox::protobuf::bridge::EventSequence> events_;
 };
 }  // namespace anbox
 }  // namespace network
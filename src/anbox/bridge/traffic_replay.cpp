@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/bridge/traffic_replay.h"
+#include "anbox/bridge/platform_api_skeleton.h"
+#include "anbox/bridge/platform_message_processor.h"
+#include "anbox/rpc/pending_call_cache.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+// Android isn't around to read our responses.
+class DiscardingMessageSender : public anbox::network::MessageSender {
+ public:
+  void send(char const *data, size_t length) override {
+    (void) data;
+    (void) length;
+  }
+
+  ssize_t send_raw(char const *data, size_t length) override {
+    (void) data;
+    return length;
+  }
+};
+}  // namespace
+
+namespace anbox {
+namespace bridge {
+TrafficReplay::TrafficReplay(const std::shared_ptr<platform::BasePlatform> &platform,
+                             const std::shared_ptr<wm::Manager> &window_manager,
+                             const std::shared_ptr<application::Database> &app_db)
+    : platform_(platform), window_manager_(window_manager), app_db_(app_db) {}
+
+TrafficReplay::~TrafficReplay() {}
+
+TrafficReplay::Stats TrafficReplay::run(const std::vector<rpc::TrafficRecorder::Record> &records,
+                                        Speed speed) {
+  // Every run starts with a fresh connection like a newly booted Android.
+  auto pending_calls = std::make_shared<rpc::PendingCallCache>();
+  auto server = std::make_shared<PlatformApiSkeleton>(pending_calls, platform_, window_manager_, app_db_);
+  PlatformMessageProcessor processor(std::make_shared<DiscardingMessageSender>(), server, pending_calls);
+
+  Stats stats;
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto &record : records) {
+    if (record.direction != rpc::TrafficRecorder::Direction::incoming)
+      continue;
+
+    if (speed == Speed::original)
+      std::this_thread::sleep_until(start + record.timestamp);
+
+    const auto before = std::chrono::steady_clock::now();
+    processor.process_data(record.data);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - before);
+
+    stats.records++;
+    stats.bytes += record.data.size();
+    stats.processing_time += elapsed;
+    stats.max_processing_time = std::max(stats.max_processing_time, elapsed);
+  }
+  stats.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+
+  return stats;
+}
+}  // namespace bridge
+}  // namespace anbox
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_BRIDGE_TRAFFIC_REPLAY_H_
+#define ANBOX_BRIDGE_TRAFFIC_REPLAY_H_
+
+#include "anbox/rpc/traffic_recorder.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace anbox {
+namespace platform {
+class BasePlatform;
+}  // namespace platform
+namespace wm {
+class Manager;
+}  // namespace wm
+namespace application {
+class Database;
+}  // namespace application
+namespace bridge {
+// Feeds recorded bridge traffic into the platform side of the bridge the
+// same way the session manager receives it from Android. Only what Android
+// sent is replayed, everything we send back is dropped.
+class TrafficReplay {
+ public:
+  enum class Speed {
+    // Waits between records as long as it took them to arrive originally.
+    original,
+    // Feeds the next record as soon as the previous one is processed.
+    maximum,
+  };
+
+  struct Stats {
+    std::size_t records = 0;
+    std::size_t bytes = 0;
+    // Time spent processing the records, without waiting between them.
+    std::chrono::nanoseconds processing_time{0};
+    std::chrono::nanoseconds max_processing_time{0};
+    std::chrono::nanoseconds duration{0};
+  };
+
+  TrafficReplay(const std::shared_ptr<platform::BasePlatform> &platform,
+                const std::shared_ptr<wm::Manager> &window_manager,
+                const std::shared_ptr<application::Database> &app_db);
+  ~TrafficReplay();
+
+  Stats run(const std::vector<rpc::TrafficRecorder::Record> &records, Speed speed);
+
+ private:
+  std::shared_ptr<platform::BasePlatform> platform_;
+  std::shared_ptr<wm::Manager> window_manager_;
+  std::shared_ptr<application::Database> app_db_;
+};
+}  // namespace bridge
+}  // namespace anbox
+
+#endif
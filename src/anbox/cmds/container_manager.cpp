@@ -64,6 +64,15 @@ anbox::cmds::ContainerManager::ContainerManager()
   flag(cli::make_flag(cli::Name{"container-network-dns-servers"},
                       cli::Description{"Assign the specified DNS servers to the Android container"},
                       container_network_dns_servers_));
+  flag(cli::make_flag(cli::Name{"container-log-level"},
+                      cli::Description{"Log level of LXC for the Android container (TRACE, DEBUG, INFO, NOTICE, WARN, ERROR, ...)"},
+                      container_log_level_));
+  flag(cli::make_flag(cli::Name{"container-log-max-size"},
+                      cli::Description{"Size in bytes after which the container and console logs get rotated"},
+                      container_log_max_size_));
+  flag(cli::make_flag(cli::Name{"container-log-rate-limit"},
+                      cli::Description{"Maximum number of lines per second written to the container and console logs, 0 to disable"},
+                      container_log_rate_limit_));
 
   action([&](const cli::Command::Context&) {
     try {
@@ -104,6 +113,9 @@ anbox::cmds::ContainerManager::ContainerManager()
       config.rootfs_overlay = enable_rootfs_overlay_;
       config.container_network_address = container_network_address_;
       config.container_network_gateway = container_network_gateway_;
+      config.container_log_level = container_log_level_;
+      config.container_log.max_file_size = container_log_max_size_;
+      config.container_log.max_lines_per_second = container_log_rate_limit_;
 
       if (container_network_dns_servers_.length() > 0)
         config.container_network_dns_servers = utils::string_split(container_network_dns_servers_, ',');
@@ -48,6 +48,9 @@ class ContainerManager : public cli::CommandWithFlagsAndAction {
   std::string container_network_address_;
   std::string container_network_gateway_;
   std::string container_network_dns_servers_;
+  std::string container_log_level_ = "WARN";
+  std::uint64_t container_log_max_size_ = 4 * 1024 * 1024;
+  unsigned int container_log_rate_limit_ = 500;
 };
 }  // namespace cmds
 }  // namespace anbox
@@ -28,6 +28,9 @@
 
 #include <boost/filesystem.hpp>
 
+#include <chrono>
+#include <thread>
+
 #include <fcntl.h>
 #include <sys/stat.h>
 
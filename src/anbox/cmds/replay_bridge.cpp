@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/cmds/replay_bridge.h"
+#include "anbox/application/database.h"
+#include "anbox/bridge/android_api_stub.h"
+#include "anbox/bridge/traffic_replay.h"
+#include "anbox/platform/null/platform.h"
+#include "anbox/rpc/traffic_recorder.h"
+#include "anbox/wm/multi_window_manager.h"
+#include "anbox/logger.h"
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace {
+double to_ms(const std::chrono::nanoseconds &duration) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count();
+}
+
+double to_us(const std::chrono::nanoseconds &duration) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(duration).count();
+}
+}  // namespace
+
+anbox::cmds::ReplayBridge::ReplayBridge()
+    : CommandWithFlagsAndAction{
+          cli::Name{"replay-bridge"}, cli::Usage{"replay-bridge"},
+          cli::Description{"Replay bridge traffic recorded by the session manager and report its processing cost"}} {
+
+  flag(cli::make_flag(cli::Name{"recording"},
+                      cli::Description{"Path of the recording to replay"},
+                      recording_));
+  flag(cli::make_flag(cli::Name{"speed"},
+                      cli::Description{"Either 'original' to keep the recorded timing or 'maximum'"},
+                      speed_));
+  flag(cli::make_flag(cli::Name{"iterations"},
+                      cli::Description{"How often the recording is replayed"},
+                      iterations_));
+
+  action([this](const cli::Command::Context&) {
+    if (recording_.empty()) {
+      ERROR("No recording specified");
+      return EXIT_FAILURE;
+    }
+
+    auto speed = bridge::TrafficReplay::Speed::maximum;
+    if (speed_ == "original") {
+      speed = bridge::TrafficReplay::Speed::original;
+    } else if (speed_ != "maximum") {
+      ERROR("Invalid replay speed '%s'", speed_);
+      return EXIT_FAILURE;
+    }
+
+    const auto records = rpc::TrafficRecorder::read(recording_);
+
+    // Launchers created for the recorded applications must not end up
+    // next to the ones of the users real Android.
+    const auto launcher_dir = fs::temp_directory_path() / fs::unique_path("anbox-replay-%%%%-%%%%");
+    fs::create_directories(launcher_dir);
+
+    for (unsigned int n = 0; n < iterations_; n++) {
+      auto platform = std::make_shared<platform::NullPlatform>();
+      auto app_db = std::make_shared<application::Database>(launcher_dir.string());
+      // There is no Android to talk to, anything which needs to call into
+      // it isn't triggered by incoming traffic.
+      auto android_api_stub = std::make_shared<bridge::AndroidApiStub>();
+      auto window_manager = std::make_shared<wm::MultiWindowManager>(platform, android_api_stub, app_db);
+
+      bridge::TrafficReplay replay(platform, window_manager, app_db);
+      const auto stats = replay.run(records, speed);
+
+      std::cout << "Iteration " << n << ": " << stats.records << " records, "
+                << stats.bytes << " bytes, processing " << to_ms(stats.processing_time) << " ms"
+                << " (" << (stats.records > 0 ? to_us(stats.processing_time) / stats.records : 0.0)
+                << " us per record, max " << to_ms(stats.max_processing_time) << " ms), total "
+                << to_ms(stats.duration) << " ms" << std::endl;
+    }
+
+    fs::remove_all(launcher_dir);
+
+    return EXIT_SUCCESS;
+  });
+}
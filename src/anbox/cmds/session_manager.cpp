@@ -23,14 +23,18 @@
 
 #include "anbox/application/launcher_storage.h"
 #include "anbox/application/database.h"
+#include "anbox/application/launch_tracker.h"
 #include "anbox/audio/server.h"
 #include "anbox/bridge/android_api_stub.h"
 #include "anbox/bridge/platform_api_skeleton.h"
 #include "anbox/bridge/platform_message_processor.h"
+#include "anbox/graphics/frame_stats.h"
 #include "anbox/graphics/gl_renderer_server.h"
 
 #include "anbox/cmds/session_manager.h"
 #include "anbox/common/dispatcher.h"
+#include "anbox/common/memory_accounting.h"
+#include "anbox/common/memory_pressure.h"
 #include "anbox/system_configuration.h"
 #include "anbox/container/client.h"
 #include "anbox/dbus/bus.h"
@@ -41,6 +45,7 @@
 #include "anbox/qemu/pipe_connection_creator.h"
 #include "anbox/rpc/channel.h"
 #include "anbox/rpc/connection_creator.h"
+#include "anbox/rpc/traffic_recorder.h"
 #include "anbox/runtime.h"
 #include "anbox/platform/base_platform.h"
 #include "anbox/wm/multi_window_manager.h"
@@ -48,6 +53,9 @@
 
 #include "external/xdg/xdg.h"
 
+#include <atomic>
+#include <chrono>
+
 #include <sys/prctl.h>
 
 #pragma GCC diagnostic pop
@@ -87,7 +95,8 @@ void anbox::cmds::SessionManager::launch_appmgr_if_needed(const std::shared_ptr<
 anbox::cmds::SessionManager::SessionManager()
     : CommandWithFlagsAndAction{cli::Name{"session-manager"}, cli::Usage{"session-manager"},
                                 cli::Description{"Run the the anbox session manager"}},
-      window_size_(default_single_window_size) {
+      window_size_(default_single_window_size),
+      memory_pressure_source_(common::MemoryPressureMonitor::PsiSource::system_path) {
   // Just for the purpose to allow QtMir (or unity8) to find this on our
   // /proc/*/cmdline
   // for proper confinement etc.
@@ -112,11 +121,36 @@ anbox::cmds::SessionManager::SessionManager()
   flag(cli::make_flag(cli::Name{"software-rendering"},
                       cli::Description{"Use software rendering instead of hardware accelerated GL rendering"},
                       use_software_rendering_));
+  flag(cli::make_flag(cli::Name{"keep-container-running"},
+                      cli::Description{"Leave the Android container running on exit so the next session manager can reattach to it"},
+                      keep_container_running_));
+  flag(cli::make_flag(cli::Name{"record-bridge"},
+                      cli::Description{"Record all traffic between Android and the session manager to the given file for 'anbox replay-bridge'"},
+                      bridge_recording_));
+  flag(cli::make_flag(cli::Name{"memory-pressure-source"},
+                      cli::Description{"PSI file to watch for memory pressure which is forwarded to Android, e.g. the memory.pressure file of a cgroup, or 'none'"},
+                      memory_pressure_source_));
+  flag(cli::make_flag(cli::Name{"memory-pressure-thresholds"},
+                      cli::Description{"Stall percentages at which memory pressure becomes moderate, low or critical, e.g. --memory-pressure-thresholds=moderate=10,low=30,critical=5"},
+                      memory_pressure_thresholds_));
 
   action([this](const cli::Command::Context &) {
+    std::shared_ptr<graphics::FrameStats> frame_stats;
+    std::shared_ptr<graphics::GLRendererServer> renderer_server;
+
     auto trap = core::posix::trap_signals_for_process(
-        {core::posix::Signal::sig_term, core::posix::Signal::sig_int});
-    trap->signal_raised().connect([trap](const core::posix::Signal &signal) {
+        {core::posix::Signal::sig_term, core::posix::Signal::sig_int, core::posix::Signal::sig_usr1});
+    trap->signal_raised().connect([trap, &frame_stats, &renderer_server](const core::posix::Signal &signal) {
+      // SIGUSR1 asks for a dump of the frame, resource and memory
+      // statistics for debugging.
+      if (signal == core::posix::Signal::sig_usr1) {
+        if (frame_stats)
+          INFO("Frame statistics:\n%s", frame_stats->dump());
+        if (renderer_server)
+          INFO("GPU resources:\n%s", renderer_server->dump_resources());
+        INFO("Host memory:\n%s", common::MemoryAccounting::global()->dump());
+        return;
+      }
       INFO("Signal %i received. Good night.", static_cast<int>(signal));
       trap->stop();
     });
@@ -126,6 +160,14 @@ anbox::cmds::SessionManager::SessionManager()
       return EXIT_FAILURE;
     }
 
+    common::MemoryPressureMonitor::Thresholds memory_pressure_thresholds;
+    try {
+      memory_pressure_thresholds = common::MemoryPressureMonitor::Thresholds::parse(memory_pressure_thresholds_);
+    } catch (const std::exception &err) {
+      ERROR("Invalid memory pressure thresholds: %s", err.what());
+      return EXIT_FAILURE;
+    }
+
     if (!fs::exists("/dev/binder") || !fs::exists("/dev/ashmem")) {
       ERROR("Failed to start as either binder or ashmem kernel drivers are not loaded");
       return EXIT_FAILURE;
@@ -163,11 +205,16 @@ anbox::cmds::SessionManager::SessionManager()
 
     auto app_db = std::make_shared<application::Database>();
 
+    // Launches can only be followed to their first frame when every task
+    // gets its own window.
+    std::shared_ptr<application::LaunchTracker> launch_tracker;
+
     std::shared_ptr<wm::Manager> window_manager;
     bool using_single_window = false;
-    if (platform->supports_multi_window() && !single_window_)
-      window_manager = std::make_shared<wm::MultiWindowManager>(platform, android_api_stub, app_db);
-    else {
+    if (platform->supports_multi_window() && !single_window_) {
+      launch_tracker = std::make_shared<application::LaunchTracker>();
+      window_manager = std::make_shared<wm::MultiWindowManager>(platform, android_api_stub, app_db, launch_tracker);
+    } else {
       window_manager = std::make_shared<wm::SingleWindowManager>(platform, display_frame, app_db);
       using_single_window = true;
     }
@@ -182,8 +229,17 @@ anbox::cmds::SessionManager::SessionManager()
       single_window_
     };
     auto gl_server = std::make_shared<graphics::GLRendererServer>(renderer_config, window_manager);
+    frame_stats = gl_server->frame_stats();
+    renderer_server = gl_server;
+    if (launch_tracker) {
+      gl_server->set_launch_tracker(launch_tracker);
+      android_api_stub->set_launch_tracker(launch_tracker);
+    }
 
     platform->set_window_manager(window_manager);
+    platform->set_clipboard_observer([android_api_stub](const platform::BasePlatform::ClipboardData &data) {
+      android_api_stub->set_clipboard_text(data.text);
+    });
     platform->set_renderer(gl_server->renderer());
     window_manager->setup();
 
@@ -209,10 +265,23 @@ anbox::cmds::SessionManager::SessionManager()
 
     boost::asio::deadline_timer appmgr_start_timer(rt->service());
 
+    // Used to report how long it took until Android is usable, either after
+    // a cold boot or after we reattached to an already running container.
+    const auto container_start_time = std::chrono::steady_clock::now();
+    std::atomic<bool> container_reattached{false};
+
+    std::shared_ptr<rpc::TrafficRecorder> bridge_recorder;
+    if (!bridge_recording_.empty())
+      bridge_recorder = std::make_shared<rpc::TrafficRecorder>(bridge_recording_);
+
     auto bridge_connector = std::make_shared<network::PublishedSocketConnector>(
         utils::string_format("%s/anbox_bridge", socket_path), rt,
         std::make_shared<rpc::ConnectionCreator>(
-            rt, [&](const std::shared_ptr<network::MessageSender> &sender) {
+            rt, [&](const std::shared_ptr<network::MessageSender> &connection_sender) {
+              auto sender = connection_sender;
+              if (bridge_recorder)
+                sender = std::make_shared<rpc::RecordingMessageSender>(connection_sender, bridge_recorder);
+
               auto pending_calls = std::make_shared<rpc::PendingCallCache>();
               auto rpc_channel =
                   std::make_shared<rpc::Channel>(pending_calls, sender);
@@ -221,11 +290,19 @@ anbox::cmds::SessionManager::SessionManager()
               // more than one one day we need proper dispatching to the right
               // one.
               android_api_stub->set_rpc_channel(rpc_channel);
+              // Android only asks for the host clipboard as long as we
+              // didn't tell it about it.
+              android_api_stub->set_clipboard_text(platform->get_clipboard_data().text);
 
               auto server = std::make_shared<bridge::PlatformApiSkeleton>(
                   pending_calls, platform, window_manager, app_db);
               server->register_boot_finished_handler([&]() {
-                DEBUG("Android successfully booted");
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - container_start_time);
+                if (container_reattached)
+                  INFO("Android ready %d ms after reattaching to running container", elapsed.count());
+                else
+                  DEBUG("Android successfully booted after %d ms", elapsed.count());
                 android_api_stub->ready().set(true);
                 appmgr_start_timer.expires_from_now(default_appmgr_startup_delay);
                 appmgr_start_timer.async_wait([&](const boost::system::error_code &err) {
@@ -234,10 +311,31 @@ anbox::cmds::SessionManager::SessionManager()
                   launch_appmgr_if_needed(android_api_stub);
                 });
               });
-              return std::make_shared<bridge::PlatformMessageProcessor>(
-                  sender, server, pending_calls);
+              std::shared_ptr<network::MessageProcessor> processor =
+                  std::make_shared<bridge::PlatformMessageProcessor>(sender, server, pending_calls);
+              if (bridge_recorder)
+                processor = std::make_shared<rpc::RecordingMessageProcessor>(processor, bridge_recorder);
+              return processor;
             }));
 
+    // Android only sees the memory of its container so we let it know when
+    // the host runs short of memory to get it to free some early.
+    std::shared_ptr<common::MemoryPressureMonitor> memory_pressure_monitor;
+    if (memory_pressure_source_ != "none") {
+      auto source = std::make_shared<common::MemoryPressureMonitor::PsiSource>(memory_pressure_source_);
+      common::MemoryPressureMonitor::Sample sample;
+      if (source->read(sample)) {
+        memory_pressure_monitor = std::make_shared<common::MemoryPressureMonitor>(
+            source, memory_pressure_thresholds, [android_api_stub](const common::MemoryPressureLevel &level) {
+              DEBUG("Host memory pressure is %s", level);
+              android_api_stub->set_memory_pressure(level);
+            });
+        memory_pressure_monitor->start(rt->service());
+      } else {
+        WARNING("Can't read memory pressure from %s, not forwarding it to Android", memory_pressure_source_);
+      }
+    }
+
     container::Configuration container_configuration;
     if (!standalone_) {
       container_configuration.bind_mounts = {
@@ -255,7 +353,7 @@ anbox::cmds::SessionManager::SessionManager()
       };
 
       dispatcher->dispatch([&]() {
-        container_->start(container_configuration);
+        container_reattached = container_->start(container_configuration, true);
       });
     }
 
@@ -264,14 +362,17 @@ anbox::cmds::SessionManager::SessionManager()
       bus_type = anbox::dbus::Bus::Type::System;
     auto bus = std::make_shared<anbox::dbus::Bus>(bus_type);
 
-    auto skeleton = anbox::dbus::skeleton::Service::create_for_bus(bus, app_manager);
+    auto skeleton = anbox::dbus::skeleton::Service::create_for_bus(bus, app_manager, frame_stats, launch_tracker);
 
-    bus->run_async();
+    bus->run_async(rt->service());
 
     rt->start();
     trap->run();
 
-    if (!standalone_) {
+    if (memory_pressure_monitor)
+      memory_pressure_monitor->stop();
+
+    if (!standalone_ && !keep_container_running_) {
       // Stop the container which should close all open connections we have on
       // our side and should terminate all services.
       container_->stop();
@@ -50,6 +50,10 @@ class SessionManager : public cli::CommandWithFlagsAndAction {
   bool experimental_ = false;
   bool use_system_dbus_ = false;
   bool use_software_rendering_ = false;
+  bool keep_container_running_ = false;
+  std::string bridge_recording_;
+  std::string memory_pressure_source_;
+  std::string memory_pressure_thresholds_;
 };
 }  // namespace cmds
 }  // namespace anbox
@@ -20,6 +20,9 @@
 #include "anbox/cmds/wait_ready.h"
 #include "anbox/dbus/stub/application_manager.h"
 
+#include <chrono>
+#include <thread>
+
 namespace {
 constexpr const unsigned int max_wait_attempts{30};
 }
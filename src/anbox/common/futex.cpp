@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/futex.h"
+
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+long futex(std::atomic<std::uint32_t> &word, int op, std::uint32_t value) {
+  return ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), op, value,
+                   nullptr, nullptr, 0);
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+void futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+  // EAGAIN (value changed) and EINTR are both fine as the caller is
+  // required to re-check its condition anyway.
+  futex(word, FUTEX_WAIT_PRIVATE, expected);
+}
+
+void futex_wake(std::atomic<std::uint32_t> &word, int count) {
+  futex(word, FUTEX_WAKE_PRIVATE, static_cast<std::uint32_t>(count));
+}
+
+void futex_wake_all(std::atomic<std::uint32_t> &word) {
+  futex_wake(word, INT_MAX);
+}
+}  // namespace common
+}  // namespace anbox
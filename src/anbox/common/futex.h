@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_FUTEX_H_
+#define ANBOX_COMMON_FUTEX_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace anbox {
+namespace common {
+// Thin wrappers around the futex(2) system call operating on a 32 bit
+// atomic word. They are used to implement blocking waits for lock-free data
+// structures without pulling in a mutex.
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "std::atomic<uint32_t> can't be used as a futex word");
+
+// Blocks the calling thread as long as |word| has the value |expected|. May
+// return spuriously so callers have to re-check their condition.
+void futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected);
+
+// Wakes up at most |count| threads blocked in futex_wait() on |word|.
+void futex_wake(std::atomic<std::uint32_t> &word, int count);
+void futex_wake_all(std::atomic<std::uint32_t> &word);
+}  // namespace common
+}  // namespace anbox
+
+#endif
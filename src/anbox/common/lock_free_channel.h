@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_LOCK_FREE_CHANNEL_H_
+#define ANBOX_COMMON_LOCK_FREE_CHANNEL_H_
+
+#include "anbox/common/futex.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include <errno.h>
+
+namespace anbox {
+namespace common {
+// A bounded multi-producer/multi-consumer channel which hands over items of
+// type |T| between threads without taking any locks on the fast path.
+//
+// The implementation follows Dmitry Vyukov's bounded MPMC queue: every slot
+// carries a sequence number which tells producers and consumers whether the
+// slot is ready to be written or read, so the only shared state they
+// contend on are the two position counters. Blocking push() and pop() calls
+// sleep on a futex and are only woken up when the other side has made
+// progress. The futex is not touched at all as long as nobody is waiting.
+//
+// The return values follow the BufferQueue conventions: 0 on success,
+// -EAGAIN if the operation would block and -EIO once the channel is closed.
+// A closed channel still allows popping the items which are left in it.
+template <typename T>
+class LockFreeChannel {
+ public:
+  // The |capacity| is rounded up to the next power of two.
+  explicit LockFreeChannel(std::size_t capacity)
+      : capacity_(round_up_capacity(capacity)),
+        mask_(capacity_ - 1),
+        cells_(new Cell[capacity_]) {
+    for (std::size_t n = 0; n < capacity_; n++)
+      cells_[n].sequence.store(n, std::memory_order_relaxed);
+  }
+
+  LockFreeChannel(const LockFreeChannel&) = delete;
+  LockFreeChannel& operator=(const LockFreeChannel&) = delete;
+
+  std::size_t capacity() const { return capacity_; }
+
+  bool is_closed() const { return closed_.load(); }
+
+  // Only a snapshot as other threads may change the channel concurrently.
+  bool empty() const {
+    return enqueue_pos_.load(std::memory_order_acquire) ==
+           dequeue_pos_.load(std::memory_order_acquire);
+  }
+
+  // Moves |item| into the channel if there is space left. On failure |item|
+  // is left untouched.
+  int try_push(T &&item) {
+    if (closed_.load())
+      return -EIO;
+    if (!enqueue(std::move(item)))
+      return -EAGAIN;
+    notify(not_empty_, pop_waiters_);
+    return 0;
+  }
+
+  int push(T &&item) {
+    return wait_for(not_full_, push_waiters_,
+                    [&]() { return try_push(std::move(item)); });
+  }
+
+  int try_pop(T *item) {
+    if (!dequeue(item))
+      return closed_.load() ? -EIO : -EAGAIN;
+    notify(not_full_, push_waiters_);
+    return 0;
+  }
+
+  int pop(T *item) {
+    return wait_for(not_empty_, pop_waiters_,
+                    [&]() { return try_pop(item); });
+  }
+
+  // Closes the channel and wakes up all blocked threads. It is not possible
+  // to push new items anymore and pop() fails once the channel is drained.
+  void close() {
+    closed_.store(true);
+    not_empty_.fetch_add(1);
+    not_full_.fetch_add(1);
+    futex_wake_all(not_empty_);
+    futex_wake_all(not_full_);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T data;
+  };
+
+  static std::size_t round_up_capacity(std::size_t capacity) {
+    std::size_t result = 2;
+    while (result < capacity)
+      result <<= 1;
+    return result;
+  }
+
+  bool enqueue(T &&item) {
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &cell = cells_[pos & mask_];
+      const auto seq = cell.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.data = std::move(item);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // The slot still holds an item which wasn't consumed yet.
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool dequeue(T *item) {
+    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &cell = cells_[pos & mask_];
+      const auto seq = cell.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          *item = std::move(cell.data);
+          cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // Nothing was written to this slot yet.
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Wakes up one waiter on |word| if there is any. The fence orders the
+  // preceding update of a cell sequence against reading the number of
+  // waiters, pairing with the increment of the waiter count in wait_for().
+  void notify(std::atomic<std::uint32_t> &word, std::atomic<std::uint32_t> &waiters) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) == 0)
+      return;
+    word.fetch_add(1);
+    futex_wake(word, 1);
+  }
+
+  template <typename Operation>
+  int wait_for(std::atomic<std::uint32_t> &word, std::atomic<std::uint32_t> &waiters,
+               const Operation &op) {
+    for (;;) {
+      // The other side is often just about to make progress so give it a
+      // chance to do so before we go to sleep.
+      auto result = op();
+      for (int n = 0; n < spin_count && result == -EAGAIN; n++) {
+        std::this_thread::yield();
+        result = op();
+      }
+      if (result != -EAGAIN)
+        return result;
+
+      waiters.fetch_add(1);
+      const auto value = word.load();
+      // Check again after we announced ourselves as waiter so we don't miss
+      // a notification which happened in between.
+      result = op();
+      if (result != -EAGAIN) {
+        waiters.fetch_sub(1);
+        return result;
+      }
+      futex_wait(word, value);
+      waiters.fetch_sub(1);
+    }
+  }
+
+  static constexpr const int spin_count{4};
+
+  // Keep the counters modified by producers and consumers on different
+  // cache lines.
+  static constexpr const std::size_t cache_line_size{64};
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  char pad0_[cache_line_size];
+  std::atomic<std::size_t> enqueue_pos_{0};
+  char pad1_[cache_line_size - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> dequeue_pos_{0};
+  char pad2_[cache_line_size - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::uint32_t> not_empty_{0};
+  std::atomic<std::uint32_t> pop_waiters_{0};
+  std::atomic<std::uint32_t> not_full_{0};
+  std::atomic<std::uint32_t> push_waiters_{0};
+  std::atomic<bool> closed_{false};
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
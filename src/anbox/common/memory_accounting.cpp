@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/memory_accounting.h"
+#include "anbox/utils.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace anbox {
+namespace common {
+constexpr const std::size_t MemoryAccounting::num_subsystems;
+
+MemoryAccounting::Account::Account(Subsystem subsystem, const std::string &owner,
+                                   const std::shared_ptr<MemoryAccounting> &accounting)
+    : accounting_(accounting), subsystem_(subsystem), owner_(owner) {
+  accounting_->attach(this);
+}
+
+MemoryAccounting::Account::~Account() {
+  accounting_->detach(this);
+}
+
+void MemoryAccounting::Account::add(std::size_t bytes) {
+  const auto current = bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  auto peak = peak_.load(std::memory_order_relaxed);
+  while (current > peak && !peak_.compare_exchange_weak(peak, current, std::memory_order_relaxed));
+}
+
+void MemoryAccounting::Account::remove(std::size_t bytes) {
+  bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryAccounting::Account::set(std::size_t bytes) {
+  bytes_.store(bytes, std::memory_order_relaxed);
+  auto peak = peak_.load(std::memory_order_relaxed);
+  while (bytes > peak && !peak_.compare_exchange_weak(peak, bytes, std::memory_order_relaxed));
+}
+
+std::size_t MemoryAccounting::Account::bytes() const {
+  return bytes_.load(std::memory_order_relaxed);
+}
+
+std::size_t MemoryAccounting::Account::peak() const {
+  return peak_.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<MemoryAccounting> MemoryAccounting::global() {
+  static auto accounting = std::make_shared<MemoryAccounting>();
+  return accounting;
+}
+
+const char* MemoryAccounting::name(Subsystem subsystem) {
+  switch (subsystem) {
+  case Subsystem::RenderThreadBuffers:
+    return "render-thread-buffers";
+  case Subsystem::StreamQueues:
+    return "stream-queues";
+  case Subsystem::ColorBuffers:
+    return "color-buffers";
+  case Subsystem::BufferPool:
+    return "buffer-pool";
+  case Subsystem::AudioQueues:
+    return "audio-queues";
+  case Subsystem::RpcMessages:
+    return "rpc-messages";
+  case Subsystem::ApplicationDatabase:
+    return "application-database";
+  }
+  return "unknown";
+}
+
+MemoryAccounting::MemoryAccounting() {}
+
+MemoryAccounting::~MemoryAccounting() {}
+
+std::string MemoryAccounting::next_owner(const std::string &prefix) {
+  static std::mutex mutex;
+  static std::map<std::string, unsigned int> counters;
+  std::lock_guard<std::mutex> l(mutex);
+  return utils::string_format("%s-%d", prefix, counters[prefix]++);
+}
+
+void MemoryAccounting::attach(Account *account) {
+  std::lock_guard<std::mutex> l(mutex_);
+  accounts_.push_back(account);
+}
+
+void MemoryAccounting::detach(Account *account) {
+  std::lock_guard<std::mutex> l(mutex_);
+  accounts_.erase(std::remove(accounts_.begin(), accounts_.end(), account), accounts_.end());
+}
+
+std::vector<MemoryAccounting::Usage> MemoryAccounting::accounts() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  std::vector<Usage> usages;
+  usages.reserve(accounts_.size());
+  for (const auto &account : accounts_)
+    usages.push_back({account->subsystem(), account->owner(), account->bytes(), account->peak()});
+
+  std::sort(usages.begin(), usages.end(), [](const Usage &a, const Usage &b) {
+    if (a.subsystem != b.subsystem)
+      return a.subsystem < b.subsystem;
+    return a.owner < b.owner;
+  });
+  return usages;
+}
+
+std::vector<MemoryAccounting::SubsystemUsage> MemoryAccounting::subsystems() const {
+  std::vector<SubsystemUsage> usages;
+  usages.reserve(num_subsystems);
+  for (std::size_t n = 0; n < num_subsystems; n++)
+    usages.push_back({static_cast<Subsystem>(n), 0, 0, 0});
+
+  for (const auto &account : accounts()) {
+    auto &usage = usages[static_cast<std::size_t>(account.subsystem)];
+    usage.bytes += account.bytes;
+    usage.peak = std::max(usage.peak, account.peak);
+    usage.accounts++;
+  }
+  return usages;
+}
+
+std::size_t MemoryAccounting::total() const {
+  std::size_t bytes = 0;
+  for (const auto &usage : subsystems())
+    bytes += usage.bytes;
+  return bytes;
+}
+
+std::string MemoryAccounting::dump() const {
+  std::stringstream ss;
+  std::size_t total = 0;
+  for (const auto &usage : subsystems()) {
+    ss << name(usage.subsystem) << ": " << usage.bytes << " bytes in "
+       << usage.accounts << " accounts (peak " << usage.peak << " bytes)" << std::endl;
+    total += usage.bytes;
+  }
+  for (const auto &account : accounts()) {
+    ss << "  " << name(account.subsystem) << " " << account.owner << ": "
+       << account.bytes << " bytes (peak " << account.peak << " bytes)" << std::endl;
+  }
+  ss << "total: " << total << " bytes" << std::endl;
+  return ss.str();
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_MEMORY_ACCOUNTING_H_
+#define ANBOX_COMMON_MEMORY_ACCOUNTING_H_
+
+#include "anbox/do_not_copy_or_move.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Attributes the host memory we hold on behalf of Android to the subsystem
+// and the connection (or other owner) holding it. Every owner opens an
+// Account and keeps it up to date whenever the memory it holds changes.
+// Updating an account only touches atomics so it can be done on the data
+// paths; walking the accounts is left to whoever asks for a dump.
+class MemoryAccounting {
+ public:
+  enum class Subsystem {
+    // Command buffers of the render threads.
+    RenderThreadBuffers,
+    // Data queued in the streams between the sockets and the render threads.
+    StreamQueues,
+    // Estimated size of the color buffer storage.
+    ColorBuffers,
+    // Buffers cached for reuse by the buffer pool.
+    BufferPool,
+    // Audio data waiting to be played.
+    AudioQueues,
+    // Buffers of the RPC connections to Android.
+    RpcMessages,
+    // Applications known to the application database.
+    ApplicationDatabase,
+  };
+
+  static constexpr const std::size_t num_subsystems{7};
+
+  class Account : public DoNotCopyOrMove {
+   public:
+    Account(Subsystem subsystem, const std::string &owner,
+            const std::shared_ptr<MemoryAccounting> &accounting = MemoryAccounting::global());
+    // Memory still attributed to the account is considered released.
+    ~Account();
+
+    void add(std::size_t bytes);
+    void remove(std::size_t bytes);
+    void set(std::size_t bytes);
+
+    std::size_t bytes() const;
+    std::size_t peak() const;
+    Subsystem subsystem() const { return subsystem_; }
+    const std::string& owner() const { return owner_; }
+
+   private:
+    std::shared_ptr<MemoryAccounting> accounting_;
+    Subsystem subsystem_;
+    std::string owner_;
+    std::atomic<std::size_t> bytes_{0};
+    std::atomic<std::size_t> peak_{0};
+  };
+
+  struct Usage {
+    Subsystem subsystem;
+    std::string owner;
+    std::size_t bytes;
+    std::size_t peak;
+  };
+
+  struct SubsystemUsage {
+    Subsystem subsystem;
+    std::size_t bytes;
+    // Highest amount seen at once by any single account.
+    std::size_t peak;
+    std::size_t accounts;
+  };
+
+  // Returns the accounting shared by all users within the process.
+  static std::shared_ptr<MemoryAccounting> global();
+
+  static const char* name(Subsystem subsystem);
+
+  MemoryAccounting();
+  ~MemoryAccounting();
+
+  MemoryAccounting(const MemoryAccounting&) = delete;
+  MemoryAccounting& operator=(const MemoryAccounting&) = delete;
+
+  // Returns an owner name for the |n|-th object created with |prefix|.
+  static std::string next_owner(const std::string &prefix);
+
+  std::vector<Usage> accounts() const;
+  std::vector<SubsystemUsage> subsystems() const;
+  std::size_t total() const;
+
+  // Human readable version of all subsystems and accounts meant for
+  // debugging.
+  std::string dump() const;
+
+ private:
+  void attach(Account *account);
+  void detach(Account *account);
+
+  mutable std::mutex mutex_;
+  std::vector<Account*> accounts_;
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/memory_pressure.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+// Picks the avg10 value out of a line like
+//   some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+bool parse_avg10(const std::string &line, double &value) {
+  std::istringstream in(line);
+  std::string field;
+  in >> field;
+  while (in >> field) {
+    if (!anbox::utils::string_starts_with(field, "avg10="))
+      continue;
+    try {
+      std::size_t pos = 0;
+      const auto str = field.substr(6);
+      value = std::stod(str, &pos);
+      return pos == str.size();
+    } catch (const std::logic_error &) {
+      return false;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+MemoryPressureMonitor::Source::~Source() {}
+
+MemoryPressureMonitor::PsiSource::PsiSource(const std::string &path) : path_(path) {}
+
+bool MemoryPressureMonitor::PsiSource::read(Sample &sample) {
+  std::ifstream in(path_);
+  if (!in.good())
+    return false;
+
+  std::stringstream content;
+  content << in.rdbuf();
+  return parse(content.str(), sample);
+}
+
+bool MemoryPressureMonitor::PsiSource::parse(const std::string &content, Sample &sample) {
+  Sample result;
+  bool have_some = false;
+  std::istringstream in(content);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (utils::string_starts_with(line, "some ")) {
+      if (!parse_avg10(line, result.some_avg10))
+        return false;
+      have_some = true;
+    } else if (utils::string_starts_with(line, "full ")) {
+      if (!parse_avg10(line, result.full_avg10))
+        return false;
+    }
+  }
+
+  // Older kernels only report the full line for cgroups other than the
+  // root one so we only insist on the some line.
+  if (!have_some)
+    return false;
+
+  sample = result;
+  return true;
+}
+
+MemoryPressureMonitor::Thresholds MemoryPressureMonitor::Thresholds::parse(const std::string &spec) {
+  Thresholds thresholds;
+  for (const auto &entry : utils::string_split(spec, ',')) {
+    if (entry.empty())
+      continue;
+
+    const auto pos = entry.find('=');
+    if (pos == std::string::npos)
+      throw std::runtime_error(utils::string_format("Missing value for '%s'", entry));
+
+    const auto key = entry.substr(0, pos);
+    const auto str = entry.substr(pos + 1);
+    double value = -1.0;
+    try {
+      std::size_t parsed = 0;
+      value = std::stod(str, &parsed);
+      if (parsed != str.size())
+        value = -1.0;
+    } catch (const std::logic_error &) {
+      // Handled below
+    }
+    if (value < 0.0 || value > 100.0)
+      throw std::runtime_error(utils::string_format("Invalid value '%s' for '%s'", str, key));
+
+    if (key == "moderate")
+      thresholds.moderate = value;
+    else if (key == "low")
+      thresholds.low = value;
+    else if (key == "critical")
+      thresholds.critical = value;
+    else
+      throw std::runtime_error(utils::string_format("Unknown key '%s'", key));
+  }
+
+  if (thresholds.low < thresholds.moderate)
+    throw std::runtime_error("Threshold for low has to be at least the one for moderate");
+
+  return thresholds;
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor(const std::shared_ptr<Source> &source,
+                                             const Thresholds &thresholds,
+                                             const Handler &handler)
+    : source_(source), thresholds_(thresholds), handler_(handler) {}
+
+MemoryPressureMonitor::~MemoryPressureMonitor() {
+  stop();
+}
+
+bool MemoryPressureMonitor::check(const Clock::time_point &now) {
+  Sample sample;
+  if (!source_->read(sample))
+    return false;
+
+  const auto measured = level_for(sample);
+  bool report = false;
+  MemoryPressureLevel level;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (measured > level_) {
+      level_ = measured;
+      lower_ = false;
+      report = true;
+    } else if (measured < level_) {
+      if (!lower_) {
+        lower_ = true;
+        lower_since_ = now;
+      } else if (now - lower_since_ >= relax_delay) {
+        level_ = measured;
+        lower_ = false;
+        report = true;
+      }
+    } else {
+      lower_ = false;
+    }
+
+    if (!report && level_ != MemoryPressureLevel::None && now - last_report_ >= repeat_interval)
+      report = true;
+
+    if (report)
+      last_report_ = now;
+    level = level_;
+  }
+
+  if (report && handler_)
+    handler_(level);
+
+  return true;
+}
+
+void MemoryPressureMonitor::start(boost::asio::io_service &service,
+                                  const std::chrono::milliseconds &interval) {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (running_)
+    return;
+
+  timer_.reset(new boost::asio::steady_timer(service));
+  interval_ = interval;
+  running_ = true;
+  schedule_check();
+}
+
+void MemoryPressureMonitor::stop() {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (!running_)
+    return;
+
+  running_ = false;
+  boost::system::error_code err;
+  timer_->cancel(err);
+}
+
+MemoryPressureLevel MemoryPressureMonitor::level() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return level_;
+}
+
+MemoryPressureLevel MemoryPressureMonitor::level_for(const Sample &sample) const {
+  if (sample.full_avg10 >= thresholds_.critical)
+    return MemoryPressureLevel::Critical;
+  else if (sample.some_avg10 >= thresholds_.low)
+    return MemoryPressureLevel::Low;
+  else if (sample.some_avg10 >= thresholds_.moderate)
+    return MemoryPressureLevel::Moderate;
+  return MemoryPressureLevel::None;
+}
+
+// Has to be called with mutex_ locked.
+void MemoryPressureMonitor::schedule_check() {
+  std::weak_ptr<MemoryPressureMonitor> weak_self = shared_from_this();
+  timer_->expires_from_now(interval_);
+  timer_->async_wait([weak_self](const boost::system::error_code &err) {
+    if (err)
+      return;
+
+    auto self = weak_self.lock();
+    if (!self)
+      return;
+
+    self->check();
+
+    std::lock_guard<std::mutex> l(self->mutex_);
+    if (self->running_)
+      self->schedule_check();
+  });
+}
+
+std::ostream& operator<<(std::ostream &out, const MemoryPressureLevel &level) {
+  switch (level) {
+  case MemoryPressureLevel::None:
+    return out << "none";
+  case MemoryPressureLevel::Moderate:
+    return out << "moderate";
+  case MemoryPressureLevel::Low:
+    return out << "low";
+  case MemoryPressureLevel::Critical:
+    return out << "critical";
+  }
+  return out;
+}
+}  // namespace common
+}  // namespace anbox
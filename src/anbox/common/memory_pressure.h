@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_MEMORY_PRESSURE_H_
+#define ANBOX_COMMON_MEMORY_PRESSURE_H_
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace anbox {
+namespace common {
+// How much the host suffers from a lack of memory. The levels correspond
+// to the TRIM_MEMORY_RUNNING_* levels Android reports to applications.
+enum class MemoryPressureLevel {
+  None,
+  Moderate,
+  Low,
+  Critical,
+};
+
+// MemoryPressureMonitor watches the memory pressure of the host, or of a
+// single cgroup, through the pressure stall information (PSI) of the kernel
+// and reports every change of the pressure level. Android only sees the
+// memory of its container and would otherwise only start to free memory
+// when the host is already swapping heavily.
+//
+// The levels are derived from the share of time tasks were stalled on
+// memory over the last ten seconds: Moderate and Low when at least some
+// tasks were stalled for the given percentage of time, Critical when all
+// tasks were. Thresholds are written as e.g.
+//
+//   moderate=10,low=30,critical=5
+//
+// A higher level is reported right away. A lower one only after the
+// pressure stayed low for relax_delay so that we don't flap between levels.
+// While the pressure stays elevated the level is reported again every
+// repeat_interval so that applications started meanwhile trim as well.
+class MemoryPressureMonitor : public std::enable_shared_from_this<MemoryPressureMonitor> {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Sample {
+    // Percentage of time at least one task was stalled on memory.
+    double some_avg10 = 0.0;
+    // Percentage of time all tasks were stalled on memory.
+    double full_avg10 = 0.0;
+  };
+
+  class Source {
+   public:
+    virtual ~Source();
+    // Returns false if no sample could be read.
+    virtual bool read(Sample &sample) = 0;
+  };
+
+  // Reads samples from a file in the PSI format like /proc/pressure/memory
+  // or the memory.pressure file of a cgroup.
+  class PsiSource : public Source {
+   public:
+    static constexpr const char *system_path{"/proc/pressure/memory"};
+
+    explicit PsiSource(const std::string &path = system_path);
+
+    bool read(Sample &sample) override;
+
+    // Parses the content of a PSI file. Returns false if it is malformed.
+    static bool parse(const std::string &content, Sample &sample);
+
+   private:
+    std::string path_;
+  };
+
+  struct Thresholds {
+    double moderate = 10.0;
+    double low = 30.0;
+    double critical = 5.0;
+
+    // Parses a specification in the format described above. Throws on
+    // malformed input.
+    static Thresholds parse(const std::string &spec);
+  };
+
+  typedef std::function<void(MemoryPressureLevel)> Handler;
+
+  MemoryPressureMonitor(const std::shared_ptr<Source> &source,
+                        const Thresholds &thresholds,
+                        const Handler &handler);
+  ~MemoryPressureMonitor();
+
+  // Reads a sample from the source and reports the resulting level to the
+  // handler if needed. Returns false if the source failed.
+  bool check(const Clock::time_point &now = Clock::now());
+
+  // Checks the pressure every interval on the given service until stop()
+  // is called.
+  void start(boost::asio::io_service &service,
+             const std::chrono::milliseconds &interval = std::chrono::seconds{1});
+  void stop();
+
+  MemoryPressureLevel level() const;
+
+  std::chrono::milliseconds relax_delay{std::chrono::seconds{10}};
+  std::chrono::milliseconds repeat_interval{std::chrono::seconds{30}};
+
+ private:
+  MemoryPressureLevel level_for(const Sample &sample) const;
+  void schedule_check();
+
+  std::shared_ptr<Source> source_;
+  Thresholds thresholds_;
+  Handler handler_;
+
+  mutable std::mutex mutex_;
+  MemoryPressureLevel level_ = MemoryPressureLevel::None;
+  Clock::time_point last_report_;
+  // Since when the measured level is below the reported one.
+  Clock::time_point lower_since_;
+  bool lower_ = false;
+
+  std::unique_ptr<boost::asio::steady_timer> timer_;
+  std::chrono::milliseconds interval_;
+  bool running_ = false;
+};
+
+std::ostream& operator<<(std::ostream &out, const MemoryPressureLevel &level);
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -295,7 +295,10 @@ class SmallFixedVector : public SmallVector<T> {
   SmallFixedVector(const SmallFixedVector& other)
       : SmallFixedVector(other.begin(), other.end()) {}
 
-  SmallFixedVector(SmallFixedVector&& other) {
+  // Moves have to be noexcept, otherwise containers like std::vector copy
+  // the elements when they grow and we lose the allocated memory.
+  SmallFixedVector(SmallFixedVector&& other) noexcept(
+      std::is_nothrow_move_constructible<T>::value) {
     if (other.isAllocated()) {
       // Just steal the allocated memory from the |other|.
       this->mBegin = other.mBegin;
@@ -320,7 +323,8 @@ class SmallFixedVector : public SmallVector<T> {
     return *this;
   }
 
-  SmallFixedVector& operator=(SmallFixedVector&& other) {
+  SmallFixedVector& operator=(SmallFixedVector&& other) noexcept(
+      std::is_nothrow_move_constructible<T>::value) {
     if (other.isAllocated()) {
       // Steal it and we're done.
       this->dtor();
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/thread_topology.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+#include <errno.h>
+#include <linux/capability.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+constexpr const char *policy_env_var{"ANBOX_THREAD_POLICY"};
+// The kernel limits thread names to 16 bytes including the terminator.
+constexpr const std::size_t max_thread_name_length{15};
+
+const std::array<std::pair<anbox::common::ThreadClass, const char*>, 5> class_names{{
+  {anbox::common::ThreadClass::Compositor, "compositor"},
+  {anbox::common::ThreadClass::Render, "render"},
+  {anbox::common::ThreadClass::IO, "io"},
+  {anbox::common::ThreadClass::Audio, "audio"},
+  {anbox::common::ThreadClass::Background, "background"},
+}};
+
+const std::array<std::pair<anbox::common::ThreadPolicy::Scheduler, const char*>, 5> scheduler_names{{
+  {anbox::common::ThreadPolicy::Scheduler::Other, "other"},
+  {anbox::common::ThreadPolicy::Scheduler::Batch, "batch"},
+  {anbox::common::ThreadPolicy::Scheduler::Idle, "idle"},
+  {anbox::common::ThreadPolicy::Scheduler::FIFO, "fifo"},
+  {anbox::common::ThreadPolicy::Scheduler::RoundRobin, "rr"},
+}};
+
+int to_native(const anbox::common::ThreadPolicy::Scheduler &scheduler) {
+  switch (scheduler) {
+  case anbox::common::ThreadPolicy::Scheduler::Batch:
+    return SCHED_BATCH;
+  case anbox::common::ThreadPolicy::Scheduler::Idle:
+    return SCHED_IDLE;
+  case anbox::common::ThreadPolicy::Scheduler::FIFO:
+    return SCHED_FIFO;
+  case anbox::common::ThreadPolicy::Scheduler::RoundRobin:
+    return SCHED_RR;
+  default:
+    break;
+  }
+  return SCHED_OTHER;
+}
+
+int parse_int(const std::string &value) {
+  std::size_t pos = 0;
+  const auto result = std::stoi(value, &pos);
+  if (pos != value.size())
+    throw std::invalid_argument(value);
+  return result;
+}
+
+// Parses a CPU list in the format taskset uses, e.g. 0-3,6.
+std::vector<unsigned int> parse_cpus(const std::string &value) {
+  std::vector<unsigned int> cpus;
+  for (const auto &range : anbox::utils::string_split(value, ',')) {
+    const auto bounds = anbox::utils::string_split(range, '-');
+    if (bounds.empty() || bounds.size() > 2)
+      throw std::runtime_error(anbox::utils::string_format("Invalid CPU range '%s'", range));
+
+    const auto first = parse_int(bounds[0]);
+    const auto last = bounds.size() == 2 ? parse_int(bounds[1]) : first;
+    if (first < 0 || last < first || last >= CPU_SETSIZE)
+      throw std::runtime_error(anbox::utils::string_format("Invalid CPU range '%s'", range));
+
+    for (auto cpu = first; cpu <= last; cpu++)
+      cpus.push_back(static_cast<unsigned int>(cpu));
+  }
+  return cpus;
+}
+
+std::vector<unsigned int> current_cpus() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  std::vector<unsigned int> cpus;
+  if (::sched_getaffinity(0, sizeof(set), &set) < 0)
+    return cpus;
+
+  for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &set))
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+}  // namespace
+
+namespace anbox {
+namespace common {
+ThreadTopology& ThreadTopology::instance() {
+  static ThreadTopology topology;
+  return topology;
+}
+
+ThreadTopology::ThreadTopology() : process_cpus_(current_cpus()) {
+  // Keep audio and composition responsive when the host is busy. Lowering
+  // the nice value needs CAP_SYS_NICE or a matching RLIMIT_NICE so this is
+  // only best effort.
+  policies_[static_cast<std::size_t>(ThreadClass::Compositor)].nice = -5;
+  policies_[static_cast<std::size_t>(ThreadClass::Audio)].nice = -10;
+  policies_[static_cast<std::size_t>(ThreadClass::Background)].nice = 10;
+
+  const auto spec = utils::get_env_value(policy_env_var, "");
+  if (spec.empty())
+    return;
+
+  try {
+    configure(spec);
+  } catch (const std::exception &err) {
+    WARNING("Ignoring invalid %s: %s", policy_env_var, err.what());
+  }
+}
+
+void ThreadTopology::configure(const std::string &spec) {
+  auto policies = [&]() {
+    std::lock_guard<std::mutex> l(mutex_);
+    return policies_;
+  }();
+
+  for (const auto &entry : utils::string_split(spec, ';')) {
+    if (entry.empty())
+      continue;
+
+    const auto fields = utils::string_split(entry, ':');
+    auto cls = std::find_if(class_names.begin(), class_names.end(), [&](const decltype(class_names)::value_type &c) {
+      return fields[0] == c.second;
+    });
+    if (cls == class_names.end())
+      throw std::runtime_error(utils::string_format("Unknown thread class '%s'", fields[0]));
+
+    auto &policy = policies[static_cast<std::size_t>(cls->first)];
+    for (std::size_t n = 1; n < fields.size(); n++) {
+      const auto pos = fields[n].find('=');
+      if (pos == std::string::npos)
+        throw std::runtime_error(utils::string_format("Missing value for '%s'", fields[n]));
+
+      const auto key = fields[n].substr(0, pos);
+      const auto value = fields[n].substr(pos + 1);
+      try {
+        if (key == "scheduler") {
+          auto scheduler = std::find_if(scheduler_names.begin(), scheduler_names.end(), [&](const decltype(scheduler_names)::value_type &s) {
+            return value == s.second;
+          });
+          if (scheduler == scheduler_names.end())
+            throw std::runtime_error(utils::string_format("Unknown scheduler '%s'", value));
+          policy.scheduler = scheduler->first;
+        } else if (key == "priority") {
+          policy.priority = parse_int(value);
+        } else if (key == "nice") {
+          policy.nice = parse_int(value);
+        } else if (key == "cpus") {
+          policy.cpus = parse_cpus(value);
+        } else {
+          throw std::runtime_error(utils::string_format("Unknown key '%s'", key));
+        }
+      } catch (const std::logic_error &err) {
+        // Thrown by std::stoi for anything which isn't a number
+        throw std::runtime_error(utils::string_format("Invalid value '%s' for '%s'", value, key));
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  policies_ = policies;
+}
+
+void ThreadTopology::set_policy(ThreadClass cls, const ThreadPolicy &policy) {
+  std::lock_guard<std::mutex> l(mutex_);
+  policies_[static_cast<std::size_t>(cls)] = policy;
+}
+
+ThreadPolicy ThreadTopology::policy(ThreadClass cls) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return policies_[static_cast<std::size_t>(cls)];
+}
+
+bool ThreadTopology::apply(ThreadClass cls, const std::string &name) const {
+  const auto policy = this->policy(cls);
+  const auto thread = pthread_self();
+  auto applied = true;
+
+  auto r = pthread_setname_np(thread, name.substr(0, max_thread_name_length).c_str());
+  if (r != 0)
+    DEBUG("Failed to set name of thread %s: %s", name, strerror(r));
+
+  sched_param param;
+  ::memset(&param, 0, sizeof(param));
+  if (policy.scheduler == ThreadPolicy::Scheduler::FIFO ||
+      policy.scheduler == ThreadPolicy::Scheduler::RoundRobin)
+    param.sched_priority = policy.priority;
+
+  r = pthread_setschedparam(thread, to_native(policy.scheduler), &param);
+  if (r != 0) {
+    DEBUG("Failed to set scheduler of %s thread %s: %s", cls, name, strerror(r));
+    applied = false;
+  }
+
+  // On Linux the nice value is a property of the thread, not the process.
+  const auto tid = static_cast<id_t>(::syscall(SYS_gettid));
+  if (::setpriority(PRIO_PROCESS, tid, policy.nice) < 0) {
+    DEBUG("Failed to set nice value of %s thread %s to %d: %s", cls, name, policy.nice, strerror(errno));
+    applied = false;
+  }
+
+  // A thread which switches from a pinned class has to be unpinned again.
+  const auto &policy_cpus = policy.cpus.empty() ? process_cpus_ : policy.cpus;
+  if (!policy_cpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (const auto &cpu : policy_cpus)
+      CPU_SET(cpu, &cpus);
+
+    r = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+    if (r != 0) {
+      WARNING("Failed to set CPU affinity of %s thread %s: %s", cls, name, strerror(r));
+      applied = false;
+    }
+  }
+
+  return applied;
+}
+
+bool ThreadTopology::can_switch(ThreadClass from, ThreadClass to) const {
+  const auto target = policy(to);
+  // Setting the affinity fails if none of the CPUs is available to us.
+  if (!target.cpus.empty() && !process_cpus_.empty() &&
+      std::none_of(target.cpus.begin(), target.cpus.end(), [&](unsigned int cpu) {
+        return std::find(process_cpus_.begin(), process_cpus_.end(), cpu) != process_cpus_.end();
+      }))
+    return false;
+
+  const auto nice = target.nice;
+  if (nice >= policy(from).nice)
+    return true;
+
+  // The kernel allows a nice value of n if 20 - n is within RLIMIT_NICE.
+  rlimit limit;
+  if (::getrlimit(RLIMIT_NICE, &limit) == 0 &&
+      (limit.rlim_cur == RLIM_INFINITY || static_cast<rlim_t>(20 - nice) <= limit.rlim_cur))
+    return true;
+
+  __user_cap_header_struct header;
+  header.version = _LINUX_CAPABILITY_VERSION_3;
+  header.pid = 0;
+  __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3];
+  if (::syscall(SYS_capget, &header, data) < 0)
+    return false;
+
+  return (data[CAP_TO_INDEX(CAP_SYS_NICE)].effective & CAP_TO_MASK(CAP_SYS_NICE)) != 0;
+}
+
+void setup_current_thread(ThreadClass cls, const std::string &name) {
+  ThreadTopology::instance().apply(cls, name);
+}
+
+std::ostream& operator<<(std::ostream &out, const ThreadClass &cls) {
+  for (const auto &c : class_names) {
+    if (c.first == cls)
+      return out << c.second;
+  }
+  return out << "unknown";
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_THREAD_TOPOLOGY_H_
+#define ANBOX_COMMON_THREAD_TOPOLOGY_H_
+
+#include <array>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace common {
+// Every thread we create belongs to one of these classes. The class
+// decides how the thread is scheduled and on which CPUs it may run.
+enum class ThreadClass {
+  // Composes the Android layers into the host windows and processes
+  // window and input events.
+  Compositor,
+  // Decodes and executes the GL command streams of the guest.
+  Render,
+  // Moves data between the guest and the host.
+  IO,
+  // Feeds the host audio system.
+  Audio,
+  // Everything which isn't time critical.
+  Background,
+};
+
+struct ThreadPolicy {
+  enum class Scheduler {
+    Other,
+    Batch,
+    Idle,
+    FIFO,
+    RoundRobin,
+  };
+
+  Scheduler scheduler = Scheduler::Other;
+  // Only used for the realtime schedulers.
+  int priority = 0;
+  int nice = 0;
+  // CPUs the thread may run on, all if empty.
+  std::vector<unsigned int> cpus;
+};
+
+// Holds the policy for every thread class and applies it to threads. The
+// defaults can be overridden through ANBOX_THREAD_POLICY, for example
+//
+//   ANBOX_THREAD_POLICY="audio:scheduler=fifo:priority=10:cpus=2-3,6;background:nice=15"
+//
+// with the schedulers other, batch, idle, fifo and rr.
+//
+// Applying a policy never fails hard: a host which doesn't allow us to
+// raise priorities still gets a working, just less responsive, Anbox.
+class ThreadTopology {
+ public:
+  static ThreadTopology& instance();
+
+  ThreadTopology();
+
+  // Parses a specification in the format described above and updates the
+  // policies of all classes it mentions. Throws on malformed input.
+  void configure(const std::string &spec);
+
+  void set_policy(ThreadClass cls, const ThreadPolicy &policy);
+  ThreadPolicy policy(ThreadClass cls) const;
+
+  // Names the calling thread and applies the policy of the given class to
+  // it. Names longer than the 15 characters the kernel supports are cut.
+  // A policy without CPUs lets the thread run on all CPUs the process was
+  // allowed to use when the topology was created. Returns false if the
+  // scheduler, nice value or CPU affinity couldn't be applied.
+  bool apply(ThreadClass cls, const std::string &name) const;
+
+  // Returns true if a thread which took the policy of |from| can take the
+  // one of |to| afterwards. Raising the nice value is always allowed but
+  // lowering it again needs CAP_SYS_NICE or a matching RLIMIT_NICE. The
+  // CPUs of |to| have to include at least one the process may use.
+  bool can_switch(ThreadClass from, ThreadClass to) const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::array<ThreadPolicy, 5> policies_;
+  // CPUs the process may run on, empty if they couldn't be determined.
+  std::vector<unsigned int> process_cpus_;
+};
+
+// Shorthand for ThreadTopology::instance().apply(cls, name).
+void setup_current_thread(ThreadClass cls, const std::string &name);
+
+std::ostream& operator<<(std::ostream &out, const ThreadClass &cls);
+}  // namespace common
+}  // namespace anbox
+
+#endif
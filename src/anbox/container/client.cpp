@@ -42,14 +42,15 @@ Client::Client(const std::shared_ptr<Runtime> &rt)
 
 Client::~Client() {}
 
-void Client::start(const Configuration &configuration) {
+bool Client::start(const Configuration &configuration, bool allow_reattach) {
   try {
-    management_api_->start_container(configuration);
+    return management_api_->start_container(configuration, allow_reattach);
   } catch (const std::exception &e) {
     ERROR("Failed to start container: %s", e.what());
     if (terminate_callback_)
       terminate_callback_();
   }
+  return false;
 }
 
 void Client::stop() {
@@ -39,7 +39,8 @@ class Client {
   Client(const std::shared_ptr<Runtime> &rt);
   ~Client();
 
-  void start(const Configuration &configuration);
+  // Returns true if we got reattached to an already running container.
+  bool start(const Configuration &configuration, bool allow_reattach = false);
   void stop();
 
   void register_terminate_handler(const TerminateCallback &callback);
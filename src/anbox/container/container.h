@@ -40,6 +40,11 @@ class Container {
   // Stop a running container
   virtual void stop() = 0;
 
+  // Hand a running container over to a new client. Only the parts of the
+  // configuration which belong to the client, like the sockets it bind
+  // mounts into the container, are applied again.
+  virtual void reattach(const Configuration &configuration) = 0;
+
   // Get the current container state
   virtual State state() = 0;
 };
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/log_pipeline.h"
+#include "anbox/common/thread_topology.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr const size_t max_line_length{4096};
+constexpr const size_t read_chunk_size{65536};
+constexpr const int pipe_size{1024 * 1024};
+constexpr const int idle_timeout_ms{1000};
+const std::chrono::seconds rate_limit_window{1};
+}  // namespace
+
+namespace anbox {
+namespace container {
+LogPipeline::LogPipeline(const std::string &path, const Configuration &config)
+    : path_(path), input_path_(path + ".fifo"), config_(config) {
+  struct stat st;
+  if (::lstat(input_path_.c_str(), &st) == 0 && !S_ISFIFO(st.st_mode))
+    ::unlink(input_path_.c_str());
+
+  if (::mkfifo(input_path_.c_str(), 0600) < 0 && errno != EEXIST)
+    throw std::runtime_error(utils::string_format("Failed to create log FIFO %s: %s",
+                                                  input_path_, std::strerror(errno)));
+
+  input_fd_ = Fd{::open(input_path_.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)};
+  if (input_fd_ < 0)
+    throw std::runtime_error(utils::string_format("Failed to open log FIFO %s: %s",
+                                                  input_path_, std::strerror(errno)));
+
+  dummy_writer_fd_ = Fd{::open(input_path_.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC)};
+  if (dummy_writer_fd_ < 0)
+    throw std::runtime_error(utils::string_format("Failed to open log FIFO %s: %s",
+                                                  input_path_, std::strerror(errno)));
+
+  // Writers block once the pipe is full so give us some room to absorb
+  // bursts. Not being able to do so isn't fatal.
+  ::fcntl(input_fd_, F_SETPIPE_SZ, pipe_size);
+
+  wakeup_fd_ = Fd{::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)};
+  if (wakeup_fd_ < 0)
+    throw std::runtime_error(utils::string_format("Failed to create eventfd: %s", std::strerror(errno)));
+
+  open_log_file();
+
+  window_start_ = std::chrono::steady_clock::now();
+  worker_ = std::thread(&LogPipeline::worker_main, this);
+}
+
+LogPipeline::~LogPipeline() {
+  running_ = false;
+  const std::uint64_t value = 1;
+  if (::write(wakeup_fd_, &value, sizeof(value)) < 0)
+    WARNING("Failed to wake up log pipeline: %s", std::strerror(errno));
+  if (worker_.joinable())
+    worker_.join();
+
+  ::unlink(input_path_.c_str());
+}
+
+std::string LogPipeline::input_path() const {
+  return input_path_;
+}
+
+LogPipeline::Statistics LogPipeline::statistics() const {
+  Statistics stats;
+  stats.lines_written = lines_written_;
+  stats.lines_dropped = lines_dropped_;
+  stats.bytes_written = bytes_written_;
+  stats.rotations = rotations_;
+  return stats;
+}
+
+void LogPipeline::flush() {
+  const auto request = ++flush_requests_;
+  const std::uint64_t value = 1;
+  if (::write(wakeup_fd_, &value, sizeof(value)) < 0)
+    return;
+
+  while (running_ && flushes_done_ < request)
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+}
+
+void LogPipeline::worker_main() {
+  common::setup_current_thread(common::ThreadClass::Background, "log-pipeline");
+
+  std::vector<char> buffer(read_chunk_size);
+
+  struct pollfd fds[2];
+  fds[0].fd = input_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = wakeup_fd_;
+  fds[1].events = POLLIN;
+
+  while (true) {
+    fds[0].revents = 0;
+    fds[1].revents = 0;
+    const auto ret = ::poll(fds, 2, idle_timeout_ms);
+    if (ret < 0 && errno != EINTR) {
+      ERROR("Failed to wait for log data: %s", std::strerror(errno));
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      std::uint64_t value = 0;
+      if (::read(wakeup_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        WARNING("Failed to read from log pipeline eventfd: %s", std::strerror(errno));
+    }
+
+    // Everything written before a flush was requested is in the pipe
+    // already so draining it afterwards satisfies the request.
+    const std::uint64_t flush_target = flush_requests_;
+
+    while (true) {
+      const auto bytes_read = ::read(input_fd_, buffer.data(), buffer.size());
+      if (bytes_read <= 0)
+        break;
+      process(buffer.data(), bytes_read);
+      write_out();
+    }
+
+    // Makes sure the dropped lines get reported even when nothing is
+    // logged anymore.
+    accept_line(std::chrono::steady_clock::now(), false);
+    write_out();
+
+    flushes_done_ = flush_target;
+
+    if (!running_)
+      break;
+  }
+}
+
+void LogPipeline::process(const char *data, size_t size) {
+  while (size > 0) {
+    const auto newline = static_cast<const char*>(std::memchr(data, '\n', size));
+    if (!newline) {
+      // Lines without an end are cut so they can't make us grow forever.
+      const auto length = std::min(size, max_line_length - partial_line_.size());
+      partial_line_.append(data, length);
+      if (partial_line_.size() >= max_line_length) {
+        partial_line_.push_back('\n');
+        process_line(partial_line_.data(), partial_line_.size());
+        partial_line_.clear();
+      }
+      data += length;
+      size -= length;
+      continue;
+    }
+
+    const size_t length = newline - data + 1;
+    if (partial_line_.empty()) {
+      process_line(data, length);
+    } else {
+      partial_line_.append(data, length);
+      process_line(partial_line_.data(), partial_line_.size());
+      partial_line_.clear();
+    }
+
+    data += length;
+    size -= length;
+  }
+}
+
+void LogPipeline::process_line(const char *data, size_t size) {
+  if (!accept_line(std::chrono::steady_clock::now(), true))
+    return;
+
+  pending_output_.append(data, size);
+  lines_written_++;
+}
+
+bool LogPipeline::accept_line(const std::chrono::steady_clock::time_point &now, bool count) {
+  if (config_.max_lines_per_second == 0)
+    return true;
+
+  if (now - window_start_ >= rate_limit_window) {
+    if (dropped_in_window_ > 0)
+      pending_output_.append(utils::string_format(
+          "anbox: dropped %d lines because of rate limiting\n", dropped_in_window_));
+
+    window_start_ = now;
+    lines_in_window_ = 0;
+    dropped_in_window_ = 0;
+  }
+
+  if (!count)
+    return true;
+
+  if (lines_in_window_ < config_.max_lines_per_second) {
+    lines_in_window_++;
+    return true;
+  }
+
+  dropped_in_window_++;
+  lines_dropped_++;
+  return false;
+}
+
+void LogPipeline::write_out() {
+  if (pending_output_.empty())
+    return;
+
+  if (output_size_ > 0 && output_size_ + pending_output_.size() > config_.max_file_size)
+    rotate();
+
+  if (output_fd_ < 0) {
+    pending_output_.clear();
+    return;
+  }
+
+  size_t offset = 0;
+  while (offset < pending_output_.size()) {
+    const auto ret = ::write(output_fd_, pending_output_.data() + offset,
+                             pending_output_.size() - offset);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      ERROR("Failed to write to %s: %s", path_, std::strerror(errno));
+      break;
+    }
+    offset += ret;
+  }
+
+  output_size_ += offset;
+  bytes_written_ += offset;
+  pending_output_.clear();
+}
+
+void LogPipeline::open_log_file() {
+  output_fd_ = Fd{::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)};
+  if (output_fd_ < 0) {
+    ERROR("Failed to open log file %s: %s", path_, std::strerror(errno));
+    output_size_ = 0;
+    return;
+  }
+
+  struct stat st;
+  output_size_ = (::fstat(output_fd_, &st) == 0) ? st.st_size : 0;
+}
+
+void LogPipeline::rotate() {
+  output_fd_ = Fd{};
+
+  if (config_.max_rotated_files == 0) {
+    ::unlink(path_.c_str());
+  } else {
+    for (auto n = config_.max_rotated_files; n > 1; n--) {
+      const auto from = utils::string_format("%s.%d", path_, n - 1);
+      const auto to = utils::string_format("%s.%d", path_, n);
+      ::rename(from.c_str(), to.c_str());
+    }
+    ::rename(path_.c_str(), utils::string_format("%s.1", path_).c_str());
+  }
+
+  rotations_++;
+  open_log_file();
+}
+}  // namespace container
+}  // namespace anbox
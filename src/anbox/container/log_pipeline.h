@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_LOG_PIPELINE_H_
+#define ANBOX_CONTAINER_LOG_PIPELINE_H_
+
+#include "anbox/common/fd.h"
+#include "anbox/do_not_copy_or_move.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace anbox {
+namespace container {
+// Sits between LXC and a log file on disk. LXC gets a FIFO to write to
+// which we drain from our own thread. Lines are rate limited and the file
+// is rotated once it reaches its maximum size so a chatty guest can't
+// flood the disk of the host.
+class LogPipeline : public DoNotCopyOrMove {
+ public:
+  struct Configuration {
+    // Size after which the log file gets rotated.
+    std::uint64_t max_file_size = 4 * 1024 * 1024;
+    // Number of rotated files we keep next to the current one.
+    unsigned int max_rotated_files = 2;
+    // Lines accepted per second. Everything above is dropped and only
+    // counted. Zero disables rate limiting.
+    unsigned int max_lines_per_second = 500;
+  };
+
+  struct Statistics {
+    std::uint64_t lines_written = 0;
+    std::uint64_t lines_dropped = 0;
+    std::uint64_t bytes_written = 0;
+    std::uint64_t rotations = 0;
+  };
+
+  LogPipeline(const std::string &path, const Configuration &config);
+  ~LogPipeline();
+
+  // Path of the FIFO writers have to log to.
+  std::string input_path() const;
+
+  Statistics statistics() const;
+
+  // Waits until everything written to the FIFO so far made it into the
+  // log file. Mostly useful for tests.
+  void flush();
+
+ private:
+  void worker_main();
+  void process(const char *data, size_t size);
+  void process_line(const char *data, size_t size);
+  // Applies the rate limit. Also reports dropped lines once the current
+  // window is over, even when called with count set to false.
+  bool accept_line(const std::chrono::steady_clock::time_point &now, bool count);
+  void write_out();
+  void open_log_file();
+  void rotate();
+
+  const std::string path_;
+  const std::string input_path_;
+  const Configuration config_;
+
+  Fd input_fd_;
+  // Kept open so the FIFO doesn't signal EOF when the last writer goes away.
+  Fd dummy_writer_fd_;
+  Fd wakeup_fd_;
+  Fd output_fd_;
+  std::uint64_t output_size_ = 0;
+
+  std::string partial_line_;
+  std::string pending_output_;
+
+  std::chrono::steady_clock::time_point window_start_;
+  unsigned int lines_in_window_ = 0;
+  std::uint64_t dropped_in_window_ = 0;
+
+  std::atomic<std::uint64_t> lines_written_{0};
+  std::atomic<std::uint64_t> lines_dropped_{0};
+  std::atomic<std::uint64_t> bytes_written_{0};
+  std::atomic<std::uint64_t> rotations_{0};
+  std::atomic<std::uint64_t> flush_requests_{0};
+  std::atomic<std::uint64_t> flushes_done_{0};
+
+  std::atomic<bool> running_{true};
+  std::thread worker_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
@@ -21,15 +21,21 @@
 #include "anbox/logger.h"
 #include "anbox/utils.h"
 
+#include <chrono>
 #include <map>
+#include <set>
 #include <stdexcept>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <boost/throw_exception.hpp>
 
+#include <lxc/version.h>
+
 #include <sys/capability.h>
+#include <sys/mount.h>
 #include <sys/prctl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -77,13 +83,31 @@ constexpr const char *lxc_config_log_file_key{"lxc.log.file"};
 constexpr const char *lxc_config_apparmor_profile_key{"lxc.apparmor.profile"};
 #endif
 
-constexpr int device_major(__dev_t dev) {
-  return int(((dev >> 8) & 0xfff) | ((dev >> 32) & (0xfffff000)));
-}
+// Records how long the individual phases of the container setup take.
+class PhaseTimer {
+ public:
+  PhaseTimer() : last_{std::chrono::steady_clock::now()} {}
 
-constexpr int device_minor(__dev_t dev) {
-  return int((dev & 0xff) | ((dev >> 12) & (0xffffff00)));
-}
+  void finish(const std::string &name) {
+    const auto now = std::chrono::steady_clock::now();
+    phases_.push_back({name, std::chrono::duration_cast<std::chrono::milliseconds>(now - last_)});
+    last_ = now;
+  }
+
+  std::string summary() const {
+    std::stringstream ss;
+    for (const auto &phase : phases_) {
+      if (ss.tellp() > 0)
+        ss << ", ";
+      ss << phase.first << " " << phase.second.count() << " ms";
+    }
+    return ss.str();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point last_;
+  std::vector<std::pair<std::string, std::chrono::milliseconds>> phases_;
+};
 } // namespace
 
 namespace anbox {
@@ -93,6 +117,8 @@ LxcContainer::LxcContainer(bool privileged,
                            const std::string& container_network_address,
                            const std::string &container_network_gateway,
                            const std::vector<std::string> &container_network_dns_servers,
+                           const std::string &log_level,
+                           const LogPipeline::Configuration &log_config,
                            const network::Credentials &creds)
     : state_(State::inactive),
       container_(nullptr),
@@ -101,6 +127,8 @@ LxcContainer::LxcContainer(bool privileged,
       container_network_address_(container_network_address),
       container_network_gateway_(container_network_gateway),
       container_network_dns_servers_(container_network_dns_servers),
+      log_level_(log_level),
+      log_config_(log_config),
       creds_(creds) {
   utils::ensure_paths({
       SystemConfiguration::instance().container_config_dir(),
@@ -135,7 +163,7 @@ void LxcContainer::setup_id_map() {
                                                      max_id - creds_.gid() - 1));
 }
 
-void LxcContainer::setup_network() {
+void LxcContainer::setup_network(SetupReconciler &reconciler) {
   if (!fs::exists("/sys/class/net/anbox0")) {
     WARNING("Anbox bridge interface 'anbox0' doesn't exist. Network functionality will not be available");
     return;
@@ -190,34 +218,26 @@ void LxcContainer::setup_network() {
   auto path = SystemConfiguration::instance().data_dir();
   for (auto iter = data_ethernet_path.begin(); iter != data_ethernet_path.end(); iter++) {
     path /= *iter;
-
-    struct stat st;
-    if (stat(path.c_str(), &st) < 0) {
-      WARNING("Cannot retrieve permissions of path %s", path);
-      continue;
+    try {
+      reconciler.ensure_not_owned_by_root(path.string(), unprivileged_uid, unprivileged_uid);
+    } catch (const std::exception &err) {
+      WARNING("%s", err.what());
     }
-
-    if (st.st_uid != 0 && st.st_gid != 0)
-      continue;
-
-    if (::chown(path.c_str(), unprivileged_uid, unprivileged_uid) < 0)
-      WARNING("Failed to set owner for path '%s'", path);
   }
 
+  // Android only reads the file on boot so we only have to write it when
+  // the configuration actually changed.
   const auto ip_conf_path = ip_conf_dir / "ipconfig.txt";
-  if (fs::exists(ip_conf_path))
-    fs::remove(ip_conf_path);
-
-  std::ofstream f(ip_conf_path.string(), std::ofstream::binary);
-  if (f.is_open()) {
-    f.write(reinterpret_cast<const char*>(buffer.data()), size);
-    f.close();
-  } else {
-    ERROR("Failed to write IP configuration. Network functionality will not be available.");
+  try {
+    reconciler.ensure_file_content(ip_conf_path.string(),
+                                   std::string(reinterpret_cast<const char*>(buffer.data()), size));
+  } catch (const std::exception &err) {
+    ERROR("Failed to write IP configuration. Network functionality will not be available: %s", err.what());
   }
 }
 
-void LxcContainer::add_device(const std::string& device, const DeviceSpecification& spec) {
+void LxcContainer::add_device(const std::string& device, const DeviceSpecification& spec,
+                              SetupReconciler &reconciler) {
   struct stat st;
   int r = stat(device.c_str(), &st);
   if (r < 0) {
@@ -225,40 +245,25 @@ void LxcContainer::add_device(const std::string& device, const DeviceSpecificati
     throw std::runtime_error(msg);
   }
 
-  const auto major = device_major(st.st_rdev);
-  const auto minor = device_minor(st.st_rdev);
-  const auto mode = ((st.st_mode >> 9) << 9) | (spec.permission & ~(1 << 9));
   const auto new_device_name = fs::basename(device);
   const auto devices_path = fs::path(SystemConfiguration::instance().container_devices_dir());
   const auto new_device_path = (devices_path / new_device_name).string();
 
-  const auto encoded_device_number = (minor & 0xff) | (major << 8) | ((minor & !0xff) << 12);
-  r = mknod(new_device_path.c_str(), mode, encoded_device_number);
-  if (r < 0) {
-    auto msg = utils::string_format("Failed to create node for device %s: %s",
-                                    device, strerror(errno));
-    throw std::runtime_error(msg);
-  }
-
   auto base_uid = unprivileged_uid;
   if (privileged_)
     base_uid = 0;
 
-  const auto shifted_uid = base_uid + st.st_uid;
-  const auto shifted_gid = base_uid + st.st_gid;
-  r = chown(new_device_path.c_str(), shifted_uid, shifted_gid);
-  if (r < 0) {
-    auto msg = utils::string_format("Failed to change ownership of new node for %s: %s",
-                                    device, strerror(errno));
-    throw std::runtime_error(msg);
-  }
-
-  // Needed as mknod respects the umask
-  r = chmod(new_device_path.c_str(), mode);
-  if (r < 0) {
-    auto msg = utils::string_format("Failed to change mode of new node for %s: %s",
-                                    device, strerror(errno));
-    throw::std::runtime_error(msg);
+  SetupReconciler::Node node;
+  node.mode = ((st.st_mode >> 9) << 9) | (spec.permission & ~(1 << 9));
+  node.rdev = st.st_rdev;
+  node.uid = base_uid + st.st_uid;
+  node.gid = base_uid + st.st_gid;
+
+  try {
+    reconciler.ensure_node(new_device_path, node);
+  } catch (const std::exception &err) {
+    throw std::runtime_error(utils::string_format("Failed to set up node for device %s: %s",
+                                                  device, err.what()));
   }
 
   auto target_path = device;
@@ -275,17 +280,27 @@ void LxcContainer::start(const Configuration &configuration) {
   if (getuid() != 0)
     throw std::runtime_error("You have to start the container as root");
 
+  const auto setup_start_time = std::chrono::steady_clock::now();
+  PhaseTimer phases;
+  SetupReconciler reconciler;
+
   if (container_ && container_->is_running(container_)) {
     WARNING("Container already started, stopping it now");
     container_->stop(container_);
   }
 
+  const auto container_config_dir = SystemConfiguration::instance().container_config_dir();
+  const auto config_path = utils::string_format("%s/default/config", container_config_dir);
+  const auto previous_config_path = config_path + ".previous";
+
   if (!container_) {
-    const auto container_config_dir = SystemConfiguration::instance().container_config_dir();
     DEBUG("Containers are stored in %s", container_config_dir);
 
-    // Remove container config to be be able to rewrite it
-    ::unlink(utils::string_format("%s/default/config", container_config_dir).c_str());
+    // Move the container config out of the way so LXC doesn't load it. We
+    // compare it against the one we generate below and only replace it
+    // when something changed.
+    if (fs::exists(config_path))
+      fs::rename(config_path, previous_config_path);
 
     container_ = lxc_container_new("default", container_config_dir.c_str());
     if (!container_)
@@ -295,6 +310,10 @@ void LxcContainer::start(const Configuration &configuration) {
     // to ensure its configuration is synchronized.
     if (container_->is_running(container_))
       container_->stop(container_);
+  } else {
+    // Start over with an empty configuration as otherwise list items like
+    // mount entries would pile up with every start.
+    container_->clear_config(container_);
   }
 
   // We can mount proc/sys as rw here as we will run the container unprivileged
@@ -330,18 +349,29 @@ void LxcContainer::start(const Configuration &configuration) {
   DEBUG("Using rootfs path %s", rootfs_path);
   set_config_item(lxc_config_rootfs_path_key, rootfs_path);
 
-  set_config_item(lxc_config_log_level_key, "0");
+  // LXC doesn't write its logs to disk itself but through our pipelines
+  // which rate limit and rotate them.
   const auto log_path = SystemConfiguration::instance().log_dir();
-  set_config_item(lxc_config_log_file_key, utils::string_format("%s/container.log", log_path).c_str());
+  if (!container_log_)
+    container_log_ = std::make_shared<LogPipeline>(
+        utils::string_format("%s/container.log", log_path), log_config_);
+
+  set_config_item(lxc_config_log_level_key, log_level_);
+  set_config_item(lxc_config_log_file_key, container_log_->input_path());
 
 #ifndef ENABLE_LXC2_SUPPORT
-    // Dump the console output to disk to have a chance to debug early boot problems
-    set_config_item("lxc.console.logfile", utils::string_format("%s/console.log", log_path).c_str());
-    set_config_item("lxc.console.rotate", "1");
+  // Dump the console output to disk to have a chance to debug early boot problems
+  if (!console_log_)
+    console_log_ = std::make_shared<LogPipeline>(
+        utils::string_format("%s/console.log", log_path), log_config_);
+
+  set_config_item("lxc.console.logfile", console_log_->input_path());
 #endif
 
+  phases.finish("config");
 
-  setup_network();
+  setup_network(reconciler);
+  phases.finish("network");
 
 #ifdef ENABLE_SNAP_CONFINEMENT
   // We take the AppArmor profile snapd has defined for us as part of the
@@ -375,6 +405,8 @@ void LxcContainer::start(const Configuration &configuration) {
     set_config_item("lxc.mount.entry", entry);
   }
 
+  phases.finish("mounts");
+
   auto devices = configuration.devices;
 
   // Additional devices we need in our container
@@ -386,24 +418,70 @@ void LxcContainer::start(const Configuration &configuration) {
   devices.insert({"/dev/urandom", {0666}});
   devices.insert({"/dev/zero", {0666}});
 
-  // Remove all left over devices from last time first before
-  // creating any new ones
+  // Device nodes from the last start are kept when they still match and
+  // only those we don't need anymore are removed.
   const auto devices_dir = SystemConfiguration::instance().container_devices_dir();
-  fs::remove_all(devices_dir);
-  fs::create_directories(devices_dir);
+  if (!fs::exists(devices_dir))
+    fs::create_directories(devices_dir);
+
+  std::set<std::string> device_names;
+  for (const auto& device : devices)
+    device_names.insert(fs::basename(device.first));
+  reconciler.remove_stale_entries(devices_dir, device_names);
 
   for (const auto& device : devices)
-    add_device(device.first, device.second);
+    add_device(device.first, device.second, reconciler);
+
+  phases.finish("devices");
 
-  if (!container_->save_config(container_, nullptr))
+  const auto new_config_path = config_path + ".new";
+  fs::create_directories(fs::path(config_path).parent_path());
+  if (!container_->save_config(container_, new_config_path.c_str()))
     throw std::runtime_error("Failed to save container configuration");
 
+  if (fs::exists(previous_config_path))
+    fs::rename(previous_config_path, config_path);
+  reconciler.ensure_file_from(new_config_path, config_path);
+
+  phases.finish("save config");
+
+  const auto reconciler_stats = reconciler.statistics();
+  DEBUG("Container setup created %d, updated %d and removed %d entries, %d were up to date",
+        reconciler_stats.created, reconciler_stats.updated,
+        reconciler_stats.removed, reconciler_stats.unchanged);
+
+  const auto log_stats_before = log_statistics();
+  const auto lxc_start_time = std::chrono::steady_clock::now();
+
   if (!container_->start(container_, 0, nullptr))
     throw std::runtime_error("Failed to start container");
 
   state_ = Container::State::running;
 
-  DEBUG("Container successfully started");
+  const auto now = std::chrono::steady_clock::now();
+  const auto log_stats = log_statistics();
+  INFO("Container started in %d ms (setup %d ms [%s], LXC start %d ms), logged %d lines / %d bytes, dropped %d lines",
+       std::chrono::duration_cast<std::chrono::milliseconds>(now - setup_start_time).count(),
+       std::chrono::duration_cast<std::chrono::milliseconds>(lxc_start_time - setup_start_time).count(),
+       phases.summary(),
+       std::chrono::duration_cast<std::chrono::milliseconds>(now - lxc_start_time).count(),
+       log_stats.lines_written - log_stats_before.lines_written,
+       log_stats.bytes_written - log_stats_before.bytes_written,
+       log_stats.lines_dropped - log_stats_before.lines_dropped);
+}
+
+LogPipeline::Statistics LxcContainer::log_statistics() const {
+  LogPipeline::Statistics stats;
+  for (const auto &pipeline : {container_log_, console_log_}) {
+    if (!pipeline)
+      continue;
+    const auto s = pipeline->statistics();
+    stats.lines_written += s.lines_written;
+    stats.lines_dropped += s.lines_dropped;
+    stats.bytes_written += s.bytes_written;
+    stats.rotations += s.rotations;
+  }
+  return stats;
 }
 
 void LxcContainer::stop() {
@@ -418,6 +496,37 @@ void LxcContainer::stop() {
   DEBUG("Container successfully stopped");
 }
 
+void LxcContainer::reattach(const Configuration &configuration) {
+  if (!container_ || !container_->is_running(container_))
+    throw std::runtime_error("Container is not running");
+
+#if LXC_VERSION_MAJOR > 3 || (LXC_VERSION_MAJOR == 3 && LXC_VERSION_MINOR >= 1)
+  for (const auto &bind_mount : configuration.bind_mounts) {
+    // Directories are still the same ones on the host side, only the socket
+    // files of the new client got recreated and need to be mounted again.
+    if (fs::is_directory(bind_mount.first))
+      continue;
+
+    auto target_path = bind_mount.second;
+    if (!utils::string_starts_with(target_path, "/"))
+      target_path = std::string("/") + target_path;
+
+    // Drop the mount which still points to the socket of the previous
+    // client. It may already be gone which is fine.
+    container_->umount(container_, target_path.c_str(), MNT_DETACH, nullptr);
+
+    if (container_->mount(container_, bind_mount.first.c_str(), target_path.c_str(),
+                          nullptr, MS_BIND, nullptr, nullptr) < 0)
+      throw std::runtime_error(utils::string_format("Failed to bind mount %s into container", target_path));
+  }
+
+  DEBUG("Reattached to running container");
+#else
+  (void) configuration;
+  throw std::runtime_error("Reattaching requires at least LXC 3.1");
+#endif
+}
+
 void LxcContainer::set_config_item(const std::string &key,
                                    const std::string &value) {
   if (!container_->set_config_item(container_, key.c_str(), value.c_str())) {
@@ -19,8 +19,11 @@
 #define ANBOX_CONTAINER_LXC_CONTAINER_H_
 
 #include "anbox/container/container.h"
+#include "anbox/container/log_pipeline.h"
+#include "anbox/container/setup_reconciler.h"
 #include "anbox/network/credentials.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -35,18 +38,23 @@ class LxcContainer : public Container {
                const std::string &container_network_address,
                const std::string &container_network_gateway,
                const std::vector<std::string> &container_network_dns_servers,
+               const std::string &log_level,
+               const LogPipeline::Configuration &log_config,
                const network::Credentials &creds);
   ~LxcContainer();
 
   void start(const Configuration &configuration) override;
   void stop() override;
+  void reattach(const Configuration &configuration) override;
   State state() override;
 
  private:
   void set_config_item(const std::string &key, const std::string &value);
   void setup_id_map();
-  void setup_network();
-  void add_device(const std::string& device, const DeviceSpecification& spec);
+  void setup_network(SetupReconciler &reconciler);
+  void add_device(const std::string& device, const DeviceSpecification& spec,
+                  SetupReconciler &reconciler);
+  LogPipeline::Statistics log_statistics() const;
 
   State state_;
   lxc_container *container_;
@@ -55,6 +63,10 @@ class LxcContainer : public Container {
   std::string container_network_address_;
   std::string container_network_gateway_;
   std::vector<std::string> container_network_dns_servers_;
+  std::string log_level_;
+  LogPipeline::Configuration log_config_;
+  std::shared_ptr<LogPipeline> container_log_;
+  std::shared_ptr<LogPipeline> console_log_;
   network::Credentials creds_;
 };
 }  // namespace container
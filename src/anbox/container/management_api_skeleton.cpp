@@ -36,10 +36,11 @@ ManagementApiSkeleton::~ManagementApiSkeleton() {}
 
 void ManagementApiSkeleton::start_container(
     anbox::protobuf::container::StartContainer const *request,
-    anbox::protobuf::rpc::Void *response, google::protobuf::Closure *done) {
+    anbox::protobuf::container::StartContainerResult *response,
+    google::protobuf::Closure *done) {
   DEBUG("");
 
-  if (container_->state() == Container::State::running) {
+  if (container_->state() == Container::State::running && !request->allow_reattach()) {
     response->set_error("Container is already running");
     done->Run();
     return;
@@ -58,6 +59,27 @@ void ManagementApiSkeleton::start_container(
     container_configuration.devices.insert({device.path(), {device.permission()}});
   }
 
+  if (container_->state() == Container::State::running) {
+    try {
+      container_->reattach(container_configuration);
+      response->set_reattached(true);
+      done->Run();
+      return;
+    } catch (std::exception &err) {
+      // Not being able to reattach only costs us a full boot of Android so
+      // we restart the container rather than failing.
+      WARNING("Failed to reattach to running container, restarting it: %s", err.what());
+    }
+
+    try {
+      container_->stop();
+    } catch (std::exception &err) {
+      response->set_error(utils::string_format("Failed to stop container: %s", err.what()));
+      done->Run();
+      return;
+    }
+  }
+
   try {
     container_->start(container_configuration);
   } catch (std::exception &err) {
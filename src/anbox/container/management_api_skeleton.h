@@ -33,6 +33,7 @@ class Void;
 }  // namespace rpc
 namespace container {
 class StartContainer;
+class StartContainerResult;
 class StopContainer;
 }  // namespace container
 }  // namespace protobuf
@@ -50,7 +51,8 @@ class ManagementApiSkeleton {
 
   void start_container(
       anbox::protobuf::container::StartContainer const *request,
-      anbox::protobuf::rpc::Void *response, google::protobuf::Closure *done);
+      anbox::protobuf::container::StartContainerResult *response,
+      google::protobuf::Closure *done);
 
   void stop_container(
       anbox::protobuf::container::StopContainer const *request,
@@ -33,8 +33,8 @@ ManagementApiStub::ManagementApiStub(
 
 ManagementApiStub::~ManagementApiStub() {}
 
-void ManagementApiStub::start_container(const Configuration &configuration) {
-  auto c = std::make_shared<Request<protobuf::rpc::Void>>();
+bool ManagementApiStub::start_container(const Configuration &configuration, bool allow_reattach) {
+  auto c = std::make_shared<Request<protobuf::container::StartContainerResult>>();
 
   protobuf::container::StartContainer message;
   auto message_configuration = new protobuf::container::Configuration;
@@ -52,6 +52,7 @@ void ManagementApiStub::start_container(const Configuration &configuration) {
   }
 
   message.set_allocated_configuration(message_configuration);
+  message.set_allow_reattach(allow_reattach);
 
   {
     std::lock_guard<decltype(mutex_)> lock(mutex_);
@@ -64,9 +65,11 @@ void ManagementApiStub::start_container(const Configuration &configuration) {
   c->wh.wait_for_all();
 
   if (c->response->has_error()) throw std::runtime_error(c->response->error());
+
+  return c->response->reattached();
 }
 
-void ManagementApiStub::container_started(Request<protobuf::rpc::Void> *request) {
+void ManagementApiStub::container_started(Request<protobuf::container::StartContainerResult> *request) {
   request->wh.result_received();
 }
 
@@ -29,6 +29,9 @@ namespace protobuf {
 namespace rpc {
 class Void;
 }  // namespace rpc
+namespace container {
+class StartContainerResult;
+}  // namespace container
 }  // namespace protobuf
 namespace rpc {
 class Channel;
@@ -39,7 +42,9 @@ class ManagementApiStub : public DoNotCopyOrMove {
   ManagementApiStub(const std::shared_ptr<rpc::Channel> &channel);
   ~ManagementApiStub();
 
-  void start_container(const Configuration &configuration);
+  // Returns true when the container manager handed us an already running
+  // container instead of starting a new one.
+  bool start_container(const Configuration &configuration, bool allow_reattach = false);
   void stop_container();
 
  private:
@@ -51,7 +56,7 @@ class ManagementApiStub : public DoNotCopyOrMove {
     common::WaitHandle wh;
   };
 
-  void container_started(Request<protobuf::rpc::Void> *request);
+  void container_started(Request<protobuf::container::StartContainerResult> *request);
   void container_stopped(Request<protobuf::rpc::Void> *request);
 
   mutable std::mutex mutex_;
@@ -68,6 +68,8 @@ Service::Service(const std::shared_ptr<Runtime> &rt, const Configuration &config
 
 Service::~Service() {
   connections_->clear();
+  // Stops the container if one is still running.
+  backend_.reset();
 }
 
 int Service::next_id() { return next_connection_id_++; }
@@ -81,17 +83,39 @@ void Service::new_client(std::shared_ptr<boost::asio::local::stream_protocol::so
 
   auto const messenger = std::make_shared<network::LocalSocketMessenger>(socket);
 
-  DEBUG("Got connection from pid %d", messenger->creds().pid());
+  const auto creds = messenger->creds();
+
+  DEBUG("Got connection from pid %d", creds.pid());
+
+  // The container outlives the connection of the client which started it so
+  // that a restarted session manager can reattach to it instead of booting
+  // Android again. As the user of the client is mapped into the container
+  // we can only do this as long as the user stays the same.
+  if (backend_ && (backend_uid_ != creds.uid() || backend_gid_ != creds.gid())) {
+    WARNING("Client runs as a different user than the running container, stopping it");
+    backend_.reset();
+  }
+
+  if (!backend_) {
+    if (config_.create_backend)
+      backend_ = config_.create_backend(creds);
+    else
+      backend_ = std::make_shared<LxcContainer>(config_.privileged,
+                                                config_.rootfs_overlay,
+                                                config_.container_network_address,
+                                                config_.container_network_gateway,
+                                                config_.container_network_dns_servers,
+                                                config_.container_log_level,
+                                                config_.container_log,
+                                                creds);
+    backend_uid_ = creds.uid();
+    backend_gid_ = creds.gid();
+  }
 
   auto pending_calls = std::make_shared<rpc::PendingCallCache>();
   auto rpc_channel = std::make_shared<rpc::Channel>(pending_calls, messenger);
   auto server = std::make_shared<container::ManagementApiSkeleton>(
-      pending_calls, std::make_shared<LxcContainer>(config_.privileged,
-                                                    config_.rootfs_overlay,
-                                                    config_.container_network_address,
-                                                    config_.container_network_gateway,
-                                                    config_.container_network_dns_servers,
-                                                    messenger->creds()));
+      pending_calls, backend_);
   auto processor = std::make_shared<container::ManagementApiMessageProcessor>(
       messenger, pending_calls, server);
 
@@ -20,12 +20,15 @@
 
 #include "anbox/common/dispatcher.h"
 #include "anbox/container/container.h"
+#include "anbox/container/log_pipeline.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/credentials.h"
 #include "anbox/network/published_socket_connector.h"
 #include "anbox/network/socket_connection.h"
 #include "anbox/runtime.h"
 
+#include <functional>
+
 namespace anbox {
 namespace container {
 class Service : public std::enable_shared_from_this<Service> {
@@ -36,6 +39,10 @@ class Service : public std::enable_shared_from_this<Service> {
     std::string container_network_address;
     std::string container_network_gateway;
     std::vector<std::string> container_network_dns_servers;
+    std::string container_log_level = "WARN";
+    LogPipeline::Configuration container_log;
+    // Creates the container for a client. Defaults to an LXC container.
+    std::function<std::shared_ptr<Container>(const network::Credentials &creds)> create_backend;
   };
 
   static std::shared_ptr<Service> create(const std::shared_ptr<Runtime> &rt,
@@ -55,6 +62,8 @@ class Service : public std::enable_shared_from_this<Service> {
   std::atomic<int> next_connection_id_;
   std::shared_ptr<network::Connections<network::SocketConnection>> connections_;
   std::shared_ptr<Container> backend_;
+  uid_t backend_uid_ = 0;
+  gid_t backend_gid_ = 0;
   Configuration config_;
 };
 }  // namespace container
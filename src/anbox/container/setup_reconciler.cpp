@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/setup_reconciler.h"
+#include "anbox/utils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+bool read_file(const std::string &path, std::string &content) {
+  std::ifstream in(path, std::ifstream::binary);
+  if (!in.is_open())
+    return false;
+  std::stringstream ss;
+  ss << in.rdbuf();
+  content = ss.str();
+  return true;
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+SetupReconciler::Result SetupReconciler::ensure_file_content(const std::string &path, const std::string &content) {
+  std::string current;
+  const auto existed = read_file(path, current);
+  if (existed && current == content)
+    return count(Result::unchanged);
+
+  const auto tmp_path = path + ".tmp";
+  std::ofstream out(tmp_path, std::ofstream::binary | std::ofstream::trunc);
+  if (!out.is_open())
+    throw std::runtime_error(utils::string_format("Failed to open %s for writing", tmp_path));
+
+  out.write(content.data(), content.size());
+  out.close();
+  if (!out)
+    throw std::runtime_error(utils::string_format("Failed to write %s", tmp_path));
+
+  if (::rename(tmp_path.c_str(), path.c_str()) < 0) {
+    const auto err = errno;
+    ::unlink(tmp_path.c_str());
+    throw std::runtime_error(utils::string_format("Failed to replace %s: %s", path, strerror(err)));
+  }
+
+  return count(existed ? Result::updated : Result::created);
+}
+
+SetupReconciler::Result SetupReconciler::ensure_file_from(const std::string &source, const std::string &path) {
+  std::string wanted;
+  if (!read_file(source, wanted))
+    throw std::runtime_error(utils::string_format("Failed to read %s", source));
+
+  std::string current;
+  const auto existed = read_file(path, current);
+  if (existed && current == wanted) {
+    ::unlink(source.c_str());
+    return count(Result::unchanged);
+  }
+
+  if (::rename(source.c_str(), path.c_str()) < 0)
+    throw std::runtime_error(utils::string_format("Failed to replace %s: %s", path, strerror(errno)));
+
+  return count(existed ? Result::updated : Result::created);
+}
+
+SetupReconciler::Result SetupReconciler::ensure_node(const std::string &path, const Node &node) {
+  const auto type = node.mode & S_IFMT;
+  const auto permissions = node.mode & 07777;
+
+  struct stat st;
+  if (::lstat(path.c_str(), &st) == 0) {
+    const auto is_device = type == S_IFCHR || type == S_IFBLK;
+    if ((st.st_mode & S_IFMT) == type && (!is_device || st.st_rdev == node.rdev)) {
+      auto result = Result::unchanged;
+
+      if (st.st_uid != node.uid || st.st_gid != node.gid) {
+        if (::lchown(path.c_str(), node.uid, node.gid) < 0)
+          throw std::runtime_error(utils::string_format("Failed to change ownership of %s: %s",
+                                                        path, strerror(errno)));
+        result = Result::updated;
+      }
+
+      // chown can drop setuid/setgid bits so check the mode afterwards.
+      if (result == Result::updated || (st.st_mode & 07777) != permissions) {
+        if (::chmod(path.c_str(), permissions) < 0)
+          throw std::runtime_error(utils::string_format("Failed to change mode of %s: %s",
+                                                        path, strerror(errno)));
+        result = Result::updated;
+      }
+
+      return count(result);
+    }
+
+    boost::system::error_code err;
+    fs::remove_all(path, err);
+    if (err)
+      throw std::runtime_error(utils::string_format("Failed to remove %s: %s", path, err.message()));
+  }
+
+  if (::mknod(path.c_str(), node.mode, node.rdev) < 0)
+    throw std::runtime_error(utils::string_format("Failed to create node %s: %s",
+                                                  path, strerror(errno)));
+
+  if (::chown(path.c_str(), node.uid, node.gid) < 0)
+    throw std::runtime_error(utils::string_format("Failed to change ownership of %s: %s",
+                                                  path, strerror(errno)));
+
+  // Needed as mknod respects the umask
+  if (::chmod(path.c_str(), permissions) < 0)
+    throw std::runtime_error(utils::string_format("Failed to change mode of %s: %s",
+                                                  path, strerror(errno)));
+
+  return count(Result::created);
+}
+
+SetupReconciler::Result SetupReconciler::ensure_not_owned_by_root(const std::string &path, uid_t uid, gid_t gid) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) < 0)
+    throw std::runtime_error(utils::string_format("Cannot retrieve permissions of path %s: %s",
+                                                  path, strerror(errno)));
+
+  if (st.st_uid != 0 && st.st_gid != 0)
+    return count(Result::unchanged);
+
+  if (::chown(path.c_str(), uid, gid) < 0)
+    throw std::runtime_error(utils::string_format("Failed to set owner for path %s: %s",
+                                                  path, strerror(errno)));
+
+  return count(Result::updated);
+}
+
+void SetupReconciler::remove_stale_entries(const std::string &dir, const std::set<std::string> &keep) {
+  boost::system::error_code err;
+  for (fs::directory_iterator iter(dir, err), end; !err && iter != end; iter.increment(err)) {
+    const auto name = iter->path().filename().string();
+    if (keep.find(name) != keep.end())
+      continue;
+
+    fs::remove_all(iter->path(), err);
+    if (err)
+      throw std::runtime_error(utils::string_format("Failed to remove %s: %s",
+                                                    iter->path().string(), err.message()));
+    stats_.removed++;
+  }
+}
+
+SetupReconciler::Statistics SetupReconciler::statistics() const {
+  return stats_;
+}
+
+SetupReconciler::Result SetupReconciler::count(Result result) {
+  switch (result) {
+  case Result::created:
+    stats_.created++;
+    break;
+  case Result::updated:
+    stats_.updated++;
+    break;
+  case Result::unchanged:
+    stats_.unchanged++;
+    break;
+  }
+  return result;
+}
+}  // namespace container
+}  // namespace anbox
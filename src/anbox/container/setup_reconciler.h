@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_CONTAINER_SETUP_RECONCILER_H_
+#define ANBOX_CONTAINER_SETUP_RECONCILER_H_
+
+#include <set>
+#include <string>
+
+#include <sys/types.h>
+
+namespace anbox {
+namespace container {
+// Brings files the container setup depends on into the desired state
+// while only touching what actually differs from it. This keeps a
+// container start cheap when nothing changed since the last one.
+class SetupReconciler {
+ public:
+  enum class Result {
+    unchanged,
+    updated,
+    created,
+  };
+
+  struct Node {
+    // File type and permission bits as passed to mknod(2).
+    mode_t mode = 0;
+    // Only relevant for character and block devices.
+    dev_t rdev = 0;
+    uid_t uid = 0;
+    gid_t gid = 0;
+  };
+
+  struct Statistics {
+    unsigned int created = 0;
+    unsigned int updated = 0;
+    unsigned int unchanged = 0;
+    unsigned int removed = 0;
+  };
+
+  // Writes content to path unless the file already has exactly that
+  // content. The file is replaced atomically.
+  Result ensure_file_content(const std::string &path, const std::string &content);
+
+  // Moves source over path if both differ in content. Otherwise source is
+  // removed and path is left untouched.
+  Result ensure_file_from(const std::string &source, const std::string &path);
+
+  // Creates the node at path or fixes mode and ownership of an existing
+  // one. Nodes of the wrong type or device number are recreated.
+  Result ensure_node(const std::string &path, const Node &node);
+
+  // Changes the ownership of path but only if it is currently owned by root.
+  Result ensure_not_owned_by_root(const std::string &path, uid_t uid, gid_t gid);
+
+  // Removes everything within dir which isn't listed in keep.
+  void remove_stale_entries(const std::string &dir, const std::set<std::string> &keep);
+
+  Statistics statistics() const;
+
+ private:
+  Result count(Result result);
+
+  Statistics stats_;
+};
+}  // namespace container
+}  // namespace anbox
+
+#endif
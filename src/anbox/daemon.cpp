@@ -26,6 +26,7 @@
 #include "anbox/cmds/session_manager.h"
 #include "anbox/cmds/system_info.h"
 #include "anbox/cmds/launch.h"
+#include "anbox/cmds/replay_bridge.h"
 #include "anbox/cmds/version.h"
 #include "anbox/cmds/wait_ready.h"
 #include "anbox/cmds/check_features.h"
@@ -44,7 +45,8 @@ Daemon::Daemon()
      .command(std::make_shared<cmds::ContainerManager>())
      .command(std::make_shared<cmds::SystemInfo>())
      .command(std::make_shared<cmds::WaitReady>())
-     .command(std::make_shared<cmds::CheckFeatures>());
+     .command(std::make_shared<cmds::CheckFeatures>())
+     .command(std::make_shared<cmds::ReplayBridge>());
 
   Log().Init(anbox::Logger::Severity::kWarning);
 
@@ -17,6 +17,17 @@
 
 #include "anbox/dbus/bus.h"
 #include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <cstring>
+#include <limits>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+constexpr const unsigned int max_messages_per_iteration{64};
+}  // namespace
 
 namespace anbox {
 namespace dbus {
@@ -56,29 +67,152 @@ sd_bus* Bus::raw() {
   return bus_;
 }
 
-void Bus::run_async() {
+void Bus::run_async(boost::asio::io_service &service) {
+  std::lock_guard<decltype(lock_)> l(lock_);
+  if (running_)
+    return;
+
+  const auto fd = sd_bus_get_fd(bus_);
+  if (fd < 0)
+    throw std::runtime_error("Failed to retrieve DBus connection file descriptor");
+
+  // sd-bus keeps owning its descriptor so we watch a duplicate of it which
+  // asio is free to close again.
+  const auto watched_fd = ::dup(fd);
+  if (watched_fd < 0)
+    throw std::runtime_error(utils::string_format("Failed to duplicate DBus connection file descriptor: %s",
+                                                  std::strerror(errno)));
+
+  strand_.reset(new boost::asio::io_service::strand(service));
+  descriptor_.reset(new boost::asio::posix::stream_descriptor(service, watched_fd));
+  timer_.reset(new boost::asio::steady_timer(service));
   running_ = true;
-  worker_thread_ = std::thread(&Bus::worker_main, this);
+
+  schedule_processing();
 }
 
 void Bus::stop() {
+  std::lock_guard<decltype(lock_)> l(lock_);
+  if (!running_)
+    return;
+
   running_ = false;
-  if (worker_thread_.joinable())
-    worker_thread_.join();
+
+  // Outstanding handlers still run, with an error, but will find the bus
+  // stopped and return immediately.
+  boost::system::error_code err;
+  timer_->cancel(err);
+  descriptor_->cancel(err);
+  descriptor_->close(err);
 }
 
-void Bus::worker_main() {
-  while (running_) {
-    auto ret = sd_bus_process(bus_, nullptr);
-    if (ret < 0)
-      break;
-    if (ret > 0)
-      continue;
+void Bus::dispatch(const std::function<void(sd_bus*)> &task) {
+  std::lock_guard<decltype(lock_)> l(lock_);
+  task(bus_);
+  // Push out whatever the task queued right away. The task may also have
+  // added something we have to wait for, like a method call with a
+  // timeout, so we have to look again at what the bus expects from us.
+  sd_bus_flush(bus_);
+  if (running_)
+    schedule_processing();
+}
+
+void Bus::schedule_processing() {
+  std::weak_ptr<Bus> weak_self = shared_from_this();
+  strand_->post([weak_self]() {
+    if (auto self = weak_self.lock())
+      self->process();
+  });
+}
 
-    ret = sd_bus_wait(bus_, 1000 * 500);
-    if (ret < 0)
+void Bus::process() {
+  std::lock_guard<decltype(lock_)> l(lock_);
+  if (!running_)
+    return;
+
+  // We process a limited number of messages at once and come back later
+  // when there is more so we don't block the runtime for too long.
+  int ret = 0;
+  for (unsigned int n = 0; n < max_messages_per_iteration; n++) {
+    ret = sd_bus_process(bus_, nullptr);
+    if (ret <= 0)
       break;
   }
+
+  if (ret < 0) {
+    ERROR("Failed to process DBus messages: %s", std::strerror(-ret));
+    return;
+  }
+
+  if (ret > 0) {
+    schedule_processing();
+    return;
+  }
+
+  wait_for_events();
+}
+
+void Bus::wait_for_events() {
+  const auto events = sd_bus_get_events(bus_);
+  if (events < 0) {
+    ERROR("Failed to retrieve DBus events to wait for: %s", std::strerror(-events));
+    return;
+  }
+
+  std::weak_ptr<Bus> weak_self = shared_from_this();
+
+  if ((events & POLLIN) && !waiting_for_read_) {
+    waiting_for_read_ = true;
+    descriptor_->async_read_some(boost::asio::null_buffers(), strand_->wrap(
+        [weak_self](const boost::system::error_code &err, std::size_t) {
+      auto self = weak_self.lock();
+      if (!self)
+        return;
+      std::lock_guard<decltype(self->lock_)> l(self->lock_);
+      self->waiting_for_read_ = false;
+      if (!err)
+        self->process();
+    }));
+  }
+
+  if ((events & POLLOUT) && !waiting_for_write_) {
+    waiting_for_write_ = true;
+    descriptor_->async_write_some(boost::asio::null_buffers(), strand_->wrap(
+        [weak_self](const boost::system::error_code &err, std::size_t) {
+      auto self = weak_self.lock();
+      if (!self)
+        return;
+      std::lock_guard<decltype(self->lock_)> l(self->lock_);
+      self->waiting_for_write_ = false;
+      if (!err)
+        self->process();
+    }));
+  }
+
+  std::uint64_t timeout_usec = 0;
+  const auto ret = sd_bus_get_timeout(bus_, &timeout_usec);
+  if (ret < 0) {
+    ERROR("Failed to retrieve DBus timeout: %s", std::strerror(-ret));
+    return;
+  }
+
+  // Setting a new expiry time cancels a wait still pending on the timer.
+  // A timeout of UINT64_MAX means sd-bus doesn't need one at all.
+  if (timeout_usec == std::numeric_limits<std::uint64_t>::max()) {
+    boost::system::error_code err;
+    timer_->cancel(err);
+    return;
+  }
+
+  // sd-bus reports the timeout as an absolute CLOCK_MONOTONIC value which
+  // is what std::chrono::steady_clock is based on as well.
+  timer_->expires_at(std::chrono::steady_clock::time_point(std::chrono::microseconds(timeout_usec)));
+  timer_->async_wait(strand_->wrap([weak_self](const boost::system::error_code &err) {
+    if (err == boost::asio::error::operation_aborted)
+      return;
+    if (auto self = weak_self.lock())
+      self->process();
+  }));
 }
 }  // namespace dbus
 }  // namespace anbox
@@ -20,16 +20,19 @@
 
 #include "anbox/do_not_copy_or_move.h"
 
-#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <thread>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 #include <systemd/sd-bus.h>
 
 namespace anbox {
 namespace dbus {
-class Bus : public DoNotCopyOrMove {
+class Bus : public DoNotCopyOrMove,
+            public std::enable_shared_from_this<Bus> {
  public:
   enum class Type {
     System,
@@ -42,15 +45,31 @@ class Bus : public DoNotCopyOrMove {
   sd_bus* raw();
 
   bool has_service_with_name(const std::string& name);
-  void run_async();
+
+  // Registers the bus connection with the given io_service. Incoming
+  // messages and timeouts are then processed by whatever thread runs the
+  // service. The bus has to be owned by a std::shared_ptr.
+  void run_async(boost::asio::io_service &service);
   void stop();
 
+  // sd-bus connections are not thread-safe. Everything which touches the
+  // bus outside of a D-Bus handler, like sending the reply for an
+  // asynchronously completed method call, has to go through here.
+  void dispatch(const std::function<void(sd_bus*)> &task);
+
  private:
-  void worker_main();
+  void schedule_processing();
+  void process();
+  void wait_for_events();
 
   sd_bus *bus_ = nullptr;
-  std::thread worker_thread_;
-  std::atomic_bool running_{false};
+  std::recursive_mutex lock_;
+  bool running_ = false;
+  std::unique_ptr<boost::asio::io_service::strand> strand_;
+  std::unique_ptr<boost::asio::posix::stream_descriptor> descriptor_;
+  std::unique_ptr<boost::asio::steady_timer> timer_;
+  bool waiting_for_read_ = false;
+  bool waiting_for_write_ = false;
 };
 using BusPtr = std::shared_ptr<Bus>;
 }  // namespace dbus
@@ -38,6 +38,54 @@ struct ApplicationManager {
     };
   };
 };
+struct FrameStatistics {
+  static inline const char* name() { return "org.anbox.FrameStatistics"; }
+  struct Methods {
+    struct Dump {
+      static inline const char* name() { return "Dump"; }
+    };
+    struct Reset {
+      static inline const char* name() { return "Reset"; }
+    };
+  };
+  struct Properties {
+    struct Windows {
+      static inline const char* name() { return "Windows"; }
+    };
+    struct Displays {
+      static inline const char* name() { return "Displays"; }
+    };
+  };
+};
+struct LaunchStatistics {
+  static inline const char* name() { return "org.anbox.LaunchStatistics"; }
+  struct Signals {
+    struct LaunchFinished {
+      static inline const char* name() { return "LaunchFinished"; }
+    };
+  };
+  struct Properties {
+    struct Launches {
+      static inline const char* name() { return "Launches"; }
+    };
+  };
+};
+struct MemoryStatistics {
+  static inline const char* name() { return "org.anbox.MemoryStatistics"; }
+  struct Methods {
+    struct Dump {
+      static inline const char* name() { return "Dump"; }
+    };
+  };
+  struct Properties {
+    struct Subsystems {
+      static inline const char* name() { return "Subsystems"; }
+    };
+    struct Accounts {
+      static inline const char* name() { return "Accounts"; }
+    };
+  };
+};
 }  // namespace interface
 }  // namespace dbus
 }  // namespace anbox
@@ -21,6 +21,7 @@
 #include "anbox/android/intent.h"
 #include "anbox/logger.h"
 
+#include <cstring>
 #include <sstream>
 
 #include <core/property.h>
@@ -120,15 +121,28 @@ int ApplicationManager::method_launch(sd_bus_message *m, void *userdata, sd_bus_
   }
 
   auto thiz = static_cast<ApplicationManager*>(userdata);
-  try {
-    thiz->launch(intent, graphics::Rect::Invalid, launch_stack);
-  } catch (std::exception &err) {
-    ERROR("Failed to launch application: %s", err.what());
-    sd_bus_error_set_const(ret_error, "org.anbox.InternalError", err.what());
-    return -EIO;
-  }
+  auto bus = thiz->bus_;
+
+  // The launch is answered from whatever thread completes it, which leaves
+  // the bus free to process other calls, including further launches, while
+  // Android is still busy starting the application.
+  sd_bus_message_ref(m);
+  thiz->launch_async(intent, graphics::Rect::Invalid, launch_stack, [bus, m](const std::string &error) {
+    bus->dispatch([&](sd_bus*) {
+      int r = 0;
+      if (!error.empty()) {
+        ERROR("Failed to launch application: %s", error);
+        r = sd_bus_reply_method_errorf(m, "org.anbox.InternalError", "%s", error.c_str());
+      } else {
+        r = sd_bus_reply_method_return(m, "");
+      }
+      if (r < 0)
+        WARNING("Failed to send reply for application launch: %s", std::strerror(-r));
+      sd_bus_message_unref(m);
+    });
+  });
 
-  return sd_bus_reply_method_return(m, "");
+  return 1;
 }
 
 int ApplicationManager::property_ready_get(sd_bus *bus, const char *path, const char *interface,
@@ -161,11 +175,13 @@ ApplicationManager::ApplicationManager(const BusPtr& bus, const std::shared_ptr<
   impl_->ready().changed().connect([&](bool value) {
     (void) value;
 
-    sd_bus_emit_properties_changed(bus_->raw(),
-                                   interface::Service::path(),
-                                   interface::ApplicationManager::name(),
-                                   interface::ApplicationManager::Properties::Ready::name(),
-                                   nullptr);
+    bus_->dispatch([](sd_bus *bus) {
+      sd_bus_emit_properties_changed(bus,
+                                     interface::Service::path(),
+                                     interface::ApplicationManager::name(),
+                                     interface::ApplicationManager::Properties::Ready::name(),
+                                     nullptr);
+    });
   });
 }
 
@@ -181,6 +197,19 @@ void ApplicationManager::launch(const android::Intent &intent,
   impl_->launch(intent, launch_bounds, stack);
 }
 
+void ApplicationManager::launch_async(const android::Intent &intent,
+                                      const graphics::Rect &launch_bounds,
+                                      const wm::Stack::Id &stack,
+                                      const LaunchCallback &done) {
+  if (!impl_->ready()) {
+    done("Anbox not yet ready to launch applications");
+    return;
+  }
+
+  DEBUG("Launching %s", intent);
+  impl_->launch_async(intent, launch_bounds, stack, done);
+}
+
 core::Property<bool>& ApplicationManager::ready() {
   return impl_->ready();
 }
@@ -35,6 +35,11 @@ class ApplicationManager : public anbox::application::Manager {
               const graphics::Rect &launch_bounds = graphics::Rect::Invalid,
               const wm::Stack::Id &stack = wm::Stack::Id::Default) override;
 
+  void launch_async(const android::Intent &intent,
+                    const graphics::Rect &launch_bounds,
+                    const wm::Stack::Id &stack,
+                    const LaunchCallback &done) override;
+
   core::Property<bool>& ready() override;
 
  private:
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/dbus/skeleton/frame_statistics.h"
+#include "anbox/dbus/interface.h"
+#include "anbox/dbus/sd_bus_helpers.h"
+
+#include <stdexcept>
+
+namespace {
+// name, frames, late frames, dropped frames, average and max latency,
+// average and max composition cost (all in microseconds) and the frame
+// interval histogram.
+constexpr const char *summary_signature{"(stttttttat)"};
+constexpr const char *summary_list_signature{"a(stttttttat)"};
+}  // namespace
+
+namespace anbox {
+namespace dbus {
+namespace skeleton {
+const sd_bus_vtable FrameStatistics::vtable[] = {
+  sdbus::vtable::start(0),
+  sdbus::vtable::method("Dump", "", "s", FrameStatistics::method_dump, SD_BUS_VTABLE_UNPRIVILEGED),
+  sdbus::vtable::method("Reset", "", "", FrameStatistics::method_reset, SD_BUS_VTABLE_UNPRIVILEGED),
+  sdbus::vtable::property("Windows", summary_list_signature, FrameStatistics::property_windows_get, 0),
+  sdbus::vtable::property("Displays", summary_list_signature, FrameStatistics::property_displays_get, 0),
+  sdbus::vtable::end()
+};
+
+FrameStatistics::FrameStatistics(const BusPtr &bus, const std::shared_ptr<graphics::FrameStats> &stats)
+    : bus_(bus), stats_(stats) {
+  const auto r = sd_bus_add_object_vtable(bus_->raw(),
+                                          &obj_slot_,
+                                          interface::Service::path(),
+                                          interface::FrameStatistics::name(),
+                                          vtable,
+                                          this);
+  if (r < 0)
+    throw std::runtime_error("Failed to setup frame statistics DBus service");
+}
+
+FrameStatistics::~FrameStatistics() {
+  bus_->dispatch([&](sd_bus*) { sd_bus_slot_unref(obj_slot_); });
+}
+
+int FrameStatistics::method_dump(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+  (void) ret_error;
+
+  auto thiz = static_cast<FrameStatistics*>(userdata);
+  const auto dump = thiz->stats_->dump();
+  return sd_bus_reply_method_return(m, "s", dump.c_str());
+}
+
+int FrameStatistics::method_reset(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+  (void) ret_error;
+
+  auto thiz = static_cast<FrameStatistics*>(userdata);
+  thiz->stats_->reset();
+  return sd_bus_reply_method_return(m, "");
+}
+
+int FrameStatistics::property_windows_get(sd_bus *bus, const char *path, const char *interface,
+                                          const char *property, sd_bus_message *reply,
+                                          void *userdata, sd_bus_error *ret_error) {
+  (void) bus;
+  (void) path;
+  (void) interface;
+  (void) property;
+  (void) ret_error;
+
+  auto thiz = static_cast<FrameStatistics*>(userdata);
+  return thiz->append_summaries(reply, graphics::FrameStats::Source::Window);
+}
+
+int FrameStatistics::property_displays_get(sd_bus *bus, const char *path, const char *interface,
+                                           const char *property, sd_bus_message *reply,
+                                           void *userdata, sd_bus_error *ret_error) {
+  (void) bus;
+  (void) path;
+  (void) interface;
+  (void) property;
+  (void) ret_error;
+
+  auto thiz = static_cast<FrameStatistics*>(userdata);
+  return thiz->append_summaries(reply, graphics::FrameStats::Source::Display);
+}
+
+int FrameStatistics::append_summaries(sd_bus_message *reply, graphics::FrameStats::Source source) {
+  auto r = sd_bus_message_open_container(reply, SD_BUS_TYPE_ARRAY, summary_signature);
+  if (r < 0)
+    return r;
+
+  for (const auto &summary : stats_->summaries()) {
+    if (summary.source != source)
+      continue;
+
+    r = sd_bus_message_open_container(reply, SD_BUS_TYPE_STRUCT, "stttttttat");
+    if (r < 0)
+      return r;
+
+    r = sd_bus_message_append(reply, "sttttttt",
+                              summary.name.c_str(),
+                              static_cast<uint64_t>(summary.frames),
+                              static_cast<uint64_t>(summary.late_frames),
+                              static_cast<uint64_t>(summary.dropped_frames),
+                              static_cast<uint64_t>(summary.average_latency.count()),
+                              static_cast<uint64_t>(summary.max_latency.count()),
+                              static_cast<uint64_t>(summary.average_composition.count()),
+                              static_cast<uint64_t>(summary.max_composition.count()));
+    if (r < 0)
+      return r;
+
+    r = sd_bus_message_open_container(reply, SD_BUS_TYPE_ARRAY, "t");
+    if (r < 0)
+      return r;
+
+    for (const auto &count : summary.intervals) {
+      r = sd_bus_message_append(reply, "t", static_cast<uint64_t>(count));
+      if (r < 0)
+        return r;
+    }
+
+    r = sd_bus_message_close_container(reply);
+    if (r < 0)
+      return r;
+
+    r = sd_bus_message_close_container(reply);
+    if (r < 0)
+      return r;
+  }
+
+  return sd_bus_message_close_container(reply);
+}
+}  // namespace skeleton
+}  // namespace dbus
+}  // namespace anbox
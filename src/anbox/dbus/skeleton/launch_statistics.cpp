@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/dbus/skeleton/launch_statistics.h"
+#include "anbox/dbus/interface.h"
+#include "anbox/dbus/sd_bus_helpers.h"
+#include "anbox/logger.h"
+
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+// package, task, error and the time in microseconds from the launch request
+// until the intent was delivered, the window was created, the first layer
+// was posted and the first frame was presented. Phases which were never
+// reached are -1.
+constexpr const char *report_signature{"sisxxxx"};
+constexpr const char *report_list_signature{"a(sisxxxx)"};
+
+int append_report(sd_bus_message *m, const anbox::application::LaunchTracker::Report &report) {
+  return sd_bus_message_append(m, report_signature,
+                               report.package.c_str(),
+                               static_cast<int32_t>(report.task),
+                               report.error.c_str(),
+                               static_cast<int64_t>(report.intent_delivered.count()),
+                               static_cast<int64_t>(report.window_created.count()),
+                               static_cast<int64_t>(report.first_layer_posted.count()),
+                               static_cast<int64_t>(report.first_frame_presented.count()));
+}
+}  // namespace
+
+namespace anbox {
+namespace dbus {
+namespace skeleton {
+const sd_bus_vtable LaunchStatistics::vtable[] = {
+  sdbus::vtable::start(0),
+  sdbus::vtable::property("Launches", report_list_signature, LaunchStatistics::property_launches_get, 0),
+  sdbus::vtable::signal("LaunchFinished", report_signature, 0),
+  sdbus::vtable::end()
+};
+
+LaunchStatistics::LaunchStatistics(const BusPtr &bus, const std::shared_ptr<application::LaunchTracker> &tracker)
+    : bus_(bus), tracker_(tracker),
+      launch_finished_connection_{tracker_->launch_finished().connect(
+          std::bind(&LaunchStatistics::on_launch_finished, this, std::placeholders::_1))} {
+  const auto r = sd_bus_add_object_vtable(bus_->raw(),
+                                          &obj_slot_,
+                                          interface::Service::path(),
+                                          interface::LaunchStatistics::name(),
+                                          vtable,
+                                          this);
+  if (r < 0)
+    throw std::runtime_error("Failed to setup launch statistics DBus service");
+}
+
+LaunchStatistics::~LaunchStatistics() {
+  bus_->dispatch([&](sd_bus*) { sd_bus_slot_unref(obj_slot_); });
+}
+
+void LaunchStatistics::on_launch_finished(const application::LaunchTracker::Report &report) {
+  // Reports are finished on whatever thread completed the launch, often
+  // the composer. Bus::dispatch sends the signal right away on that thread
+  // under the bus lock and flushes the connection there.
+  bus_->dispatch([report](sd_bus *bus) {
+    sd_bus_message *m = nullptr;
+    auto r = sd_bus_message_new_signal(bus, &m,
+                                       interface::Service::path(),
+                                       interface::LaunchStatistics::name(),
+                                       interface::LaunchStatistics::Signals::LaunchFinished::name());
+    if (r >= 0)
+      r = append_report(m, report);
+    if (r >= 0)
+      r = sd_bus_send(bus, m, nullptr);
+    if (r < 0)
+      WARNING("Failed to emit launch statistics: %s", std::strerror(-r));
+    sd_bus_message_unref(m);
+  });
+}
+
+int LaunchStatistics::property_launches_get(sd_bus *bus, const char *path, const char *interface,
+                                            const char *property, sd_bus_message *reply,
+                                            void *userdata, sd_bus_error *ret_error) {
+  (void) bus;
+  (void) path;
+  (void) interface;
+  (void) property;
+  (void) ret_error;
+
+  auto thiz = static_cast<LaunchStatistics*>(userdata);
+
+  auto r = sd_bus_message_open_container(reply, SD_BUS_TYPE_ARRAY, "(sisxxxx)");
+  if (r < 0)
+    return r;
+
+  for (const auto &report : thiz->tracker_->reports()) {
+    r = sd_bus_message_open_container(reply, SD_BUS_TYPE_STRUCT, report_signature);
+    if (r < 0)
+      return r;
+
+    r = append_report(reply, report);
+    if (r < 0)
+      return r;
+
+    r = sd_bus_message_close_container(reply);
+    if (r < 0)
+      return r;
+  }
+
+  return sd_bus_message_close_container(reply);
+}
+}  // namespace skeleton
+}  // namespace dbus
+}  // namespace anbox
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_DBUS_SKELETON_LAUNCH_STATISTICS_H_
+#define ANBOX_DBUS_SKELETON_LAUNCH_STATISTICS_H_
+
+#include "anbox/application/launch_tracker.h"
+#include "anbox/dbus/bus.h"
+#include "anbox/do_not_copy_or_move.h"
+
+#include <memory>
+
+#include <core/connection.h>
+
+namespace anbox {
+namespace dbus {
+namespace skeleton {
+class LaunchStatistics : public DoNotCopyOrMove {
+ public:
+  LaunchStatistics(const BusPtr &bus, const std::shared_ptr<application::LaunchTracker> &tracker);
+  ~LaunchStatistics();
+
+ private:
+  static const sd_bus_vtable vtable[];
+  static int property_launches_get(sd_bus *bus, const char *path, const char *interface,
+                                   const char *property, sd_bus_message *reply, void *userdata,
+                                   sd_bus_error *ret_error);
+  void on_launch_finished(const application::LaunchTracker::Report &report);
+
+  BusPtr bus_;
+  std::shared_ptr<application::LaunchTracker> tracker_;
+  sd_bus_slot *obj_slot_ = nullptr;
+  core::ScopedConnection launch_finished_connection_;
+};
+}  // namespace skeleton
+}  // namespace dbus
+}  // namespace anbox
+
+#endif
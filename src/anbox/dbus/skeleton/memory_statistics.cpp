@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/dbus/skeleton/memory_statistics.h"
+#include "anbox/dbus/interface.h"
+#include "anbox/dbus/sd_bus_helpers.h"
+
+#include <stdexcept>
+
+namespace {
+// subsystem, bytes, peak bytes and number of accounts
+constexpr const char *subsystem_signature{"(sttt)"};
+constexpr const char *subsystem_list_signature{"a(sttt)"};
+// subsystem, owner, bytes and peak bytes
+constexpr const char *account_signature{"(sstt)"};
+constexpr const char *account_list_signature{"a(sstt)"};
+}  // namespace
+
+namespace anbox {
+namespace dbus {
+namespace skeleton {
+const sd_bus_vtable MemoryStatistics::vtable[] = {
+  sdbus::vtable::start(0),
+  sdbus::vtable::method("Dump", "", "s", MemoryStatistics::method_dump, SD_BUS_VTABLE_UNPRIVILEGED),
+  sdbus::vtable::property("Subsystems", subsystem_list_signature, MemoryStatistics::property_subsystems_get, 0),
+  sdbus::vtable::property("Accounts", account_list_signature, MemoryStatistics::property_accounts_get, 0),
+  sdbus::vtable::end()
+};
+
+MemoryStatistics::MemoryStatistics(const BusPtr &bus, const std::shared_ptr<common::MemoryAccounting> &accounting)
+    : bus_(bus), accounting_(accounting) {
+  const auto r = sd_bus_add_object_vtable(bus_->raw(),
+                                          &obj_slot_,
+                                          interface::Service::path(),
+                                          interface::MemoryStatistics::name(),
+                                          vtable,
+                                          this);
+  if (r < 0)
+    throw std::runtime_error("Failed to setup memory statistics DBus service");
+}
+
+MemoryStatistics::~MemoryStatistics() {
+  bus_->dispatch([&](sd_bus*) { sd_bus_slot_unref(obj_slot_); });
+}
+
+int MemoryStatistics::method_dump(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+  (void) ret_error;
+
+  auto thiz = static_cast<MemoryStatistics*>(userdata);
+  const auto dump = thiz->accounting_->dump();
+  return sd_bus_reply_method_return(m, "s", dump.c_str());
+}
+
+int MemoryStatistics::property_subsystems_get(sd_bus *bus, const char *path, const char *interface,
+                                              const char *property, sd_bus_message *reply,
+                                              void *userdata, sd_bus_error *ret_error) {
+  (void) bus;
+  (void) path;
+  (void) interface;
+  (void) property;
+  (void) ret_error;
+
+  auto thiz = static_cast<MemoryStatistics*>(userdata);
+
+  auto r = sd_bus_message_open_container(reply, SD_BUS_TYPE_ARRAY, subsystem_signature);
+  if (r < 0)
+    return r;
+
+  for (const auto &usage : thiz->accounting_->subsystems()) {
+    r = sd_bus_message_append(reply, subsystem_signature,
+                              common::MemoryAccounting::name(usage.subsystem),
+                              static_cast<uint64_t>(usage.bytes),
+                              static_cast<uint64_t>(usage.peak),
+                              static_cast<uint64_t>(usage.accounts));
+    if (r < 0)
+      return r;
+  }
+
+  return sd_bus_message_close_container(reply);
+}
+
+int MemoryStatistics::property_accounts_get(sd_bus *bus, const char *path, const char *interface,
+                                            const char *property, sd_bus_message *reply,
+                                            void *userdata, sd_bus_error *ret_error) {
+  (void) bus;
+  (void) path;
+  (void) interface;
+  (void) property;
+  (void) ret_error;
+
+  auto thiz = static_cast<MemoryStatistics*>(userdata);
+
+  auto r = sd_bus_message_open_container(reply, SD_BUS_TYPE_ARRAY, account_signature);
+  if (r < 0)
+    return r;
+
+  for (const auto &account : thiz->accounting_->accounts()) {
+    r = sd_bus_message_append(reply, account_signature,
+                              common::MemoryAccounting::name(account.subsystem),
+                              account.owner.c_str(),
+                              static_cast<uint64_t>(account.bytes),
+                              static_cast<uint64_t>(account.peak));
+    if (r < 0)
+      return r;
+  }
+
+  return sd_bus_message_close_container(reply);
+}
+}  // namespace skeleton
+}  // namespace dbus
+}  // namespace anbox
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_DBUS_SKELETON_MEMORY_STATISTICS_H_
+#define ANBOX_DBUS_SKELETON_MEMORY_STATISTICS_H_
+
+#include "anbox/common/memory_accounting.h"
+#include "anbox/dbus/bus.h"
+#include "anbox/do_not_copy_or_move.h"
+
+#include <memory>
+
+namespace anbox {
+namespace dbus {
+namespace skeleton {
+class MemoryStatistics : public DoNotCopyOrMove {
+ public:
+  MemoryStatistics(const BusPtr &bus, const std::shared_ptr<common::MemoryAccounting> &accounting);
+  ~MemoryStatistics();
+
+ private:
+  static const sd_bus_vtable vtable[];
+  static int method_dump(sd_bus_message *m, void *userdata, sd_bus_error *ret_error);
+  static int property_subsystems_get(sd_bus *bus, const char *path, const char *interface,
+                                     const char *property, sd_bus_message *reply, void *userdata,
+                                     sd_bus_error *ret_error);
+  static int property_accounts_get(sd_bus *bus, const char *path, const char *interface,
+                                   const char *property, sd_bus_message *reply, void *userdata,
+                                   sd_bus_error *ret_error);
+
+  BusPtr bus_;
+  std::shared_ptr<common::MemoryAccounting> accounting_;
+  sd_bus_slot *obj_slot_ = nullptr;
+};
+}  // namespace skeleton
+}  // namespace dbus
+}  // namespace anbox
+
+#endif
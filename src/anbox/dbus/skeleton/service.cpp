@@ -18,16 +18,23 @@
 #include "anbox/dbus/interface.h"
 #include "anbox/dbus/skeleton/service.h"
 #include "anbox/dbus/skeleton/application_manager.h"
+#include "anbox/dbus/skeleton/frame_statistics.h"
+#include "anbox/dbus/skeleton/launch_statistics.h"
+#include "anbox/dbus/skeleton/memory_statistics.h"
 #include "anbox/logger.h"
 
 namespace anbox {
 namespace dbus {
 namespace skeleton {
-std::shared_ptr<Service> Service::create_for_bus(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl) {
-  return std::shared_ptr<Service>(new Service(bus, impl));
+std::shared_ptr<Service> Service::create_for_bus(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl,
+                                                const std::shared_ptr<graphics::FrameStats> &frame_stats,
+                                                const std::shared_ptr<application::LaunchTracker> &launch_tracker) {
+  return std::shared_ptr<Service>(new Service(bus, impl, frame_stats, launch_tracker));
 }
 
-Service::Service(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl)
+Service::Service(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl,
+                 const std::shared_ptr<graphics::FrameStats> &frame_stats,
+                 const std::shared_ptr<application::LaunchTracker> &launch_tracker)
     : bus_{bus} {
   if (!bus_)
     throw std::invalid_argument("Missing bus object");
@@ -41,6 +48,11 @@ Service::Service(const BusPtr& bus, const std::shared_ptr<anbox::application::Ma
   DEBUG("Successfully acquired DBus service name");
 
   application_manager_ = std::make_shared<ApplicationManager>(bus, impl);
+  if (frame_stats)
+    frame_statistics_ = std::make_shared<FrameStatistics>(bus, frame_stats);
+  if (launch_tracker)
+    launch_statistics_ = std::make_shared<LaunchStatistics>(bus, launch_tracker);
+  memory_statistics_ = std::make_shared<MemoryStatistics>(bus, common::MemoryAccounting::global());
 }
 
 Service::~Service() {}
@@ -18,9 +18,11 @@
 #ifndef ANBOX_DBUS_SKELETON_SERVICE_H_
 #define ANBOX_DBUS_SKELETON_SERVICE_H_
 
+#include "anbox/application/launch_tracker.h"
 #include "anbox/application/manager.h"
 #include "anbox/dbus/bus.h"
 #include "anbox/do_not_copy_or_move.h"
+#include "anbox/graphics/frame_stats.h"
 
 #include <atomic>
 #include <memory>
@@ -32,17 +34,27 @@ namespace anbox {
 namespace dbus {
 namespace skeleton {
 class ApplicationManager;
+class FrameStatistics;
+class LaunchStatistics;
+class MemoryStatistics;
 class Service : public DoNotCopyOrMove {
  public:
-  static std::shared_ptr<Service> create_for_bus(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl);
+  static std::shared_ptr<Service> create_for_bus(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl,
+                                                 const std::shared_ptr<graphics::FrameStats> &frame_stats = nullptr,
+                                                 const std::shared_ptr<application::LaunchTracker> &launch_tracker = nullptr);
 
   ~Service();
 
  private:
-  Service(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl);
+  Service(const BusPtr& bus, const std::shared_ptr<anbox::application::Manager> &impl,
+          const std::shared_ptr<graphics::FrameStats> &frame_stats,
+          const std::shared_ptr<application::LaunchTracker> &launch_tracker);
 
   BusPtr bus_;
   std::shared_ptr<application::Manager> application_manager_;
+  std::shared_ptr<FrameStatistics> frame_statistics_;
+  std::shared_ptr<LaunchStatistics> launch_statistics_;
+  std::shared_ptr<MemoryStatistics> memory_statistics_;
 };
 }  // namespace skeleton
 }  // namespace dbus
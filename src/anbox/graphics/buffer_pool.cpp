@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/buffer_pool.h"
+
+#include <string.h>
+
+namespace {
+// Returns the index of the smallest size class which can hold |size| bytes.
+std::size_t class_for_size(std::size_t size) {
+  std::size_t index = 0;
+  std::size_t class_size = anbox::graphics::BufferPool::min_class_size;
+  while (class_size < size) {
+    class_size <<= 1;
+    index++;
+  }
+  return index;
+}
+
+// Returns the index of the largest size class whose size is not larger
+// than |capacity|. Only valid for capacities >= min_class_size.
+std::size_t class_for_capacity(std::size_t capacity) {
+  std::size_t index = 0;
+  std::size_t class_size = anbox::graphics::BufferPool::min_class_size;
+  while ((class_size << 1) <= capacity) {
+    class_size <<= 1;
+    index++;
+  }
+  return index;
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr const std::size_t BufferPool::min_class_size;
+constexpr const std::size_t BufferPool::max_class_size;
+constexpr const std::size_t BufferPool::default_max_cached_per_class;
+constexpr const std::size_t BufferPool::num_classes;
+
+std::shared_ptr<BufferPool> BufferPool::global() {
+  static auto pool = std::make_shared<BufferPool>();
+  return pool;
+}
+
+BufferPool::BufferPool(std::size_t max_cached_per_class)
+    : max_cached_per_class_(max_cached_per_class),
+      account_(common::MemoryAccounting::Subsystem::BufferPool,
+               common::MemoryAccounting::next_owner("pool")) {}
+
+BufferPool::~BufferPool() {}
+
+Buffer BufferPool::acquire(std::size_t size) {
+  acquired_.fetch_add(1, std::memory_order_relaxed);
+  bytes_acquired_.fetch_add(size, std::memory_order_relaxed);
+
+  Buffer buffer;
+
+  // Small buffers live entirely in the in-place storage and don't need
+  // anything from us.
+  if (size <= Buffer::kSmallSize) {
+    buffer.resize_noinit(size);
+    return buffer;
+  }
+
+  // Huge buffers are allocated with their exact size and never cached as
+  // we don't want to hold onto them for longer than necessary.
+  if (size > max_class_size) {
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    buffer.resize_noinit(size);
+    return buffer;
+  }
+
+  const auto index = class_for_size(size);
+  auto &size_class = classes_[index];
+  {
+    std::lock_guard<std::mutex> l(size_class.lock);
+    if (!size_class.buffers.empty()) {
+      buffer = std::move(size_class.buffers.back());
+      size_class.buffers.pop_back();
+    }
+  }
+
+  if (buffer.isAllocated()) {
+    reuses_.fetch_add(1, std::memory_order_relaxed);
+    cached_buffers_.fetch_sub(1, std::memory_order_relaxed);
+    cached_bytes_.fetch_sub(buffer.capacity(), std::memory_order_relaxed);
+    account_.remove(buffer.capacity());
+  } else {
+    // Always allocate the full class size so the buffer can serve any
+    // request of the same class once it is released.
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    buffer.reserve(min_class_size << index);
+  }
+
+  buffer.resize_noinit(size);
+  return buffer;
+}
+
+Buffer BufferPool::acquire(const void *data, std::size_t size) {
+  auto buffer = acquire(size);
+  if (size > 0)
+    ::memcpy(buffer.data(), data, size);
+  return buffer;
+}
+
+void BufferPool::release(Buffer &&buffer) {
+  if (!buffer.isAllocated())
+    return;
+
+  released_.fetch_add(1, std::memory_order_relaxed);
+
+  const auto capacity = buffer.capacity();
+  if (capacity < min_class_size || capacity > max_class_size) {
+    discarded_.fetch_add(1, std::memory_order_relaxed);
+    // Moving out of the buffer is the only way to free its storage.
+    Buffer discard(std::move(buffer));
+    return;
+  }
+
+  buffer.clear();
+
+  auto &size_class = classes_[class_for_capacity(capacity)];
+  {
+    std::lock_guard<std::mutex> l(size_class.lock);
+    if (size_class.buffers.size() < max_cached_per_class_) {
+      size_class.buffers.push_back(std::move(buffer));
+      cached_buffers_.fetch_add(1, std::memory_order_relaxed);
+      cached_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+      account_.add(capacity);
+      return;
+    }
+  }
+
+  discarded_.fetch_add(1, std::memory_order_relaxed);
+  Buffer discard(std::move(buffer));
+}
+
+BufferPool::Statistics BufferPool::statistics() const {
+  Statistics stats;
+  stats.acquired = acquired_.load(std::memory_order_relaxed);
+  stats.allocations = allocations_.load(std::memory_order_relaxed);
+  stats.reuses = reuses_.load(std::memory_order_relaxed);
+  stats.released = released_.load(std::memory_order_relaxed);
+  stats.discarded = discarded_.load(std::memory_order_relaxed);
+  stats.bytes_acquired = bytes_acquired_.load(std::memory_order_relaxed);
+  stats.cached_buffers = cached_buffers_.load(std::memory_order_relaxed);
+  stats.cached_bytes = cached_bytes_.load(std::memory_order_relaxed);
+  return stats;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_BUFFER_POOL_H_
+#define ANBOX_GRAPHICS_BUFFER_POOL_H_
+
+#include "anbox/common/memory_accounting.h"
+#include "anbox/graphics/buffer_queue.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// BufferPool recycles the heap storage of Buffer instances which are too
+// large to fit into their in-place storage. Buffers are sorted into power of
+// two size classes so that a buffer acquired for a particular size can be
+// served by any previously released buffer of the same class.
+//
+// The pool is meant to sit between a producer (typically the socket read
+// path) and a consumer on another thread (render thread, audio callback)
+// which releases the buffer once it has processed its content. Every size
+// class has its own lock so producers and consumers of differently sized
+// buffers don't contend with each other.
+class BufferPool {
+ public:
+  struct Statistics {
+    // Number of buffers handed out by acquire().
+    std::uint64_t acquired = 0;
+    // Number of heap allocations done because no cached buffer was available.
+    std::uint64_t allocations = 0;
+    // Number of acquired buffers served from the cache.
+    std::uint64_t reuses = 0;
+    // Number of buffers returned through release().
+    std::uint64_t released = 0;
+    // Number of released buffers freed as the cache was full or the buffer
+    // didn't fit into any size class.
+    std::uint64_t discarded = 0;
+    // Total number of bytes requested through acquire().
+    std::uint64_t bytes_acquired = 0;
+    // Buffers and bytes currently held by the cache.
+    std::uint64_t cached_buffers = 0;
+    std::uint64_t cached_bytes = 0;
+  };
+
+  static constexpr const std::size_t min_class_size{1024};
+  static constexpr const std::size_t max_class_size{4 * 1024 * 1024};
+  static constexpr const std::size_t default_max_cached_per_class{32};
+
+  // Returns the pool shared by all users within the process.
+  static std::shared_ptr<BufferPool> global();
+
+  explicit BufferPool(std::size_t max_cached_per_class = default_max_cached_per_class);
+  ~BufferPool();
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // Returns a buffer with a size of exactly |size| bytes. The content of the
+  // buffer is not initialized.
+  Buffer acquire(std::size_t size);
+
+  // Returns a buffer holding a copy of |size| bytes from |data|.
+  Buffer acquire(const void *data, std::size_t size);
+
+  // Hands the storage of |buffer| back to the pool. The buffer is left
+  // empty and can be reused by the caller.
+  void release(Buffer &&buffer);
+
+  Statistics statistics() const;
+
+ private:
+  static constexpr const std::size_t num_classes{13};
+  static_assert((min_class_size << (num_classes - 1)) == max_class_size,
+                "Size classes do not cover the range of cached buffer sizes");
+
+  struct SizeClass {
+    std::mutex lock;
+    std::vector<Buffer> buffers;
+  };
+
+  std::size_t max_cached_per_class_;
+  std::array<SizeClass, num_classes> classes_;
+
+  std::atomic<std::uint64_t> acquired_{0};
+  std::atomic<std::uint64_t> allocations_{0};
+  std::atomic<std::uint64_t> reuses_{0};
+  std::atomic<std::uint64_t> released_{0};
+  std::atomic<std::uint64_t> discarded_{0};
+  std::atomic<std::uint64_t> bytes_acquired_{0};
+  std::atomic<std::uint64_t> cached_buffers_{0};
+  std::atomic<std::uint64_t> cached_bytes_{0};
+  common::MemoryAccounting::Account account_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -16,17 +16,21 @@
  */
 
 #include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/common/thread_topology.h"
 #include "anbox/logger.h"
 
 namespace anbox {
 namespace graphics {
 BufferedIOStream::BufferedIOStream(
     const std::shared_ptr<anbox::network::SocketMessenger> &messenger,
-    size_t buffer_size)
+    size_t buffer_size, const std::shared_ptr<BufferPool> &pool,
+    const std::string &owner)
     : IOStream(buffer_size),
       messenger_(messenger),
+      pool_(pool),
       in_queue_(1024U),
       out_queue_(16U),
+      account_(common::MemoryAccounting::Subsystem::StreamQueues, owner),
       worker_thread_(&BufferedIOStream::thread_main, this) {
   write_buffer_.resize_noinit(buffer_size);
 }
@@ -38,25 +42,30 @@ BufferedIOStream::~BufferedIOStream() {
 
 void *BufferedIOStream::allocBuffer(size_t min_size) {
   std::unique_lock<std::mutex> l(out_lock_);
-  if (write_buffer_.size() < min_size) write_buffer_.resize_noinit(min_size);
+  if (write_buffer_.size() < min_size) {
+    if (min_size > Buffer::kSmallSize && !write_buffer_.isAllocated())
+      write_buffer_ = pool_->acquire(min_size);
+    else
+      write_buffer_.resize_noinit(min_size);
+  }
   return write_buffer_.data();
 }
 
 size_t BufferedIOStream::commitBuffer(size_t size) {
   std::unique_lock<std::mutex> l(out_lock_);
   assert(size <= write_buffer_.size());
+  account_.add(size);
   if (write_buffer_.isAllocated()) {
     write_buffer_.resize(size);
-    out_queue_.push_locked(std::move(write_buffer_), l);
+    out_queue_.push(std::move(write_buffer_));
   } else {
-    out_queue_.push_locked(
-        Buffer{write_buffer_.data(), write_buffer_.data() + size}, l);
+    out_queue_.push(
+        Buffer{write_buffer_.data(), write_buffer_.data() + size});
   }
   return size;
 }
 
 const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
-  std::unique_lock<std::mutex> l(lock_);
   size_t wanted = *inout_len;
   size_t count = 0U;
   auto dst = static_cast<uint8_t *>(buf);
@@ -71,12 +80,20 @@ const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
       continue;
     }
 
+    // Hand the storage of the consumed buffer back before we replace it
+    // with the next one from the queue.
+    account_.remove(read_buffer_.size());
+    pool_->release(std::move(read_buffer_));
+    // The pool leaves small inline buffers untouched, make sure we don't
+    // account them a second time if the queue is empty now.
+    read_buffer_.clear();
+
     bool blocking = (count == 0);
     auto result = -EIO;
     if (blocking)
-      result = in_queue_.pop_locked(&read_buffer_, l);
+      result = in_queue_.pop(&read_buffer_);
     else
-      result = in_queue_.try_pop_locked(&read_buffer_);
+      result = in_queue_.try_pop(&read_buffer_);
 
     if (result == 0) {
       read_buffer_left_ = read_buffer_.size();
@@ -95,27 +112,30 @@ const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
 }
 
 void BufferedIOStream::forceStop() {
-  std::lock_guard<std::mutex> l(lock_);
-  in_queue_.close_locked();
-  out_queue_.close_locked();
+  in_queue_.close();
+  out_queue_.close();
 }
 
 void BufferedIOStream::post_data(Buffer &&data) {
-  std::unique_lock<std::mutex> l(lock_);
-  in_queue_.push_locked(std::move(data), l);
+  account_.add(data.size());
+  in_queue_.push(std::move(data));
+}
+
+void BufferedIOStream::post_data(const void *data, size_t size) {
+  account_.add(size);
+  in_queue_.push(pool_->acquire(data, size));
 }
 
 bool BufferedIOStream::needs_data() {
-  std::unique_lock<std::mutex> l(lock_);
-  return !in_queue_.can_pop_locked();
+  return in_queue_.empty();
 }
 
 void BufferedIOStream::thread_main() {
-  while (true) {
-    std::unique_lock<std::mutex> l(out_lock_);
+  common::setup_current_thread(common::ThreadClass::IO, "gl-writer");
 
+  while (true) {
     Buffer buffer;
-    const auto result = out_queue_.pop_locked(&buffer, l);
+    const auto result = out_queue_.pop(&buffer);
     if (result != 0 && result != -EAGAIN) break;
 
     auto bytes_left = buffer.size();
@@ -131,6 +151,9 @@ void BufferedIOStream::thread_main() {
       } else
         bytes_left -= written;
     }
+
+    account_.remove(buffer.size());
+    pool_->release(std::move(buffer));
   }
 }
 }  // namespace graphics
@@ -20,6 +20,9 @@
 
 #include "external/android-emugl/host/include/libOpenglRender/IOStream.h"
 
+#include "anbox/common/lock_free_channel.h"
+#include "anbox/common/memory_accounting.h"
+#include "anbox/graphics/buffer_pool.h"
 #include "anbox/graphics/buffer_queue.h"
 #include "anbox/network/socket_messenger.h"
 
@@ -34,7 +37,9 @@ class BufferedIOStream : public IOStream {
 
   explicit BufferedIOStream(
       const std::shared_ptr<anbox::network::SocketMessenger> &messenger,
-      size_t buffer_size = default_buffer_size);
+      size_t buffer_size = default_buffer_size,
+      const std::shared_ptr<BufferPool> &pool = BufferPool::global(),
+      const std::string &owner = "gles");
 
   virtual ~BufferedIOStream();
 
@@ -43,6 +48,7 @@ class BufferedIOStream : public IOStream {
   const unsigned char *read(void *buf, size_t *inout_len) override;
   void forceStop() override;
   void post_data(Buffer &&data);
+  void post_data(const void *data, size_t size);
 
   bool needs_data();
 
@@ -50,13 +56,15 @@ class BufferedIOStream : public IOStream {
   void thread_main();
 
   std::shared_ptr<anbox::network::SocketMessenger> messenger_;
-  std::mutex lock_;
+  std::shared_ptr<BufferPool> pool_;
   std::mutex out_lock_;
   Buffer write_buffer_;
   Buffer read_buffer_;
   size_t read_buffer_left_ = 0;
-  BufferQueue in_queue_;
-  BufferQueue out_queue_;
+  common::LockFreeChannel<Buffer> in_queue_;
+  common::LockFreeChannel<Buffer> out_queue_;
+  // Data queued in either direction.
+  common::MemoryAccounting::Account account_;
   std::thread worker_thread_;
 };
 }  // namespace graphics
@@ -15,10 +15,12 @@
 */
 
 #include "anbox/graphics/emugl/ColorBuffer.h"
+#include "anbox/common/memory_accounting.h"
 #include "anbox/graphics/emugl/DispatchTables.h"
 #include "anbox/graphics/emugl/RenderThreadInfo.h"
 #include "anbox/graphics/emugl/TextureDraw.h"
 #include "anbox/graphics/emugl/TextureResize.h"
+#include "anbox/graphics/emugl/YUVConverter.h"
 #include "anbox/logger.h"
 
 #include "external/android-emugl/host/include/OpenGLESDispatch/EGLDispatch.h"
@@ -34,6 +36,15 @@ inline void* SafePointerFromUInt(unsigned int handle) {
   return reinterpret_cast<void*>(static_cast<uintptr_t>(handle));
 }
 
+// Color buffers are shared between all connections so they're accounted
+// to the renderer as a whole. Never destroyed as color buffers might
+// outlive any static.
+anbox::common::MemoryAccounting::Account& memoryAccount() {
+  static auto account = new anbox::common::MemoryAccounting::Account{
+      anbox::common::MemoryAccounting::Subsystem::ColorBuffers, "renderer"};
+  return *account;
+}
+
 // Lazily create and bind a framebuffer object to the current host context.
 // |fbo| is the address of the framebuffer object name.
 // |tex| is the name of a texture that is attached to the framebuffer object
@@ -117,6 +128,16 @@ ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
       texInternalFormat = GL_RGBA;
       break;
 
+    case GL_YV12_ANBOX:
+    case GL_NV21_ANBOX:
+      // Chroma is subsampled per 2x2 block of pixels.
+      if ((p_width & 1) || (p_height & 1))
+        return NULL;
+      // The planes get converted into a RGBA texture so everything which
+      // samples, composites or reads back the buffer works unchanged.
+      texInternalFormat = GL_RGBA;
+      break;
+
     default:
       return NULL;
       break;
@@ -173,6 +194,12 @@ ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
 
   cb->m_resizer = new TextureResize(p_width, p_height);
 
+  cb->m_memorySize = 2 * nComp * p_width * p_height;
+  memoryAccount().add(cb->m_memorySize);
+
+  if (YUVConverter::isYUVFormat(p_internalFormat))
+    cb->m_yuv = new YUVConverter(p_internalFormat, p_width, p_height);
+
   return cb;
 }
 
@@ -184,7 +211,10 @@ ColorBuffer::ColorBuffer(EGLDisplay display, Helper* helper)
       m_fbo(0),
       m_internalFormat(0),
       m_display(display),
-      m_helper(helper) {}
+      m_helper(helper),
+      m_resizer(nullptr),
+      m_yuv(nullptr),
+      m_memorySize(0) {}
 
 ColorBuffer::~ColorBuffer() {
   ScopedHelperContext context(m_helper);
@@ -204,6 +234,9 @@ ColorBuffer::~ColorBuffer() {
   s_gles2.glDeleteTextures(2, tex);
 
   delete m_resizer;
+  delete m_yuv;
+
+  memoryAccount().remove(m_memorySize);
 }
 
 void ColorBuffer::readPixels(int x, int y, int width, int height,
@@ -226,12 +259,41 @@ void ColorBuffer::subUpdate(int x, int y, int width, int height,
     return;
   }
 
+  if (m_yuv) {
+    updateFromYUV(x, y, width, height, p_format, pixels);
+    return;
+  }
+
   s_gles2.glBindTexture(GL_TEXTURE_2D, m_tex);
   s_gles2.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   s_gles2.glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, p_format,
                           p_type, pixels);
 }
 
+void ColorBuffer::updateFromYUV(int x, int y, int width, int height,
+                                GLenum p_format, void* pixels) {
+  if (x != 0 || y != 0 || width != static_cast<int>(m_width) ||
+      height != static_cast<int>(m_height) || p_format != m_yuv->format()) {
+    ERROR("YUV color buffer only takes complete frames of its own format");
+    return;
+  }
+
+  if (!bindFbo(&m_fbo, m_tex)) {
+    return;
+  }
+
+  GLint vport[4] = {
+      0,
+  };
+  s_gles2.glGetIntegerv(GL_VIEWPORT, vport);
+  s_gles2.glViewport(0, 0, m_width, m_height);
+
+  m_yuv->convert(pixels);
+
+  s_gles2.glViewport(vport[0], vport[1], vport[2], vport[3]);
+  unbindFbo();
+}
+
 bool ColorBuffer::blitFromCurrentReadBuffer() {
   RenderThreadInfo* tInfo = RenderThreadInfo::get();
   if (!tInfo->currContext) {
@@ -24,6 +24,7 @@
 
 class TextureDraw;
 class TextureResize;
+class YUVConverter;
 
 // A class used to model a guest color buffer, and used to implement several
 // related things:
@@ -71,7 +72,9 @@ class ColorBuffer {
   // |p_width| and |p_height| are the buffer's dimensions in pixels.
   // |p_internalFormat| is the internal pixel format to use, valid values
   // are: GL_RGB, GL_RGB565, GL_RGBA, GL_RGB5_A1_OES and GL_RGBA4_OES.
-  // Implementation is free to use something else though.
+  // Implementation is free to use something else though. GL_YV12_ANBOX
+  // and GL_NV21_ANBOX (see YUVConverter.h) create a buffer which takes
+  // whole YUV frames in subUpdate() and holds their RGB conversion.
   // |has_eglimage_texture_2d| should be true iff the display supports
   // the EGL_KHR_gl_texture_2D_image extension.
   // Returns NULL on failure.
@@ -91,6 +94,7 @@ class ColorBuffer {
                   GLenum p_type, void* pixels);
 
   // Update the ColorBuffer instance's pixel values from host memory.
+  // YUV buffers only accept complete frames in their own format.
   void subUpdate(int x, int y, int width, int height, GLenum p_format,
                  GLenum p_type, void* pixels);
 
@@ -120,6 +124,9 @@ class ColorBuffer {
 
   explicit ColorBuffer(EGLDisplay display, Helper* helper);
 
+  void updateFromYUV(int x, int y, int width, int height, GLenum p_format,
+                     void* pixels);
+
  private:
   GLuint m_tex;
   GLuint m_blitTex;
@@ -132,6 +139,9 @@ class ColorBuffer {
   EGLDisplay m_display;
   Helper* m_helper;
   TextureResize* m_resizer;
+  YUVConverter* m_yuv;
+  // Estimated size of both textures.
+  size_t m_memorySize;
 };
 
 typedef std::shared_ptr<ColorBuffer> ColorBufferPtr;
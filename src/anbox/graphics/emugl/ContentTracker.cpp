@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/ContentTracker.h"
+
+void ContentTracker::contentUpdated(HandleType colorBuffer) {
+  {
+    std::lock_guard<std::mutex> l(m_lock);
+    m_buffers[colorBuffer].sequence++;
+  }
+  m_updated.notify_all();
+}
+
+void ContentTracker::remove(HandleType colorBuffer) {
+  {
+    std::lock_guard<std::mutex> l(m_lock);
+    m_buffers.erase(colorBuffer);
+
+    for (auto it = m_layers.begin(); it != m_layers.end();) {
+      if (it->second == colorBuffer)
+        it = m_layers.erase(it);
+      else
+        ++it;
+    }
+  }
+  // Nothing will ever be written into it anymore.
+  m_updated.notify_all();
+}
+
+uint64_t ContentTracker::sequence(HandleType colorBuffer) const {
+  std::lock_guard<std::mutex> l(m_lock);
+  auto b = m_buffers.find(colorBuffer);
+  if (b == m_buffers.end())
+    return 0;
+  return b->second.sequence;
+}
+
+bool ContentTracker::waitForLayers(const std::vector<Layer> &layers,
+                                   const std::chrono::milliseconds &timeout,
+                                   std::unique_lock<std::mutex> *decodeLock) {
+  // Flushes take the decode lock before m_lock, so it is released first
+  // and taken again only after m_lock.
+  const auto relock = decodeLock && decodeLock->owns_lock();
+  if (relock)
+    decodeLock->unlock();
+
+  const auto complete = waitForContent(layers, timeout);
+
+  if (relock)
+    decodeLock->lock();
+  return complete;
+}
+
+bool ContentTracker::waitForContent(const std::vector<Layer> &layers,
+                                    const std::chrono::milliseconds &timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  bool complete = true;
+
+  std::unique_lock<std::mutex> l(m_lock);
+  for (const auto &layer : layers) {
+    auto &posted = m_layers[layer.first];
+    // A buffer posted again in the same layer is left as it is, its
+    // producer didn't queue it again.
+    if (posted != layer.second) {
+      posted = layer.second;
+      // A buffer we never saw any write into has no content yet either
+      // and the entry is created here with both counters at zero. Buffers
+      // can be destroyed while we wait, which erases their entry.
+      const auto ready = [&]() {
+        auto b = m_buffers.find(layer.second);
+        return b == m_buffers.end() || b->second.sequence > b->second.composed;
+      };
+      m_buffers[layer.second];
+      if (!m_updated.wait_until(l, deadline, ready))
+        complete = false;
+    }
+
+    auto b = m_buffers.find(layer.second);
+    if (b != m_buffers.end())
+      b->second.composed = b->second.sequence;
+  }
+  return complete;
+}
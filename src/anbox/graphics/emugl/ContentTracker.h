@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _LIBRENDER_CONTENT_TRACKER_H
+#define _LIBRENDER_CONTENT_TRACKER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Orders the composition of posted color buffers after the writes of
+// their producers.
+//
+// The guest doesn't wait for asynchronous window flushes, so
+// SurfaceFlinger can post a buffer before the render thread of the app
+// which queued it got to the flush. Nothing SurfaceFlinger sends tells us
+// which frame it expects, so every color buffer counts the writes into
+// it instead. When a layer shows another buffer than in its last post,
+// that buffer was queued again and has to hold a newer write than the
+// one we composed from it last time.
+//
+// Thread safe, the compositor waits without the Renderer lock held. It
+// composes on a render thread which holds the decode lock shared by all
+// render threads, that is released while waiting as well.
+class ContentTracker {
+ public:
+  typedef uint32_t HandleType;
+
+  // Name and color buffer of a layer about to be composed.
+  typedef std::pair<std::string, HandleType> Layer;
+
+  // Record a finished write into |colorBuffer|.
+  void contentUpdated(HandleType colorBuffer);
+
+  // Forget a destroyed color buffer and the layers which showed it.
+  void remove(HandleType colorBuffer);
+
+  // Return the number of writes recorded for |colorBuffer|.
+  uint64_t sequence(HandleType colorBuffer) const;
+
+  // Wait until the buffer of every layer which changed its buffer since
+  // its last post has new content, for at most |timeout| altogether.
+  // Afterwards all layers count as composed. Returns false if we gave up
+  // on any of them. |decodeLock|, if given and held, is released while
+  // waiting so the flushes we wait for can be decoded.
+  bool waitForLayers(const std::vector<Layer> &layers,
+                     const std::chrono::milliseconds &timeout,
+                     std::unique_lock<std::mutex> *decodeLock = nullptr);
+
+ private:
+  bool waitForContent(const std::vector<Layer> &layers,
+                       const std::chrono::milliseconds &timeout);
+
+  struct Buffer {
+    // Writes into the buffer so far.
+    uint64_t sequence = 0;
+    // Value of |sequence| when the buffer was composed last time.
+    uint64_t composed = 0;
+  };
+
+  mutable std::mutex m_lock;
+  std::condition_variable m_updated;
+  std::map<HandleType, Buffer> m_buffers;
+  std::map<std::string, HandleType> m_layers;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/FenceSync.h"
+#include "anbox/graphics/gl_extensions.h"
+#include "anbox/logger.h"
+
+#include "external/android-emugl/host/include/OpenGLESDispatch/EGLDispatch.h"
+
+#include <mutex>
+
+namespace {
+std::mutex supported_lock;
+EGLDisplay supported_display = EGL_NO_DISPLAY;
+bool supported = false;
+}  // namespace
+
+bool fenceSyncSupported(EGLDisplay display) {
+  if (!s_egl.initialized || display == EGL_NO_DISPLAY)
+    return false;
+
+  // We only ever have a single display so remembering the result for
+  // the last one is enough to keep the extension string parsing out of
+  // the common path.
+  std::lock_guard<std::mutex> l(supported_lock);
+  if (display == supported_display)
+    return supported;
+
+  const auto extensions = s_egl.eglQueryString(display, EGL_EXTENSIONS);
+  supported = extensions &&
+              anbox::graphics::GLExtensions{extensions}.support("EGL_KHR_fence_sync") &&
+              s_egl.eglCreateSyncKHR &&
+              s_egl.eglDestroySyncKHR &&
+              s_egl.eglClientWaitSyncKHR;
+  supported_display = display;
+
+  if (!supported)
+    DEBUG("EGL_KHR_fence_sync is not available, using glFinish to wait for the guest");
+
+  return supported;
+}
+
+bool finishCurrentContext() {
+  if (!s_egl.initialized || !s_egl.eglGetCurrentDisplay)
+    return false;
+
+  const auto display = s_egl.eglGetCurrentDisplay();
+  if (!fenceSyncSupported(display))
+    return false;
+
+  const auto sync = s_egl.eglCreateSyncKHR(display, EGL_SYNC_FENCE_KHR, nullptr);
+  if (sync == EGL_NO_SYNC_KHR)
+    return false;
+
+  // The flush bit makes sure the fence is submitted, otherwise we could
+  // wait forever for commands still sitting in the driver.
+  const auto result = s_egl.eglClientWaitSyncKHR(display, sync, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR);
+  s_egl.eglDestroySyncKHR(display, sync);
+
+  return result == EGL_CONDITION_SATISFIED_KHR;
+}
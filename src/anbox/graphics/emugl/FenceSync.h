@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _LIBRENDER_FENCE_SYNC_H
+#define _LIBRENDER_FENCE_SYNC_H
+
+#include <EGL/egl.h>
+
+// Waits until all commands the current context of the calling thread
+// issued so far have completed. Unlike glFinish this uses a fence sync
+// in the command stream of that context so the host driver doesn't
+// have to drain the work of all other contexts sharing the GPU.
+//
+// Returns false if the host EGL implementation doesn't support
+// EGL_KHR_fence_sync or waiting for the fence failed. Callers have to
+// fall back to glFinish then.
+bool finishCurrentContext();
+
+// Returns true if finishCurrentContext() can use fence syncs on the
+// given display.
+bool fenceSyncSupported(EGLDisplay display);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/ProcessResources.h"
+#include "anbox/logger.h"
+
+#include <sstream>
+
+uint32_t ProcessResources::createProcess() {
+  uint32_t id;
+  do {
+    id = ++m_nextProcess;
+  } while (id == 0 || m_processes.find(id) != m_processes.end());
+
+  m_processes[id].connections = 1;
+  return id;
+}
+
+bool ProcessResources::addConnection(uint32_t process) {
+  auto p = m_processes.find(process);
+  if (p == m_processes.end())
+    return false;
+
+  p->second.connections++;
+  return true;
+}
+
+void ProcessResources::removeConnection(uint32_t process, const ReleaseFunc &release) {
+  auto p = m_processes.find(process);
+  if (p == m_processes.end())
+    return;
+
+  if (--p->second.connections > 0)
+    return;
+
+  uint64_t references = 0;
+  uint64_t destroyed = 0;
+  for (const auto &cb : p->second.colorBuffers) {
+    references += cb.second;
+    if (release(cb.first, cb.second))
+      destroyed++;
+  }
+  m_processes.erase(p);
+
+  if (references == 0)
+    return;
+
+  m_leakingProcesses++;
+  m_reclaimedReferences += references;
+  m_reclaimedColorBuffers += destroyed;
+  WARNING("Guest process %d went away holding %d color buffer references, destroyed %d color buffers",
+          process, references, destroyed);
+}
+
+void ProcessResources::addReference(uint32_t process, HandleType colorBuffer) {
+  auto p = m_processes.find(process);
+  if (p == m_processes.end())
+    return;
+
+  p->second.colorBuffers[colorBuffer]++;
+}
+
+void ProcessResources::removeReference(uint32_t process, HandleType colorBuffer) {
+  auto p = m_processes.find(process);
+  if (p == m_processes.end())
+    return;
+
+  // Processes may close references another process opened, we can only
+  // account for the ones we know about.
+  auto cb = p->second.colorBuffers.find(colorBuffer);
+  if (cb == p->second.colorBuffers.end())
+    return;
+
+  if (--cb->second == 0)
+    p->second.colorBuffers.erase(cb);
+}
+
+ProcessResources::Stats ProcessResources::stats() const {
+  Stats stats;
+  stats.processes = m_processes.size();
+  for (const auto &p : m_processes) {
+    for (const auto &cb : p.second.colorBuffers)
+      stats.references += cb.second;
+  }
+  stats.leaking_processes = m_leakingProcesses;
+  stats.reclaimed_references = m_reclaimedReferences;
+  stats.reclaimed_color_buffers = m_reclaimedColorBuffers;
+  return stats;
+}
+
+std::string ProcessResources::dump() const {
+  const auto s = stats();
+  std::stringstream out;
+  out << "processes " << s.processes
+      << ", references " << s.references
+      << ", leaking processes " << s.leaking_processes
+      << ", reclaimed references " << s.reclaimed_references
+      << ", reclaimed color buffers " << s.reclaimed_color_buffers << std::endl;
+  for (const auto &p : m_processes) {
+    uint64_t references = 0;
+    for (const auto &cb : p.second.colorBuffers)
+      references += cb.second;
+    out << "  process " << p.first << ": " << p.second.connections << " connections, "
+        << p.second.colorBuffers.size() << " color buffers, "
+        << references << " references" << std::endl;
+  }
+  return out.str();
+}
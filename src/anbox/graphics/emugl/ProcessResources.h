@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _LIBRENDER_PROCESS_RESOURCES_H
+#define _LIBRENDER_PROCESS_RESOURCES_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+// Keeps track of the color buffer references each guest process holds.
+// Guest processes share color buffers and a process which crashes or is
+// killed never closes the ones it opened, so when the last connection of
+// a process goes away we hand back everything it still references.
+//
+// Connections which never identified their process (older system images)
+// are not tracked. Not thread safe, the Renderer calls it with its lock
+// held.
+class ProcessResources {
+ public:
+  typedef uint32_t HandleType;
+
+  // Called for every color buffer a process still referenced when its
+  // last connection went away, with the number of references to drop.
+  // Returns true if that destroyed the color buffer.
+  typedef std::function<bool(HandleType, uint32_t)> ReleaseFunc;
+
+  struct Stats {
+    // Processes with at least one open connection.
+    uint64_t processes = 0;
+    // Color buffer references held by those processes.
+    uint64_t references = 0;
+    // Processes which went away without closing all their references.
+    uint64_t leaking_processes = 0;
+    // References and color buffers we reclaimed from those.
+    uint64_t reclaimed_references = 0;
+    uint64_t reclaimed_color_buffers = 0;
+  };
+
+  // Register a new guest process with a single connection and return
+  // its id. Ids are never 0.
+  uint32_t createProcess();
+
+  // Attribute another connection to |process|. Returns false if the
+  // process is unknown, e.g. because it was already reclaimed.
+  bool addConnection(uint32_t process);
+
+  // Drop a connection of |process|. Once the last one is gone |release|
+  // is called for every reference the process didn't close itself.
+  void removeConnection(uint32_t process, const ReleaseFunc &release);
+
+  // Record that |process| took or dropped a reference to |colorBuffer|.
+  void addReference(uint32_t process, HandleType colorBuffer);
+  void removeReference(uint32_t process, HandleType colorBuffer);
+
+  Stats stats() const;
+  std::string dump() const;
+
+ private:
+  struct Process {
+    uint32_t connections = 0;
+    // Number of references per color buffer.
+    std::map<HandleType, uint32_t> colorBuffers;
+  };
+
+  uint32_t m_nextProcess = 0;
+  std::map<uint32_t, Process> m_processes;
+  uint64_t m_leakingProcesses = 0;
+  uint64_t m_reclaimedReferences = 0;
+  uint64_t m_reclaimedColorBuffers = 0;
+};
+
+#endif
@@ -18,45 +18,145 @@
 #include "anbox/logger.h"
 
 #include <assert.h>
-#include <limits.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
-ReadBuffer::ReadBuffer(size_t bufsize) {
-  m_size = bufsize;
-  m_buf = static_cast<unsigned char*>(malloc(m_size * sizeof(unsigned char)));
-  m_validData = 0;
-  m_readPtr = m_buf;
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+namespace {
+// A grown buffer is given back once this many times its size went
+// through it without needing more than the initial size. Bursts of large
+// commands are usually close together and we don't want to pay for
+// mapping fresh memory for each of them.
+constexpr const size_t shrink_after_sizes{4};
+
+// Leftovers up to this size are moved to the start of the buffer before
+// reading more. That is cheaper than walking the whole ring and keeps the
+// data we decode in the cache.
+constexpr const size_t max_compact_size{16 * 1024};
+
+size_t round_to_pages(size_t size) {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return (size + page_size - 1) / page_size * page_size;
 }
 
-ReadBuffer::~ReadBuffer() { free(m_buf); }
+// Maps size bytes of shared memory twice, directly one after the other.
+unsigned char *map_mirrored(size_t size) {
+#ifdef SYS_memfd_create
+  const int fd = static_cast<int>(::syscall(SYS_memfd_create, "anbox-read-buffer", MFD_CLOEXEC));
+  if (fd < 0)
+    return nullptr;
 
-int ReadBuffer::getData(IOStream* stream) {
-  if (stream == NULL) return -1;
-  if ((m_validData > 0) && (m_readPtr > m_buf)) {
-    memmove(m_buf, m_readPtr, m_validData);
-  }
-  // get fresh data into the buffer;
-  size_t len = m_size - m_validData;
-  if (len == 0) {
-    // we need to inc our buffer
-    size_t new_size = m_size * 2;
-    unsigned char* new_buf;
-    if (new_size < m_size) {  // overflow check
-      new_size = INT_MAX;
+  unsigned char *area = nullptr;
+  if (::ftruncate(fd, size) == 0) {
+    // Reserve the whole range first so nobody else can take the second
+    // half before we mapped it.
+    auto reserved = ::mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved != MAP_FAILED) {
+      area = static_cast<unsigned char*>(reserved);
+      if (::mmap(area, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+          ::mmap(area + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        ::munmap(area, 2 * size);
+        area = nullptr;
+      }
     }
+  }
+  ::close(fd);
+  return area;
+#else
+  (void)size;
+  return nullptr;
+#endif
+}
+}  // namespace
+
+ReadBuffer::ReadBuffer(size_t bufsize) : m_initialSize(round_to_pages(bufsize)) {
+  if (!resize(m_initialSize))
+    ERROR("Failed to alloc %zu bytes for ReadBuffer", m_initialSize);
+}
+
+ReadBuffer::~ReadBuffer() {
+  if (m_buf)
+    ::munmap(m_buf, m_mirrored ? 2 * m_size : m_size);
+}
+
+bool ReadBuffer::resize(size_t size) {
+  assert(size >= m_validData);
+
+  bool mirrored = true;
+  auto buf = map_mirrored(size);
+  if (!buf) {
+    mirrored = false;
+    auto area = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+      return false;
+    buf = static_cast<unsigned char*>(area);
+  }
 
-    new_buf = static_cast<unsigned char*>(realloc(m_buf, new_size));
-    if (!new_buf) {
+  if (m_buf) {
+    // With a mirrored buffer the valid data is always contiguous, even
+    // when it wraps around the end.
+    if (m_validData > 0)
+      memcpy(buf, m_buf + m_head, m_validData);
+    ::munmap(m_buf, m_mirrored ? 2 * m_size : m_size);
+  }
+
+  m_buf = buf;
+  m_size = size;
+  m_head = 0;
+  m_mirrored = mirrored;
+  m_quietBytes = 0;
+  return true;
+}
+
+int ReadBuffer::getData(IOStream* stream) {
+  if (stream == NULL || m_buf == NULL) return -1;
+
+  // Give the memory back once a burst of large commands is over.
+  if (m_size > m_initialSize && m_quietBytes >= shrink_after_sizes * m_size &&
+      m_validData < m_initialSize / 2 && !resize(m_initialSize))
+    m_quietBytes = 0;
+
+  // A single command doesn't fit so we need a bigger buffer.
+  if (m_validData == m_size) {
+    const size_t new_size = m_size * 2;
+    if (new_size < m_size || !resize(new_size)) {
       ERROR("Failed to alloc %zu bytes for ReadBuffer", new_size);
       return -1;
     }
-    m_size = new_size;
-    m_buf = new_buf;
-    len = m_size - m_validData;
   }
-  m_readPtr = m_buf;
-  if (NULL != stream->read(m_buf + m_validData, &len)) {
+
+  // Data crossing the end of the ring can't be moved in place as its end
+  // is the mirror of the start we would write to.
+  if (m_head > 0 && m_validData <= max_compact_size && m_head + m_validData <= m_size) {
+    memmove(m_buf, m_buf + m_head, m_validData);
+    m_head = 0;
+  }
+
+  size_t tail = m_head + m_validData;
+  if (m_mirrored) {
+    // Everything from the tail up to the head is free and thanks to the
+    // second mapping it is contiguous too.
+    if (tail >= m_size)
+      tail -= m_size;
+  } else if (m_head > 0 && m_size - tail < m_size / 4) {
+    // Without the mirror we have to make room at the end ourself.
+    memmove(m_buf, m_buf + m_head, m_validData);
+    m_head = 0;
+    tail = m_validData;
+  }
+
+  size_t len = m_mirrored ? m_size - m_validData : m_size - tail;
+  if (NULL != stream->read(m_buf + tail, &len)) {
     m_validData += len;
+    if (m_validData > m_initialSize)
+      m_quietBytes = 0;
+    else
+      m_quietBytes += len;
     return len;
   }
   return -1;
@@ -65,5 +165,10 @@ int ReadBuffer::getData(IOStream* stream) {
 void ReadBuffer::consume(size_t amount) {
   assert(amount <= m_validData);
   m_validData -= amount;
-  m_readPtr += amount;
+  m_head += amount;
+
+  if (m_validData == 0)
+    m_head = 0;
+  else if (m_mirrored && m_head >= m_size)
+    m_head -= m_size;
 }
@@ -18,21 +18,40 @@
 
 #include "external/android-emugl/host/include/libOpenglRender/IOStream.h"
 
+// Buffers the data we read from the stream until the decoders have
+// consumed it. The buffer is a ring mapped twice back to back into the
+// address space so that any range of valid data, even one crossing the
+// end of the ring, can be handed to the decoders as a single contiguous
+// block without moving it around. If the kernel can't provide such a
+// mapping we fall back to a linear buffer which compacts itself.
+//
+// The buffer grows when a single command doesn't fit and shrinks back to
+// its initial size once the burst is over.
 class ReadBuffer {
  public:
   ReadBuffer(size_t bufSize);
   ~ReadBuffer();
   int getData(IOStream *stream);              // get fresh data from the stream
-  unsigned char *buf() { return m_readPtr; }  // return the next read location
+  unsigned char *buf() { return m_buf + m_head; }  // return the next read location
   size_t validData() {
     return m_validData;
   }                             // return the amount of valid data in readptr
   void consume(size_t amount);  // notify that 'amount' data has been consumed;
+
+  size_t size() const { return m_size; }
+  bool mirrored() const { return m_mirrored; }
+
  private:
-  unsigned char *m_buf;
-  unsigned char *m_readPtr;
-  size_t m_size;
-  size_t m_validData;
+  bool resize(size_t size);
+
+  unsigned char *m_buf = nullptr;
+  size_t m_size = 0;
+  size_t m_initialSize = 0;
+  size_t m_head = 0;
+  size_t m_validData = 0;
+  bool m_mirrored = false;
+  // Bytes read since we last needed more than the initial size.
+  size_t m_quietBytes = 0;
 };
 
 #endif
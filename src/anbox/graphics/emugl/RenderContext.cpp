@@ -16,10 +16,14 @@
 
 #include "anbox/graphics/emugl/RenderContext.h"
 
+#include "anbox/graphics/emugl/DispatchTables.h"
+#include "anbox/logger.h"
+
 #include "OpenGLESDispatch/EGLDispatch.h"
 
 RenderContext* RenderContext::create(EGLDisplay display, EGLConfig config,
-                                     EGLContext sharedContext, bool isGl2) {
+                                     EGLContext sharedContext, bool isGl2,
+                                     EGLSurface releaseSurface) {
   const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, isGl2 ? 2 : 1,
                                    EGL_NONE};
   EGLContext context =
@@ -28,14 +32,42 @@ RenderContext* RenderContext::create(EGLDisplay display, EGLConfig config,
     return NULL;
   }
 
-  return new RenderContext(display, context, isGl2);
+  return new RenderContext(display, context, isGl2, releaseSurface);
 }
 
-RenderContext::RenderContext(EGLDisplay display, EGLContext context, bool isGl2)
-    : mDisplay(display), mContext(context), mIsGl2(isGl2), mContextData() {}
+RenderContext::RenderContext(EGLDisplay display, EGLContext context, bool isGl2,
+                             EGLSurface releaseSurface)
+    : mDisplay(display), mContext(context), mReleaseSurface(releaseSurface),
+      mIsGl2(isGl2), mContextData() {}
 
 RenderContext::~RenderContext() {
   if (mContext != EGL_NO_CONTEXT) {
+    releaseStreamBuffers();
     s_egl.eglDestroyContext(mDisplay, mContext);
   }
 }
+
+void RenderContext::releaseStreamBuffers() {
+  if (!mContextData.hasStreamBuffers()) return;
+
+  // The buffers belong to the share group which lives on as long as any
+  // context sharing with us, so they have to be deleted while we are
+  // still current.
+  EGLContext prevContext = s_egl.eglGetCurrentContext();
+  EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
+  EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+
+  if (prevContext != mContext &&
+      !s_egl.eglMakeCurrent(mDisplay, mReleaseSurface, mReleaseSurface, mContext)) {
+    DEBUG("Failed to bind context to release its stream buffers, they live on with its share group");
+    return;
+  }
+
+  if (mIsGl2)
+    mContextData.releaseStreamBuffers(&s_gles2);
+  else
+    mContextData.releaseStreamBuffers(&s_gles1);
+
+  if (prevContext != mContext)
+    s_egl.eglMakeCurrent(mDisplay, prevDrawSurf, prevReadSurf, prevContext);
+}
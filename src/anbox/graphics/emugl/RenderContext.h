@@ -34,8 +34,12 @@ class RenderContext {
   // |sharedContext| is either EGL_NO_CONTEXT of a host EGLContext handle.
   // |isGl2| is true iff the new context will be used with GLESv2, or
   // GLESv1 otherwise.
+  // |releaseSurface| is bound with the context to delete the buffers it
+  // streamed client arrays through on destruction, EGL_NO_SURFACE if the
+  // display supports surfaceless contexts.
   static RenderContext* create(EGLDisplay display, EGLConfig config,
-                               EGLContext sharedContext, bool isGL2 = false);
+                               EGLContext sharedContext, bool isGL2 = false,
+                               EGLSurface releaseSurface = EGL_NO_SURFACE);
 
   // Destructor.
   ~RenderContext();
@@ -53,11 +57,15 @@ class RenderContext {
  private:
   RenderContext();
 
-  RenderContext(EGLDisplay display, EGLContext context, bool isGl2);
+  RenderContext(EGLDisplay display, EGLContext context, bool isGl2,
+                EGLSurface releaseSurface);
+
+  void releaseStreamBuffers();
 
  private:
   EGLDisplay mDisplay;
   EGLContext mContext;
+  EGLSurface mReleaseSurface;
   bool mIsGl2;
   GLDecoderContextData mContextData;
 };
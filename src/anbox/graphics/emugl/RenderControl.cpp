@@ -31,6 +31,12 @@
 #include <sstream>
 
 static const GLint rendererVersion = 1;
+
+// Feature strings we append to GL_EXTENSIONS so the guest can find out
+// which additional renderControl calls we support.
+static const char *kAsyncFrameCommands = "ANDROID_EMU_async_frame_commands";
+static const char *kProcessTracking = "ANDROID_EMU_process_tracking";
+static const char *kYUVColorBuffers = "ANDROID_EMU_yuv_color_buffers";
 static std::shared_ptr<anbox::graphics::LayerComposer> composer;
 static std::shared_ptr<Renderer> renderer;
 
@@ -144,6 +150,18 @@ static EGLint rcGetGLString(EGLenum name, void* buffer, EGLint bufferSize) {
     };
 
     result = filter_extensions(result, whitelisted_extensions);
+
+    if (!result.empty())
+      result += " ";
+    result += kAsyncFrameCommands;
+    result += " ";
+    result += kProcessTracking;
+
+    // Without it the guest converts YUV buffers itself.
+    if (renderer && renderer->getCaps().has_yuv_color_buffers) {
+      result += " ";
+      result += kYUVColorBuffers;
+    }
   }
 
   int nextBufferSize = result.size() + 1;
@@ -276,16 +294,45 @@ static void rcCloseColorBuffer(uint32_t colorbuffer) {
   renderer->closeColorBuffer(colorbuffer);
 }
 
-static int rcFlushWindowColorBuffer(uint32_t windowSurface) {
+static bool flushWindowColorBuffer(uint32_t windowSurface) {
   if (!renderer)
-    return -1;
+    return false;
+
+  return renderer->flushWindowSurfaceColorBuffer(windowSurface);
+}
+
+static int rcFlushWindowColorBuffer(uint32_t windowSurface) {
+  bool asyncFlushFailed = false;
+  RenderThreadInfo *tInfo = RenderThreadInfo::get();
+  if (tInfo) {
+    asyncFlushFailed = tInfo->m_asyncFlushFailed;
+    tInfo->m_asyncFlushFailed = false;
+  }
 
-  if (!renderer->flushWindowSurfaceColorBuffer(windowSurface))
+  if (!flushWindowColorBuffer(windowSurface) || asyncFlushFailed)
     return -1;
 
   return 0;
 }
 
+static void rcFlushWindowColorBufferAsync(uint32_t windowSurface) {
+  if (flushWindowColorBuffer(windowSurface))
+    return;
+
+  // Nobody waits for our reply so keep the error until the guest asks
+  // for it with the next synchronous flush.
+  RenderThreadInfo *tInfo = RenderThreadInfo::get();
+  if (tInfo)
+    tInfo->m_asyncFlushFailed = true;
+}
+
+static void rcSetProcessId(uint32_t processId) {
+  if (!renderer)
+    return;
+
+  renderer->setProcess(processId);
+}
+
 static void rcSetWindowColorBuffer(uint32_t windowSurface,
                                    uint32_t colorBuffer) {
   if (!renderer)
@@ -402,6 +449,8 @@ int rcGetDisplayVsyncPeriod(uint32_t display_id) {
 }
 
 static std::vector<Renderable> frame_layers;
+// When Android started posting the layers of the current frame.
+static anbox::graphics::FrameStats::Clock::time_point frame_posted;
 
 bool is_layer_blacklisted(const std::string &name) {
   static std::vector<std::string> blacklist = {
@@ -425,13 +474,20 @@ void rcPostLayer(const char *name, uint32_t color_buffer, float alpha,
       alpha,
       {displayFrameLeft, displayFrameTop, displayFrameRight, displayFrameBottom},
       {sourceCropLeft, sourceCropTop, sourceCropRight, sourceCropBottom}};
+  if (frame_posted == anbox::graphics::FrameStats::Clock::time_point{})
+    frame_posted = anbox::graphics::FrameStats::Clock::now();
   frame_layers.push_back(r);
 }
 
 void rcPostAllLayersDone() {
-  if (composer) composer->submit_layers(frame_layers);
+  // Composition releases the decode lock while it waits for content so
+  // other render threads may post layers in the meantime.
+  std::vector<Renderable> layers;
+  layers.swap(frame_layers);
+  const auto posted = frame_posted;
+  frame_posted = anbox::graphics::FrameStats::Clock::time_point{};
 
-  frame_layers.clear();
+  if (composer) composer->submit_layers(layers, posted);
 }
 
 void initRenderControlContext(renderControl_decoder_context_t *dec) {
@@ -472,4 +528,6 @@ void initRenderControlContext(renderControl_decoder_context_t *dec) {
   dec->rcGetDisplayVsyncPeriod = rcGetDisplayVsyncPeriod;
   dec->rcPostLayer = rcPostLayer;
   dec->rcPostAllLayersDone = rcPostAllLayersDone;
+  dec->rcFlushWindowColorBufferAsync = rcFlushWindowColorBufferAsync;
+  dec->rcSetProcessId = rcSetProcessId;
 }
@@ -15,6 +15,9 @@
 */
 
 #include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/common/memory_accounting.h"
+#include "anbox/common/thread_topology.h"
+#include "anbox/graphics/emugl/FenceSync.h"
 #include "anbox/graphics/emugl/ReadBuffer.h"
 #include "anbox/graphics/emugl/RenderControl.h"
 #include "anbox/graphics/emugl/RenderThreadInfo.h"
@@ -27,54 +30,118 @@
 #include "external/android-emugl/host/include/OpenGLESDispatch/GLESv1Dispatch.h"
 #include "external/android-emugl/host/include/OpenGLESDispatch/GLESv2Dispatch.h"
 
+#include <atomic>
+
 #define STREAM_BUFFER_SIZE 4 * 1024 * 1024
 
-RenderThread::RenderThread(const std::shared_ptr<Renderer> &renderer, IOStream *stream, std::mutex &m)
-    : emugl::Thread(), renderer_(renderer), m_lock(m), m_stream(stream) {}
+namespace {
+// The guest implements glFinish with a round trip to the host. The
+// decoders would answer it with a glFinish which drains the work of every
+// context on the host GPU, so we only wait for the calling context.
+template<typename Decoder>
+int finishRoundTrip(void *self) {
+  if (!finishCurrentContext())
+    static_cast<Decoder*>(self)->glFinish();
+  return 0;
+}
+
+// Base opcodes from gles1.attrib, gles2.attrib and renderControl.attrib.
+constexpr const uint32_t kGLESv1FirstOpcode = 1024;
+constexpr const uint32_t kGLESv2FirstOpcode = 2048;
+constexpr const uint32_t kRenderControlFirstOpcode = 10000;
+
+// Decoders of an API are created when its first command arrives and take
+// over the context data of the context already bound for it.
+template<typename Decoder>
+void createDecoder(std::unique_ptr<Decoder> &decoder, RenderThreadInfo &threadInfo,
+                   typename Decoder::get_proc_func_t getProcFunc, bool gl2) {
+  decoder.reset(new Decoder);
+  decoder->initGL(getProcFunc, NULL);
+  decoder->glFinishRoundTrip = finishRoundTrip<Decoder>;
+  if (threadInfo.currContext && threadInfo.currContext->isGL2() == gl2)
+    decoder->setContextData(&threadInfo.currContext->decoderContextData());
+}
+
+void createDecoderFor(ReadBuffer &readBuf, RenderThreadInfo &threadInfo) {
+  if (readBuf.validData() < sizeof(uint32_t))
+    return;
+
+  const auto opcode = *reinterpret_cast<const uint32_t*>(readBuf.buf());
+  if (opcode >= kGLESv1FirstOpcode && opcode < kGLESv2FirstOpcode) {
+    if (!threadInfo.m_glDec)
+      createDecoder(threadInfo.m_glDec, threadInfo, gles1_dispatch_get_proc_func, false);
+  } else if (opcode >= kGLESv2FirstOpcode && opcode < kRenderControlFirstOpcode) {
+    if (!threadInfo.m_gl2Dec)
+      createDecoder(threadInfo.m_gl2Dec, threadInfo, gles2_dispatch_get_proc_func, true);
+  }
+}
+}  // namespace
+
+RenderThread::RenderThread(const std::shared_ptr<Renderer> &renderer, IOStream *stream, std::mutex &m,
+                           const std::string &owner)
+    : emugl::Thread(), renderer_(renderer), m_lock(m), m_stream(stream), m_owner(owner) {}
 
 RenderThread::~RenderThread() {
   forceStop();
 }
 
-RenderThread *RenderThread::create(const std::shared_ptr<Renderer> &renderer, IOStream *stream, std::mutex &m) {
-  return new RenderThread(renderer, stream, m);
+RenderThread *RenderThread::create(const std::shared_ptr<Renderer> &renderer, IOStream *stream, std::mutex &m,
+                                   const std::string &owner) {
+  return new RenderThread(renderer, stream, m, owner);
 }
 
 void RenderThread::forceStop() { m_stream->forceStop(); }
 
 intptr_t RenderThread::main() {
+  static std::atomic<unsigned int> next_thread_id{0};
+  const auto thread_name = "render-" + std::to_string(next_thread_id++);
+  anbox::common::setup_current_thread(anbox::common::ThreadClass::Render, thread_name);
+
   RenderThreadInfo threadInfo;
+  threadInfo.m_throttle = anbox::graphics::RenderThrottle::global()->connect(thread_name);
   ChecksumCalculatorThreadInfo threadChecksumInfo;
 
-  threadInfo.m_glDec.initGL(gles1_dispatch_get_proc_func, NULL);
-  threadInfo.m_gl2Dec.initGL(gles2_dispatch_get_proc_func, NULL);
   initRenderControlContext(&threadInfo.m_rcDec);
 
   ReadBuffer readBuf(STREAM_BUFFER_SIZE);
+  anbox::common::MemoryAccounting::Account account{
+      anbox::common::MemoryAccounting::Subsystem::RenderThreadBuffers, m_owner};
 
   while (true) {
     int stat = readBuf.getData(m_stream);
     if (stat <= 0)
       break;
 
+    // The buffer only changes its size while reading.
+    account.set(readBuf.size());
+
     bool progress;
     do {
       progress = false;
 
       std::unique_lock<std::mutex> l(m_lock);
+      threadInfo.m_decodeLock = &l;
 
-      size_t last =
-          threadInfo.m_glDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-      if (last > 0) {
-        progress = true;
-        readBuf.consume(last);
+      createDecoderFor(readBuf, threadInfo);
+
+      size_t last = 0;
+      if (threadInfo.m_glDec) {
+        last = threadInfo.m_glDec->decode(readBuf.buf(), readBuf.validData(), m_stream);
+        if (last > 0) {
+          progress = true;
+          readBuf.consume(last);
+        }
       }
 
-      last =
-          threadInfo.m_gl2Dec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-      if (last > 0) {
-        progress = true;
-        readBuf.consume(last);
+      // The GLES1 decoder stops at the first command of another API.
+      createDecoderFor(readBuf, threadInfo);
+
+      if (threadInfo.m_gl2Dec) {
+        last = threadInfo.m_gl2Dec->decode(readBuf.buf(), readBuf.validData(), m_stream);
+        if (last > 0) {
+          progress = true;
+          readBuf.consume(last);
+        }
       }
 
       last = threadInfo.m_rcDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
@@ -83,12 +150,18 @@ intptr_t RenderThread::main() {
         progress = true;
       }
 
+      // Sleeping with the lock held would stall all other connections.
+      threadInfo.m_decodeLock = nullptr;
+      l.unlock();
+      threadInfo.m_throttle->wait_for_next_frame();
     } while (progress);
 
   }
 
-  threadInfo.m_gl2Dec.freeShader();
-  threadInfo.m_gl2Dec.freeProgram();
+  if (threadInfo.m_gl2Dec) {
+    threadInfo.m_gl2Dec->freeShader();
+    threadInfo.m_gl2Dec->freeProgram();
+  }
 
   // Release references to the current thread's context/surfaces if any
   renderer_->bindContext(0, 0, 0);
@@ -97,6 +170,7 @@ intptr_t RenderThread::main() {
 
   renderer_->drainWindowSurface();
   renderer_->drainRenderContext();
+  renderer_->drainProcessResources();
 
   return 0;
 }
@@ -23,6 +23,7 @@
 
 #include <memory>
 #include <mutex>
+#include <string>
 
 class Renderer;
 
@@ -37,7 +38,9 @@ class RenderThread : public emugl::Thread {
   // decoding operations between all threads.
   // TODO(digit): Why is this needed here? Shouldn't this be handled
   //              by the decoders themselves or at a lower-level?
-  static RenderThread* create(const std::shared_ptr<Renderer>& renderer, IOStream* stream, std::mutex &m);
+  // |owner| is the connection the memory of the thread is accounted to.
+  static RenderThread* create(const std::shared_ptr<Renderer>& renderer, IOStream* stream, std::mutex &m,
+                              const std::string &owner);
 
   // Destructor.
   virtual ~RenderThread();
@@ -52,13 +55,15 @@ class RenderThread : public emugl::Thread {
  private:
   RenderThread();  // No default constructor
 
-  RenderThread(const std::shared_ptr<Renderer>& renderer, IOStream* stream, std::mutex &m);
+  RenderThread(const std::shared_ptr<Renderer>& renderer, IOStream* stream, std::mutex &m,
+               const std::string &owner);
 
   virtual intptr_t main();
 
   std::shared_ptr<Renderer> renderer_;
   std::mutex &m_lock;
   IOStream* m_stream;
+  std::string m_owner;
 };
 
 #endif
@@ -18,6 +18,7 @@
 #define _LIB_OPENGL_RENDER_THREAD_INFO_H
 
 #include "anbox/graphics/emugl/RenderContext.h"
+#include "anbox/graphics/render_throttle.h"
 #include "anbox/graphics/emugl/WindowSurface.h"
 
 #include "external/android-emugl/host/libs/GLESv1_dec/GLESv1Decoder.h"
@@ -26,6 +27,8 @@
 // Generated with emugl at build time
 #include "renderControl_dec.h"
 
+#include <memory>
+#include <mutex>
 #include <set>
 
 typedef uint32_t HandleType;
@@ -50,15 +53,31 @@ struct RenderThreadInfo {
   WindowSurfacePtr currDrawSurf;
   WindowSurfacePtr currReadSurf;
 
-  // Decoder states.
-  GLESv1Decoder m_glDec;
-  GLESv2Decoder m_gl2Dec;
+  // Decoder states. The GLES decoders are only created once the guest
+  // sends commands for their API, most connections only ever use one.
+  std::unique_ptr<GLESv1Decoder> m_glDec;
+  std::unique_ptr<GLESv2Decoder> m_gl2Dec;
   renderControl_decoder_context_t m_rcDec;
 
   // all the contexts that are created by this render thread
   ThreadContextSet m_contextSet;
   // all the window surfaces that are created by this render thread
   WindowSurfaceSet m_windowSet;
+
+  // Set when an asynchronous window flush failed. Reported to the guest
+  // with the next synchronous flush.
+  bool m_asyncFlushFailed = false;
+
+  // Guest process this connection belongs to, 0 if it never told us.
+  uint32_t m_processId = 0;
+
+  // Decode lock shared by all render threads, set while this thread
+  // holds it. Commands which wait for other render threads release it.
+  std::unique_lock<std::mutex> *m_decodeLock = nullptr;
+
+  // Paces the connection when the window it renders for is in the
+  // background.
+  std::shared_ptr<anbox::graphics::RenderThrottle::Connection> m_throttle;
 };
 
 #endif
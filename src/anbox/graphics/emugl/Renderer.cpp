@@ -19,6 +19,7 @@
 #include "anbox/graphics/emugl/RenderThreadInfo.h"
 #include "anbox/graphics/emugl/TimeUtils.h"
 #include "anbox/graphics/gl_extensions.h"
+#include "anbox/graphics/render_throttle.h"
 #include "anbox/logger.h"
 
 #include "external/android-emugl/host/include/OpenGLESDispatch/EGLDispatch.h"
@@ -27,6 +28,9 @@
 #include "gles2_dec.h"
 
 #include <stdio.h>
+#include <string.h>
+
+#include <sstream>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wold-style-cast"
@@ -36,6 +40,9 @@
 #pragma GCC diagnostic pop
 
 namespace {
+// How long the compositor waits for the content of posted buffers before
+// it draws them anyway.
+constexpr const std::chrono::milliseconds max_flush_wait{100};
 
 // Helper class to call the bind_locked() / unbind_locked() properly.
 class ScopedBind {
@@ -236,6 +243,16 @@ bool Renderer::initialize(EGLNativeDisplayType nativeDisplay) {
   m_glRenderer = reinterpret_cast<const char *>(s_gles2.glGetString(GL_RENDERER));
   m_glVersion = reinterpret_cast<const char *>(s_gles2.glGetString(GL_VERSION));
 
+  bool software_renderer = false;
+  for (const auto &name : {"llvmpipe", "softpipe", "SwiftShader"}) {
+    if (m_glRenderer && strstr(m_glRenderer, name)) {
+      software_renderer = true;
+      break;
+    }
+  }
+  m_caps.has_streaming_client_arrays = !software_renderer;
+  m_caps.has_yuv_color_buffers = !software_renderer;
+
   m_textureDraw = new TextureDraw(m_eglDisplay);
   if (!m_textureDraw) {
     ERROR("Failed: creation of TextureDraw instance");
@@ -278,13 +295,9 @@ Renderer::Renderer()
       m_prevDrawSurf(EGL_NO_SURFACE),
       m_textureDraw(NULL),
       m_lastPostedColorBuffer(0),
-      m_statsNumFrames(0),
-      m_statsStartTime(0LL),
       m_glVendor(NULL),
       m_glRenderer(NULL),
-      m_glVersion(NULL) {
-  m_fpsStats = getenv("SHOW_FPS_STATS") != NULL;
-}
+      m_glVersion(NULL) {}
 
 Renderer::~Renderer() {
   delete m_textureDraw;
@@ -374,6 +387,9 @@ HandleType Renderer::createColorBuffer(int p_width, int p_height,
     ret = genHandle();
     m_colorbuffers[ret].cb = cb;
     m_colorbuffers[ret].refcount = 1;
+    RenderThreadInfo *tinfo = RenderThreadInfo::get();
+    if (tinfo && tinfo->m_processId)
+      m_processes.addReference(tinfo->m_processId, ret);
   }
   return ret;
 }
@@ -401,8 +417,9 @@ HandleType Renderer::createRenderContext(int p_config, HandleType p_share,
       share ? share->getEGLContext() : EGL_NO_CONTEXT;
 
   RenderContextPtr rctx(RenderContext::create(
-      m_eglDisplay, config->getEglConfig(), sharedContext, p_isGL2));
+      m_eglDisplay, config->getEglConfig(), sharedContext, p_isGL2, m_pbufSurface));
   if (rctx) {
+    rctx->decoderContextData().setStreamingEnabled(m_caps.has_streaming_client_arrays);
     ret = genHandle();
     m_contexts[ret] = rctx;
     RenderThreadInfo *tinfo = RenderThreadInfo::get();
@@ -461,7 +478,7 @@ void Renderer::drainWindowSurface() {
         ColorBufferMap::iterator cit(m_colorbuffers.find(oldColorBufferHandle));
         if (cit != m_colorbuffers.end()) {
           if (--(*cit).second.refcount == 0) {
-            m_colorbuffers.erase(cit);
+            removeColorBuffer_locked(cit);
           }
         }
       }
@@ -471,6 +488,68 @@ void Renderer::drainWindowSurface() {
   tinfo->m_windowSet.clear();
 }
 
+void Renderer::setProcess(uint32_t p_process) {
+  std::unique_lock<std::mutex> l(m_lock);
+
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (!tinfo || tinfo->m_processId) return;
+
+  if (m_processes.addConnection(p_process))
+    tinfo->m_processId = p_process;
+}
+
+void Renderer::drainProcessResources() {
+  std::unique_lock<std::mutex> l(m_lock);
+
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (!tinfo || !tinfo->m_processId) return;
+
+  removeProcessConnection_locked(tinfo->m_processId);
+  tinfo->m_processId = 0;
+}
+
+uint32_t Renderer::registerProcess() {
+  std::unique_lock<std::mutex> l(m_lock);
+  return m_processes.createProcess();
+}
+
+void Renderer::unregisterProcess(uint32_t p_process) {
+  std::unique_lock<std::mutex> l(m_lock);
+  removeProcessConnection_locked(p_process);
+}
+
+void Renderer::removeProcessConnection_locked(uint32_t p_process) {
+  m_processes.removeConnection(p_process, [&](HandleType colorBuffer, uint32_t references) {
+    ColorBufferMap::iterator c(m_colorbuffers.find(colorBuffer));
+    if (c == m_colorbuffers.end()) return false;
+
+    if (references >= (*c).second.refcount) {
+      removeColorBuffer_locked(c);
+      return true;
+    }
+    (*c).second.refcount -= references;
+    return false;
+  });
+}
+
+void Renderer::removeColorBuffer_locked(ColorBufferMap::iterator c) {
+  const auto handle = (*c).first;
+  m_colorbuffers.erase(c);
+  m_content.remove(handle);
+  anbox::graphics::RenderThrottle::global()->buffer_closed(handle);
+}
+
+std::string Renderer::dumpResourceStats() {
+  std::unique_lock<std::mutex> l(m_lock);
+
+  std::stringstream out;
+  out << "color buffers " << m_colorbuffers.size()
+      << ", contexts " << m_contexts.size()
+      << ", window surfaces " << m_windows.size() << std::endl
+      << m_processes.dump();
+  return out.str();
+}
+
 void Renderer::DestroyRenderContext(HandleType p_context) {
   std::unique_lock<std::mutex> l(m_lock);
 
@@ -501,6 +580,9 @@ int Renderer::openColorBuffer(HandleType p_colorbuffer) {
     return -1;
   }
   (*c).second.refcount++;
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (tinfo && tinfo->m_processId)
+    m_processes.addReference(tinfo->m_processId, p_colorbuffer);
   return 0;
 }
 
@@ -515,8 +597,11 @@ void Renderer::closeColorBuffer(HandleType p_colorbuffer) {
     // to give guest a notice yet)
     return;
   }
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (tinfo && tinfo->m_processId)
+    m_processes.removeReference(tinfo->m_processId, p_colorbuffer);
   if (--(*c).second.refcount == 0) {
-    m_colorbuffers.erase(c);
+    removeColorBuffer_locked(c);
   }
 }
 
@@ -535,7 +620,16 @@ bool Renderer::flushWindowSurfaceColorBuffer(HandleType p_surface) {
   if (!surface)
     return false;
 
-  surface->flushColorBuffer();
+  // Even a failed flush is final, the compositor shouldn't wait for it.
+  const auto flushed = surface->flushColorBuffer();
+  if ((*w).second.second)
+    m_content.contentUpdated((*w).second.second);
+  if (!flushed)
+    return false;
+
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (tinfo && tinfo->m_throttle)
+    tinfo->m_throttle->frame_flushed((*w).second.second);
 
   return true;
 }
@@ -589,6 +683,7 @@ bool Renderer::updateColorBuffer(HandleType p_colorbuffer, int x, int y,
   }
 
   (*c).second.cb->subUpdate(x, y, width, height, format, type, pixels);
+  m_content.contentUpdated(p_colorbuffer);
 
   return true;
 }
@@ -614,6 +709,9 @@ bool Renderer::bindColorBufferToRenderbuffer(HandleType p_colorbuffer) {
     return false;
   }
 
+  // We can't follow the rendering into the buffer, so don't let the
+  // compositor wait for it.
+  m_content.contentUpdated(p_colorbuffer);
   return (*c).second.cb->bindToRenderbuffer();
 }
 
@@ -691,14 +789,17 @@ bool Renderer::bindContext(HandleType p_context, HandleType p_drawSurface,
   tinfo->currContext = ctx;
   tinfo->currDrawSurf = draw;
   tinfo->currReadSurf = read;
+  // Decoders which don't exist yet pick up the context when created.
   if (ctx) {
-    if (ctx->isGL2())
-      tinfo->m_gl2Dec.setContextData(&ctx->decoderContextData());
-    else
-      tinfo->m_glDec.setContextData(&ctx->decoderContextData());
+    if (ctx->isGL2() && tinfo->m_gl2Dec)
+      tinfo->m_gl2Dec->setContextData(&ctx->decoderContextData());
+    else if (!ctx->isGL2() && tinfo->m_glDec)
+      tinfo->m_glDec->setContextData(&ctx->decoderContextData());
   } else {
-    tinfo->m_glDec.setContextData(NULL);
-    tinfo->m_gl2Dec.setContextData(NULL);
+    if (tinfo->m_glDec)
+      tinfo->m_glDec->setContextData(NULL);
+    if (tinfo->m_gl2Dec)
+      tinfo->m_gl2Dec->setContextData(NULL);
   }
   return true;
 }
@@ -938,9 +1039,28 @@ void Renderer::draw(RendererWindow *window, const Renderable &renderable,
   s_gles2.glDisableVertexAttribArray(prog.position_attr);
 }
 
+void Renderer::waitForPostedContent(const RenderableList &renderables) {
+  std::vector<ContentTracker::Layer> layers;
+  {
+    std::unique_lock<std::mutex> l(m_lock);
+    for (const auto &r : renderables) {
+      if (m_colorbuffers.find(r.buffer()) != m_colorbuffers.end())
+        layers.push_back(ContentTracker::Layer{r.name(), r.buffer()});
+    }
+  }
+
+  // Flushes need m_lock so we must not hold it while waiting. We compose
+  // on the render thread of the guest's compositor, the flushes of the
+  // other render threads can only be decoded without its decode lock.
+  RenderThreadInfo *tinfo = RenderThreadInfo::get();
+  if (!m_content.waitForLayers(layers, max_flush_wait, tinfo ? tinfo->m_decodeLock : nullptr))
+    DEBUG("Timed out waiting for the content of posted color buffers");
+}
+
 bool Renderer::draw(EGLNativeWindowType native_window,
                     const anbox::graphics::Rect &window_frame,
                     const RenderableList &renderables) {
+  waitForPostedContent(renderables);
 
   std::unique_lock<std::mutex> l(m_lock);
 
@@ -963,5 +1083,5 @@ bool Renderer::draw(EGLNativeWindowType native_window,
 
   unbind_locked();
 
-  return false;
+  return true;
 }
@@ -17,6 +17,8 @@
 #define _LIBRENDER_FRAMEBUFFER_H
 
 #include "anbox/graphics/emugl/ColorBuffer.h"
+#include "anbox/graphics/emugl/ContentTracker.h"
+#include "anbox/graphics/emugl/ProcessResources.h"
 #include "anbox/graphics/emugl/RenderContext.h"
 #include "anbox/graphics/emugl/RendererConfig.h"
 #include "anbox/graphics/emugl/TextureDraw.h"
@@ -53,11 +55,19 @@ typedef std::map<HandleType, ColorBufferRef> ColorBufferMap;
 // extension is supported.
 // |has_eglimage_renderbuffer| is true iff the EGL_KHR_gl_renderbuffer_image
 // extension is supported.
+// |has_streaming_client_arrays| is true iff guest client array data
+// should be streamed through buffer objects. Software rasterizers read
+// client arrays in place and stall on every buffer update instead.
+// |has_yuv_color_buffers| is true iff YUV color buffers should be
+// converted on the host. Software rasterizers are slower at running the
+// conversion shader than the guest is at converting on the CPU.
 // |eglMajor| and |eglMinor| are the major and minor version numbers of
 // the underlying EGL implementation.
 struct RendererCaps {
   bool has_eglimage_texture_2d;
   bool has_eglimage_renderbuffer;
+  bool has_streaming_client_arrays;
+  bool has_yuv_color_buffers;
   EGLint eglMajor;
   EGLint eglMinor;
 };
@@ -142,6 +152,31 @@ class Renderer : public anbox::graphics::Renderer {
   // host buffers when a guest application crashes, for example.
   void drainWindowSurface();
 
+  // Attribute the calling render thread to the guest process |p_process|
+  // returned by registerProcess() for another connection. Color buffer
+  // references taken by the thread are attributed to it from then on.
+  void setProcess(uint32_t p_process);
+
+  // Call this function when a render thread terminates. Once the last
+  // connection of a guest process is gone all color buffer references
+  // it still holds are dropped. Necessary to avoid leaking host buffers
+  // when a guest process crashes or is killed, for example.
+  void drainProcessResources();
+
+  // Register a guest process for a connection which exists only to hold
+  // the process on our side (see IOSTREAM_CLIENT_PROCESS_SENTINEL) and
+  // return its id. Such a connection has no render thread.
+  uint32_t registerProcess();
+
+  // Drop the connection registered with registerProcess(). Once the last
+  // connection of the process is gone its remaining color buffer
+  // references are dropped as with drainProcessResources().
+  void unregisterProcess(uint32_t p_process);
+
+  // Returns a human readable summary of the tracked guest processes and
+  // the resources reclaimed from them.
+  std::string dumpResourceStats();
+
   // Destroy a given RenderContext instance. |p_context| is its handle
   // value as returned by createRenderContext().
   void DestroyRenderContext(HandleType p_context);
@@ -244,8 +279,11 @@ class Renderer : public anbox::graphics::Renderer {
   HandleType genHandle();
 
   bool bindWindow_locked(RendererWindow* window);
+  void removeProcessConnection_locked(uint32_t p_process);
+  void removeColorBuffer_locked(ColorBufferMap::iterator c);
 
   void setupViewport(RendererWindow* window, const anbox::graphics::Rect& rect);
+  void waitForPostedContent(const RenderableList& renderables);
   struct Program;
   void draw(RendererWindow* window, const Renderable& renderable,
             const Program& prog);
@@ -263,6 +301,8 @@ class Renderer : public anbox::graphics::Renderer {
   RenderContextMap m_contexts;
   WindowSurfaceMap m_windows;
   ColorBufferMap m_colorbuffers;
+  ProcessResources m_processes;
+  ContentTracker m_content;
   ColorBuffer::Helper* m_colorBufferHelper;
 
   EGLContext m_eglContext;
@@ -276,10 +316,6 @@ class Renderer : public anbox::graphics::Renderer {
   EGLConfig m_eglConfig;
   HandleType m_lastPostedColorBuffer;
 
-  int m_statsNumFrames;
-  long long m_statsStartTime;
-  bool m_fpsStats;
-
   const char* m_glVendor;
   const char* m_glRenderer;
   const char* m_glVersion;
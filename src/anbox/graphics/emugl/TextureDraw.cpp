@@ -14,6 +14,7 @@
 
 #include "anbox/graphics/emugl/TextureDraw.h"
 #include "anbox/graphics/emugl/DispatchTables.h"
+#include "anbox/graphics/gl_extensions.h"
 #include "anbox/logger.h"
 
 #include <math.h>
@@ -95,13 +96,31 @@ const GLint kIndicesLen = sizeof(kIndices) / sizeof(kIndices[0]);
 
 }  // namespace
 
+#ifdef CHECK_GL_ERROR
+// Only used for debugging as glGetError() forces the driver to synchronize
+// with the calling thread.
+#define CHECK_GL(what)                                  \
+  do {                                                  \
+    const GLenum err = s_gles2.glGetError();            \
+    if (err != GL_NO_ERROR)                             \
+      ERROR("%s failed with error 0x%x", what, err);    \
+  } while (0)
+#else
+#define CHECK_GL(what) \
+  do {                 \
+  } while (0)
+#endif
+
 TextureDraw::TextureDraw(EGLDisplay)
     : mVertexShader(0),
       mFragmentShader(0),
       mProgram(0),
       mPositionSlot(-1),
       mInCoordSlot(-1),
-      mTextureSlot(-1) {
+      mTextureSlot(-1),
+      mVertexBuffer(0),
+      mIndexBuffer(0),
+      mVertexArray(0) {
   // Create shaders and program.
   mVertexShader = createShader(GL_VERTEX_SHADER, kVertexShaderSource);
   mFragmentShader = createShader(GL_FRAGMENT_SHADER, kFragmentShaderSource);
@@ -126,13 +145,13 @@ TextureDraw::TextureDraw(EGLDisplay)
 
   // Retrieve attribute/uniform locations.
   mPositionSlot = s_gles2.glGetAttribLocation(mProgram, "position");
-  s_gles2.glEnableVertexAttribArray(mPositionSlot);
-
   mInCoordSlot = s_gles2.glGetAttribLocation(mProgram, "inCoord");
-  s_gles2.glEnableVertexAttribArray(mInCoordSlot);
-
   mTextureSlot = s_gles2.glGetUniformLocation(mProgram, "texture");
 
+  // The sampler always reads from the first texture unit so the uniform
+  // value is part of the program state and only needs to be set once.
+  s_gles2.glUniform1i(mTextureSlot, 0);
+
   // Create vertex and index buffers.
   s_gles2.glGenBuffers(1, &mVertexBuffer);
   s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
@@ -143,38 +162,46 @@ TextureDraw::TextureDraw(EGLDisplay)
   s_gles2.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
   s_gles2.glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(kIndices), kIndices,
                        GL_STATIC_DRAW);
-}
 
-bool TextureDraw::draw(GLuint texture) {
-  if (!mProgram) {
-    ERROR(" No program");
-    return false;
+  // Record the vertex state in a VAO if the driver supports it. VAOs are not
+  // shared between contexts so draw() must be called with the same context
+  // bound which is the case as we're only used from the renderer's pbuffer
+  // context.
+  const auto extensions = reinterpret_cast<const char*>(s_gles2.glGetString(GL_EXTENSIONS));
+  if (extensions && anbox::graphics::GLExtensions{extensions}.support("GL_OES_vertex_array_object") &&
+      s_gles2.glGenVertexArraysOES && s_gles2.glBindVertexArrayOES &&
+      s_gles2.glDeleteVertexArraysOES) {
+    s_gles2.glGenVertexArraysOES(1, &mVertexArray);
+    s_gles2.glBindVertexArrayOES(mVertexArray);
+    setupVertexState();
+    s_gles2.glBindVertexArrayOES(0);
+  } else {
+    DEBUG("No support for vertex array objects; will setup vertex state on every draw");
   }
 
-  // TODO(digit): Save previous program state.
-
-  GLenum err;
-
-  s_gles2.glUseProgram(mProgram);
-  err = s_gles2.glGetError();
-  if (err != GL_NO_ERROR) {
-    ERROR("Could not use program error 0x%x", err);
+  // Validate the program once here rather than on every draw as this is
+  // a rather expensive operation which often causes the driver to flush.
+  s_gles2.glValidateProgram(mProgram);
+  GLint validState = 0;
+  s_gles2.glGetProgramiv(mProgram, GL_VALIDATE_STATUS, &validState);
+  if (validState == GL_FALSE) {
+    GLchar messages[256];
+    s_gles2.glGetProgramInfoLog(mProgram, sizeof(messages), 0, &messages[0]);
+    ERROR("Could not validate program: %s", messages);
+    s_gles2.glDeleteProgram(mProgram);
+    mProgram = 0;
+    return;
   }
 
+  CHECK_GL("TextureDraw setup");
+}
+
+void TextureDraw::setupVertexState() {
   // Setup the |position| attribute values.
   s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
-  err = s_gles2.glGetError();
-  if (err != GL_NO_ERROR) {
-    ERROR("Could not bind GL_ARRAY_BUFFER error=0x%x", err);
-  }
-
   s_gles2.glEnableVertexAttribArray(mPositionSlot);
   s_gles2.glVertexAttribPointer(mPositionSlot, 3, GL_FLOAT, GL_FALSE,
                                 sizeof(Vertex), 0);
-  err = s_gles2.glGetError();
-  if (err != GL_NO_ERROR) {
-    ERROR("Could glVertexAttribPointer with mPositionSlot error 0x%x", err);
-  }
 
   // Setup the |inCoord| attribute values.
   s_gles2.glEnableVertexAttribArray(mInCoordSlot);
@@ -182,34 +209,36 @@ bool TextureDraw::draw(GLuint texture) {
       mInCoordSlot, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
       reinterpret_cast<GLvoid*>(static_cast<uintptr_t>(sizeof(float) * 3)));
 
-  // setup the |texture| uniform value.
-  s_gles2.glActiveTexture(GL_TEXTURE0);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
-  s_gles2.glUniform1i(mTextureSlot, 0);
+  s_gles2.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+  CHECK_GL("Vertex state setup");
+}
 
-  // Validate program, just to be sure.
-  s_gles2.glValidateProgram(mProgram);
-  GLint validState = 0;
-  s_gles2.glGetProgramiv(mProgram, GL_VALIDATE_STATUS, &validState);
-  if (validState == GL_FALSE) {
-    GLchar messages[256];
-    s_gles2.glGetProgramInfoLog(mProgram, sizeof(messages), 0, &messages[0]);
-    ERROR("Could not run program: %s", messages);
+bool TextureDraw::draw(GLuint texture) {
+  if (!mProgram) {
+    ERROR(" No program");
     return false;
   }
 
-  // Do the rendering.
-  s_gles2.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
-  err = s_gles2.glGetError();
-  if (err != GL_NO_ERROR) {
-    ERROR("Could not glBindBuffer(GL_ELEMENT_ARRAY_BUFFER) error 0x%x", err);
-  }
+  // TODO(digit): Save previous program state.
+
+  s_gles2.glUseProgram(mProgram);
+  CHECK_GL("glUseProgram");
+
+  if (mVertexArray)
+    s_gles2.glBindVertexArrayOES(mVertexArray);
+  else
+    setupVertexState();
 
+  // Bind the texture to the unit the |texture| uniform refers to.
+  s_gles2.glActiveTexture(GL_TEXTURE0);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
+
+  // Do the rendering.
   s_gles2.glDrawElements(GL_TRIANGLES, kIndicesLen, GL_UNSIGNED_BYTE, 0);
-  err = s_gles2.glGetError();
-  if (err != GL_NO_ERROR) {
-    ERROR("Could not glDrawElements() error 0x%x", err);
-  }
+  CHECK_GL("glDrawElements");
+
+  if (mVertexArray)
+    s_gles2.glBindVertexArrayOES(0);
 
   // TODO(digit): Restore previous program state.
 
@@ -217,9 +246,15 @@ bool TextureDraw::draw(GLuint texture) {
 }
 
 TextureDraw::~TextureDraw() {
+  if (mVertexArray) {
+    s_gles2.glDeleteVertexArraysOES(1, &mVertexArray);
+  }
   s_gles2.glDeleteBuffers(1, &mIndexBuffer);
   s_gles2.glDeleteBuffers(1, &mVertexBuffer);
 
+  if (mProgram) {
+    s_gles2.glDeleteProgram(mProgram);
+  }
   if (mFragmentShader) {
     s_gles2.glDeleteShader(mFragmentShader);
   }
@@ -29,6 +29,13 @@
 //      in the GL y-upwards coordinate space. This function fills the whole
 //      framebuffer with texture content.
 //
+// The program is validated and all vertex state is set up once at
+// construction time. When GL_OES_vertex_array_object is available the
+// attribute and index buffer bindings are recorded in a vertex array object
+// so that draw() only needs to bind the program, the VAO and the texture.
+// Error checks after each GL call are only compiled in when CHECK_GL_ERROR
+// is defined as glGetError() forces a round-trip to the driver.
+//
 class TextureDraw {
  public:
   // Create a new instance.
@@ -42,6 +49,8 @@ class TextureDraw {
   bool draw(GLuint texture);
 
  private:
+  void setupVertexState();
+
   GLuint mVertexShader;
   GLuint mFragmentShader;
   GLuint mProgram;
@@ -50,6 +59,7 @@ class TextureDraw {
   GLint mTextureSlot;
   GLuint mVertexBuffer;
   GLuint mIndexBuffer;
+  GLuint mVertexArray;
 };
 
 #endif  // TEXTURE_DRAW_H
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/YUVConverter.h"
+#include "anbox/graphics/emugl/DispatchTables.h"
+#include "anbox/logger.h"
+
+#include <string>
+
+namespace {
+// Interpolating the unit square keeps the first row of every plane at the
+// bottom of the framebuffer, the same as an RGB upload would.
+const char kVertexShaderSource[] =
+    "attribute vec2 aPosition;\n"
+    "varying vec2 vUV;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(aPosition, 0, 1);\n"
+    "  vUV = (aPosition + 1.0) / 2.0;\n"
+    "}\n";
+
+// BT.601 with video range, which is what the Android software codecs and
+// the camera emit. For NV21 the chroma plane is uploaded as luminance/alpha
+// so V ends up in .r and U in .a.
+const char kFragmentShaderSource[] =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "varying vec2 vUV;\n"
+    "uniform sampler2D uY;\n"
+    "uniform sampler2D uV;\n"
+    "uniform sampler2D uU;\n"
+    "void main() {\n"
+    "  float y = 1.164383 * (texture2D(uY, vUV).r - 0.0625);\n"
+    "#ifdef SEMI_PLANAR\n"
+    "  vec4 vu = texture2D(uV, vUV);\n"
+    "  float v = vu.r - 0.5;\n"
+    "  float u = vu.a - 0.5;\n"
+    "#else\n"
+    "  float v = texture2D(uV, vUV).r - 0.5;\n"
+    "  float u = texture2D(uU, vUV).r - 0.5;\n"
+    "#endif\n"
+    "  gl_FragColor = vec4(y + 1.596027 * v,\n"
+    "                      y - 0.391762 * u - 0.812968 * v,\n"
+    "                      y + 2.017232 * u,\n"
+    "                      1.0);\n"
+    "}\n";
+
+const float kVertexData[] = {-1, -1, 3, -1, -1, 3};
+
+GLuint createShader(GLenum type, const char* define, const char* source) {
+  GLuint shader = s_gles2.glCreateShader(type);
+  if (!shader)
+    return 0;
+
+  const GLchar* sources[] = {define, source};
+  s_gles2.glShaderSource(shader, 2, sources, nullptr);
+  s_gles2.glCompileShader(shader);
+
+  GLint success = GL_FALSE;
+  s_gles2.glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (success == GL_FALSE) {
+    GLint infoLength = 0;
+    s_gles2.glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLength);
+    std::string infoLog(infoLength + 1, '\0');
+    s_gles2.glGetShaderInfoLog(shader, infoLength, nullptr, &infoLog[0]);
+    ERROR("YUV conversion shader compile failed: %s", infoLog.c_str());
+    s_gles2.glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+GLuint createPlane(GLenum format, GLuint width, GLuint height) {
+  GLuint texture = 0;
+  s_gles2.glGenTextures(1, &texture);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
+  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
+                       GL_UNSIGNED_BYTE, nullptr);
+  // Every chroma sample covers its 2x2 block of pixels, as with libyuv.
+  // Filtering it costs more than a third of the conversion time on
+  // software renderers.
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  return texture;
+}
+
+void uploadPlane(GLuint texture, GLenum format, GLuint width, GLuint height,
+                 const unsigned char* pixels) {
+  s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
+  s_gles2.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format,
+                          GL_UNSIGNED_BYTE, pixels);
+}
+}  // namespace
+
+// static
+bool YUVConverter::isYUVFormat(GLenum format) {
+  return format == GL_YV12_ANBOX || format == GL_NV21_ANBOX;
+}
+
+// static
+size_t YUVConverter::frameSize(GLenum format, GLuint width, GLuint height) {
+  if (!isYUVFormat(format))
+    return 0;
+  // Both formats carry one chroma sample pair per 2x2 block of pixels.
+  return width * height + 2 * (width / 2) * (height / 2);
+}
+
+YUVConverter::YUVConverter(GLenum format, GLuint width, GLuint height)
+    : mFormat(format),
+      mWidth(width),
+      mHeight(height),
+      mProgram(0),
+      mPositionSlot(-1),
+      mTextures{0, 0, 0},
+      mVertexBuffer(0) {
+  const char* define =
+      (format == GL_NV21_ANBOX) ? "#define SEMI_PLANAR\n" : "\n";
+  GLuint vShader = createShader(GL_VERTEX_SHADER, define, kVertexShaderSource);
+  GLuint fShader = createShader(GL_FRAGMENT_SHADER, define, kFragmentShaderSource);
+  if (vShader && fShader) {
+    mProgram = s_gles2.glCreateProgram();
+    s_gles2.glAttachShader(mProgram, vShader);
+    s_gles2.glAttachShader(mProgram, fShader);
+    s_gles2.glLinkProgram(mProgram);
+
+    GLint success = GL_FALSE;
+    s_gles2.glGetProgramiv(mProgram, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE) {
+      GLchar messages[256];
+      s_gles2.glGetProgramInfoLog(mProgram, sizeof(messages), 0, &messages[0]);
+      ERROR("Could not create/link YUV conversion program: %s", messages);
+      s_gles2.glDeleteProgram(mProgram);
+      mProgram = 0;
+    }
+  }
+  // The program keeps the shaders alive as long as it needs them.
+  if (vShader)
+    s_gles2.glDeleteShader(vShader);
+  if (fShader)
+    s_gles2.glDeleteShader(fShader);
+
+  if (mProgram) {
+    s_gles2.glUseProgram(mProgram);
+    mPositionSlot = s_gles2.glGetAttribLocation(mProgram, "aPosition");
+    s_gles2.glUniform1i(s_gles2.glGetUniformLocation(mProgram, "uY"), 0);
+    s_gles2.glUniform1i(s_gles2.glGetUniformLocation(mProgram, "uV"), 1);
+    s_gles2.glUniform1i(s_gles2.glGetUniformLocation(mProgram, "uU"), 2);
+    s_gles2.glUseProgram(0);
+  }
+
+  mTextures[0] = createPlane(GL_LUMINANCE, width, height);
+  if (format == GL_NV21_ANBOX) {
+    mTextures[1] = createPlane(GL_LUMINANCE_ALPHA, width / 2, height / 2);
+  } else {
+    mTextures[1] = createPlane(GL_LUMINANCE, width / 2, height / 2);
+    mTextures[2] = createPlane(GL_LUMINANCE, width / 2, height / 2);
+  }
+  s_gles2.glBindTexture(GL_TEXTURE_2D, 0);
+
+  s_gles2.glGenBuffers(1, &mVertexBuffer);
+  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+  s_gles2.glBufferData(GL_ARRAY_BUFFER, sizeof(kVertexData), kVertexData,
+                       GL_STATIC_DRAW);
+  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+YUVConverter::~YUVConverter() {
+  s_gles2.glDeleteTextures(mFormat == GL_NV21_ANBOX ? 2 : 3, mTextures);
+  s_gles2.glDeleteBuffers(1, &mVertexBuffer);
+  if (mProgram)
+    s_gles2.glDeleteProgram(mProgram);
+}
+
+bool YUVConverter::convert(const void* frame) {
+  if (!mProgram)
+    return false;
+
+  const auto y = static_cast<const unsigned char*>(frame);
+  const auto chroma = y + mWidth * mHeight;
+  const GLuint chromaWidth = mWidth / 2;
+  const GLuint chromaHeight = mHeight / 2;
+
+  s_gles2.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  s_gles2.glActiveTexture(GL_TEXTURE0);
+  uploadPlane(mTextures[0], GL_LUMINANCE, mWidth, mHeight, y);
+  s_gles2.glActiveTexture(GL_TEXTURE1);
+  if (mFormat == GL_NV21_ANBOX) {
+    uploadPlane(mTextures[1], GL_LUMINANCE_ALPHA, chromaWidth, chromaHeight, chroma);
+  } else {
+    uploadPlane(mTextures[1], GL_LUMINANCE, chromaWidth, chromaHeight, chroma);
+    s_gles2.glActiveTexture(GL_TEXTURE2);
+    uploadPlane(mTextures[2], GL_LUMINANCE, chromaWidth, chromaHeight,
+                chroma + chromaWidth * chromaHeight);
+  }
+
+  s_gles2.glUseProgram(mProgram);
+  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+  s_gles2.glEnableVertexAttribArray(mPositionSlot);
+  s_gles2.glVertexAttribPointer(mPositionSlot, 2, GL_FLOAT, GL_FALSE, 0, 0);
+  s_gles2.glDrawArrays(GL_TRIANGLES, 0,
+                       sizeof(kVertexData) / (2 * sizeof(float)));
+
+  // Clear the bindings.
+  s_gles2.glDisableVertexAttribArray(mPositionSlot);
+  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, 0);
+  s_gles2.glUseProgram(0);
+  for (GLenum unit = GL_TEXTURE2; unit >= GL_TEXTURE0; unit--) {
+    s_gles2.glActiveTexture(unit);
+    s_gles2.glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  return true;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _LIBRENDER_YUV_CONVERTER_H
+#define _LIBRENDER_YUV_CONVERTER_H
+
+#include <GLES2/gl2.h>
+
+#include <cstddef>
+
+// Pseudo internal formats the guest passes to rcCreateColorBuffer and
+// rcUpdateColorBuffer for YUV 4:2:0 buffers. They are FourCC codes so they
+// can't clash with any GL enum. Frames are tightly packed:
+//
+//   GL_YV12_ANBOX  Y plane, then the V plane, then the U plane
+//   GL_NV21_ANBOX  Y plane, then one plane of interleaved V and U samples
+//
+// Both need 12 bits per pixel where the RGBA equivalent needs 32.
+#define GL_YV12_ANBOX 0x32315659
+#define GL_NV21_ANBOX 0x3132564e
+
+// Uploads YUV frames into per plane textures and converts them to RGB by
+// drawing into the currently bound framebuffer. Width and height have to
+// be even. Needs a current GLES 2.x context when any method is called and
+// changes the program, texture and array buffer bindings of it.
+class YUVConverter {
+ public:
+  // Whether |format| is one of the formats above.
+  static bool isYUVFormat(GLenum format);
+
+  // Size in bytes of a tightly packed frame of |format|.
+  static size_t frameSize(GLenum format, GLuint width, GLuint height);
+
+  YUVConverter(GLenum format, GLuint width, GLuint height);
+  ~YUVConverter();
+
+  GLenum format() const { return mFormat; }
+
+  // Upload the planes of |frame| and fill the viewport of the current
+  // framebuffer with their BT.601 conversion. The first row of the frame
+  // ends up at the bottom, matching what glTexSubImage2D() does with RGB
+  // pixels. Returns false if the conversion program is not usable.
+  bool convert(const void* frame);
+
+ private:
+  GLenum mFormat;
+  GLuint mWidth;
+  GLuint mHeight;
+  GLuint mProgram;
+  GLint mPositionSlot;
+  GLuint mTextures[3];
+  GLuint mVertexBuffer;
+};
+
+#endif
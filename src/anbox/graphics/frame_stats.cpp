@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/frame_stats.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+// A gap this long means the source stopped updating rather than dropped
+// frames. It starts a new burst of frames instead of counting as jank.
+constexpr const std::chrono::milliseconds idle_threshold{250};
+// Sources we keep statistics for before the least recently updated one
+// gets dropped to make room for a new one.
+constexpr const std::size_t max_entries{64};
+
+std::chrono::microseconds to_us(const anbox::graphics::FrameStats::Clock::duration &d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d);
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr const std::array<std::uint32_t, 6> FrameStats::interval_bucket_bounds_ms;
+constexpr const std::size_t FrameStats::interval_buckets;
+
+FrameStats::FrameStats(const std::chrono::microseconds &refresh_period)
+    : refresh_period_{refresh_period} {}
+
+void FrameStats::record_frame(Source source, const std::string &name,
+                              const Clock::time_point &posted,
+                              const Clock::time_point &presented,
+                              const Clock::duration &composition) {
+  std::lock_guard<std::mutex> l(mutex_);
+
+  const auto key = std::make_pair(source, name);
+  auto iter = entries_.find(key);
+  if (iter == entries_.end()) {
+    if (entries_.size() >= max_entries) {
+      auto oldest = std::min_element(entries_.begin(), entries_.end(), [](const decltype(entries_)::value_type &a,
+                                                                          const decltype(entries_)::value_type &b) {
+        return a.second.last_presented < b.second.last_presented;
+      });
+      entries_.erase(oldest);
+    }
+
+    Entry entry;
+    entry.summary.source = source;
+    entry.summary.name = name;
+    iter = entries_.insert({key, entry}).first;
+  }
+
+  auto &entry = iter->second;
+  auto &summary = entry.summary;
+
+  if (summary.frames > 0) {
+    const auto interval = presented - entry.last_presented;
+    if (interval < idle_threshold) {
+      const auto interval_ms = std::chrono::duration_cast<std::chrono::milliseconds>(interval).count();
+      std::size_t bucket = 0;
+      while (bucket < interval_bucket_bounds_ms.size() &&
+             interval_ms >= static_cast<std::int64_t>(interval_bucket_bounds_ms[bucket]))
+        bucket++;
+      summary.intervals[bucket]++;
+
+      if (interval * 2 > refresh_period_ * 3)
+        summary.late_frames++;
+
+      // Round to the number of refresh periods which passed; everything
+      // beyond the first one is a frame we didn't get to show.
+      const auto periods = (interval + refresh_period_ / 2) / refresh_period_;
+      if (periods > 1)
+        summary.dropped_frames += periods - 1;
+    }
+  }
+
+  const auto latency = presented - posted;
+  summary.frames++;
+  summary.max_latency = std::max(summary.max_latency, to_us(latency));
+  summary.max_composition = std::max(summary.max_composition, to_us(composition));
+  entry.total_latency += latency;
+  entry.total_composition += composition;
+  entry.last_presented = presented;
+}
+
+FrameStats::Summary FrameStats::finish_summary(const Entry &entry) const {
+  auto summary = entry.summary;
+  if (summary.frames > 0) {
+    summary.average_latency = to_us(entry.total_latency / summary.frames);
+    summary.average_composition = to_us(entry.total_composition / summary.frames);
+  }
+  return summary;
+}
+
+std::vector<FrameStats::Summary> FrameStats::summaries() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  std::vector<Summary> summaries;
+  summaries.reserve(entries_.size());
+  for (const auto &entry : entries_)
+    summaries.push_back(finish_summary(entry.second));
+  return summaries;
+}
+
+std::string FrameStats::dump() const {
+  std::stringstream ss;
+  for (const auto &summary : summaries()) {
+    ss << (summary.source == Source::Display ? "display " : "window ") << summary.name << ":"
+       << " frames " << summary.frames
+       << " late " << summary.late_frames
+       << " dropped " << summary.dropped_frames
+       << " latency avg " << summary.average_latency.count() << "us"
+       << " max " << summary.max_latency.count() << "us"
+       << " composition avg " << summary.average_composition.count() << "us"
+       << " max " << summary.max_composition.count() << "us"
+       << " intervals";
+    for (std::size_t n = 0; n < summary.intervals.size(); n++) {
+      if (n < interval_bucket_bounds_ms.size())
+        ss << " <" << interval_bucket_bounds_ms[n] << "ms:";
+      else
+        ss << " >=" << interval_bucket_bounds_ms.back() << "ms:";
+      ss << summary.intervals[n];
+    }
+    ss << std::endl;
+  }
+  return ss.str();
+}
+
+void FrameStats::reset() {
+  std::lock_guard<std::mutex> l(mutex_);
+  entries_.clear();
+}
+}  // namespace graphics
+}  // namespace anbox
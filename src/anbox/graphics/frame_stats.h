@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_FRAME_STATS_H_
+#define ANBOX_GRAPHICS_FRAME_STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// Collects frame timing for every window and display we compose. Each
+// frame is recorded with the time Android posted it, the time it was
+// presented and how long composing it took. From that we derive frame
+// intervals and with them late and dropped frames.
+class FrameStats {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum class Source {
+    Window,
+    Display,
+  };
+
+  // Upper bounds of the frame interval histogram buckets. The last bucket
+  // takes everything above the last bound.
+  static constexpr const std::array<std::uint32_t, 6> interval_bucket_bounds_ms{{8, 17, 25, 34, 50, 100}};
+  static constexpr const std::size_t interval_buckets = interval_bucket_bounds_ms.size() + 1;
+
+  struct Summary {
+    Source source = Source::Window;
+    std::string name;
+    std::uint64_t frames = 0;
+    // Frames which arrived later than 1.5 times the refresh period after
+    // their predecessor.
+    std::uint64_t late_frames = 0;
+    // Refresh periods which passed without a new frame while the source
+    // was actively updating.
+    std::uint64_t dropped_frames = 0;
+    std::chrono::microseconds average_latency{0};
+    std::chrono::microseconds max_latency{0};
+    std::chrono::microseconds average_composition{0};
+    std::chrono::microseconds max_composition{0};
+    std::array<std::uint64_t, interval_buckets> intervals{};
+  };
+
+  explicit FrameStats(const std::chrono::microseconds &refresh_period = std::chrono::microseconds{16667});
+
+  void record_frame(Source source, const std::string &name,
+                    const Clock::time_point &posted,
+                    const Clock::time_point &presented,
+                    const Clock::duration &composition);
+
+  std::vector<Summary> summaries() const;
+
+  // Human readable version of all summaries meant for debugging.
+  std::string dump() const;
+
+  void reset();
+
+ private:
+  struct Entry {
+    Summary summary;
+    Clock::time_point last_presented;
+    Clock::duration total_latency{0};
+    Clock::duration total_composition{0};
+  };
+
+  Summary finish_summary(const Entry &entry) const;
+
+  const Clock::duration refresh_period_;
+  mutable std::mutex mutex_;
+  std::map<std::pair<Source, std::string>, Entry> entries_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
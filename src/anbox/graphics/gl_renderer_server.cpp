@@ -106,5 +106,17 @@ GLRendererServer::GLRendererServer(const Config &config, const std::shared_ptr<w
 }
 
 GLRendererServer::~GLRendererServer() { renderer_->finalize(); }
+
+std::shared_ptr<FrameStats> GLRendererServer::frame_stats() const {
+  return composer_->frame_stats();
+}
+
+std::string GLRendererServer::dump_resources() const {
+  return renderer_->dumpResourceStats();
+}
+
+void GLRendererServer::set_launch_tracker(const std::shared_ptr<application::LaunchTracker> &tracker) {
+  composer_->set_launch_tracker(tracker);
+}
 }  // namespace graphics
 }  // namespace anbox
@@ -24,6 +24,9 @@
 class Renderer;
 
 namespace anbox {
+namespace application {
+class LaunchTracker;
+}  // namespace application
 namespace input {
 class Manager;
 }  // namespace input
@@ -31,6 +34,7 @@ namespace wm {
 class Manager;
 }  // namespace wm
 namespace graphics {
+class FrameStats;
 class LayerComposer;
 class GLRendererServer {
  public:
@@ -51,6 +55,11 @@ class GLRendererServer {
   ~GLRendererServer();
 
   std::shared_ptr<Renderer> renderer() const { return renderer_; }
+  std::shared_ptr<FrameStats> frame_stats() const;
+  // Summary of the host resources held by guest processes and of the
+  // ones reclaimed from processes which went away without freeing them.
+  std::string dump_resources() const;
+  void set_launch_tracker(const std::shared_ptr<application::LaunchTracker> &tracker);
 
  private:
   std::shared_ptr<Renderer> renderer_;
@@ -16,24 +16,72 @@
  */
 
 #include "anbox/graphics/layer_composer.h"
+#include "anbox/application/launch_tracker.h"
+#include "anbox/common/thread_topology.h"
 #include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/render_throttle.h"
 #include "anbox/logger.h"
 #include "anbox/wm/manager.h"
+#include "anbox/wm/window.h"
 
 namespace anbox {
 namespace graphics {
 LayerComposer::LayerComposer(const std::shared_ptr<Renderer> renderer, const std::shared_ptr<Strategy> &strategy)
-    : renderer_(renderer), strategy_(strategy) {}
+    : renderer_(renderer), strategy_(strategy),
+      frame_stats_(std::make_shared<FrameStats>()),
+      throttle_(RenderThrottle::global()) {}
 
 LayerComposer::~LayerComposer() {}
 
-void LayerComposer::submit_layers(const RenderableList &renderables) {
+void LayerComposer::submit_layers(const RenderableList &renderables,
+                                  const FrameStats::Clock::time_point &posted) {
+  // Composition happens on the render thread of the guest's composer
+  // which is the one we want to prioritize over all other render threads.
+  static thread_local bool composer_thread_setup = false;
+  if (!composer_thread_setup) {
+    common::setup_current_thread(common::ThreadClass::Compositor, "compositor");
+    composer_thread_setup = true;
+  }
+
+  const auto composition_start = FrameStats::Clock::now();
+  const auto frame_posted = posted == FrameStats::Clock::time_point{} ? composition_start : posted;
+
   auto win_layers = strategy_->process_layers(renderables);
   for (auto &w : win_layers) {
-    renderer_->draw(w.first->native_handle(),
-                    Rect{0, 0, w.first->frame().width(), w.first->frame().height()},
-                    w.second);
+    if (launch_tracker_)
+      launch_tracker_->layer_posted(w.first->task(), frame_posted);
+
+    std::vector<std::uint32_t> buffers;
+    buffers.reserve(w.second.size());
+    for (const auto &r : w.second)
+      buffers.push_back(r.buffer());
+    throttle_->buffers_presented(w.first->task(), buffers);
+
+    const auto draw_start = FrameStats::Clock::now();
+    if (!renderer_->draw(w.first->native_handle(),
+                         Rect{0, 0, w.first->frame().width(), w.first->frame().height()},
+                         w.second))
+      continue;
+
+    const auto presented = FrameStats::Clock::now();
+    if (launch_tracker_)
+      launch_tracker_->frame_presented(w.first->task(), presented);
+    frame_stats_->record_frame(FrameStats::Source::Window, w.first->title(),
+                               frame_posted, presented, presented - draw_start);
   }
+
+  // We only have a single display for now.
+  const auto composed = FrameStats::Clock::now();
+  frame_stats_->record_frame(FrameStats::Source::Display, "0", frame_posted,
+                             composed, composed - composition_start);
+}
+
+std::shared_ptr<FrameStats> LayerComposer::frame_stats() const {
+  return frame_stats_;
+}
+
+void LayerComposer::set_launch_tracker(const std::shared_ptr<application::LaunchTracker> &tracker) {
+  launch_tracker_ = tracker;
 }
 }  // namespace graphics
 }  // namespace anbox
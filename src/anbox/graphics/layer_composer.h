@@ -18,17 +18,23 @@
 #ifndef ANBOX_GRAPHICS_LAYER_COMPOSER_H_
 #define ANBOX_GRAPHICS_LAYER_COMPOSER_H_
 
+#include "anbox/graphics/frame_stats.h"
 #include "anbox/graphics/renderer.h"
 
 #include <memory>
 #include <map>
 
 namespace anbox {
+namespace application {
+class LaunchTracker;
+}  // namespace application
 namespace wm {
 class Manager;
 class Window;
 }  // namespace wm
 namespace graphics {
+class RenderThrottle;
+
 class LayerComposer {
  public:
   class Strategy {
@@ -43,11 +49,22 @@ class LayerComposer {
                 const std::shared_ptr<Strategy> &strategy);
   ~LayerComposer();
 
-  void submit_layers(const RenderableList &renderables);
+  // posted is the time Android posted the first layer of the frame. If
+  // not given the frame is considered to be posted right now.
+  void submit_layers(const RenderableList &renderables,
+                     const FrameStats::Clock::time_point &posted = FrameStats::Clock::time_point{});
+
+  std::shared_ptr<FrameStats> frame_stats() const;
+
+  // Has to be set before the first layers are submitted.
+  void set_launch_tracker(const std::shared_ptr<application::LaunchTracker> &tracker);
 
  private:
   std::shared_ptr<Renderer> renderer_;
   std::shared_ptr<Strategy> strategy_;
+  std::shared_ptr<FrameStats> frame_stats_;
+  std::shared_ptr<RenderThrottle> throttle_;
+  std::shared_ptr<application::LaunchTracker> launch_tracker_;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -16,9 +16,12 @@
  */
 
 #include "anbox/graphics/opengles_message_processor.h"
+#include "anbox/common/memory_accounting.h"
 #include "anbox/common/small_vector.h"
+#include "anbox/graphics/buffer_pool.h"
 #include "anbox/graphics/buffered_io_stream.h"
 #include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/graphics/emugl/Renderer.h"
 #include "anbox/logger.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/delegate_message_processor.h"
@@ -32,10 +35,11 @@ namespace graphics {
 std::mutex OpenGlesMessageProcessor::global_lock{};
 
 OpenGlesMessageProcessor::OpenGlesMessageProcessor(
-    const std::shared_ptr<Renderer> &renderer,
+    const std::shared_ptr<::Renderer> &renderer,
     const std::shared_ptr<network::SocketMessenger> &messenger)
-    : messenger_(messenger),
-      stream_(std::make_shared<BufferedIOStream>(messenger_)) {
+    : owner_(common::MemoryAccounting::next_owner("gles")),
+      renderer_(renderer),
+      messenger_(messenger) {
   // We have to read the client flags first before we can continue
   // processing the actual commands
   unsigned int client_flags = 0;
@@ -43,22 +47,46 @@ OpenGlesMessageProcessor::OpenGlesMessageProcessor(
       boost::asio::buffer(&client_flags, sizeof(unsigned int)));
   if (err) ERROR("%s", err.message());
 
-  render_thread_.reset(RenderThread::create(renderer, stream_.get(), std::ref(global_lock)));
+  // A process sentinel only holds a guest process until it dies, so it
+  // gets neither a stream nor a render thread.
+  if (client_flags & IOSTREAM_CLIENT_PROCESS_SENTINEL) {
+    process_ = renderer_->registerProcess();
+    messenger_->send(reinterpret_cast<const char*>(&process_), sizeof(process_));
+    return;
+  }
+
+  stream_ = std::make_shared<BufferedIOStream>(messenger_, BufferedIOStream::default_buffer_size,
+                                               BufferPool::global(), owner_);
+  render_thread_.reset(RenderThread::create(renderer, stream_.get(), std::ref(global_lock), owner_));
   if (!render_thread_->start())
     BOOST_THROW_EXCEPTION(
         std::runtime_error("Failed to start renderer thread"));
 }
 
 OpenGlesMessageProcessor::~OpenGlesMessageProcessor() {
+  if (!render_thread_) {
+    if (process_)
+      renderer_->unregisterProcess(process_);
+    return;
+  }
+
   render_thread_->forceStop();
   render_thread_->wait(nullptr);
+
+  const auto stats = BufferPool::global()->statistics();
+  DEBUG("Buffer pool: acquired %d (%d bytes), allocations %d, reuses %d, discarded %d, cached %d (%d bytes)",
+        stats.acquired, stats.bytes_acquired, stats.allocations, stats.reuses,
+        stats.discarded, stats.cached_buffers, stats.cached_bytes);
 }
 
 bool OpenGlesMessageProcessor::process_data(
     const std::vector<std::uint8_t> &data) {
+  // Sentinels don't send anything after their flags.
+  if (!stream_)
+    return true;
+
   auto stream = std::static_pointer_cast<BufferedIOStream>(stream_);
-  Buffer buffer{data.data(), data.data() + data.size()};
-  stream->post_data(std::move(buffer));
+  stream->post_data(data.data(), data.size());
   return true;
 }
 }  // namespace graphics
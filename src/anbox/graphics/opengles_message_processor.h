@@ -25,6 +25,7 @@
 
 #include <boost/asio.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <mutex>
 
@@ -46,7 +47,12 @@ class OpenGlesMessageProcessor : public network::MessageProcessor {
  private:
   static std::mutex global_lock;
 
+  // Name the memory of this connection is accounted to.
+  std::string owner_;
+  std::shared_ptr<Renderer> renderer_;
   std::shared_ptr<network::SocketMessenger> messenger_;
+  // Guest process registered by a process sentinel connection.
+  uint32_t process_ = 0;
   std::shared_ptr<IOStream> stream_;
   std::shared_ptr<RenderThread> render_thread_;
 };
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/render_throttle.h"
+#include "anbox/common/thread_topology.h"
+#include "anbox/logger.h"
+#include "anbox/utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+constexpr const char *throttle_env_var{"ANBOX_RENDER_THROTTLE"};
+// Unfocused windows stay smooth enough to follow what happens in them while
+// hidden ones only keep the application alive.
+constexpr const unsigned int default_background_cap{30};
+constexpr const unsigned int default_hidden_cap{5};
+
+unsigned int parse_cap(const std::string &value) {
+  std::size_t pos = 0;
+  int cap = -1;
+  try {
+    cap = std::stoi(value, &pos);
+  } catch (const std::logic_error &) {
+    // Handled below
+  }
+  if (cap < 0 || pos != value.size())
+    throw std::runtime_error(anbox::utils::string_format("Invalid frame rate cap '%s'", value));
+  return static_cast<unsigned int>(cap);
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+RenderThrottle::Connection::Connection(const std::shared_ptr<RenderThrottle> &throttle,
+                                       std::uint64_t id, const std::string &thread_name)
+    : throttle_(throttle), id_(id), thread_name_(thread_name) {}
+
+RenderThrottle::Connection::~Connection() {
+  throttle_->disconnect(*this);
+}
+
+void RenderThrottle::Connection::frame_flushed(std::uint32_t color_buffer) {
+  frame_pending_ = true;
+  throttle_->frame_flushed(*this, color_buffer);
+}
+
+void RenderThrottle::Connection::wait_for_next_frame() {
+  if (!frame_pending_)
+    return;
+  frame_pending_ = false;
+
+  const auto demote = throttle_->pace(*this) != State::Foreground;
+  if (demote == demoted_)
+    return;
+
+  auto &topology = common::ThreadTopology::instance();
+  if (demote) {
+    // Background render threads also give up CPU time to the focused one.
+    // Without the privileges to return to the render thread class the
+    // frame rate cap alone has to do.
+    if (!topology.can_switch(common::ThreadClass::Background, common::ThreadClass::Render))
+      return;
+    topology.apply(common::ThreadClass::Background, thread_name_);
+  } else if (!topology.apply(common::ThreadClass::Render, thread_name_)) {
+    WARNING("Failed to restore the priority of render thread %s", thread_name_);
+  }
+  demoted_ = demote;
+}
+
+std::shared_ptr<RenderThrottle> RenderThrottle::global() {
+  static auto throttle = std::make_shared<RenderThrottle>();
+  return throttle;
+}
+
+RenderThrottle::RenderThrottle() {
+  state_caps_[static_cast<std::size_t>(State::Foreground)] = 0;
+  state_caps_[static_cast<std::size_t>(State::Background)] = default_background_cap;
+  state_caps_[static_cast<std::size_t>(State::Hidden)] = default_hidden_cap;
+
+  const auto spec = utils::get_env_value(throttle_env_var, "");
+  if (spec.empty())
+    return;
+
+  try {
+    configure(spec);
+  } catch (const std::exception &err) {
+    WARNING("Ignoring invalid %s: %s", throttle_env_var, err.what());
+  }
+}
+
+void RenderThrottle::configure(const std::string &spec) {
+  auto state_caps = state_caps_;
+  std::map<std::string, unsigned int> package_caps;
+
+  for (const auto &entry : utils::string_split(spec, ';')) {
+    if (entry.empty())
+      continue;
+
+    const auto pos = entry.find('=');
+    if (pos == std::string::npos || pos == 0)
+      throw std::runtime_error(utils::string_format("Invalid entry '%s'", entry));
+
+    const auto key = entry.substr(0, pos);
+    const auto cap = parse_cap(entry.substr(pos + 1));
+    if (key == "background")
+      state_caps[static_cast<std::size_t>(State::Background)] = cap;
+    else if (key == "hidden")
+      state_caps[static_cast<std::size_t>(State::Hidden)] = cap;
+    else
+      package_caps[key] = cap;
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  state_caps_ = state_caps;
+  for (const auto &cap : package_caps)
+    package_caps_[cap.first] = cap.second;
+  changed_.notify_all();
+}
+
+void RenderThrottle::set_frame_rate_cap(State state, unsigned int fps) {
+  std::lock_guard<std::mutex> l(mutex_);
+  state_caps_[static_cast<std::size_t>(state)] = fps;
+  changed_.notify_all();
+}
+
+void RenderThrottle::set_frame_rate_cap(const std::string &package, unsigned int fps) {
+  std::lock_guard<std::mutex> l(mutex_);
+  package_caps_[package] = fps;
+  changed_.notify_all();
+}
+
+unsigned int RenderThrottle::frame_rate_cap(const wm::Task::Id &task) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  const auto interval = frame_interval_locked(task);
+  if (interval == Clock::duration::zero())
+    return 0;
+  return static_cast<unsigned int>(std::chrono::seconds{1} / interval);
+}
+
+std::shared_ptr<RenderThrottle::Connection> RenderThrottle::connect(const std::string &thread_name) {
+  std::lock_guard<std::mutex> l(mutex_);
+  const auto id = next_connection_id_++;
+  connections_[id] = 0;
+  return std::shared_ptr<Connection>(new Connection(shared_from_this(), id, thread_name));
+}
+
+void RenderThrottle::set_task_package(const wm::Task::Id &task, const std::string &package) {
+  std::lock_guard<std::mutex> l(mutex_);
+  tasks_[task].package = package;
+  changed_.notify_all();
+}
+
+void RenderThrottle::set_task_state(const wm::Task::Id &task, State state) {
+  std::lock_guard<std::mutex> l(mutex_);
+  tasks_[task].state = state;
+  changed_.notify_all();
+}
+
+void RenderThrottle::remove_task(const wm::Task::Id &task) {
+  std::lock_guard<std::mutex> l(mutex_);
+  tasks_.erase(task);
+  for (auto &c : connections_) {
+    if (c.second == task)
+      c.second = 0;
+  }
+  changed_.notify_all();
+}
+
+RenderThrottle::State RenderThrottle::task_state(const wm::Task::Id &task) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return task_state_locked(task);
+}
+
+void RenderThrottle::buffers_presented(const wm::Task::Id &task, const std::vector<std::uint32_t> &color_buffers) {
+  std::lock_guard<std::mutex> l(mutex_);
+  bool changed = false;
+  for (const auto &buffer : color_buffers) {
+    auto owner = buffer_owners_.find(buffer);
+    if (owner == buffer_owners_.end())
+      continue;
+
+    auto c = connections_.find(owner->second);
+    if (c == connections_.end() || c->second == task)
+      continue;
+
+    c->second = task;
+    changed = true;
+  }
+
+  if (changed)
+    changed_.notify_all();
+}
+
+void RenderThrottle::buffer_closed(std::uint32_t color_buffer) {
+  std::lock_guard<std::mutex> l(mutex_);
+  buffer_owners_.erase(color_buffer);
+}
+
+wm::Task::Id RenderThrottle::task_for_connection(const Connection &connection) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  auto c = connections_.find(connection.id_);
+  if (c == connections_.end())
+    return 0;
+  return c->second;
+}
+
+void RenderThrottle::frame_flushed(const Connection &connection, std::uint32_t color_buffer) {
+  std::lock_guard<std::mutex> l(mutex_);
+  buffer_owners_[color_buffer] = connection.id_;
+}
+
+RenderThrottle::State RenderThrottle::pace(Connection &connection) {
+  std::unique_lock<std::mutex> l(mutex_);
+
+  const auto task = [&]() {
+    auto c = connections_.find(connection.id_);
+    return c == connections_.end() ? 0 : c->second;
+  };
+
+  const auto interval = frame_interval_locked(task());
+  if (interval != Clock::duration::zero()) {
+    const auto due = connection.last_frame_ + interval;
+    // Stop waiting as soon as the cap changes, e.g. because the window got
+    // focused, the next frame will be paced with the new cap.
+    const auto cap_changed = changed_.wait_until(l, due, [&]() {
+      return frame_interval_locked(task()) != interval;
+    });
+
+    const auto now = Clock::now();
+    // Keep the frames on the grid of the cap unless we fell behind more
+    // than a whole frame.
+    connection.last_frame_ = (!cap_changed && now - due < interval) ? due : now;
+  } else {
+    connection.last_frame_ = Clock::now();
+  }
+
+  return task_state_locked(task());
+}
+
+void RenderThrottle::disconnect(const Connection &connection) {
+  std::lock_guard<std::mutex> l(mutex_);
+  connections_.erase(connection.id_);
+  for (auto it = buffer_owners_.begin(); it != buffer_owners_.end();) {
+    if (it->second == connection.id_)
+      it = buffer_owners_.erase(it);
+    else
+      ++it;
+  }
+}
+
+RenderThrottle::Clock::duration RenderThrottle::frame_interval_locked(const wm::Task::Id &task) const {
+  if (!task)
+    return Clock::duration::zero();
+
+  auto cap = state_caps_[static_cast<std::size_t>(task_state_locked(task))];
+
+  auto t = tasks_.find(task);
+  if (t != tasks_.end()) {
+    auto p = package_caps_.find(t->second.package);
+    if (p != package_caps_.end() && p->second > 0)
+      cap = cap > 0 ? std::min(cap, p->second) : p->second;
+  }
+
+  if (cap == 0)
+    return Clock::duration::zero();
+  return std::chrono::duration_cast<Clock::duration>(std::chrono::seconds{1}) / cap;
+}
+
+RenderThrottle::State RenderThrottle::task_state_locked(const wm::Task::Id &task) const {
+  auto t = tasks_.find(task);
+  if (t == tasks_.end())
+    return State::Foreground;
+  return t->second.state;
+}
+}  // namespace graphics
+}  // namespace anbox
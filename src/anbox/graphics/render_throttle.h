@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_RENDER_THROTTLE_H_
+#define ANBOX_GRAPHICS_RENDER_THROTTLE_H_
+
+#include "anbox/wm/task.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+// RenderThrottle paces the render threads of guest applications depending
+// on how the window of their task is presented on the host. Render threads
+// of tasks which don't have the input focus or aren't visible at all are
+// capped to a lower frame rate so that the focused application gets the
+// CPU and GPU time it needs. If we are allowed to restore their priority
+// later they are also moved into the background thread class.
+//
+// Render connections don't know which task they draw for. We learn that
+// from the composition: whoever flushed last into a color buffer which is
+// shown in the window of a task renders for that task. Connections we
+// can't associate with a task, like the one of the guest's compositor, are
+// never throttled.
+//
+// The caps can be overridden through ANBOX_RENDER_THROTTLE, for example
+//
+//   ANBOX_RENDER_THROTTLE="background=20;hidden=1;com.example.game=30"
+//
+// where background and hidden set the caps for unfocused and invisible
+// windows and every other key caps the windows of the given package in
+// any state. A cap of 0 disables it.
+class RenderThrottle : public std::enable_shared_from_this<RenderThrottle> {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum class State {
+    // The window has the input focus.
+    Foreground,
+    // The window is visible but doesn't have the input focus.
+    Background,
+    // The window is minimized or hidden.
+    Hidden,
+  };
+
+  // Connection is the part of the throttle owned by a single render
+  // thread. All of its methods have to be called from that thread.
+  class Connection {
+   public:
+    ~Connection();
+
+    // Records that the render thread flushed a frame into the given color
+    // buffer. Called with the renderer locked so it never blocks.
+    void frame_flushed(std::uint32_t color_buffer);
+
+    // Blocks until the render thread may start its next frame. Returns
+    // immediately if no frame was flushed since the last call. Must be
+    // called without holding any lock other render threads need.
+    void wait_for_next_frame();
+
+   private:
+    friend class RenderThrottle;
+
+    Connection(const std::shared_ptr<RenderThrottle> &throttle,
+               std::uint64_t id, const std::string &thread_name);
+
+    std::shared_ptr<RenderThrottle> throttle_;
+    std::uint64_t id_;
+    std::string thread_name_;
+    bool frame_pending_ = false;
+    Clock::time_point last_frame_;
+    // Set while the thread runs in the background thread class.
+    bool demoted_ = false;
+  };
+
+  static std::shared_ptr<RenderThrottle> global();
+
+  RenderThrottle();
+
+  // Parses a specification in the format described above and updates the
+  // caps it mentions. Throws on malformed input.
+  void configure(const std::string &spec);
+
+  void set_frame_rate_cap(State state, unsigned int fps);
+  void set_frame_rate_cap(const std::string &package, unsigned int fps);
+
+  // Returns the frame rate the render threads of the given task are capped
+  // to, 0 if they are not capped.
+  unsigned int frame_rate_cap(const wm::Task::Id &task) const;
+
+  // Registers the calling render thread. The thread name is used when the
+  // thread class of the thread changes.
+  std::shared_ptr<Connection> connect(const std::string &thread_name);
+
+  // Fed by the window manager.
+  void set_task_package(const wm::Task::Id &task, const std::string &package);
+  void set_task_state(const wm::Task::Id &task, State state);
+  void remove_task(const wm::Task::Id &task);
+  State task_state(const wm::Task::Id &task) const;
+
+  // Fed by the compositor with the color buffers it showed in the window of
+  // the given task.
+  void buffers_presented(const wm::Task::Id &task, const std::vector<std::uint32_t> &color_buffers);
+
+  // Fed by the renderer when a color buffer is destroyed. Its handle may be
+  // reused for a buffer another thread renders into.
+  void buffer_closed(std::uint32_t color_buffer);
+
+  // Returns the task the connection renders for, 0 if not known yet.
+  wm::Task::Id task_for_connection(const Connection &connection) const;
+
+ private:
+  struct TaskInfo {
+    State state = State::Foreground;
+    std::string package;
+  };
+
+  void frame_flushed(const Connection &connection, std::uint32_t color_buffer);
+  // Returns the state the connection's task is in right now.
+  State pace(Connection &connection);
+  void disconnect(const Connection &connection);
+
+  Clock::duration frame_interval_locked(const wm::Task::Id &task) const;
+  State task_state_locked(const wm::Task::Id &task) const;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::array<unsigned int, 3> state_caps_;
+  std::map<std::string, unsigned int> package_caps_;
+  std::map<wm::Task::Id, TaskInfo> tasks_;
+  // Task every connection renders for, 0 if not known.
+  std::map<std::uint64_t, wm::Task::Id> connections_;
+  // Connection which flushed last into a color buffer.
+  std::map<std::uint32_t, std::uint64_t> buffer_owners_;
+  std::uint64_t next_connection_id_ = 1;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -17,23 +17,68 @@
  */
 
 #include "anbox/network/base_socket_messenger.h"
-#include "anbox/common/variable_length_array.h"
 #include "anbox/logger.h"
 
 #include <boost/throw_exception.hpp>
 
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <string.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <stdexcept>
-
-namespace bs = boost::system;
-namespace ba = boost::asio;
+#include <vector>
 
 namespace {
-/// Buffers need to be big enough to support messages
-unsigned int const serialization_buffer_size = 2048;
+// Used when the kernel can't send the file for us.
+constexpr const size_t copy_chunk_size{256 * 1024};
+
+// sendfile() has no MSG_NOSIGNAL, so a peer which went away would kill us
+// with SIGPIPE. Blocks the signal for the calling thread and swallows one
+// raised while it was blocked.
+class ScopedSigpipeBlock {
+ public:
+  ScopedSigpipeBlock() {
+    sigemptyset(&sigpipe_);
+    sigaddset(&sigpipe_, SIGPIPE);
+
+    // A SIGPIPE pending from before isn't ours to swallow.
+    sigset_t pending;
+    sigpending(&pending);
+    was_pending_ = sigismember(&pending, SIGPIPE) == 1;
+
+    pthread_sigmask(SIG_BLOCK, &sigpipe_, &old_mask_);
+  }
+
+  ~ScopedSigpipeBlock() {
+    if (!was_pending_) {
+      sigset_t pending;
+      sigpending(&pending);
+      if (sigismember(&pending, SIGPIPE) == 1) {
+        const timespec no_wait{0, 0};
+        while (sigtimedwait(&sigpipe_, nullptr, &no_wait) < 0 && errno == EINTR);
+      }
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask_, nullptr);
+  }
+
+ private:
+  sigset_t sigpipe_;
+  sigset_t old_mask_;
+  bool was_pending_ = false;
+};
+
+bool is_disconnect(int err) {
+  return err == EPIPE || err == ECONNRESET;
 }
+}  // namespace
+
+namespace bs = boost::system;
+namespace ba = boost::asio;
 
 namespace anbox {
 namespace network {
@@ -76,9 +121,6 @@ Credentials BaseSocketMessenger<stream_protocol>::creds() const {
 template <typename stream_protocol>
 ssize_t BaseSocketMessenger<stream_protocol>::send_raw(char const* data,
                                                        size_t length) {
-  VariableLengthArray<serialization_buffer_size> whole_message{length};
-  std::copy(data, data + length, whole_message.data());
-
   std::unique_lock<std::mutex> lg(message_lock);
   return ::send(socket_fd, data, length, MSG_NOSIGNAL);
 }
@@ -86,13 +128,10 @@ ssize_t BaseSocketMessenger<stream_protocol>::send_raw(char const* data,
 template <typename stream_protocol>
 void BaseSocketMessenger<stream_protocol>::send(char const* data,
                                                 size_t length) {
-  VariableLengthArray<serialization_buffer_size> whole_message{length};
-  std::copy(data, data + length, whole_message.data());
-
   for (;;) {
     try {
       std::unique_lock<std::mutex> lg(message_lock);
-      ba::write(*socket, ba::buffer(whole_message.data(), whole_message.size()),
+      ba::write(*socket, ba::buffer(data, length),
                 boost::asio::transfer_all());
     } catch (const boost::system::system_error& err) {
       if (err.code() == boost::asio::error::try_again) continue;
@@ -151,6 +190,89 @@ void BaseSocketMessenger<stream_protocol>::close() {
   socket->close();
 }
 
+template <typename stream_protocol>
+void BaseSocketMessenger<stream_protocol>::send_file(int fd, off_t offset,
+                                                     size_t length) {
+  std::unique_lock<std::mutex> lg(message_lock);
+  const ScopedSigpipeBlock block_sigpipe;
+
+  while (length > 0) {
+    const auto sent = ::sendfile(socket_fd, fd, &offset, length);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        wait_until_writable();
+        continue;
+      }
+      if (is_disconnect(errno)) {
+        DEBUG("Peer disconnected while sending file");
+        return;
+      }
+      // Not every file or socket type supports sendfile. Nothing was sent
+      // in that case so we can simply continue with copying.
+      if (errno == EINVAL || errno == ENOSYS) {
+        copy_file(fd, offset, length);
+        return;
+      }
+      BOOST_THROW_EXCEPTION(std::runtime_error(
+          std::string("Failed to send file: ") + strerror(errno)));
+    }
+    if (sent == 0)
+      BOOST_THROW_EXCEPTION(std::runtime_error("File ended before all data was sent"));
+
+    length -= sent;
+  }
+}
+
+template <typename stream_protocol>
+void BaseSocketMessenger<stream_protocol>::wait_until_writable() {
+  pollfd pfd{socket_fd, POLLOUT, 0};
+  while (::poll(&pfd, 1, -1) < 0) {
+    if (errno != EINTR)
+      BOOST_THROW_EXCEPTION(std::runtime_error(
+          std::string("Failed to wait for socket: ") + strerror(errno)));
+  }
+}
+
+template <typename stream_protocol>
+void BaseSocketMessenger<stream_protocol>::copy_file(int fd, off_t offset,
+                                                     size_t length) {
+  std::vector<char> buffer(std::min(length, copy_chunk_size));
+
+  while (length > 0) {
+    const auto bytes_read = ::pread(fd, buffer.data(), std::min(length, buffer.size()), offset);
+    if (bytes_read < 0 && errno == EINTR) continue;
+    if (bytes_read < 0)
+      BOOST_THROW_EXCEPTION(std::runtime_error(
+          std::string("Failed to read file: ") + strerror(errno)));
+    if (bytes_read == 0)
+      BOOST_THROW_EXCEPTION(std::runtime_error("File ended before all data was sent"));
+
+    size_t written = 0;
+    while (written < static_cast<size_t>(bytes_read)) {
+      const auto sent = ::send(socket_fd, buffer.data() + written,
+                               bytes_read - written, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN) {
+          wait_until_writable();
+          continue;
+        }
+        if (is_disconnect(errno)) {
+          DEBUG("Peer disconnected while sending file");
+          return;
+        }
+        BOOST_THROW_EXCEPTION(std::runtime_error(
+            std::string("Failed to send file: ") + strerror(errno)));
+      }
+      written += sent;
+    }
+
+    offset += bytes_read;
+    length -= bytes_read;
+  }
+}
+
 template class BaseSocketMessenger<boost::asio::local::stream_protocol>;
 template class BaseSocketMessenger<boost::asio::ip::tcp>;
 }  // namespace network
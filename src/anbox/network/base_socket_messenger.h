@@ -49,12 +49,17 @@ class BaseSocketMessenger : public SocketMessenger {
   void set_no_delay() override;
   void close() override;
 
+  void send_file(int fd, off_t offset, size_t length) override;
+
  protected:
   BaseSocketMessenger();
   void setup(std::shared_ptr<
              boost::asio::basic_stream_socket<stream_protocol>> const& s);
 
  private:
+  void wait_until_writable();
+  void copy_file(int fd, off_t offset, size_t length);
+
   std::shared_ptr<boost::asio::basic_stream_socket<stream_protocol>> socket;
   anbox::Fd socket_fd;
   std::mutex message_lock;
@@ -63,10 +63,9 @@ void SocketConnection::on_read_size(const boost::system::error_code& error, std:
     return;
   }
 
-  std::vector<std::uint8_t> data(bytes_read);
-  std::copy(buffer_.data(), buffer_.data() + bytes_read, data.data());
+  data_.assign(buffer_.data(), buffer_.data() + bytes_read);
 
-  if (processor_->process_data(data))
+  if (processor_->process_data(data_))
     read_next_message();
   else
       connections_->remove(id());
@@ -57,6 +57,9 @@ class SocketConnection {
   std::shared_ptr<Connections<SocketConnection>> const connections_;
   std::shared_ptr<MessageProcessor> processor_;
   std::array<std::uint8_t, 8192> buffer_;
+  // Reused for every message we hand over to the processor so reading
+  // from the socket doesn't need a heap allocation per chunk.
+  std::vector<std::uint8_t> data_;
   std::string name_;
 };
 }  // namespace anbox
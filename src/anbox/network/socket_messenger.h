@@ -21,6 +21,8 @@
 
 #include <mutex>
 
+#include <sys/types.h>
+
 #include "anbox/network/credentials.h"
 #include "anbox/network/message_receiver.h"
 #include "anbox/network/message_sender.h"
@@ -33,6 +35,11 @@ class SocketMessenger : public MessageSender, public MessageReceiver {
   virtual unsigned short local_port() const = 0;
   virtual void set_no_delay() = 0;
   virtual void close() = 0;
+
+  // Sends length bytes of the file behind fd starting at offset. This
+  // is done inside the kernel where possible and blocks until everything
+  // was sent or the peer disconnected.
+  virtual void send_file(int fd, off_t offset, size_t length) = 0;
 };
 }  // namespace network
 }  // namespace anbox
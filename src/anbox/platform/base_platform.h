@@ -21,6 +21,7 @@
 #include "anbox/graphics/rect.h"
 #include "anbox/wm/window_state.h"
 
+#include <functional>
 #include <memory>
 
 class Renderer;
@@ -51,6 +52,10 @@ class BasePlatform {
   virtual void set_clipboard_data(const ClipboardData &data) = 0;
   virtual ClipboardData get_clipboard_data() = 0;
 
+  // Called on the platform thread whenever the host clipboard changed.
+  typedef std::function<void(const ClipboardData&)> ClipboardObserver;
+  virtual void set_clipboard_observer(const ClipboardObserver &observer) = 0;
+
   virtual std::shared_ptr<audio::Sink> create_audio_sink() = 0;
   virtual std::shared_ptr<audio::Source> create_audio_source() = 0;
 
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/platform/clipboard.h"
+#include "anbox/logger.h"
+
+namespace anbox {
+namespace platform {
+constexpr const std::size_t Clipboard::max_text_size;
+
+Clipboard::Clipboard(const std::shared_ptr<Source> &source) : source_{source} {}
+
+void Clipboard::set_observer(const Observer &observer) {
+  std::lock_guard<std::mutex> l(mutex_);
+  observer_ = observer;
+}
+
+void Clipboard::host_changed() {
+  if (!source_)
+    return;
+
+  auto text = source_->read_text();
+  if (text.size() > max_text_size) {
+    WARNING("Not passing %d bytes of host clipboard data to Android, limit is %d",
+            text.size(), max_text_size);
+    // Better nothing than something stale the user didn't copy last.
+    text.clear();
+  }
+
+  Observer observer;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    // A guest update which didn't reach the host yet is newer. Refreshes
+    // which find what we have already aren't reported.
+    if (pending_host_write_ || text == text_)
+      return;
+    text_ = text;
+    observer = observer_;
+  }
+
+  if (observer)
+    observer(text);
+}
+
+void Clipboard::sync_to_host() {
+  std::string text;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    if (!pending_host_write_)
+      return;
+    pending_host_write_ = false;
+    text = text_;
+  }
+
+  if (source_)
+    source_->write_text(text);
+}
+
+bool Clipboard::set_from_guest(const std::string &text) {
+  if (text.size() > max_text_size) {
+    WARNING("Not passing %d bytes of Android clipboard data to the host, limit is %d",
+            text.size(), max_text_size);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> l(mutex_);
+  text_ = text;
+  if (!source_)
+    return false;
+  pending_host_write_ = true;
+  return true;
+}
+
+std::string Clipboard::text() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return text_;
+}
+}  // namespace platform
+}  // namespace anbox
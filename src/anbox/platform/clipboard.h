@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_PLATFORM_CLIPBOARD_H_
+#define ANBOX_PLATFORM_CLIPBOARD_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace anbox {
+namespace platform {
+// Keeps a copy of the host clipboard so the guest never has to wait for
+// the windowing system. Reading the clipboard on X11 is a synchronous
+// round trip to whichever client owns the selection, so the platform
+// only talks to it from its own thread: it refreshes the copy when the
+// host clipboard changed and applies what the guest set on its next turn.
+class Clipboard {
+ public:
+  // Access to the clipboard of the windowing system. Only ever called from
+  // the thread which calls host_changed() and sync_to_host().
+  class Source {
+   public:
+    virtual ~Source() = default;
+    virtual std::string read_text() = 0;
+    virtual void write_text(const std::string &text) = 0;
+  };
+
+  // Called with the new contents when host_changed() found the host
+  // clipboard changed, on the thread which called it.
+  typedef std::function<void(const std::string&)> Observer;
+
+  // Larger payloads aren't passed on in either direction.
+  static constexpr const std::size_t max_text_size{1024 * 1024};
+
+  // Without a |source| the clipboard is only shared within the guest.
+  explicit Clipboard(const std::shared_ptr<Source> &source);
+
+  void set_observer(const Observer &observer);
+
+  // Re-reads the host clipboard. Platform thread only.
+  void host_changed();
+
+  // Writes what the guest set last to the host clipboard if that didn't
+  // happen yet. Platform thread only.
+  void sync_to_host();
+
+  // Stores |text| set by the guest. Returns true if the platform thread
+  // has to call sync_to_host() for it to reach the host.
+  bool set_from_guest(const std::string &text);
+
+  // The current contents, never blocks on the source.
+  std::string text() const;
+
+ private:
+  std::shared_ptr<Source> source_;
+  mutable std::mutex mutex_;
+  Observer observer_;
+  std::string text_;
+  bool pending_host_write_ = false;
+};
+}  // namespace platform
+}  // namespace anbox
+
+#endif
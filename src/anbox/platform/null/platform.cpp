@@ -31,7 +31,8 @@ class NullWindow : public anbox::wm::Window {
 
 namespace anbox {
 namespace platform {
-NullPlatform::NullPlatform() {}
+NullPlatform::NullPlatform(const std::shared_ptr<Clipboard::Source> &clipboard_source)
+    : clipboard_{clipboard_source} {}
 
 std::shared_ptr<wm::Window> NullPlatform::create_window(
     const anbox::wm::Task::Id &task, const anbox::graphics::Rect &frame, const std::string &title) {
@@ -39,13 +40,23 @@ std::shared_ptr<wm::Window> NullPlatform::create_window(
 }
 
 void NullPlatform::set_clipboard_data(const ClipboardData &data) {
-  (void)data;
-  ERROR("Not implemented");
+  if (clipboard_.set_from_guest(data.text))
+    clipboard_.sync_to_host();
 }
 
 NullPlatform::ClipboardData NullPlatform::get_clipboard_data() {
-  ERROR("Not implemented");
-  return ClipboardData{};
+  return ClipboardData{clipboard_.text()};
+}
+
+void NullPlatform::set_clipboard_observer(const ClipboardObserver &observer) {
+  clipboard_.set_observer([observer](const std::string &text) {
+    if (observer)
+      observer(ClipboardData{text});
+  });
+}
+
+void NullPlatform::host_clipboard_changed() {
+  clipboard_.host_changed();
 }
 
 std::shared_ptr<audio::Sink> NullPlatform::create_audio_sink() {
@@ -19,23 +19,34 @@
 #define ANBOX_PLATFORM_NULL_PLATFORM_H_
 
 #include "anbox/platform/base_platform.h"
+#include "anbox/platform/clipboard.h"
 
 namespace anbox {
 namespace platform {
 class NullPlatform : public BasePlatform {
  public:
-  NullPlatform();
+  // Without a |clipboard_source| the clipboard is only shared within
+  // the guest.
+  NullPlatform(const std::shared_ptr<Clipboard::Source> &clipboard_source = nullptr);
   std::shared_ptr<wm::Window> create_window(
       const anbox::wm::Task::Id &task,
       const anbox::graphics::Rect &frame,
       const std::string &title) override;
   void set_clipboard_data(const ClipboardData &data) override;
   ClipboardData get_clipboard_data() override;
+  void set_clipboard_observer(const ClipboardObserver &observer) override;
   std::shared_ptr<audio::Sink> create_audio_sink() override;
   std::shared_ptr<audio::Source> create_audio_source() override;
   void set_renderer(const std::shared_ptr<Renderer> &renderer) override;
   void set_window_manager(const std::shared_ptr<wm::Manager> &window_manager) override;
   bool supports_multi_window() const override;
+
+  // There is no platform thread, whoever owns the clipboard source calls
+  // this from the thread it uses the source on when its content changed.
+  void host_clipboard_changed();
+
+ private:
+  Clipboard clipboard_;
 };
 }  // namespace wm
 }  // namespace anbox
@@ -16,6 +16,7 @@
  */
 
 #include "anbox/platform/sdl/audio_sink.h"
+#include "anbox/common/thread_topology.h"
 #include "anbox/logger.h"
 
 #include <stdexcept>
@@ -31,12 +32,22 @@ namespace platform {
 namespace sdl {
 AudioSink::AudioSink() :
   device_id_(0),
-  queue_(max_queue_size) {
+  pool_(graphics::BufferPool::global()),
+  queue_(max_queue_size),
+  account_(common::MemoryAccounting::Subsystem::AudioQueues,
+           common::MemoryAccounting::next_owner("audio-sink")) {
 }
 
 AudioSink::~AudioSink() {}
 
 void AudioSink::on_data_requested(void *user_data, std::uint8_t *buffer, int size) {
+  // SDL owns the audio thread so we can only set it up once it calls us.
+  static thread_local bool audio_thread_setup = false;
+  if (!audio_thread_setup) {
+    common::setup_current_thread(common::ThreadClass::Audio, "sdl-audio");
+    audio_thread_setup = true;
+  }
+
   auto thiz = static_cast<AudioSink*>(user_data);
   thiz->read_data(buffer, size);
 }
@@ -71,7 +82,6 @@ void AudioSink::disconnect_audio() {
 }
 
 void AudioSink::read_data(std::uint8_t *buffer, int size) {
-  std::unique_lock<std::mutex> l(lock_);
   const auto wanted = size;
   int count = 0;
   auto dst = buffer;
@@ -87,12 +97,18 @@ void AudioSink::read_data(std::uint8_t *buffer, int size) {
       continue;
     }
 
+    account_.remove(read_buffer_.size());
+    pool_->release(std::move(read_buffer_));
+    // The pool leaves small inline buffers untouched, make sure we don't
+    // account them a second time if the queue is empty now.
+    read_buffer_.clear();
+
     bool blocking = (count == 0);
     auto result = -EIO;
     if (blocking)
-      result = queue_.pop_locked(&read_buffer_, l);
+      result = queue_.pop(&read_buffer_);
     else
-      result = queue_.try_pop_locked(&read_buffer_);
+      result = queue_.try_pop(&read_buffer_);
 
     if (result == 0) {
       read_buffer_left_ = read_buffer_.size();
@@ -106,13 +122,15 @@ void AudioSink::read_data(std::uint8_t *buffer, int size) {
 }
 
 void AudioSink::write_data(const std::vector<std::uint8_t> &data) {
-  std::unique_lock<std::mutex> l(lock_);
-  if (!connect_audio()) {
-    WARNING("Audio server not connected, skipping %d bytes", data.size());
-    return;
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    if (!connect_audio()) {
+      WARNING("Audio server not connected, skipping %d bytes", data.size());
+      return;
+    }
   }
-  graphics::Buffer buffer{data.data(), data.data() + data.size()};
-  queue_.push_locked(std::move(buffer), l);
+  account_.add(data.size());
+  queue_.push(pool_->acquire(data.data(), data.size()));
 }
 } // namespace sdl
 } // namespace platform
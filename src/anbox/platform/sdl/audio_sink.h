@@ -19,7 +19,9 @@
 #define ANBOX_PLATFORM_SDL_AUDIO_SINK_H_
 
 #include "anbox/audio/sink.h"
-#include "anbox/graphics/buffer_queue.h"
+#include "anbox/common/lock_free_channel.h"
+#include "anbox/common/memory_accounting.h"
+#include "anbox/graphics/buffer_pool.h"
 #include "anbox/platform/sdl/sdl_wrapper.h"
 
 #include <thread>
@@ -44,9 +46,11 @@ class AudioSink : public audio::Sink {
   std::mutex lock_;
   SDL_AudioSpec spec_;
   SDL_AudioDeviceID device_id_;
-  graphics::BufferQueue queue_;
+  std::shared_ptr<graphics::BufferPool> pool_;
+  common::LockFreeChannel<graphics::Buffer> queue_;
   graphics::Buffer read_buffer_;
   size_t read_buffer_left_ = 0;
+  common::MemoryAccounting::Account account_;
 };
 } // namespace sdl
 } // namespace platform
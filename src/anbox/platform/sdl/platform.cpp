@@ -18,6 +18,7 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wswitch-default"
 #include "anbox/platform/sdl/platform.h"
+#include "anbox/common/thread_topology.h"
 #include "anbox/input/device.h"
 #include "anbox/input/manager.h"
 #include "anbox/logger.h"
@@ -32,6 +33,30 @@
 #include <sys/types.h>
 #pragma GCC diagnostic pop
 
+namespace {
+class ClipboardSource : public anbox::platform::Clipboard::Source {
+ public:
+  std::string read_text() override {
+    if (!SDL_HasClipboardText())
+      return std::string{};
+
+    auto text = SDL_GetClipboardText();
+    if (!text)
+      return std::string{};
+
+    std::string result{text};
+    SDL_free(text);
+    return result;
+  }
+
+  void write_text(const std::string &text) override {
+    if (text.empty())
+      return;
+    SDL_SetClipboardText(text.c_str());
+  }
+};
+}  // namespace
+
 namespace anbox {
 namespace platform {
 namespace sdl {
@@ -41,7 +66,8 @@ Platform::Platform(
     bool single_window)
     : input_manager_(input_manager),
       event_thread_running_(false),
-      single_window_(single_window) {
+      single_window_(single_window),
+      clipboard_(std::make_shared<ClipboardSource>()) {
 
   // Don't block the screensaver from kicking in. It will be blocked
   // by the desktop shell already and we don't have to do this again.
@@ -125,6 +151,10 @@ Platform::Platform(
   touch_->set_prop_bit(INPUT_PROP_DIRECT);
 #endif
 
+  // Wakes up the event thread to hand clipboard data from Android to
+  // the host.
+  clipboard_event_ = SDL_RegisterEvents(1);
+
   event_thread_ = std::thread(&Platform::process_events, this);
 }
 
@@ -144,8 +174,12 @@ void Platform::set_window_manager(const std::shared_ptr<wm::Manager> &window_man
 }
 
 void Platform::process_events() {
+  common::setup_current_thread(common::ThreadClass::Compositor, "sdl-events");
+
   event_thread_running_ = true;
 
+  clipboard_.host_changed();
+
   while (event_thread_running_) {
     SDL_Event event;
     while (SDL_WaitEventTimeout(&event, 100)) {
@@ -176,7 +210,12 @@ void Platform::process_events() {
         case SDL_FINGERMOTION:
           process_input_event(event);
           break;
+        case SDL_CLIPBOARDUPDATE:
+          clipboard_.host_changed();
+          break;
         default:
+          if (event.type == clipboard_event_)
+            clipboard_.sync_to_host();
           break;
       }
     }
@@ -400,6 +439,10 @@ void Platform::window_wants_focus(const Window::Id &id) {
 
   if (auto window = w->second.lock())
     window_manager_->set_focused_task(window->task());
+
+  // Not every SDL video backend reports clipboard updates so refresh our
+  // copy whenever one of our windows gets focus.
+  clipboard_.host_changed();
 }
 
 void Platform::window_moved(const Window::Id &id, const std::int32_t &x,
@@ -433,23 +476,39 @@ void Platform::window_resized(const Window::Id &id,
   }
 }
 
+void Platform::window_visibility_changed(const Window::Id &id, bool visible,
+                                         bool focused) {
+  auto w = windows_.find(id);
+  if (w == windows_.end()) return;
+
+  if (auto window = w->second.lock())
+    window_manager_->set_task_visibility(window->task(), visible, focused);
+}
+
 void Platform::set_clipboard_data(const ClipboardData &data) {
-  if (data.text.empty())
+  if (data.text.empty() || !clipboard_.set_from_guest(data.text))
     return;
-  SDL_SetClipboardText(data.text.c_str());
+
+  if (clipboard_event_ == static_cast<std::uint32_t>(-1)) {
+    ERROR("No event to hand clipboard data to the event thread");
+    return;
+  }
+
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = clipboard_event_;
+  SDL_PushEvent(&event);
 }
 
 Platform::ClipboardData Platform::get_clipboard_data() {
-  if (!SDL_HasClipboardText())
-    return ClipboardData{};
-
-  auto text = SDL_GetClipboardText();
-  if (!text)
-    return ClipboardData{};
+  return ClipboardData{clipboard_.text()};
+}
 
-  auto data = ClipboardData{text};
-  SDL_free(text);
-  return data;
+void Platform::set_clipboard_observer(const ClipboardObserver &observer) {
+  clipboard_.set_observer([observer](const std::string &text) {
+    if (observer)
+      observer(ClipboardData{text});
+  });
 }
 
 std::shared_ptr<audio::Sink> Platform::create_audio_sink() {
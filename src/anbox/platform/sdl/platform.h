@@ -21,6 +21,7 @@
 #include "anbox/platform/sdl/window.h"
 #include "anbox/platform/sdl/sdl_wrapper.h"
 #include "anbox/platform/base_platform.h"
+#include "anbox/platform/clipboard.h"
 #include "anbox/graphics/emugl/DisplayManager.h"
 
 #include <map>
@@ -58,12 +59,15 @@ class Platform : public std::enable_shared_from_this<Platform>,
                     const std::int32_t &y) override;
   void window_resized(const Window::Id &id, const std::int32_t &width,
                       const std::int32_t &height) override;
+  void window_visibility_changed(const Window::Id &id, bool visible,
+                                 bool focused) override;
 
   void set_renderer(const std::shared_ptr<Renderer> &renderer) override;
   void set_window_manager(const std::shared_ptr<wm::Manager> &window_manager) override;
 
   void set_clipboard_data(const ClipboardData &data) override;
   ClipboardData get_clipboard_data() override;
+  void set_clipboard_observer(const ClipboardObserver &observer) override;
 
   std::shared_ptr<audio::Sink> create_audio_sink() override;
   std::shared_ptr<audio::Source> create_audio_source() override;
@@ -91,6 +95,8 @@ class Platform : public std::enable_shared_from_this<Platform>,
   graphics::Rect display_frame_;
   bool window_size_immutable_ = false;
   bool single_window_ = false;
+  Clipboard clipboard_;
+  std::uint32_t clipboard_event_ = static_cast<std::uint32_t>(-1);
 };
 } // namespace sdl
 } // namespace platform
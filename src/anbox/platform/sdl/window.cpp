@@ -162,12 +162,24 @@ void Window::switch_window_state() {
     SDL_MaximizeWindow(window_);
 }
 
+void Window::update_visibility(bool visible, bool focused) {
+  if (visible == visible_ && focused == focused_)
+    return;
+
+  visible_ = visible;
+  focused_ = focused;
+  if (observer_)
+    observer_->window_visibility_changed(id_, visible_, focused_);
+}
+
 void Window::process_event(const SDL_Event &event) {
   switch (event.window.event) {
     case SDL_WINDOWEVENT_FOCUS_GAINED:
       if (observer_) observer_->window_wants_focus(id_);
+      update_visibility(visible_, true);
       break;
     case SDL_WINDOWEVENT_FOCUS_LOST:
+      update_visibility(visible_, false);
       break;
     // Not need to listen for SDL_WINDOWEVENT_RESIZED here as the
     // SDL_WINDOWEVENT_SIZE_CHANGED is always sent.
@@ -180,8 +192,13 @@ void Window::process_event(const SDL_Event &event) {
         observer_->window_moved(id_, event.window.data1, event.window.data2);
       break;
     case SDL_WINDOWEVENT_SHOWN:
+    case SDL_WINDOWEVENT_RESTORED:
+    case SDL_WINDOWEVENT_MAXIMIZED:
+      update_visibility(true, focused_);
       break;
     case SDL_WINDOWEVENT_HIDDEN:
+    case SDL_WINDOWEVENT_MINIMIZED:
+      update_visibility(false, focused_);
       break;
     case SDL_WINDOWEVENT_CLOSE:
       if (observer_)
@@ -45,6 +45,8 @@ class Window : public std::enable_shared_from_this<Window>, public wm::Window {
                               const std::int32_t &y) = 0;
     virtual void window_resized(const Id &id, const std::int32_t &x,
                                 const std::int32_t &y) = 0;
+    virtual void window_visibility_changed(const Id &id, bool visible,
+                                           bool focused) = 0;
   };
 
   Window(const std::shared_ptr<Renderer> &renderer,
@@ -66,12 +68,16 @@ class Window : public std::enable_shared_from_this<Window>, public wm::Window {
 
   void close();
   void switch_window_state();
+  void update_visibility(bool visible, bool focused);
 
   Id id_;
   std::shared_ptr<Observer> observer_;
   EGLNativeDisplayType native_display_;
   EGLNativeWindowType native_window_;
   SDL_Window *window_;
+  // SDL sends SHOWN and FOCUS_GAINED right after the window was created.
+  bool visible_ = false;
+  bool focused_ = false;
 };
 } // namespace sdl
 } // namespace platform
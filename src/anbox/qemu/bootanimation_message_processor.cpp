@@ -16,9 +16,12 @@
  */
 
 #include "anbox/qemu//bootanimation_message_processor.h"
+#include "anbox/common/fd.h"
 #include "anbox/logger.h"
 
-#include <fstream>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
 
 namespace anbox {
 namespace qemu {
@@ -34,14 +37,23 @@ void BootAnimationMessageProcessor::handle_command(const std::string &command) {
 }
 
 void BootAnimationMessageProcessor::retrieve_icon() {
-  std::ifstream icon_file(icon_path_, std::ifstream::binary);
-  std::array<char, 1024> buffer;
+  const auto fd = ::open(icon_path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    WARNING("Failed to open boot animation icon %s: %s", icon_path_, strerror(errno));
+    return;
+  }
+  const anbox::Fd icon_fd{IntOwnedFd{fd}};
 
-  while (icon_file.read(buffer.data(), buffer.size())) {
-    const auto bytes_read = icon_file.gcount();
-    messenger_->send(buffer.data(), bytes_read);
-    DEBUG("Sending %d bytes", bytes_read);
+  struct stat st;
+  if (::fstat(icon_fd, &st) < 0) {
+    WARNING("Failed to query size of boot animation icon %s: %s", icon_path_, strerror(errno));
+    return;
   }
+
+  // The icon is sent in one go straight from the page cache to avoid
+  // copying it through userspace in small chunks while Android boots.
+  messenger_->send_file(icon_fd, 0, st.st_size);
+  DEBUG("Sent %d bytes", st.st_size);
 }
 
 }  // namespace qemu
@@ -18,7 +18,6 @@
  */
 
 #include "anbox/rpc/channel.h"
-#include "anbox/common/variable_length_array.h"
 #include "anbox/network/message_sender.h"
 #include "anbox/rpc/constants.h"
 #include "anbox/rpc/pending_call_cache.h"
@@ -29,7 +28,9 @@ namespace anbox {
 namespace rpc {
 Channel::Channel(const std::shared_ptr<PendingCallCache> &pending_calls,
                  const std::shared_ptr<network::MessageSender> &sender)
-    : pending_calls_(pending_calls), sender_(sender) {}
+    : pending_calls_(pending_calls), sender_(sender),
+      invocation_(new protobuf::rpc::Invocation),
+      event_result_(new protobuf::rpc::Result) {}
 
 Channel::~Channel() {}
 
@@ -37,41 +38,31 @@ void Channel::call_method(std::string const &method_name,
                           google::protobuf::MessageLite const *parameters,
                           google::protobuf::MessageLite *response,
                           google::protobuf::Closure *complete) {
-  auto const &invocation = invocation_for(method_name, parameters);
-  pending_calls_->save_completion_details(invocation, response, complete);
-  send_message(MessageType::invocation, invocation);
-}
-
-void Channel::send_event(google::protobuf::MessageLite const &event) {
-  VariableLengthArray<2048> buffer{static_cast<size_t>(event.ByteSize())};
-  event.SerializeWithCachedSizesToArray(buffer.data());
+  std::unique_lock<std::mutex> lock(write_mutex_);
 
-  anbox::protobuf::rpc::Result response;
-  response.add_events(buffer.data(), buffer.size());
+  invocation_->set_id(next_id());
+  invocation_->set_method_name(method_name);
+  parameters->SerializeToString(invocation_->mutable_parameters());
+  invocation_->set_protocol_version(1);
 
-  send_message(MessageType::response, response);
+  pending_calls_->save_completion_details(*invocation_, response, complete);
+  send_message(MessageType::invocation, *invocation_, lock);
 }
 
-protobuf::rpc::Invocation Channel::invocation_for(
-    std::string const &method_name,
-    google::protobuf::MessageLite const *request) {
-  anbox::VariableLengthArray<2048> buffer{
-      static_cast<size_t>(request->ByteSize())};
-
-  request->SerializeWithCachedSizesToArray(buffer.data());
-
-  anbox::protobuf::rpc::Invocation invoke;
+void Channel::send_event(google::protobuf::MessageLite const &event) {
+  std::unique_lock<std::mutex> lock(write_mutex_);
 
-  invoke.set_id(next_id());
-  invoke.set_method_name(method_name);
-  invoke.set_parameters(buffer.data(), buffer.size());
-  invoke.set_protocol_version(1);
+  // Clearing keeps the previously allocated event string around so it
+  // gets reused by add_events().
+  event_result_->Clear();
+  event.SerializeToString(event_result_->add_events());
 
-  return invoke;
+  send_message(MessageType::response, *event_result_, lock);
 }
 
 void Channel::send_message(const std::uint8_t &type,
-                           google::protobuf::MessageLite const &message) {
+                           google::protobuf::MessageLite const &message,
+                           std::unique_lock<std::mutex> &lock) {
   const size_t size = message.ByteSize();
   const unsigned char header_bytes[header_size] = {
       static_cast<unsigned char>((size >>16) & 0xff),
@@ -79,16 +70,18 @@ void Channel::send_message(const std::uint8_t &type,
       static_cast<unsigned char>((size >> 0) & 0xff), type,
   };
 
-  std::vector<std::uint8_t> send_buffer(sizeof(header_bytes) + size);
+  send_buffer_.resize(sizeof(header_bytes) + size);
   std::copy(header_bytes, header_bytes + sizeof(header_bytes),
-            send_buffer.begin());
-  message.SerializeToArray(send_buffer.data() + sizeof(header_bytes), size);
+            send_buffer_.begin());
+  message.SerializeWithCachedSizesToArray(send_buffer_.data() + sizeof(header_bytes));
 
   try {
-    std::lock_guard<std::mutex> lock(write_mutex_);
-    sender_->send(reinterpret_cast<const char *>(send_buffer.data()),
-                  send_buffer.size());
+    sender_->send(reinterpret_cast<const char *>(send_buffer_.data()),
+                  send_buffer_.size());
   } catch (std::runtime_error const &) {
+    // Completing the pending calls runs their closures which must not
+    // find us still holding the lock.
+    lock.unlock();
     notify_disconnected();
     throw;
   }
@@ -19,8 +19,11 @@
 #define ANBOX_RPC_CHANNEL_H_
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace google {
 namespace protobuf {
@@ -33,6 +36,7 @@ namespace anbox {
 namespace protobuf {
 namespace rpc {
 class Invocation;
+class Result;
 }  // namespace rpc
 }  // namespace protobuf
 namespace network {
@@ -54,17 +58,22 @@ class Channel {
   void send_event(google::protobuf::MessageLite const &event);
 
  private:
-  protobuf::rpc::Invocation invocation_for(
-      std::string const &method_name,
-      google::protobuf::MessageLite const *request);
+  // Has to be called with write_mutex_ locked through lock.
   void send_message(const std::uint8_t &type,
-                    google::protobuf::MessageLite const &message);
+                    google::protobuf::MessageLite const &message,
+                    std::unique_lock<std::mutex> &lock);
   std::uint32_t next_id();
   void notify_disconnected();
 
   std::shared_ptr<PendingCallCache> pending_calls_;
   std::shared_ptr<network::MessageSender> sender_;
   std::mutex write_mutex_;
+  // Messages and buffers are reused for every call and event to not pay
+  // for allocating them and their fields again each time. All of them
+  // are protected by write_mutex_.
+  std::unique_ptr<protobuf::rpc::Invocation> invocation_;
+  std::unique_ptr<protobuf::rpc::Result> event_result_;
+  std::vector<std::uint8_t> send_buffer_;
 };
 }  // namespace rpc
 }  // namespace anbox
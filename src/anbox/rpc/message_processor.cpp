@@ -16,9 +16,7 @@
  */
 
 #include "anbox/rpc/message_processor.h"
-#include "anbox/common/variable_length_array.h"
 #include "anbox/rpc/constants.h"
-#include "anbox/rpc/make_protobuf_object.h"
 #include "anbox/rpc/template_message_processor.h"
 
 #include "anbox_rpc.pb.h"
@@ -38,47 +36,62 @@ google::protobuf::uint32 Invocation::id() const { return invocation_.id(); }
 MessageProcessor::MessageProcessor(
     const std::shared_ptr<network::MessageSender> &sender,
     const std::shared_ptr<PendingCallCache> &pending_calls)
-    : sender_(sender), pending_calls_(pending_calls) {}
+    : sender_(sender), pending_calls_(pending_calls),
+      invocation_(new anbox::protobuf::rpc::Invocation),
+      result_(new anbox::protobuf::rpc::Result),
+      response_result_(new anbox::protobuf::rpc::Result),
+      account_(common::MemoryAccounting::Subsystem::RpcMessages,
+               common::MemoryAccounting::next_owner("rpc")) {}
 
 MessageProcessor::~MessageProcessor() {}
 
 bool MessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
-  for (const auto &byte : data) buffer_.push_back(byte);
-
-  while (buffer_.size() > 0) {
-    const auto high = buffer_[0];
-    const auto medium = buffer_[1];
-    const auto low = buffer_[2];
+  buffer_.insert(buffer_.end(), data.begin(), data.end());
+
+  // Processed messages are only dropped from the buffer once we're done
+  // with all complete ones instead of moving the remaining data for each.
+  size_t offset = 0;
+  while (buffer_.size() - offset >= header_size) {
+    const auto high = buffer_[offset];
+    const auto medium = buffer_[offset + 1];
+    const auto low = buffer_[offset + 2];
     size_t const message_size = (high << 16) + (medium << 8) + low;
-    const auto message_type = buffer_[3];
+    const auto message_type = buffer_[offset + 3];
 
     // If we don't have yet all bytes for a new message return and wait
     // until we have all.
-    if (buffer_.size() - header_size < message_size) break;
+    if (buffer_.size() - offset - header_size < message_size) break;
+
+    const auto message_data = buffer_.data() + offset + header_size;
 
     if (message_type == MessageType::invocation) {
-      anbox::protobuf::rpc::Invocation raw_invocation;
-      raw_invocation.ParseFromArray(buffer_.data() + header_size, message_size);
+      invocation_->ParseFromArray(message_data, message_size);
 
-      dispatch(Invocation(raw_invocation));
+      dispatch(Invocation(*invocation_));
     } else if (message_type == MessageType::response) {
-      auto result = make_protobuf_object<protobuf::rpc::Result>();
-      result->ParseFromArray(buffer_.data() + header_size, message_size);
+      result_->ParseFromArray(message_data, message_size);
 
-      if (result->has_id()) {
-        pending_calls_->populate_message_for_result(*result,
+      if (result_->has_id()) {
+        pending_calls_->populate_message_for_result(*result_,
                                                     [&](google::protobuf::MessageLite *result_message) {
-                                                      result_message->ParseFromString(result->response());
+                                                      result_message->ParseFromString(result_->response());
                                                     });
-        pending_calls_->complete_response(*result);
+        pending_calls_->complete_response(*result_);
       }
 
-      for (int n = 0; n < result->events_size(); n++)
-        process_event_sequence(result->events(n));
+      for (int n = 0; n < result_->events_size(); n++)
+        process_event_sequence(result_->events(n));
     }
 
-    buffer_.erase(buffer_.begin(),
-                  buffer_.begin() + header_size + message_size);
+    offset += header_size + message_size;
+  }
+
+  buffer_.erase(buffer_.begin(), buffer_.begin() + offset);
+
+  if (buffer_.capacity() != receive_capacity_) {
+    account_.remove(receive_capacity_);
+    receive_capacity_ = buffer_.capacity();
+    account_.add(receive_capacity_);
   }
 
   return true;
@@ -86,36 +99,33 @@ bool MessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
 
 void MessageProcessor::send_response(::google::protobuf::uint32 id,
                                      google::protobuf::MessageLite *response) {
-  VariableLengthArray<serialization_buffer_size> send_response_buffer(
-      static_cast<size_t>(response->ByteSize()));
-
-  response->SerializeWithCachedSizesToArray(send_response_buffer.data());
+  std::lock_guard<std::mutex> lock(send_mutex_);
 
-  anbox::protobuf::rpc::Result send_response_result;
-  send_response_result.set_id(id);
-  send_response_result.set_response(send_response_buffer.data(),
-                                    send_response_buffer.size());
+  response_result_->Clear();
+  response_result_->set_id(id);
+  response->SerializeToString(response_result_->mutable_response());
 
-  send_response_buffer.resize(send_response_result.ByteSize());
-  send_response_result.SerializeWithCachedSizesToArray(
-      send_response_buffer.data());
-
-  const size_t size = send_response_buffer.size();
+  const size_t size = response_result_->ByteSize();
   const unsigned char header_bytes[header_size] = {
       static_cast<unsigned char>((size >> 16) & 0xff),
       static_cast<unsigned char>((size >> 8) & 0xff),
       static_cast<unsigned char>((size >> 0) & 0xff), MessageType::response,
   };
 
-  std::vector<std::uint8_t> send_buffer(sizeof(header_bytes) + size);
+  send_buffer_.resize(sizeof(header_bytes) + size);
   std::copy(header_bytes, header_bytes + sizeof(header_bytes),
-            send_buffer.begin());
-  std::copy(send_response_buffer.data(),
-            send_response_buffer.data() + send_response_buffer.size(),
-            send_buffer.begin() + sizeof(header_bytes));
+            send_buffer_.begin());
+  response_result_->SerializeWithCachedSizesToArray(
+      send_buffer_.data() + sizeof(header_bytes));
+
+  if (send_buffer_.capacity() != send_capacity_) {
+    account_.remove(send_capacity_);
+    send_capacity_ = send_buffer_.capacity();
+    account_.add(send_capacity_);
+  }
 
-  sender_->send(reinterpret_cast<const char *>(send_buffer.data()),
-                send_buffer.size());
+  sender_->send(reinterpret_cast<const char *>(send_buffer_.data()),
+                send_buffer_.size());
 }
 }  // namespace anbox
 }  // namespace network
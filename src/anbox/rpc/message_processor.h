@@ -18,11 +18,13 @@
 #ifndef ANBOX_RPC_MESSAGE_PROCESSOR_H_
 #define ANBOX_RPC_MESSAGE_PROCESSOR_H_
 
+#include "anbox/common/memory_accounting.h"
 #include "anbox/network/message_processor.h"
 #include "anbox/network/message_sender.h"
 #include "anbox/rpc/pending_call_cache.h"
 
 #include <memory>
+#include <mutex>
 
 #include <google/protobuf/message_lite.h>
 #include <google/protobuf/stubs/common.h>
@@ -31,6 +33,7 @@ namespace anbox {
 namespace protobuf {
 namespace rpc {
 class Invocation;
+class Result;
 }  // namespace rpc
 }  // namespace protobuf
 namespace rpc {
@@ -65,6 +68,19 @@ class MessageProcessor : public network::MessageProcessor {
   std::shared_ptr<network::MessageSender> sender_;
   std::vector<std::uint8_t> buffer_;
   std::shared_ptr<PendingCallCache> pending_calls_;
+  // Incoming messages are parsed into the same objects every time so
+  // their fields can reuse what was allocated for earlier messages.
+  std::unique_ptr<anbox::protobuf::rpc::Invocation> invocation_;
+  std::unique_ptr<anbox::protobuf::rpc::Result> result_;
+  // Responses can be sent from any thread.
+  std::mutex send_mutex_;
+  std::unique_ptr<anbox::protobuf::rpc::Result> response_result_;
+  std::vector<std::uint8_t> send_buffer_;
+  // Holds the capacity of both buffers. Each is only looked at by the
+  // thread using the buffer.
+  common::MemoryAccounting::Account account_;
+  std::size_t receive_capacity_ = 0;
+  std::size_t send_capacity_ = 0;
 };
 }  // namespace rpc
 }  // namespace anbox
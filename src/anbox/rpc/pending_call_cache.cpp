@@ -36,7 +36,12 @@ void PendingCallCache::populate_message_for_result(
     anbox::protobuf::rpc::Result& result,
     std::function<void(google::protobuf::MessageLite*)> const& populator) {
   std::unique_lock<std::mutex> lock(mutex_);
-  populator(pending_calls_.at(result.id()).response);
+  // Responses for calls which were already forced to complete or which we
+  // never made (e.g. when replaying recorded traffic) are dropped.
+  auto call = pending_calls_.find(result.id());
+  if (call == pending_calls_.end())
+    return;
+  populator(call->second.response);
 }
 
 void PendingCallCache::complete_response(anbox::protobuf::rpc::Result& result) {
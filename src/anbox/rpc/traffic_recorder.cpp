@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/traffic_recorder.h"
+#include "anbox/utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+// Bumped whenever the layout of a record changes.
+constexpr const char file_magic[8] = {'A', 'N', 'B', 'X', 'R', 'P', 'C', '1'};
+// Direction (1 byte), timestamp in ns (8 bytes) and data size (4 bytes),
+// all little endian.
+constexpr const std::size_t record_header_size{13};
+
+void write_le(std::uint8_t *out, std::uint64_t value, std::size_t size) {
+  for (std::size_t n = 0; n < size; n++)
+    out[n] = static_cast<std::uint8_t>((value >> (n * 8)) & 0xff);
+}
+
+std::uint64_t read_le(const std::uint8_t *in, std::size_t size) {
+  std::uint64_t value = 0;
+  for (std::size_t n = 0; n < size; n++)
+    value |= static_cast<std::uint64_t>(in[n]) << (n * 8);
+  return value;
+}
+}  // namespace
+
+namespace anbox {
+namespace rpc {
+TrafficRecorder::TrafficRecorder(const std::string &path)
+    : out_(path, std::ios::binary | std::ios::trunc),
+      start_(std::chrono::steady_clock::now()) {
+  if (!out_)
+    throw std::runtime_error(utils::string_format("Failed to open %s for recording", path));
+  out_.write(file_magic, sizeof(file_magic));
+}
+
+TrafficRecorder::~TrafficRecorder() {}
+
+void TrafficRecorder::record(Direction direction, const std::uint8_t *data, std::size_t size) {
+  const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start_);
+
+  std::uint8_t header[record_header_size];
+  header[0] = static_cast<std::uint8_t>(direction);
+  write_le(header + 1, timestamp.count(), 8);
+  write_le(header + 9, size, 4);
+
+  std::lock_guard<std::mutex> l(mutex_);
+  out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+  out_.write(reinterpret_cast<const char*>(data), size);
+}
+
+std::vector<TrafficRecorder::Record> TrafficRecorder::read(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error(utils::string_format("Failed to open recording %s", path));
+
+  char magic[sizeof(file_magic)];
+  if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), file_magic))
+    throw std::runtime_error(utils::string_format("%s is not a RPC recording", path));
+
+  std::vector<Record> records;
+  std::uint8_t header[record_header_size];
+  while (in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+    if (header[0] > static_cast<std::uint8_t>(Direction::outgoing))
+      throw std::runtime_error(utils::string_format("Invalid record in %s", path));
+
+    Record record;
+    record.direction = static_cast<Direction>(header[0]);
+    record.timestamp = std::chrono::nanoseconds{read_le(header + 1, 8)};
+    record.data.resize(read_le(header + 9, 4));
+    if (!in.read(reinterpret_cast<char*>(record.data.data()), record.data.size()))
+      throw std::runtime_error(utils::string_format("Recording %s is truncated", path));
+
+    records.push_back(std::move(record));
+  }
+
+  if (in.gcount() != 0)
+    throw std::runtime_error(utils::string_format("Recording %s is truncated", path));
+
+  return records;
+}
+
+RecordingMessageSender::RecordingMessageSender(const std::shared_ptr<network::MessageSender> &sender,
+                                               const std::shared_ptr<TrafficRecorder> &recorder)
+    : sender_(sender), recorder_(recorder) {}
+
+void RecordingMessageSender::send(char const *data, size_t length) {
+  recorder_->record(TrafficRecorder::Direction::outgoing,
+                    reinterpret_cast<const std::uint8_t*>(data), length);
+  sender_->send(data, length);
+}
+
+ssize_t RecordingMessageSender::send_raw(char const *data, size_t length) {
+  const auto written = sender_->send_raw(data, length);
+  if (written > 0)
+    recorder_->record(TrafficRecorder::Direction::outgoing,
+                      reinterpret_cast<const std::uint8_t*>(data), written);
+  return written;
+}
+
+RecordingMessageProcessor::RecordingMessageProcessor(const std::shared_ptr<network::MessageProcessor> &processor,
+                                                     const std::shared_ptr<TrafficRecorder> &recorder)
+    : processor_(processor), recorder_(recorder) {}
+
+bool RecordingMessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
+  recorder_->record(TrafficRecorder::Direction::incoming, data.data(), data.size());
+  return processor_->process_data(data);
+}
+}  // namespace rpc
+}  // namespace anbox
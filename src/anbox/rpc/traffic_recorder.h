@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_RPC_TRAFFIC_RECORDER_H_
+#define ANBOX_RPC_TRAFFIC_RECORDER_H_
+
+#include "anbox/network/message_processor.h"
+#include "anbox/network/message_sender.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anbox {
+namespace rpc {
+// Writes everything passing an RPC connection into a file so that the
+// session can be replayed later without a running Android. Data is stored
+// in the chunks it was read from or written to the socket, together with
+// the time since recording started.
+class TrafficRecorder {
+ public:
+  enum class Direction : std::uint8_t {
+    incoming = 0,
+    outgoing = 1,
+  };
+
+  struct Record {
+    Direction direction;
+    std::chrono::nanoseconds timestamp;
+    std::vector<std::uint8_t> data;
+  };
+
+  // Throws std::runtime_error if |path| can't be opened for writing.
+  explicit TrafficRecorder(const std::string &path);
+  ~TrafficRecorder();
+
+  void record(Direction direction, const std::uint8_t *data, std::size_t size);
+
+  // Throws std::runtime_error if |path| isn't a complete recording.
+  static std::vector<Record> read(const std::string &path);
+
+ private:
+  std::mutex mutex_;
+  std::ofstream out_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Passes everything sent through |sender| on to |recorder|.
+class RecordingMessageSender : public network::MessageSender {
+ public:
+  RecordingMessageSender(const std::shared_ptr<network::MessageSender> &sender,
+                         const std::shared_ptr<TrafficRecorder> &recorder);
+
+  void send(char const *data, size_t length) override;
+  ssize_t send_raw(char const *data, size_t length) override;
+
+ private:
+  std::shared_ptr<network::MessageSender> sender_;
+  std::shared_ptr<TrafficRecorder> recorder_;
+};
+
+// Passes everything |processor| receives on to |recorder|.
+class RecordingMessageProcessor : public network::MessageProcessor {
+ public:
+  RecordingMessageProcessor(const std::shared_ptr<network::MessageProcessor> &processor,
+                            const std::shared_ptr<TrafficRecorder> &recorder);
+
+  bool process_data(const std::vector<std::uint8_t> &data) override;
+
+ private:
+  std::shared_ptr<network::MessageProcessor> processor_;
+  std::shared_ptr<TrafficRecorder> recorder_;
+};
+}  // namespace rpc
+}  // namespace anbox
+
+#endif
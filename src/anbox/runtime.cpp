@@ -17,6 +17,7 @@
 
 #include <iostream>
 
+#include "anbox/common/thread_topology.h"
 #include "anbox/logger.h"
 #include "anbox/runtime.h"
 
@@ -72,8 +73,13 @@ Runtime::~Runtime() noexcept(true) {
 }
 
 void Runtime::start() {
-  for (unsigned int i = 0; i < pool_size_; i++)
-    workers_.push_back(std::thread{exception_safe_run, std::ref(service_)});
+  for (unsigned int i = 0; i < pool_size_; i++) {
+    workers_.push_back(std::thread{[this, i]() {
+      common::setup_current_thread(common::ThreadClass::IO,
+                                   "rt-worker-" + std::to_string(i));
+      exception_safe_run(service_);
+    }});
+  }
 }
 
 void Runtime::stop() {
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_TESTING_SWIFTSHADER_CONTEXT_H_
+#define ANBOX_TESTING_SWIFTSHADER_CONTEXT_H_
+
+#include "anbox/graphics/emugl/DispatchTables.h"
+#include "anbox/graphics/emugl/RenderApi.h"
+#include "anbox/utils.h"
+
+#include "external/android-emugl/host/include/OpenGLESDispatch/EGLDispatch.h"
+
+#include <boost/filesystem.hpp>
+
+#include <vector>
+
+namespace anbox {
+namespace testing {
+// Loads SwiftShader from $SWIFTSHADER_PATH or from the location used by
+// the snap and sets up a pbuffer context for the calling thread we can
+// render into. Every thread which renders needs its own instance.
+class SwiftShaderContext {
+ public:
+  SwiftShaderContext(int width, int height) : width_{width}, height_{height} {}
+
+  bool initialize() {
+    // Loading the libraries is not thread safe, so only do it once.
+    static const bool loaded = load_libraries();
+    if (!loaded)
+      return false;
+
+    display_ = s_egl.eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!s_egl.eglInitialize(display_, nullptr, nullptr))
+      return false;
+
+    s_egl.eglBindAPI(EGL_OPENGL_ES_API);
+
+    const EGLint config_attribs[] = {EGL_RED_SIZE, 8,
+                                     EGL_GREEN_SIZE, 8,
+                                     EGL_BLUE_SIZE, 8,
+                                     EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                     EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+                                     EGL_NONE};
+    EGLConfig config;
+    EGLint num_configs = 0;
+    if (!s_egl.eglChooseConfig(display_, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+      return false;
+
+    const EGLint context_attribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    context_ = s_egl.eglCreateContext(display_, config, EGL_NO_CONTEXT, context_attribs);
+    if (context_ == EGL_NO_CONTEXT)
+      return false;
+
+    const EGLint surface_attribs[] = {EGL_WIDTH, width_, EGL_HEIGHT, height_, EGL_NONE};
+    surface_ = s_egl.eglCreatePbufferSurface(display_, config, surface_attribs);
+    if (surface_ == EGL_NO_SURFACE)
+      return false;
+
+    return s_egl.eglMakeCurrent(display_, surface_, surface_, context_);
+  }
+
+  ~SwiftShaderContext() {
+    if (display_ == EGL_NO_DISPLAY)
+      return;
+    s_egl.eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface_ != EGL_NO_SURFACE)
+      s_egl.eglDestroySurface(display_, surface_);
+    if (context_ != EGL_NO_CONTEXT)
+      s_egl.eglDestroyContext(display_, context_);
+  }
+
+  EGLDisplay display() const { return display_; }
+
+ private:
+  static bool load_libraries() {
+    namespace fs = boost::filesystem;
+
+    const auto snap_path = utils::get_env_value("SNAP", "/snap/anbox/current");
+    const auto swiftshader_path = fs::path(utils::get_env_value(
+        "SWIFTSHADER_PATH", (fs::path(snap_path) / "lib" / "anbox" / "swiftshader").string()));
+
+    const std::vector<graphics::emugl::GLLibrary> libs{
+      {graphics::emugl::GLLibrary::Type::EGL, swiftshader_path / "libEGL.so"},
+      {graphics::emugl::GLLibrary::Type::GLESv2, swiftshader_path / "libGLESv2.so"},
+    };
+    return graphics::emugl::initialize(libs, nullptr, nullptr);
+  }
+
+  int width_;
+  int height_;
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLContext context_ = EGL_NO_CONTEXT;
+  EGLSurface surface_ = EGL_NO_SURFACE;
+};
+}  // namespace testing
+}  // namespace anbox
+
+#endif
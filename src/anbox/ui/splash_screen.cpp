@@ -16,6 +16,7 @@
  */
 
 #include "anbox/ui/splash_screen.h"
+#include "anbox/common/thread_topology.h"
 #include "anbox/system_configuration.h"
 #include "anbox/utils.h"
 #include "anbox/logger.h"
@@ -85,6 +86,8 @@ SplashScreen::~SplashScreen() {
 }
 
 void SplashScreen::process_events() {
+  common::setup_current_thread(common::ThreadClass::Background, "splash-events");
+
   event_thread_running_ = true;
   while (event_thread_running_) {
     SDL_Event event;
@@ -16,9 +16,20 @@
  */
 
 #include "anbox/wm/manager.h"
+#include "anbox/graphics/render_throttle.h"
 
 namespace anbox {
 namespace wm {
 Manager::~Manager() {}
+
+void Manager::set_task_visibility(const Task::Id &task, bool visible, bool focused) {
+  using State = graphics::RenderThrottle::State;
+  auto state = State::Foreground;
+  if (!visible)
+    state = State::Hidden;
+  else if (!focused)
+    state = State::Background;
+  graphics::RenderThrottle::global()->set_task_state(task, state);
+}
 } // namespace wm
 } // namespace anbox
@@ -40,6 +40,11 @@ class Manager {
   virtual void set_focused_task(const Task::Id &task) = 0;
   virtual void remove_task(const Task::Id &task) = 0;
 
+  // Called by the platform whenever the host window of a task is shown,
+  // hidden, gets or loses the input focus. Render work of tasks the user
+  // doesn't look at is throttled.
+  virtual void set_task_visibility(const Task::Id &task, bool visible, bool focused);
+
   // FIXME only applies for the multi-window case
   virtual std::shared_ptr<Window> find_window_for_task(const Task::Id &task) = 0;
 };
@@ -16,9 +16,11 @@
  */
 
 #include "anbox/application/database.h"
+#include "anbox/application/launch_tracker.h"
 #include "anbox/wm/multi_window_manager.h"
 #include "anbox/platform/base_platform.h"
 #include "anbox/bridge/android_api_stub.h"
+#include "anbox/graphics/render_throttle.h"
 #include "anbox/logger.h"
 
 #include <algorithm>
@@ -27,8 +29,10 @@ namespace anbox {
 namespace wm {
 MultiWindowManager::MultiWindowManager(const std::weak_ptr<platform::BasePlatform> &platform,
                                        const std::shared_ptr<bridge::AndroidApiStub> &android_api_stub,
-                                       const std::shared_ptr<application::Database> &app_db)
-    : platform_(platform), android_api_stub_(android_api_stub), app_db_(app_db) {}
+                                       const std::shared_ptr<application::Database> &app_db,
+                                       const std::shared_ptr<application::LaunchTracker> &launch_tracker)
+    : platform_(platform), android_api_stub_(android_api_stub), app_db_(app_db),
+      launch_tracker_(launch_tracker) {}
 
 MultiWindowManager::~MultiWindowManager() {}
 
@@ -50,6 +54,11 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
     // And also those which don't have a surface mapped at the moment
     if (!window.has_surface()) continue;
 
+    // A launched application might reuse an already existing task so we
+    // let the tracker know about every task which has a window.
+    if (launch_tracker_)
+      launch_tracker_->window_state_updated(window.package_name(), window.task());
+
     // If we know that task already we first collect all window updates
     // for it so we can apply all of them together.
     auto w = windows_.find(window.task());
@@ -72,6 +81,7 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
       if (w) {
         w->attach();
         windows_.insert({window.task(), w});
+        graphics::RenderThrottle::global()->set_task_package(window.task(), window.package_name());
       } else {
         // FIXME can we call this here safely or do we need to schedule the removal?
         remove_task(window.task());
@@ -100,6 +110,7 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
       auto platform_window = w->second;
       platform_window->release();
       windows_.erase(w);
+      graphics::RenderThrottle::global()->remove_task(window.task());
     }
   }
 }
@@ -27,6 +27,7 @@
 namespace anbox {
 namespace application {
 class Database;
+class LaunchTracker;
 } // namespace application
 namespace bridge {
 class AndroidApiStub;
@@ -39,7 +40,8 @@ class MultiWindowManager : public Manager {
  public:
   MultiWindowManager(const std::weak_ptr<platform::BasePlatform> &platform,
                      const std::shared_ptr<bridge::AndroidApiStub> &android_api_stub,
-                     const std::shared_ptr<application::Database> &app_db);
+                     const std::shared_ptr<application::Database> &app_db,
+                     const std::shared_ptr<application::LaunchTracker> &launch_tracker = nullptr);
   ~MultiWindowManager();
 
   void apply_window_state_update(const WindowState::List &updated, const WindowState::List &removed) override;
@@ -56,6 +58,7 @@ class MultiWindowManager : public Manager {
   std::weak_ptr<platform::BasePlatform> platform_;
   std::shared_ptr<bridge::AndroidApiStub> android_api_stub_;
   std::shared_ptr<application::Database> app_db_;
+  std::shared_ptr<application::LaunchTracker> launch_tracker_;
   std::map<Task::Id, std::shared_ptr<Window>> windows_;
 };
 }  // namespace wm
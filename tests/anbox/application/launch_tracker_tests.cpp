@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Both includes need to go first as otherwise they can conflict with EGL.h
+// being included by the following includes.
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "anbox/application/database.h"
+#include "anbox/application/launch_tracker.h"
+#include "anbox/bridge/android_api_stub.h"
+#include "anbox/graphics/layer_composer.h"
+#include "anbox/graphics/multi_window_composer_strategy.h"
+#include "anbox/network/message_sender.h"
+#include "anbox/platform/base_platform.h"
+#include "anbox/rpc/channel.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/pending_call_cache.h"
+#include "anbox/wm/multi_window_manager.h"
+#include "anbox/wm/window_state.h"
+
+#include "anbox_rpc.pb.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+using namespace ::testing;
+
+namespace {
+// Stands in for the Android side of the bridge and answers invocations
+// whenever the test asks it to.
+class FakeBridge : public anbox::network::MessageSender {
+ public:
+  FakeBridge(const std::shared_ptr<anbox::rpc::PendingCallCache> &pending_calls)
+      : pending_calls_(pending_calls) {}
+
+  void send(char const *data, size_t length) override {
+    anbox::protobuf::rpc::Invocation invocation;
+    invocation.ParseFromArray(data + anbox::rpc::header_size,
+                              length - anbox::rpc::header_size);
+    std::lock_guard<std::mutex> lock(mutex_);
+    invocations_.push_back(invocation.id());
+  }
+
+  ssize_t send_raw(char const *data, size_t length) override {
+    (void)data;
+    return length;
+  }
+
+  void respond_to_next(const std::string &error = std::string{}) {
+    std::uint32_t id = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ASSERT_FALSE(invocations_.empty());
+      id = invocations_.front();
+      invocations_.pop_front();
+    }
+
+    anbox::protobuf::rpc::Void response;
+    if (!error.empty())
+      response.set_error(error);
+
+    anbox::protobuf::rpc::Result result;
+    result.set_id(id);
+    result.set_response(response.SerializeAsString());
+
+    pending_calls_->populate_message_for_result(result, [&](google::protobuf::MessageLite *message) {
+      message->ParseFromString(result.response());
+    });
+    pending_calls_->complete_response(result);
+  }
+
+ private:
+  std::shared_ptr<anbox::rpc::PendingCallCache> pending_calls_;
+  std::mutex mutex_;
+  std::deque<std::uint32_t> invocations_;
+};
+
+class MockRenderer : public anbox::graphics::Renderer {
+ public:
+  MOCK_METHOD3(draw, bool(EGLNativeWindowType, const anbox::graphics::Rect&,
+                          const RenderableList&));
+};
+
+anbox::android::Intent intent_for(const std::string &package) {
+  anbox::android::Intent intent;
+  intent.package = package;
+  return intent;
+}
+
+anbox::wm::WindowState window_for(const std::string &package, const anbox::wm::Task::Id &task) {
+  return anbox::wm::WindowState{
+      anbox::wm::Display::Id{1},
+      true,
+      anbox::graphics::Rect{0, 0, 1024, 768},
+      package,
+      task,
+      anbox::wm::Stack::Id::Freeform,
+  };
+}
+}  // namespace
+
+namespace anbox {
+namespace application {
+class LaunchTrackerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tracker = std::make_shared<LaunchTracker>();
+    tracker->launch_finished().connect([this](const LaunchTracker::Report &report) {
+      finished.push_back(report);
+    });
+
+    auto pending_calls = std::make_shared<rpc::PendingCallCache>();
+    fake_bridge = std::make_shared<FakeBridge>(pending_calls);
+    stub = std::make_shared<bridge::AndroidApiStub>();
+    stub->set_rpc_channel(std::make_shared<rpc::Channel>(pending_calls, fake_bridge));
+    stub->set_launch_tracker(tracker);
+
+    // The default platform creates dumb windows which are good enough
+    // for the composer to map layers to.
+    platform = platform::create();
+    wm = std::make_shared<wm::MultiWindowManager>(platform, nullptr,
+                                                  std::make_shared<Database>(), tracker);
+
+    renderer = std::make_shared<MockRenderer>();
+    composer = std::make_shared<graphics::LayerComposer>(
+        renderer, std::make_shared<graphics::MultiWindowComposerStrategy>(wm));
+    composer->set_launch_tracker(tracker);
+  }
+
+  void launch(const std::string &package) {
+    stub->launch_async(intent_for(package), graphics::Rect::Invalid, wm::Stack::Id::Freeform,
+                       [](const std::string&) {});
+  }
+
+  std::shared_ptr<LaunchTracker> tracker;
+  std::vector<LaunchTracker::Report> finished;
+  std::shared_ptr<FakeBridge> fake_bridge;
+  std::shared_ptr<bridge::AndroidApiStub> stub;
+  std::shared_ptr<platform::BasePlatform> platform;
+  std::shared_ptr<wm::MultiWindowManager> wm;
+  std::shared_ptr<MockRenderer> renderer;
+  std::shared_ptr<graphics::LayerComposer> composer;
+};
+
+TEST_F(LaunchTrackerTest, FollowsLaunchUntilFirstFrame) {
+  EXPECT_CALL(*renderer, draw(_, _, _)).WillRepeatedly(Return(true));
+
+  launch("org.anbox.test");
+  ASSERT_TRUE(tracker->has_pending_launches());
+
+  fake_bridge->respond_to_next();
+  wm->apply_window_state_update({window_for("org.anbox.test", 3)}, {});
+  ASSERT_TRUE(finished.empty());
+
+  // Layers for other tasks don't finish the launch.
+  composer->submit_layers({{"org.anbox.surface.4", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}}});
+  ASSERT_TRUE(finished.empty());
+
+  composer->submit_layers({{"org.anbox.surface.3", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}}});
+
+  ASSERT_FALSE(tracker->has_pending_launches());
+  ASSERT_EQ(1u, finished.size());
+
+  const auto report = finished[0];
+  ASSERT_EQ("org.anbox.test", report.package);
+  ASSERT_EQ(3, report.task);
+  ASSERT_TRUE(report.error.empty());
+  ASSERT_GE(report.intent_delivered.count(), 0);
+  ASSERT_GE(report.window_created.count(), report.intent_delivered.count());
+  ASSERT_GE(report.first_layer_posted.count(), report.window_created.count());
+  ASSERT_GE(report.first_frame_presented.count(), report.first_layer_posted.count());
+
+  ASSERT_EQ(1u, tracker->reports().size());
+}
+
+TEST_F(LaunchTrackerTest, FailedLaunchIsReported) {
+  launch("org.anbox.test");
+  fake_bridge->respond_to_next("Activity not found");
+
+  ASSERT_FALSE(tracker->has_pending_launches());
+  ASSERT_EQ(1u, finished.size());
+  ASSERT_EQ("Activity not found", finished[0].error);
+  ASSERT_GE(finished[0].intent_delivered.count(), 0);
+  ASSERT_EQ(-1, finished[0].window_created.count());
+  ASSERT_EQ(-1, finished[0].first_frame_presented.count());
+}
+
+TEST_F(LaunchTrackerTest, FrameWhichFailedToDrawDoesNotFinishLaunch) {
+  EXPECT_CALL(*renderer, draw(_, _, _))
+      .WillOnce(Return(false))
+      .WillOnce(Return(true));
+
+  launch("org.anbox.test");
+  fake_bridge->respond_to_next();
+  wm->apply_window_state_update({window_for("org.anbox.test", 1)}, {});
+
+  composer->submit_layers({{"org.anbox.surface.1", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}}});
+  ASSERT_TRUE(finished.empty());
+
+  composer->submit_layers({{"org.anbox.surface.1", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}}});
+  ASSERT_EQ(1u, finished.size());
+  ASSERT_TRUE(finished[0].error.empty());
+}
+
+TEST(LaunchTracker, LaunchWithoutWindowTimesOutOnNextFrame) {
+  LaunchTracker tracker;
+  tracker.launch_requested("org.anbox.test");
+  ASSERT_TRUE(tracker.has_pending_launches());
+
+  // Frames of other windows keep being composed while the launch never
+  // gets one of its own.
+  const auto later = LaunchTracker::Clock::now() + LaunchTracker::launch_timeout;
+  tracker.layer_posted(4, later - std::chrono::seconds{1});
+  ASSERT_TRUE(tracker.has_pending_launches());
+  tracker.layer_posted(4, later);
+  ASSERT_FALSE(tracker.has_pending_launches());
+
+  const auto reports = tracker.reports();
+  ASSERT_EQ(1u, reports.size());
+  ASSERT_FALSE(reports[0].error.empty());
+  ASSERT_EQ(-1, reports[0].window_created.count());
+
+  tracker.launch_requested("org.anbox.test");
+  tracker.frame_presented(4, LaunchTracker::Clock::now() + LaunchTracker::launch_timeout);
+  ASSERT_FALSE(tracker.has_pending_launches());
+  ASSERT_EQ(2u, tracker.reports().size());
+}
+
+TEST(LaunchTracker, LaunchesOfSamePackageAreAssignedToTasksInOrder) {
+  LaunchTracker tracker;
+  const auto first = tracker.launch_requested("org.anbox.test");
+  const auto second = tracker.launch_requested("org.anbox.test");
+
+  tracker.window_state_updated("org.anbox.test", 7);
+  // Further updates for a task we already know about change nothing.
+  tracker.window_state_updated("org.anbox.test", 7);
+  tracker.window_state_updated("org.anbox.test", 8);
+
+  const auto now = LaunchTracker::Clock::now();
+  tracker.layer_posted(8, now);
+  tracker.frame_presented(8, now);
+  tracker.layer_posted(7, now);
+  tracker.frame_presented(7, now);
+
+  const auto reports = tracker.reports();
+  ASSERT_EQ(2u, reports.size());
+  ASSERT_EQ(second, reports[0].id);
+  ASSERT_EQ(8, reports[0].task);
+  ASSERT_EQ(first, reports[1].id);
+  ASSERT_EQ(7, reports[1].task);
+}
+}  // namespace application
+}  // namespace anbox
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/bridge/android_api_stub.h"
+#include "anbox/network/message_sender.h"
+#include "anbox/platform/null/platform.h"
+#include "anbox/rpc/channel.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/pending_call_cache.h"
+
+#include "anbox_bridge.pb.h"
+#include "anbox_rpc.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+// Stands in for the Android side of the bridge. Every invocation sent
+// through it is queued and can then be answered in any order. Events are
+// collected as they arrive.
+class FakeBridge : public anbox::network::MessageSender {
+ public:
+  FakeBridge(const std::shared_ptr<anbox::rpc::PendingCallCache> &pending_calls)
+      : pending_calls_(pending_calls) {}
+
+  void send(char const *data, size_t length) override {
+    if (data[anbox::rpc::header_size - 1] == anbox::rpc::MessageType::response) {
+      anbox::protobuf::rpc::Result result;
+      result.ParseFromArray(data + anbox::rpc::header_size,
+                            length - anbox::rpc::header_size);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (int n = 0; n < result.events_size(); n++) {
+        anbox::protobuf::bridge::EventSequence seq;
+        seq.ParseFromString(result.events(n));
+        events_.push_back(seq);
+      }
+      return;
+    }
+
+    anbox::protobuf::rpc::Invocation invocation;
+    invocation.ParseFromArray(data + anbox::rpc::header_size,
+                              length - anbox::rpc::header_size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    invocations_.push_back(invocation.id());
+    cond_.notify_all();
+  }
+
+  ssize_t send_raw(char const *data, size_t length) override {
+    (void)data;
+    return length;
+  }
+
+  bool wait_for_invocations(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, std::chrono::seconds{5},
+                          [&]() { return invocations_.size() >= count; });
+  }
+
+  std::vector<anbox::protobuf::bridge::EventSequence> events() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return events_;
+  }
+
+  std::uint32_t take_invocation() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto id = invocations_.front();
+    invocations_.pop_front();
+    return id;
+  }
+
+  void respond(std::uint32_t id, const std::string &error = std::string{}) {
+    anbox::protobuf::rpc::Void response;
+    if (!error.empty())
+      response.set_error(error);
+
+    anbox::protobuf::rpc::Result result;
+    result.set_id(id);
+    result.set_response(response.SerializeAsString());
+
+    pending_calls_->populate_message_for_result(result, [&](google::protobuf::MessageLite *message) {
+      message->ParseFromString(result.response());
+    });
+    pending_calls_->complete_response(result);
+  }
+
+ private:
+  std::shared_ptr<anbox::rpc::PendingCallCache> pending_calls_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::uint32_t> invocations_;
+  std::vector<anbox::protobuf::bridge::EventSequence> events_;
+};
+
+// Lets the test decide how much memory pressure the host is under.
+class FakePressureSource : public anbox::common::MemoryPressureMonitor::Source {
+ public:
+  bool read(anbox::common::MemoryPressureMonitor::Sample &sample) override {
+    sample.some_avg10 = some_avg10;
+    sample.full_avg10 = full_avg10;
+    return true;
+  }
+
+  double some_avg10 = 0.0;
+  double full_avg10 = 0.0;
+};
+
+class FakeClipboardSource : public anbox::platform::Clipboard::Source {
+ public:
+  std::string read_text() override { return text; }
+  void write_text(const std::string &t) override { text = t; }
+
+  std::string text;
+};
+
+struct Launch {
+  bool completed = false;
+  std::string error;
+};
+
+anbox::android::Intent intent_for(const std::string &package) {
+  anbox::android::Intent intent;
+  intent.package = package;
+  return intent;
+}
+}  // namespace
+
+namespace anbox {
+namespace bridge {
+class AndroidApiStubTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    pending_calls = std::make_shared<rpc::PendingCallCache>();
+    fake_bridge = std::make_shared<FakeBridge>(pending_calls);
+    stub.set_rpc_channel(std::make_shared<rpc::Channel>(pending_calls, fake_bridge));
+  }
+
+  std::shared_ptr<rpc::PendingCallCache> pending_calls;
+  std::shared_ptr<FakeBridge> fake_bridge;
+  AndroidApiStub stub;
+};
+
+TEST_F(AndroidApiStubTest, AsyncLaunchesAreCompletedWithTheirOwnResult) {
+  const size_t num_launches = 4;
+  std::vector<Launch> launches(num_launches);
+
+  for (size_t n = 0; n < num_launches; n++) {
+    stub.launch_async(intent_for("org.anbox.test"), graphics::Rect::Invalid,
+                      wm::Stack::Id::Default, [&launches, n](const std::string &error) {
+      launches[n].completed = true;
+      launches[n].error = error;
+    });
+  }
+
+  // All launches are on the wire before any of them got answered.
+  ASSERT_TRUE(fake_bridge->wait_for_invocations(num_launches));
+  for (const auto &launch : launches)
+    ASSERT_FALSE(launch.completed);
+
+  std::vector<std::uint32_t> ids;
+  for (size_t n = 0; n < num_launches; n++)
+    ids.push_back(fake_bridge->take_invocation());
+
+  // Answer in reverse order and let one of them fail.
+  fake_bridge->respond(ids[3]);
+  fake_bridge->respond(ids[2], "Activity not found");
+  fake_bridge->respond(ids[1]);
+  fake_bridge->respond(ids[0]);
+
+  for (size_t n = 0; n < num_launches; n++) {
+    ASSERT_TRUE(launches[n].completed);
+    if (n == 2)
+      ASSERT_EQ("Activity not found", launches[n].error);
+    else
+      ASSERT_TRUE(launches[n].error.empty());
+  }
+}
+
+TEST_F(AndroidApiStubTest, ParallelLaunchesCompleteConcurrently) {
+  const size_t num_launches = 8;
+  const auto response_delay = std::chrono::milliseconds{100};
+
+  // The fake bridge takes a while to answer every launch, like Android does
+  // when it has to start an application first.
+  std::vector<std::thread> responders;
+  std::thread responder([&]() {
+    for (size_t n = 0; n < num_launches; n++) {
+      if (!fake_bridge->wait_for_invocations(1))
+        return;
+      const auto id = fake_bridge->take_invocation();
+      responders.push_back(std::thread([this, id, response_delay]() {
+        std::this_thread::sleep_for(response_delay);
+        fake_bridge->respond(id);
+      }));
+    }
+  });
+
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> launchers;
+  // Not std::vector<bool>, its elements share bytes which the launcher
+  // threads would write concurrently.
+  std::vector<char> succeeded(num_launches, 0);
+  for (size_t n = 0; n < num_launches; n++) {
+    launchers.push_back(std::thread([&, n]() {
+      try {
+        stub.launch(intent_for("org.anbox.test"));
+        succeeded[n] = 1;
+      } catch (...) {
+      }
+    }));
+  }
+
+  for (auto &launcher : launchers)
+    launcher.join();
+  responder.join();
+  for (auto &r : responders)
+    r.join();
+
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  for (size_t n = 0; n < num_launches; n++)
+    ASSERT_TRUE(succeeded[n] != 0);
+
+  // Serialized launches would take num_launches * response_delay.
+  ASSERT_LT(elapsed, response_delay * (num_launches / 2));
+}
+
+TEST_F(AndroidApiStubTest, ResetFailsPendingLaunches) {
+  Launch launch;
+  stub.launch_async(intent_for("org.anbox.test"), graphics::Rect::Invalid,
+                    wm::Stack::Id::Default, [&](const std::string &error) {
+    launch.completed = true;
+    launch.error = error;
+  });
+
+  ASSERT_TRUE(fake_bridge->wait_for_invocations(1));
+  ASSERT_FALSE(launch.completed);
+
+  ASSERT_EQ(1u, stub.num_pending_launches());
+
+  stub.reset_rpc_channel();
+  ASSERT_EQ(0u, stub.num_pending_launches());
+  ASSERT_TRUE(launch.completed);
+  ASSERT_FALSE(launch.error.empty());
+
+  // A late answer for the already failed launch is ignored.
+  fake_bridge->respond(fake_bridge->take_invocation());
+}
+
+TEST_F(AndroidApiStubTest, TimedOutLaunchesAreDropped) {
+  stub.launch_timeout = std::chrono::milliseconds{50};
+
+  // Android never answers within the timeout.
+  for (unsigned int n = 0; n < 3; n++)
+    ASSERT_THROW(stub.launch(intent_for("org.anbox.test")), std::runtime_error);
+
+  ASSERT_TRUE(fake_bridge->wait_for_invocations(3));
+  ASSERT_EQ(0u, stub.num_pending_launches());
+
+  // Late answers for the abandoned launches are ignored.
+  for (unsigned int n = 0; n < 3; n++)
+    fake_bridge->respond(fake_bridge->take_invocation());
+  ASSERT_EQ(0u, stub.num_pending_launches());
+}
+
+TEST_F(AndroidApiStubTest, ForwardsMemoryPressureAsEvents) {
+  auto source = std::make_shared<FakePressureSource>();
+  common::MemoryPressureMonitor monitor(source, common::MemoryPressureMonitor::Thresholds{},
+                                        [this](const common::MemoryPressureLevel &level) {
+    stub.set_memory_pressure(level);
+  });
+  monitor.relax_delay = std::chrono::seconds{0};
+
+  source->some_avg10 = 50.0;
+  monitor.check();
+  source->full_avg10 = 50.0;
+  monitor.check();
+  source->some_avg10 = 0.0;
+  source->full_avg10 = 0.0;
+  monitor.check();
+  monitor.check();
+
+  const auto events = fake_bridge->events();
+  ASSERT_EQ(3u, events.size());
+  for (const auto &event : events)
+    ASSERT_TRUE(event.has_memory_pressure());
+  EXPECT_EQ(protobuf::bridge::MemoryPressureEvent::LOW, events[0].memory_pressure().level());
+  EXPECT_EQ(protobuf::bridge::MemoryPressureEvent::CRITICAL, events[1].memory_pressure().level());
+  EXPECT_EQ(protobuf::bridge::MemoryPressureEvent::NONE, events[2].memory_pressure().level());
+}
+
+TEST_F(AndroidApiStubTest, PushesHostClipboardAsEvents) {
+  auto clipboard_source = std::make_shared<FakeClipboardSource>();
+  platform::NullPlatform platform{clipboard_source};
+  platform.set_clipboard_observer([this](const platform::BasePlatform::ClipboardData &data) {
+    stub.set_clipboard_text(data.text);
+  });
+
+  clipboard_source->text = "copied on the host";
+  platform.host_clipboard_changed();
+  // Refreshes which don't find anything new aren't sent again.
+  platform.host_clipboard_changed();
+
+  const auto events = fake_bridge->events();
+  ASSERT_EQ(1u, events.size());
+  ASSERT_TRUE(events[0].has_clipboard_update());
+  EXPECT_EQ("copied on the host", events[0].clipboard_update().text());
+}
+
+TEST(AndroidApiStub, MemoryPressureIsDroppedWithoutChannel) {
+  AndroidApiStub stub;
+  ASSERT_NO_THROW(stub.set_memory_pressure(common::MemoryPressureLevel::Critical));
+}
+
+TEST(AndroidApiStub, LaunchFailsWithoutChannel) {
+  AndroidApiStub stub;
+
+  Launch launch;
+  stub.launch_async(intent_for("org.anbox.test"), graphics::Rect::Invalid,
+                    wm::Stack::Id::Default, [&](const std::string &error) {
+    launch.completed = true;
+    launch.error = error;
+  });
+
+  ASSERT_TRUE(launch.completed);
+  ASSERT_FALSE(launch.error.empty());
+
+  ASSERT_THROW(stub.launch(intent_for("org.anbox.test")), std::runtime_error);
+}
+}  // namespace bridge
+}  // namespace anbox
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/application/database.h"
+#include "anbox/bridge/android_api_stub.h"
+#include "anbox/bridge/traffic_replay.h"
+#include "anbox/network/message_sender.h"
+#include "anbox/platform/null/platform.h"
+#include "anbox/rpc/channel.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/pending_call_cache.h"
+#include "anbox/rpc/traffic_recorder.h"
+#include "anbox/wm/multi_window_manager.h"
+
+#include "anbox_bridge.pb.h"
+#include "anbox_rpc.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const int window_count{8};
+constexpr const int update_count{500};
+
+// Keeps everything it was asked to send.
+class CapturingSender : public anbox::network::MessageSender {
+ public:
+  void send(char const *data, size_t length) override {
+    messages.emplace_back(data, data + length);
+  }
+
+  ssize_t send_raw(char const *data, size_t length) override {
+    (void)data;
+    return length;
+  }
+
+  std::vector<std::vector<std::uint8_t>> messages;
+};
+
+class CountingProcessor : public anbox::network::MessageProcessor {
+ public:
+  bool process_data(const std::vector<std::uint8_t> &data) override {
+    bytes += data.size();
+    return true;
+  }
+
+  std::size_t bytes = 0;
+};
+
+class TemporaryPath {
+ public:
+  TemporaryPath() : path_(fs::temp_directory_path() / fs::unique_path("anbox-test-%%%%-%%%%")) {}
+  ~TemporaryPath() { fs::remove_all(path_); }
+
+  std::string string() const { return path_.string(); }
+
+ private:
+  fs::path path_;
+};
+
+// Moves all windows a bit with every update like Android does while the
+// user drags a window around.
+anbox::protobuf::bridge::EventSequence make_window_state_update(int step) {
+  anbox::protobuf::bridge::EventSequence seq;
+  auto event = seq.mutable_window_state_update();
+  for (int n = 0; n < window_count; n++) {
+    auto window = event->add_windows();
+    window->set_display_id(0);
+    window->set_has_surface(true);
+    window->set_package_name("com.example.application");
+    window->set_frame_left(n * 10 + step);
+    window->set_frame_top(n * 10);
+    window->set_frame_right(n * 10 + step + 640);
+    window->set_frame_bottom(n * 10 + 480);
+    window->set_task_id(n);
+    window->set_stack_id(2);
+  }
+  return seq;
+}
+
+// Records a window state storm as Android would send it over the bridge.
+void record_window_state_storm(const std::string &path) {
+  const auto sender = std::make_shared<CapturingSender>();
+  anbox::rpc::Channel channel(std::make_shared<anbox::rpc::PendingCallCache>(), sender);
+  for (int n = 0; n < update_count; n++)
+    channel.send_event(make_window_state_update(n));
+
+  anbox::rpc::TrafficRecorder recorder(path);
+  for (const auto &message : sender->messages)
+    recorder.record(anbox::rpc::TrafficRecorder::Direction::incoming, message.data(), message.size());
+}
+
+struct ReplaySetup {
+  explicit ReplaySetup(const std::string &launcher_dir)
+      : platform(std::make_shared<anbox::platform::NullPlatform>()),
+        app_db(std::make_shared<anbox::application::Database>(launcher_dir)),
+        window_manager(std::make_shared<anbox::wm::MultiWindowManager>(
+            platform, std::make_shared<anbox::bridge::AndroidApiStub>(), app_db)),
+        replay(platform, window_manager, app_db) {}
+
+  std::shared_ptr<anbox::platform::NullPlatform> platform;
+  std::shared_ptr<anbox::application::Database> app_db;
+  std::shared_ptr<anbox::wm::MultiWindowManager> window_manager;
+  anbox::bridge::TrafficReplay replay;
+};
+}  // namespace
+
+TEST(TrafficRecorder, RecordsBothDirections) {
+  TemporaryPath path;
+  {
+    auto recorder = std::make_shared<anbox::rpc::TrafficRecorder>(path.string());
+    const auto sender = std::make_shared<CapturingSender>();
+    const auto processor = std::make_shared<CountingProcessor>();
+    anbox::rpc::RecordingMessageSender recording_sender(sender, recorder);
+    anbox::rpc::RecordingMessageProcessor recording_processor(processor, recorder);
+
+    recording_processor.process_data({1, 2, 3});
+    recording_sender.send("abcd", 4);
+
+    ASSERT_EQ(3u, processor->bytes);
+    ASSERT_EQ(1u, sender->messages.size());
+  }
+
+  const auto records = anbox::rpc::TrafficRecorder::read(path.string());
+  ASSERT_EQ(2u, records.size());
+  ASSERT_EQ(anbox::rpc::TrafficRecorder::Direction::incoming, records[0].direction);
+  ASSERT_EQ(std::vector<std::uint8_t>({1, 2, 3}), records[0].data);
+  ASSERT_EQ(anbox::rpc::TrafficRecorder::Direction::outgoing, records[1].direction);
+  ASSERT_EQ(std::vector<std::uint8_t>({'a', 'b', 'c', 'd'}), records[1].data);
+  ASSERT_LE(records[0].timestamp, records[1].timestamp);
+}
+
+TEST(TrafficRecorder, RejectsTruncatedRecordings) {
+  TemporaryPath path;
+  {
+    anbox::rpc::TrafficRecorder recorder(path.string());
+    const std::uint8_t data[] = {1, 2, 3, 4};
+    recorder.record(anbox::rpc::TrafficRecorder::Direction::incoming, data, sizeof(data));
+  }
+
+  fs::resize_file(path.string(), fs::file_size(path.string()) - 1);
+  ASSERT_THROW(anbox::rpc::TrafficRecorder::read(path.string()), std::runtime_error);
+
+  std::ofstream(path.string()) << "garbage";
+  ASSERT_THROW(anbox::rpc::TrafficRecorder::read(path.string()), std::runtime_error);
+}
+
+TEST(TrafficReplay, IgnoresResponsesForUnknownCalls) {
+  TemporaryPath recording;
+  TemporaryPath launcher_dir;
+
+  anbox::protobuf::rpc::Result result;
+  result.set_id(42);
+  const auto size = result.ByteSize();
+  std::vector<std::uint8_t> message = {
+      0, 0, static_cast<std::uint8_t>(size), anbox::rpc::MessageType::response};
+  message.resize(message.size() + size);
+  result.SerializeWithCachedSizesToArray(message.data() + anbox::rpc::header_size);
+
+  {
+    anbox::rpc::TrafficRecorder recorder(recording.string());
+    recorder.record(anbox::rpc::TrafficRecorder::Direction::incoming, message.data(), message.size());
+  }
+
+  ReplaySetup setup(launcher_dir.string());
+  const auto stats = setup.replay.run(anbox::rpc::TrafficRecorder::read(recording.string()),
+                                      anbox::bridge::TrafficReplay::Speed::maximum);
+  ASSERT_EQ(1u, stats.records);
+}
+
+TEST(TrafficReplay, ReplaysWindowStateStorm) {
+  TemporaryPath recording;
+  TemporaryPath launcher_dir;
+  record_window_state_storm(recording.string());
+
+  const auto records = anbox::rpc::TrafficRecorder::read(recording.string());
+  ASSERT_EQ(static_cast<std::size_t>(update_count), records.size());
+
+  ReplaySetup setup(launcher_dir.string());
+  const auto stats = setup.replay.run(records, anbox::bridge::TrafficReplay::Speed::maximum);
+
+  ASSERT_EQ(records.size(), stats.records);
+  for (int n = 0; n < window_count; n++)
+    ASSERT_NE(nullptr, setup.window_manager->find_window_for_task(n));
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/lock_free_channel.h"
+#include "anbox/graphics/buffer_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace common {
+TEST(LockFreeChannel, RoundsUpCapacity) {
+  LockFreeChannel<int> channel(5);
+  ASSERT_EQ(8, channel.capacity());
+}
+
+TEST(LockFreeChannel, TryPushAndPop) {
+  LockFreeChannel<int> channel(2);
+  int value = 0;
+  EXPECT_EQ(-EAGAIN, channel.try_pop(&value));
+  EXPECT_TRUE(channel.empty());
+
+  EXPECT_EQ(0, channel.try_push(1));
+  EXPECT_EQ(0, channel.try_push(2));
+  EXPECT_EQ(-EAGAIN, channel.try_push(3));
+  EXPECT_FALSE(channel.empty());
+
+  EXPECT_EQ(0, channel.try_pop(&value));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(0, channel.try_pop(&value));
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(-EAGAIN, channel.try_pop(&value));
+}
+
+TEST(LockFreeChannel, ItemIsNotMovedOnFailure) {
+  LockFreeChannel<std::string> channel(2);
+  EXPECT_EQ(0, channel.try_push(std::string("Hello")));
+  EXPECT_EQ(0, channel.try_push(std::string("World")));
+
+  std::string item("You Shall Not Move");
+  EXPECT_EQ(-EAGAIN, channel.try_push(std::move(item)));
+  EXPECT_EQ("You Shall Not Move", item);
+}
+
+TEST(LockFreeChannel, ClosedChannelCanBeDrained) {
+  LockFreeChannel<int> channel(4);
+  EXPECT_EQ(0, channel.push(1));
+  channel.close();
+  EXPECT_TRUE(channel.is_closed());
+  EXPECT_EQ(-EIO, channel.push(2));
+
+  int value = 0;
+  EXPECT_EQ(0, channel.pop(&value));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(-EIO, channel.pop(&value));
+  EXPECT_EQ(-EIO, channel.try_pop(&value));
+}
+
+TEST(LockFreeChannel, CloseWakesUpBlockedThreads) {
+  LockFreeChannel<int> empty(2);
+  LockFreeChannel<int> full(2);
+  EXPECT_EQ(0, full.push(1));
+  EXPECT_EQ(0, full.push(2));
+
+  int pop_result = 0, push_result = 0;
+  std::thread popper([&]() {
+    int value;
+    pop_result = empty.pop(&value);
+  });
+  std::thread pusher([&]() { push_result = full.push(3); });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  empty.close();
+  full.close();
+  popper.join();
+  pusher.join();
+
+  EXPECT_EQ(-EIO, pop_result);
+  EXPECT_EQ(-EIO, push_result);
+}
+
+TEST(LockFreeChannel, BlockingPopIsWokenUpByPush) {
+  LockFreeChannel<int> channel(2);
+  int value = 0;
+  std::thread consumer([&]() { channel.pop(&value); });
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  EXPECT_EQ(0, channel.push(42));
+  consumer.join();
+  EXPECT_EQ(42, value);
+}
+
+// Many producers and consumers hammer a small channel. Every item has to
+// arrive exactly once.
+TEST(LockFreeChannel, MultipleProducersAndConsumers) {
+  const int num_producers = 4;
+  const int num_consumers = 4;
+  const int items_per_producer = 200000;
+
+  LockFreeChannel<std::uint64_t> channel(8);
+  std::vector<std::uint64_t> sums(num_consumers, 0);
+  std::vector<std::uint64_t> counts(num_consumers, 0);
+
+  std::vector<std::thread> consumers;
+  for (int n = 0; n < num_consumers; n++) {
+    consumers.emplace_back([&, n]() {
+      std::uint64_t value = 0;
+      while (channel.pop(&value) == 0) {
+        sums[n] += value;
+        counts[n]++;
+      }
+    });
+  }
+
+  std::vector<std::thread> producers;
+  for (int n = 0; n < num_producers; n++) {
+    producers.emplace_back([&]() {
+      for (int i = 1; i <= items_per_producer; i++)
+        ASSERT_EQ(0, channel.push(static_cast<std::uint64_t>(i)));
+    });
+  }
+
+  for (auto &t : producers)
+    t.join();
+  channel.close();
+  for (auto &t : consumers)
+    t.join();
+
+  std::uint64_t total_sum = 0, total_count = 0;
+  for (int n = 0; n < num_consumers; n++) {
+    total_sum += sums[n];
+    total_count += counts[n];
+  }
+
+  const std::uint64_t expected_sum =
+      num_producers * (static_cast<std::uint64_t>(items_per_producer) * (items_per_producer + 1) / 2);
+  EXPECT_EQ(static_cast<std::uint64_t>(num_producers * items_per_producer), total_count);
+  EXPECT_EQ(expected_sum, total_sum);
+}
+
+namespace {
+// The mutex and condition variable based ring MessageChannel used before it
+// was moved on top of LockFreeChannel. Only kept as reference for the
+// benchmark below.
+template <typename T>
+class MutexChannel {
+ public:
+  explicit MutexChannel(size_t capacity) : capacity_(capacity), items_(new T[capacity]) {}
+
+  void push(T &&item) {
+    std::unique_lock<std::mutex> l(lock_);
+    while (count_ >= capacity_)
+      can_write_.wait(l);
+    auto pos = pos_ + count_;
+    if (pos >= capacity_)
+      pos -= capacity_;
+    items_[pos] = std::move(item);
+    count_++;
+    can_read_.notify_one();
+  }
+
+  void pop(T *item) {
+    std::unique_lock<std::mutex> l(lock_);
+    while (count_ == 0)
+      can_read_.wait(l);
+    *item = std::move(items_[pos_]);
+    if (++pos_ == capacity_)
+      pos_ = 0U;
+    count_--;
+    can_write_.notify_one();
+  }
+
+ private:
+  size_t pos_ = 0;
+  size_t count_ = 0;
+  size_t capacity_;
+  std::unique_ptr<T[]> items_;
+  std::mutex lock_;
+  std::condition_variable can_read_;
+  std::condition_variable can_write_;
+};
+
+std::chrono::milliseconds run_benchmark(int num_producers, int num_consumers,
+                                        const std::function<void()> &produce,
+                                        const std::function<void()> &consume) {
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int n = 0; n < num_producers; n++)
+    threads.emplace_back(produce);
+  for (int n = 0; n < num_consumers; n++)
+    threads.emplace_back(consume);
+  for (auto &t : threads)
+    t.join();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+}  // namespace
+
+// Compares the throughput of the channel with the previous mutex and
+// condition variable based implementation when many threads contend on it.
+TEST(LockFreeChannel, ContentionBenchmark) {
+  const int num_threads = std::max(2U, std::thread::hardware_concurrency());
+  const int items_per_thread = 100000;
+  const size_t capacity = 64;
+
+  LockFreeChannel<graphics::Buffer> channel(capacity);
+  const auto channel_duration = run_benchmark(
+      num_threads, num_threads,
+      [&]() {
+        for (int n = 0; n < items_per_thread; n++)
+          channel.push(graphics::Buffer{"Hello"});
+      },
+      [&]() {
+        graphics::Buffer buffer;
+        for (int n = 0; n < items_per_thread; n++)
+          channel.pop(&buffer);
+      });
+
+  MutexChannel<graphics::Buffer> mutex_channel(capacity);
+  const auto mutex_channel_duration = run_benchmark(
+      num_threads, num_threads,
+      [&]() {
+        for (int n = 0; n < items_per_thread; n++)
+          mutex_channel.push(graphics::Buffer{"Hello"});
+      },
+      [&]() {
+        graphics::Buffer buffer;
+        for (int n = 0; n < items_per_thread; n++)
+          mutex_channel.pop(&buffer);
+      });
+
+  std::cout << num_threads << " producers/" << num_threads << " consumers, "
+            << num_threads * items_per_thread << " items" << std::endl
+            << "LockFreeChannel: " << channel_duration.count() << "ms" << std::endl
+            << "MutexChannel:    " << mutex_channel_duration.count() << "ms" << std::endl;
+
+  EXPECT_TRUE(channel.empty());
+}
+
+// Single producer and consumer as used by the BufferedIOStream which was
+// based on graphics::BufferQueue before.
+TEST(LockFreeChannel, SingleProducerSingleConsumerBenchmark) {
+  const int num_items = 500000;
+  const size_t capacity = 16;
+
+  LockFreeChannel<graphics::Buffer> channel(capacity);
+  const auto channel_duration = run_benchmark(
+      1, 1,
+      [&]() {
+        for (int n = 0; n < num_items; n++)
+          channel.push(graphics::Buffer{"Hello"});
+      },
+      [&]() {
+        graphics::Buffer buffer;
+        for (int n = 0; n < num_items; n++)
+          channel.pop(&buffer);
+      });
+
+  graphics::BufferQueue queue(capacity);
+  std::mutex lock;
+  const auto queue_duration = run_benchmark(
+      1, 1,
+      [&]() {
+        for (int n = 0; n < num_items; n++) {
+          std::unique_lock<std::mutex> l(lock);
+          queue.push_locked(graphics::Buffer{"Hello"}, l);
+        }
+      },
+      [&]() {
+        graphics::Buffer buffer;
+        for (int n = 0; n < num_items; n++) {
+          std::unique_lock<std::mutex> l(lock);
+          queue.pop_locked(&buffer, l);
+        }
+      });
+
+  std::cout << num_items << " items" << std::endl
+            << "LockFreeChannel: " << channel_duration.count() << "ms" << std::endl
+            << "BufferQueue:     " << queue_duration.count() << "ms" << std::endl;
+
+  EXPECT_TRUE(channel.empty());
+}
+}  // namespace common
+}  // namespace anbox
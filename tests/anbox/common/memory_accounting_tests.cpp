@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/memory_accounting.h"
+#include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/network/message_sender.h"
+#include "anbox/network/socket_messenger.h"
+#include "anbox/platform/sdl/audio_sink.h"
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/message_processor.h"
+#include "anbox/rpc/pending_call_cache.h"
+
+#include "anbox_rpc.pb.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using anbox::common::MemoryAccounting;
+
+namespace {
+// Holds memory the same way a connection does: some of it in its
+// own buffers and some in the stream queues feeding it.
+class SyntheticConnection {
+ public:
+  SyntheticConnection(const std::shared_ptr<MemoryAccounting> &accounting, const std::string &name)
+      : buffers_{MemoryAccounting::Subsystem::RenderThreadBuffers, name, accounting},
+        queues_{MemoryAccounting::Subsystem::StreamQueues, name, accounting} {}
+
+  void resize_buffer(std::size_t size) { buffers_.set(size); }
+  void queue(std::size_t size) { queues_.add(size); }
+  void dequeue(std::size_t size) { queues_.remove(size); }
+
+ private:
+  MemoryAccounting::Account buffers_;
+  MemoryAccounting::Account queues_;
+};
+
+class NullSender : public anbox::network::MessageSender {
+ public:
+  void send(char const *data, size_t length) override {
+    (void)data;
+    (void)length;
+  }
+
+  ssize_t send_raw(char const *data, size_t length) override {
+    (void)data;
+    return length;
+  }
+};
+
+class NullSocketMessenger : public anbox::network::SocketMessenger {
+ public:
+  anbox::network::Credentials creds() const override { return {0, 0, 0}; }
+  unsigned short local_port() const override { return 0; }
+  void set_no_delay() override {}
+  void close() override {}
+  void send_file(int, off_t, size_t) override {}
+
+  void send(char const *, size_t) override {}
+  ssize_t send_raw(char const *, size_t length) override { return length; }
+
+  void async_receive_msg(AnboxReadHandler const &, boost::asio::mutable_buffers_1 const &) override {}
+  boost::system::error_code receive_msg(boost::asio::mutable_buffers_1 const &) override {
+    return boost::system::error_code{};
+  }
+  size_t available_bytes() override { return 0; }
+};
+
+MemoryAccounting::SubsystemUsage usage_of(const MemoryAccounting &accounting, MemoryAccounting::Subsystem subsystem) {
+  for (const auto &usage : accounting.subsystems()) {
+    if (usage.subsystem == subsystem)
+      return usage;
+  }
+  return {subsystem, 0, 0, 0};
+}
+
+std::size_t bytes_of(const MemoryAccounting &accounting, MemoryAccounting::Subsystem subsystem,
+                     const std::string &owner) {
+  for (const auto &account : accounting.accounts()) {
+    if (account.subsystem == subsystem && account.owner == owner)
+      return account.bytes;
+  }
+  return 0;
+}
+}  // namespace
+
+TEST(MemoryAccounting, AttributesMemoryToSubsystemsAndConnections) {
+  auto accounting = std::make_shared<MemoryAccounting>();
+
+  SyntheticConnection first(accounting, "gles-0");
+  SyntheticConnection second(accounting, "gles-1");
+
+  first.resize_buffer(4096);
+  second.resize_buffer(8192);
+  first.queue(100);
+  first.queue(200);
+  second.queue(50);
+  first.dequeue(100);
+
+  ASSERT_EQ(4096u, bytes_of(*accounting, MemoryAccounting::Subsystem::RenderThreadBuffers, "gles-0"));
+  ASSERT_EQ(8192u, bytes_of(*accounting, MemoryAccounting::Subsystem::RenderThreadBuffers, "gles-1"));
+  ASSERT_EQ(200u, bytes_of(*accounting, MemoryAccounting::Subsystem::StreamQueues, "gles-0"));
+  ASSERT_EQ(50u, bytes_of(*accounting, MemoryAccounting::Subsystem::StreamQueues, "gles-1"));
+
+  const auto buffers = usage_of(*accounting, MemoryAccounting::Subsystem::RenderThreadBuffers);
+  ASSERT_EQ(4096u + 8192u, buffers.bytes);
+  ASSERT_EQ(8192u, buffers.peak);
+  ASSERT_EQ(2u, buffers.accounts);
+
+  const auto queues = usage_of(*accounting, MemoryAccounting::Subsystem::StreamQueues);
+  ASSERT_EQ(250u, queues.bytes);
+  ASSERT_EQ(300u, queues.peak);
+
+  ASSERT_EQ(0u, usage_of(*accounting, MemoryAccounting::Subsystem::AudioQueues).accounts);
+  ASSERT_EQ(4096u + 8192u + 250u, accounting->total());
+}
+
+TEST(MemoryAccounting, ClosedConnectionsReleaseTheirMemory) {
+  auto accounting = std::make_shared<MemoryAccounting>();
+
+  SyntheticConnection remaining(accounting, "gles-0");
+  remaining.resize_buffer(1024);
+  {
+    SyntheticConnection closed(accounting, "gles-1");
+    closed.resize_buffer(1024 * 1024);
+    closed.queue(512);
+    ASSERT_EQ(1024u + 1024u * 1024u + 512u, accounting->total());
+  }
+
+  ASSERT_EQ(1024u, accounting->total());
+  ASSERT_EQ(2u, accounting->accounts().size());
+}
+
+TEST(MemoryAccounting, DumpListsSubsystemsAndOwners) {
+  auto accounting = std::make_shared<MemoryAccounting>();
+
+  SyntheticConnection connection(accounting, "gles-7");
+  connection.resize_buffer(4096);
+
+  const auto dump = accounting->dump();
+  for (std::size_t n = 0; n < MemoryAccounting::num_subsystems; n++)
+    ASSERT_NE(std::string::npos, dump.find(MemoryAccounting::name(static_cast<MemoryAccounting::Subsystem>(n))));
+  ASSERT_NE(std::string::npos, dump.find("render-thread-buffers gles-7: 4096 bytes"));
+  ASSERT_NE(std::string::npos, dump.find("total: 4096 bytes"));
+}
+
+TEST(MemoryAccounting, ConcurrentUpdatesBalance) {
+  auto accounting = std::make_shared<MemoryAccounting>();
+  MemoryAccounting::Account account{MemoryAccounting::Subsystem::StreamQueues, "gles-0", accounting};
+
+  std::vector<std::thread> threads;
+  for (int n = 0; n < 4; n++) {
+    threads.emplace_back([&]() {
+      for (int m = 0; m < 10000; m++) {
+        account.add(64);
+        account.remove(64);
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  ASSERT_EQ(0u, account.bytes());
+  ASSERT_GE(account.peak(), 64u);
+  ASSERT_LE(account.peak(), 4u * 64u);
+}
+
+TEST(MemoryAccounting, NextOwnerCountsPerPrefix) {
+  const auto first = MemoryAccounting::next_owner("memory-accounting-test");
+  const auto second = MemoryAccounting::next_owner("memory-accounting-test");
+  ASSERT_EQ("memory-accounting-test-0", first);
+  ASSERT_EQ("memory-accounting-test-1", second);
+}
+
+TEST(MemoryAccounting, RpcConnectionAccountsItsBuffers) {
+  const auto accounting = MemoryAccounting::global();
+  const auto before = usage_of(*accounting, MemoryAccounting::Subsystem::RpcMessages);
+
+  anbox::protobuf::rpc::Invocation invocation;
+  invocation.set_id(1);
+  invocation.set_method_name("synthetic");
+  invocation.set_parameters(std::string(64 * 1024, 'a'));
+  invocation.set_protocol_version(1);
+  const auto size = invocation.ByteSize();
+
+  std::vector<std::uint8_t> message = {
+      static_cast<std::uint8_t>((size >> 16) & 0xff),
+      static_cast<std::uint8_t>((size >> 8) & 0xff),
+      static_cast<std::uint8_t>(size & 0xff),
+      anbox::rpc::MessageType::invocation};
+  message.resize(message.size() + size);
+  invocation.SerializeWithCachedSizesToArray(message.data() + anbox::rpc::header_size);
+
+  {
+    anbox::rpc::MessageProcessor processor(std::make_shared<NullSender>(),
+                                           std::make_shared<anbox::rpc::PendingCallCache>());
+    // Only deliver the first half so the message has to stay buffered.
+    processor.process_data(std::vector<std::uint8_t>(message.begin(), message.begin() + message.size() / 2));
+
+    const auto during = usage_of(*accounting, MemoryAccounting::Subsystem::RpcMessages);
+    ASSERT_EQ(before.accounts + 1, during.accounts);
+    ASSERT_GE(during.bytes - before.bytes, message.size() / 2);
+  }
+
+  const auto after = usage_of(*accounting, MemoryAccounting::Subsystem::RpcMessages);
+  ASSERT_EQ(before.accounts, after.accounts);
+  ASSERT_EQ(before.bytes, after.bytes);
+}
+
+TEST(MemoryAccounting, StreamReleasesSmallChunksOnce) {
+  const auto accounting = MemoryAccounting::global();
+  const auto before = usage_of(*accounting, MemoryAccounting::Subsystem::StreamQueues);
+
+  anbox::graphics::BufferedIOStream stream(std::make_shared<NullSocketMessenger>());
+  const std::vector<char> chunk(64, 'a');
+  std::vector<char> data(1024);
+  for (int round = 0; round < 3; round++) {
+    for (int n = 0; n < 4; n++)
+      stream.post_data(chunk.data(), chunk.size());
+
+    // Asking for more than is queued ends every read on an empty queue
+    // with the last small chunk still in hand.
+    size_t size = data.size();
+    ASSERT_NE(nullptr, stream.read(data.data(), &size));
+    ASSERT_EQ(4 * chunk.size(), size);
+    ASSERT_EQ(before.bytes, usage_of(*accounting, MemoryAccounting::Subsystem::StreamQueues).bytes);
+  }
+}
+
+TEST(MemoryAccounting, AudioSinkReleasesSmallChunksOnce) {
+  ::setenv("SDL_AUDIODRIVER", "dummy", 1);
+  ASSERT_EQ(0, SDL_InitSubSystem(SDL_INIT_AUDIO));
+
+  const auto accounting = MemoryAccounting::global();
+  const auto before = usage_of(*accounting, MemoryAccounting::Subsystem::AudioQueues);
+  const auto queued = [&]() {
+    return usage_of(*accounting, MemoryAccounting::Subsystem::AudioQueues).bytes - before.bytes;
+  };
+
+  anbox::platform::sdl::AudioSink sink;
+  for (int round = 0; round < 3; round++) {
+    // Far less than SDL asks for with every callback, so each one drains
+    // the queue and the next one starts with a consumed small chunk.
+    for (int n = 0; n < 4; n++)
+      sink.write_data(std::vector<std::uint8_t>(64, 0));
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (queued() != 0 && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    ASSERT_EQ(0u, queued());
+
+    // Let a few more callbacks run on the empty queue.
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    ASSERT_EQ(0u, queued());
+  }
+
+  // Closes the device so the callback doesn't outlive the sink.
+  SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
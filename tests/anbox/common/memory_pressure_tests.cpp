@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/memory_pressure.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+namespace anbox {
+namespace common {
+namespace {
+// Hands out whatever pressure the test sets.
+class FakeSource : public MemoryPressureMonitor::Source {
+ public:
+  bool read(MemoryPressureMonitor::Sample &sample) override {
+    if (fail)
+      return false;
+    sample = this->sample;
+    reads++;
+    return true;
+  }
+
+  void set(double some, double full = 0.0) {
+    sample.some_avg10 = some;
+    sample.full_avg10 = full;
+  }
+
+  MemoryPressureMonitor::Sample sample;
+  bool fail = false;
+  int reads = 0;
+};
+
+struct Reports {
+  MemoryPressureMonitor::Handler handler() {
+    return [this](const MemoryPressureLevel &level) { levels.push_back(level); };
+  }
+  std::vector<MemoryPressureLevel> levels;
+};
+
+constexpr const char *system_pressure{
+  "some avg10=12.50 avg60=3.00 avg300=0.50 total=123456\n"
+  "full avg10=1.25 avg60=0.20 avg300=0.00 total=2345\n"};
+}  // namespace
+
+TEST(MemoryPressure, ParsesPsiFile) {
+  MemoryPressureMonitor::Sample sample;
+  ASSERT_TRUE(MemoryPressureMonitor::PsiSource::parse(system_pressure, sample));
+  EXPECT_DOUBLE_EQ(12.5, sample.some_avg10);
+  EXPECT_DOUBLE_EQ(1.25, sample.full_avg10);
+
+  // Some kernels only have the some line.
+  ASSERT_TRUE(MemoryPressureMonitor::PsiSource::parse("some avg10=0.30 avg60=0.10 avg300=0.00 total=12\n", sample));
+  EXPECT_DOUBLE_EQ(0.3, sample.some_avg10);
+  EXPECT_DOUBLE_EQ(0.0, sample.full_avg10);
+
+  EXPECT_FALSE(MemoryPressureMonitor::PsiSource::parse("", sample));
+  EXPECT_FALSE(MemoryPressureMonitor::PsiSource::parse("full avg10=1.00 avg60=0.00 avg300=0.00 total=1\n", sample));
+  EXPECT_FALSE(MemoryPressureMonitor::PsiSource::parse("some avg10=lots avg60=0.00\n", sample));
+  EXPECT_FALSE(MemoryPressureMonitor::PsiSource::parse("some avg60=0.00 avg300=0.00\n", sample));
+}
+
+TEST(MemoryPressure, ReadsPsiFileFromDisk) {
+  const auto path = fs::temp_directory_path() / fs::unique_path("memory.pressure-%%%%%%");
+  {
+    std::ofstream out(path.string());
+    out << system_pressure;
+  }
+
+  MemoryPressureMonitor::PsiSource source(path.string());
+  MemoryPressureMonitor::Sample sample;
+  ASSERT_TRUE(source.read(sample));
+  EXPECT_DOUBLE_EQ(12.5, sample.some_avg10);
+
+  fs::remove(path);
+  EXPECT_FALSE(source.read(sample));
+}
+
+TEST(MemoryPressure, ParsesThresholds) {
+  const auto thresholds = MemoryPressureMonitor::Thresholds::parse("moderate=5,low=20.5,critical=2");
+  EXPECT_DOUBLE_EQ(5.0, thresholds.moderate);
+  EXPECT_DOUBLE_EQ(20.5, thresholds.low);
+  EXPECT_DOUBLE_EQ(2.0, thresholds.critical);
+
+  const auto defaults = MemoryPressureMonitor::Thresholds::parse("");
+  EXPECT_DOUBLE_EQ(MemoryPressureMonitor::Thresholds{}.moderate, defaults.moderate);
+
+  EXPECT_THROW(MemoryPressureMonitor::Thresholds::parse("moderate"), std::runtime_error);
+  EXPECT_THROW(MemoryPressureMonitor::Thresholds::parse("moderate=high"), std::runtime_error);
+  EXPECT_THROW(MemoryPressureMonitor::Thresholds::parse("low=101"), std::runtime_error);
+  EXPECT_THROW(MemoryPressureMonitor::Thresholds::parse("swap=10"), std::runtime_error);
+  EXPECT_THROW(MemoryPressureMonitor::Thresholds::parse("moderate=40,low=20"), std::runtime_error);
+}
+
+TEST(MemoryPressure, ReportsRisingPressureRightAway) {
+  auto source = std::make_shared<FakeSource>();
+  Reports reports;
+  MemoryPressureMonitor monitor(source, MemoryPressureMonitor::Thresholds{}, reports.handler());
+
+  const auto start = MemoryPressureMonitor::Clock::now();
+  source->set(1.0);
+  ASSERT_TRUE(monitor.check(start));
+  EXPECT_TRUE(reports.levels.empty());
+
+  source->set(15.0);
+  monitor.check(start + std::chrono::seconds{1});
+  source->set(40.0);
+  monitor.check(start + std::chrono::seconds{2});
+  source->set(40.0, 8.0);
+  monitor.check(start + std::chrono::seconds{3});
+
+  EXPECT_EQ((std::vector<MemoryPressureLevel>{MemoryPressureLevel::Moderate,
+                                              MemoryPressureLevel::Low,
+                                              MemoryPressureLevel::Critical}),
+            reports.levels);
+  EXPECT_EQ(MemoryPressureLevel::Critical, monitor.level());
+}
+
+TEST(MemoryPressure, RelaxesOnlyAfterPressureStayedLow) {
+  auto source = std::make_shared<FakeSource>();
+  Reports reports;
+  MemoryPressureMonitor monitor(source, MemoryPressureMonitor::Thresholds{}, reports.handler());
+  monitor.relax_delay = std::chrono::seconds{10};
+
+  const auto start = MemoryPressureMonitor::Clock::now();
+  source->set(40.0);
+  monitor.check(start);
+
+  // A short dip doesn't change anything.
+  source->set(0.0);
+  monitor.check(start + std::chrono::seconds{1});
+  source->set(40.0);
+  monitor.check(start + std::chrono::seconds{2});
+  source->set(0.0);
+  monitor.check(start + std::chrono::seconds{3});
+  monitor.check(start + std::chrono::seconds{12});
+  EXPECT_EQ(MemoryPressureLevel::Low, monitor.level());
+  EXPECT_EQ(1u, reports.levels.size());
+
+  monitor.check(start + std::chrono::seconds{13});
+  EXPECT_EQ(MemoryPressureLevel::None, monitor.level());
+  EXPECT_EQ((std::vector<MemoryPressureLevel>{MemoryPressureLevel::Low, MemoryPressureLevel::None}),
+            reports.levels);
+}
+
+TEST(MemoryPressure, RepeatsElevatedLevel) {
+  auto source = std::make_shared<FakeSource>();
+  Reports reports;
+  MemoryPressureMonitor monitor(source, MemoryPressureMonitor::Thresholds{}, reports.handler());
+  monitor.repeat_interval = std::chrono::seconds{30};
+
+  const auto start = MemoryPressureMonitor::Clock::now();
+  source->set(15.0);
+  for (int n = 0; n <= 60; n++)
+    monitor.check(start + std::chrono::seconds{n});
+
+  EXPECT_EQ(3u, reports.levels.size());
+  for (const auto &level : reports.levels)
+    EXPECT_EQ(MemoryPressureLevel::Moderate, level);
+
+  // Nothing is repeated without pressure.
+  Reports quiet;
+  source->set(0.0);
+  MemoryPressureMonitor idle(source, MemoryPressureMonitor::Thresholds{}, quiet.handler());
+  for (int n = 0; n <= 60; n++)
+    idle.check(start + std::chrono::seconds{n});
+  EXPECT_TRUE(quiet.levels.empty());
+}
+
+TEST(MemoryPressure, FailingSourceKeepsLevel) {
+  auto source = std::make_shared<FakeSource>();
+  Reports reports;
+  MemoryPressureMonitor monitor(source, MemoryPressureMonitor::Thresholds{}, reports.handler());
+
+  source->set(40.0);
+  monitor.check();
+  source->fail = true;
+  EXPECT_FALSE(monitor.check());
+  EXPECT_EQ(MemoryPressureLevel::Low, monitor.level());
+}
+
+TEST(MemoryPressure, ChecksPeriodicallyOnService) {
+  auto source = std::make_shared<FakeSource>();
+  source->set(15.0);
+  Reports reports;
+  auto monitor = std::make_shared<MemoryPressureMonitor>(source, MemoryPressureMonitor::Thresholds{}, reports.handler());
+
+  boost::asio::io_service service;
+  monitor->start(service, std::chrono::milliseconds{10});
+  // The service runs until the monitor stopped its timer.
+  std::thread runner([&]() { service.run(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  monitor->stop();
+  runner.join();
+
+  EXPECT_GE(source->reads, 3);
+  ASSERT_FALSE(reports.levels.empty());
+  EXPECT_EQ(MemoryPressureLevel::Moderate, reports.levels.front());
+}
+}  // namespace common
+}  // namespace anbox
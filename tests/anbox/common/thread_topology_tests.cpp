@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/thread_topology.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace anbox {
+namespace common {
+TEST(ThreadTopology, DefaultPolicies) {
+  ThreadTopology topology;
+  EXPECT_LT(topology.policy(ThreadClass::Audio).nice, topology.policy(ThreadClass::Render).nice);
+  EXPECT_LT(topology.policy(ThreadClass::Compositor).nice, topology.policy(ThreadClass::Render).nice);
+  EXPECT_GT(topology.policy(ThreadClass::Background).nice, topology.policy(ThreadClass::Render).nice);
+  EXPECT_TRUE(topology.policy(ThreadClass::Render).cpus.empty());
+}
+
+TEST(ThreadTopology, ParsesSpecification) {
+  ThreadTopology topology;
+  topology.configure("audio:scheduler=fifo:priority=10:cpus=2-3,6;background:nice=15");
+
+  const auto audio = topology.policy(ThreadClass::Audio);
+  EXPECT_EQ(ThreadPolicy::Scheduler::FIFO, audio.scheduler);
+  EXPECT_EQ(10, audio.priority);
+  EXPECT_EQ((std::vector<unsigned int>{2, 3, 6}), audio.cpus);
+
+  const auto background = topology.policy(ThreadClass::Background);
+  EXPECT_EQ(ThreadPolicy::Scheduler::Other, background.scheduler);
+  EXPECT_EQ(15, background.nice);
+}
+
+TEST(ThreadTopology, RejectsMalformedSpecification) {
+  ThreadTopology topology;
+  const auto before = topology.policy(ThreadClass::Render).nice;
+
+  EXPECT_THROW(topology.configure("gpu:nice=1"), std::runtime_error);
+  EXPECT_THROW(topology.configure("render:nice"), std::runtime_error);
+  EXPECT_THROW(topology.configure("render:nice=high"), std::runtime_error);
+  EXPECT_THROW(topology.configure("render:scheduler=deadline"), std::runtime_error);
+  EXPECT_THROW(topology.configure("render:cpus=3-1"), std::runtime_error);
+  EXPECT_THROW(topology.configure("render:nice=3;io:color=red"), std::runtime_error);
+
+  // A failed configuration must not leave half applied policies behind.
+  EXPECT_EQ(before, topology.policy(ThreadClass::Render).nice);
+}
+
+TEST(ThreadTopology, AppliesPolicyToThread) {
+  ThreadTopology topology;
+
+  // Raising the nice value needs no privileges, whatever we inherited. We
+  // can only pin to a CPU the process is allowed to run on.
+  const auto current_nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  unsigned int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed))
+    cpu++;
+
+  ThreadPolicy policy;
+  policy.nice = std::min(current_nice + 5, 19);
+  policy.cpus = {cpu};
+  topology.set_policy(ThreadClass::Background, policy);
+
+  std::string name;
+  int nice = 0;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+
+  std::thread thread([&]() {
+    topology.apply(ThreadClass::Background, "a-very-long-thread-name");
+
+    char buffer[16] = {0};
+    pthread_getname_np(pthread_self(), buffer, sizeof(buffer));
+    name = buffer;
+    nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+    pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  });
+  thread.join();
+
+  EXPECT_EQ("a-very-long-thr", name);
+  EXPECT_EQ(policy.nice, nice);
+  EXPECT_EQ(1, CPU_COUNT(&cpus));
+  EXPECT_TRUE(CPU_ISSET(cpu, &cpus));
+}
+
+TEST(ThreadTopology, UnpinsThreadForPolicyWithoutCpus) {
+  ThreadTopology topology;
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  unsigned int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed))
+    cpu++;
+
+  ThreadPolicy pinned;
+  pinned.cpus = {cpu};
+  topology.set_policy(ThreadClass::Audio, pinned);
+  topology.set_policy(ThreadClass::Render, ThreadPolicy{});
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  std::thread thread([&]() {
+    topology.apply(ThreadClass::Audio, "audio");
+    topology.apply(ThreadClass::Render, "render");
+    pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  });
+  thread.join();
+
+  EXPECT_TRUE(CPU_EQUAL(&allowed, &cpus));
+}
+
+TEST(ThreadTopology, CannotSwitchToUnavailableCpus) {
+  ThreadTopology topology;
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  unsigned int cpu = CPU_SETSIZE - 1;
+  while (CPU_ISSET(cpu, &allowed))
+    cpu--;
+
+  ThreadPolicy unavailable;
+  unavailable.nice = topology.policy(ThreadClass::Render).nice;
+  unavailable.cpus = {cpu};
+  topology.set_policy(ThreadClass::Background, unavailable);
+
+  EXPECT_FALSE(topology.can_switch(ThreadClass::Render, ThreadClass::Background));
+  EXPECT_TRUE(topology.can_switch(ThreadClass::Background, ThreadClass::Render));
+}
+
+TEST(ThreadTopology, RaisingTheNiceValueIsAlwaysPossible) {
+  ThreadTopology topology;
+
+  ThreadPolicy lower;
+  lower.nice = 5;
+  ThreadPolicy higher;
+  higher.nice = 10;
+  topology.set_policy(ThreadClass::Render, lower);
+  topology.set_policy(ThreadClass::Background, higher);
+
+  EXPECT_TRUE(topology.can_switch(ThreadClass::Render, ThreadClass::Background));
+  EXPECT_TRUE(topology.can_switch(ThreadClass::Render, ThreadClass::Render));
+}
+
+TEST(ThreadTopology, SwitchesBackWhenAllowedTo) {
+  ThreadTopology topology;
+
+  bool applied = false;
+  int nice = 0;
+  std::thread thread([&]() {
+    topology.apply(ThreadClass::Background, "background");
+    applied = topology.apply(ThreadClass::Render, "render");
+    nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+  });
+  thread.join();
+
+  // Whoever may switch back has to end up with the policy.
+  if (topology.can_switch(ThreadClass::Background, ThreadClass::Render)) {
+    EXPECT_TRUE(applied);
+    EXPECT_EQ(topology.policy(ThreadClass::Render).nice, nice);
+  } else {
+    EXPECT_FALSE(applied);
+  }
+}
+}  // namespace common
+}  // namespace anbox
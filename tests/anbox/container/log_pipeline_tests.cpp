@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/log_pipeline.h"
+#include "anbox/utils.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    char tmpl[] = "/tmp/anbox-log-pipeline-XXXXXX";
+    path_ = ::mkdtemp(tmpl);
+  }
+  ~TemporaryDirectory() { fs::remove_all(path_); }
+  fs::path path() const { return path_; }
+
+ private:
+  fs::path path_;
+};
+
+// Writes like LXC does: a plain blocking writer on the FIFO.
+void write_lines(const std::string &path, unsigned int count, const std::string &prefix = "line") {
+  const auto fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  ASSERT_GE(fd, 0);
+  for (unsigned int n = 0; n < count; n++) {
+    const auto line = anbox::utils::string_format("%s %d\n", prefix, n);
+    ASSERT_EQ(static_cast<ssize_t>(line.size()), ::write(fd, line.data(), line.size()));
+  }
+  ::close(fd);
+}
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path.string());
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+TEST(LogPipeline, WritesLinesToFile) {
+  TemporaryDirectory dir;
+  const auto log_path = dir.path() / "container.log";
+
+  LogPipeline pipeline(log_path.string(), LogPipeline::Configuration{});
+  ASSERT_TRUE(fs::exists(pipeline.input_path()));
+
+  write_lines(pipeline.input_path(), 10);
+  pipeline.flush();
+
+  const auto content = read_file(log_path);
+  ASSERT_EQ(0, content.find("line 0\n"));
+  ASSERT_NE(std::string::npos, content.find("line 9\n"));
+  ASSERT_EQ(10, pipeline.statistics().lines_written);
+  ASSERT_EQ(0, pipeline.statistics().lines_dropped);
+}
+
+TEST(LogPipeline, RotatesWhenFileGetsTooLarge) {
+  TemporaryDirectory dir;
+  const auto log_path = dir.path() / "container.log";
+
+  LogPipeline::Configuration config;
+  config.max_file_size = 1024;
+  config.max_rotated_files = 2;
+  config.max_lines_per_second = 0;
+  LogPipeline pipeline(log_path.string(), config);
+
+  for (int n = 0; n < 20; n++) {
+    write_lines(pipeline.input_path(), 50);
+    pipeline.flush();
+  }
+
+  ASSERT_TRUE(fs::exists(log_path));
+  ASSERT_TRUE(fs::exists(log_path.string() + ".1"));
+  ASSERT_TRUE(fs::exists(log_path.string() + ".2"));
+  ASSERT_FALSE(fs::exists(log_path.string() + ".3"));
+  ASSERT_LE(fs::file_size(log_path), config.max_file_size);
+  ASSERT_GT(pipeline.statistics().rotations, 0);
+}
+
+TEST(LogPipeline, DropsLinesAboveRateLimit) {
+  TemporaryDirectory dir;
+  const auto log_path = dir.path() / "container.log";
+
+  LogPipeline::Configuration config;
+  config.max_lines_per_second = 100;
+  LogPipeline pipeline(log_path.string(), config);
+
+  const unsigned int num_lines = 5000;
+  write_lines(pipeline.input_path(), num_lines);
+  pipeline.flush();
+
+  const auto stats = pipeline.statistics();
+  ASSERT_EQ(num_lines, stats.lines_written + stats.lines_dropped);
+  // The burst may span two rate limit windows at most.
+  ASSERT_LE(stats.lines_written, 2 * config.max_lines_per_second);
+  ASSERT_GT(stats.lines_dropped, 0);
+
+  std::cout << "Wrote " << stats.lines_written << " lines, dropped "
+            << stats.lines_dropped << std::endl;
+}
+
+TEST(LogPipeline, ReportsDroppedLines) {
+  TemporaryDirectory dir;
+  const auto log_path = dir.path() / "container.log";
+
+  LogPipeline::Configuration config;
+  config.max_lines_per_second = 10;
+  LogPipeline pipeline(log_path.string(), config);
+
+  write_lines(pipeline.input_path(), 100);
+  // Once the rate limit window is over the number of dropped lines is
+  // written out even without any further lines coming in.
+  std::this_thread::sleep_for(std::chrono::milliseconds{2200});
+  pipeline.flush();
+
+  ASSERT_NE(std::string::npos, read_file(log_path).find("lines because of rate limiting"));
+}
+
+TEST(LogPipeline, CutsOverlongLines) {
+  TemporaryDirectory dir;
+  const auto log_path = dir.path() / "container.log";
+
+  LogPipeline pipeline(log_path.string(), LogPipeline::Configuration{});
+
+  const std::string data(10000, 'x');
+  const auto fd = ::open(pipeline.input_path().c_str(), O_WRONLY | O_CLOEXEC);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(static_cast<ssize_t>(data.size()), ::write(fd, data.data(), data.size()));
+  ::close(fd);
+  pipeline.flush();
+
+  ASSERT_EQ(2, pipeline.statistics().lines_written);
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/container.h"
+#include "anbox/container/management_api_skeleton.h"
+
+#include "anbox_container.pb.h"
+
+#include <google/protobuf/stubs/common.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+// Behaves like a container which takes a while to boot Android.
+class FakeContainer : public anbox::container::Container {
+ public:
+  void start(const anbox::container::Configuration &configuration) override {
+    std::this_thread::sleep_for(boot_time);
+    state_ = State::running;
+    configuration_ = configuration;
+    starts++;
+  }
+
+  void stop() override {
+    state_ = State::inactive;
+    stops++;
+  }
+
+  void reattach(const anbox::container::Configuration &configuration) override {
+    if (fail_reattach)
+      throw std::runtime_error("Reattaching not supported");
+    configuration_ = configuration;
+    reattaches++;
+  }
+
+  State state() override { return state_; }
+
+  std::chrono::milliseconds boot_time{0};
+  bool fail_reattach = false;
+  int starts = 0;
+  int stops = 0;
+  int reattaches = 0;
+  anbox::container::Configuration configuration_;
+
+ private:
+  State state_ = State::inactive;
+};
+
+class Done : public google::protobuf::Closure {
+ public:
+  void Run() override { called = true; }
+  bool called = false;
+};
+
+anbox::protobuf::container::StartContainer start_request(const std::string &socket, bool allow_reattach) {
+  anbox::protobuf::container::StartContainer request;
+  auto bind_mount = request.mutable_configuration()->add_bind_mounts();
+  bind_mount->set_source(socket);
+  bind_mount->set_target("/dev/anbox_bridge");
+  request.set_allow_reattach(allow_reattach);
+  return request;
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+TEST(ManagementApiSkeleton, StartsInactiveContainer) {
+  auto container = std::make_shared<FakeContainer>();
+  ManagementApiSkeleton skeleton(nullptr, container);
+
+  const auto request = start_request("/run/user/1000/anbox/sockets/anbox_bridge", true);
+  protobuf::container::StartContainerResult response;
+  Done done;
+  skeleton.start_container(&request, &response, &done);
+
+  ASSERT_TRUE(done.called);
+  ASSERT_FALSE(response.has_error());
+  ASSERT_FALSE(response.reattached());
+  ASSERT_EQ(1, container->starts);
+  ASSERT_EQ(0, container->reattaches);
+}
+
+TEST(ManagementApiSkeleton, RejectsStartOfRunningContainerWithoutReattach) {
+  auto container = std::make_shared<FakeContainer>();
+  ManagementApiSkeleton skeleton(nullptr, container);
+
+  const auto request = start_request("/run/user/1000/anbox/sockets/anbox_bridge", false);
+  protobuf::container::StartContainerResult response;
+  Done done;
+  skeleton.start_container(&request, &response, &done);
+  ASSERT_FALSE(response.has_error());
+
+  protobuf::container::StartContainerResult second_response;
+  Done second_done;
+  skeleton.start_container(&request, &second_response, &second_done);
+
+  ASSERT_TRUE(second_done.called);
+  ASSERT_TRUE(second_response.has_error());
+  ASSERT_EQ(1, container->starts);
+  ASSERT_EQ(0, container->reattaches);
+}
+
+TEST(ManagementApiSkeleton, ReattachesToRunningContainer) {
+  auto container = std::make_shared<FakeContainer>();
+  container->boot_time = std::chrono::milliseconds{200};
+
+  // The first session manager starts the container and goes away again
+  // without stopping it.
+  {
+    ManagementApiSkeleton skeleton(nullptr, container);
+    const auto request = start_request("/run/user/1000/anbox/sockets/anbox_bridge", true);
+    protobuf::container::StartContainerResult response;
+    Done done;
+
+    const auto start = std::chrono::steady_clock::now();
+    skeleton.start_container(&request, &response, &done);
+    const auto cold_boot = std::chrono::steady_clock::now() - start;
+
+    ASSERT_FALSE(response.has_error());
+    ASSERT_FALSE(response.reattached());
+    RecordProperty("cold_boot_us", static_cast<int>(
+        std::chrono::duration_cast<std::chrono::microseconds>(cold_boot).count()));
+  }
+
+  // A new one connects with the sockets it just created.
+  ManagementApiSkeleton skeleton(nullptr, container);
+  const auto request = start_request("/run/user/1000/anbox/sockets/anbox_bridge.new", true);
+  protobuf::container::StartContainerResult response;
+  Done done;
+
+  const auto start = std::chrono::steady_clock::now();
+  skeleton.start_container(&request, &response, &done);
+  const auto reattach = std::chrono::steady_clock::now() - start;
+
+  ASSERT_TRUE(done.called);
+  ASSERT_FALSE(response.has_error());
+  ASSERT_TRUE(response.reattached());
+  ASSERT_EQ(1, container->starts);
+  ASSERT_EQ(0, container->stops);
+  ASSERT_EQ(1, container->reattaches);
+  ASSERT_EQ("/dev/anbox_bridge",
+            container->configuration_.bind_mounts.at("/run/user/1000/anbox/sockets/anbox_bridge.new"));
+
+  const auto reattach_us = std::chrono::duration_cast<std::chrono::microseconds>(reattach).count();
+  std::cout << "Reattached to running container in " << reattach_us << "us" << std::endl;
+  RecordProperty("reattach_us", static_cast<int>(reattach_us));
+  ASSERT_LT(reattach, container->boot_time);
+}
+
+TEST(ManagementApiSkeleton, RestartsContainerWhenReattachFails) {
+  auto container = std::make_shared<FakeContainer>();
+  container->fail_reattach = true;
+  ManagementApiSkeleton skeleton(nullptr, container);
+
+  const auto request = start_request("/run/user/1000/anbox/sockets/anbox_bridge", true);
+  protobuf::container::StartContainerResult response;
+  Done done;
+  skeleton.start_container(&request, &response, &done);
+  ASSERT_FALSE(response.has_error());
+
+  protobuf::container::StartContainerResult second_response;
+  Done second_done;
+  skeleton.start_container(&request, &second_response, &second_done);
+
+  ASSERT_TRUE(second_done.called);
+  ASSERT_FALSE(second_response.has_error());
+  ASSERT_FALSE(second_response.reattached());
+  ASSERT_EQ(2, container->starts);
+  ASSERT_EQ(1, container->stops);
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/service.h"
+#include "anbox/system_configuration.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+class FakeContainer : public anbox::container::Container {
+ public:
+  void start(const anbox::container::Configuration &configuration) override {
+    (void)configuration;
+    state_ = State::running;
+  }
+
+  void stop() override {
+    state_ = State::inactive;
+    stops++;
+  }
+
+  void reattach(const anbox::container::Configuration &configuration) override {
+    (void)configuration;
+  }
+
+  State state() override { return state_; }
+
+  int stops = 0;
+
+ private:
+  State state_ = State::inactive;
+};
+
+// Connects to the container socket the way a session manager does and
+// returns the socket, or -1 if the service didn't accept the connection.
+// Only uses system calls so it can run in a forked child.
+int connect_client(const char *path) {
+  sockaddr_un addr;
+  ::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  ::strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+  for (int attempt = 0; attempt < 50; attempt++) {
+    const auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      return -1;
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+      // The service closes connections it doesn't take right away, for
+      // example while the previous client is still being torn down.
+      pollfd pfd{fd, POLLIN, 0};
+      if (::poll(&pfd, 1, 100) == 0)
+        return fd;
+    }
+    ::close(fd);
+  }
+  return -1;
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+class ContainerServiceTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    char tmpl[] = "/tmp/anbox-container-service-XXXXXX";
+    directory = ::mkdtemp(tmpl);
+    // Other users have to reach the socket as well.
+    ::chmod(directory.c_str(), 0755);
+    // The socket path is determined once per process.
+    ::setenv("SNAP_COMMON", directory.c_str(), 1);
+    socket_path = SystemConfiguration::instance().container_socket_path();
+  }
+
+  static void TearDownTestCase() {
+    fs::remove_all(directory);
+  }
+
+  void SetUp() override {
+    rt = Runtime::create();
+    rt->start();
+
+    Service::Configuration config;
+    config.create_backend = [this](const network::Credentials &creds) {
+      auto container = std::make_shared<FakeContainer>();
+      std::lock_guard<std::mutex> l(lock);
+      backends.push_back(container);
+      backend_uids.push_back(creds.uid());
+      return container;
+    };
+    service = Service::create(rt, config);
+  }
+
+  void TearDown() override {
+    service.reset();
+    rt->stop();
+  }
+
+  size_t num_backends() {
+    std::lock_guard<std::mutex> l(lock);
+    return backends.size();
+  }
+
+  bool wait_for_backends(size_t count) {
+    for (int n = 0; n < 100 && num_backends() < count; n++)
+      std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    return num_backends() >= count;
+  }
+
+  static std::string directory;
+  static std::string socket_path;
+
+  std::shared_ptr<Runtime> rt;
+  std::shared_ptr<Service> service;
+  std::mutex lock;
+  std::vector<std::weak_ptr<FakeContainer>> backends;
+  std::vector<uid_t> backend_uids;
+};
+
+std::string ContainerServiceTest::directory;
+std::string ContainerServiceTest::socket_path;
+
+TEST_F(ContainerServiceTest, KeepsContainerAcrossReconnects) {
+  auto fd = connect_client(socket_path.c_str());
+  ASSERT_GE(fd, 0);
+  ASSERT_TRUE(wait_for_backends(1));
+  ::close(fd);
+
+  // The same user comes back, e.g. with a restarted session manager.
+  fd = connect_client(socket_path.c_str());
+  ASSERT_GE(fd, 0);
+  ::close(fd);
+
+  ASSERT_EQ(1u, num_backends());
+  auto backend = backends[0].lock();
+  ASSERT_NE(nullptr, backend);
+  ASSERT_EQ(0, backend->stops);
+}
+
+TEST_F(ContainerServiceTest, ReplacesContainerForDifferentUser) {
+  if (::geteuid() != 0) {
+    std::cout << "Connecting as a different user needs root, skipping test" << std::endl;
+    return;
+  }
+
+  auto fd = connect_client(socket_path.c_str());
+  ASSERT_GE(fd, 0);
+  ASSERT_TRUE(wait_for_backends(1));
+  ::close(fd);
+
+  const uid_t other_uid = 65534;
+  const gid_t other_gid = 65534;
+  const auto path = socket_path.c_str();
+  const auto pid = ::fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    if (::setgid(other_gid) != 0 || ::setuid(other_uid) != 0)
+      ::_exit(2);
+    const auto child_fd = connect_client(path);
+    ::_exit(child_fd >= 0 ? 0 : 1);
+  }
+
+  int status = 0;
+  ASSERT_EQ(pid, ::waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+
+  // The container of the first user was dropped and a new one was
+  // created for the other user.
+  ASSERT_TRUE(wait_for_backends(2));
+  ASSERT_EQ(other_uid, backend_uids[1]);
+  ASSERT_TRUE(backends[0].expired());
+}
+}  // namespace container
+}  // namespace anbox
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/container/setup_reconciler.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <set>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    char tmpl[] = "/tmp/anbox-setup-reconciler-XXXXXX";
+    path_ = ::mkdtemp(tmpl);
+  }
+  ~TemporaryDirectory() { fs::remove_all(path_); }
+  fs::path path() const { return path_; }
+
+ private:
+  fs::path path_;
+};
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in(path.string());
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+  std::ofstream out(path.string());
+  out << content;
+}
+
+ino_t inode_of(const fs::path &path) {
+  struct stat st;
+  if (::lstat(path.c_str(), &st) < 0)
+    return 0;
+  return st.st_ino;
+}
+
+// FIFOs can be created without privileges and are handled the same way
+// as device nodes.
+anbox::container::SetupReconciler::Node fifo_node(mode_t permissions) {
+  anbox::container::SetupReconciler::Node node;
+  node.mode = S_IFIFO | permissions;
+  node.uid = ::getuid();
+  node.gid = ::getgid();
+  return node;
+}
+}  // namespace
+
+namespace anbox {
+namespace container {
+TEST(SetupReconciler, WritesFileOnlyWhenContentDiffers) {
+  TemporaryDirectory dir;
+  const auto path = dir.path() / "ipconfig.txt";
+
+  SetupReconciler reconciler;
+  ASSERT_EQ(SetupReconciler::Result::created, reconciler.ensure_file_content(path.string(), "foo"));
+  const auto inode = inode_of(path);
+
+  ASSERT_EQ(SetupReconciler::Result::unchanged, reconciler.ensure_file_content(path.string(), "foo"));
+  ASSERT_EQ(inode, inode_of(path));
+
+  ASSERT_EQ(SetupReconciler::Result::updated, reconciler.ensure_file_content(path.string(), "bar"));
+  ASSERT_EQ("bar", read_file(path));
+  ASSERT_FALSE(fs::exists(path.string() + ".tmp"));
+
+  const auto stats = reconciler.statistics();
+  ASSERT_EQ(1u, stats.created);
+  ASSERT_EQ(1u, stats.updated);
+  ASSERT_EQ(1u, stats.unchanged);
+}
+
+TEST(SetupReconciler, ReplacesFileFromSourceOnlyWhenContentDiffers) {
+  TemporaryDirectory dir;
+  const auto path = dir.path() / "config";
+  const auto source = dir.path() / "config.new";
+
+  write_file(path, "lxc.tty.max = 0\n");
+  const auto inode = inode_of(path);
+
+  SetupReconciler reconciler;
+  write_file(source, "lxc.tty.max = 0\n");
+  ASSERT_EQ(SetupReconciler::Result::unchanged, reconciler.ensure_file_from(source.string(), path.string()));
+  ASSERT_EQ(inode, inode_of(path));
+  ASSERT_FALSE(fs::exists(source));
+
+  write_file(source, "lxc.tty.max = 1\n");
+  ASSERT_EQ(SetupReconciler::Result::updated, reconciler.ensure_file_from(source.string(), path.string()));
+  ASSERT_EQ("lxc.tty.max = 1\n", read_file(path));
+  ASSERT_FALSE(fs::exists(source));
+}
+
+TEST(SetupReconciler, KeepsMatchingNodes) {
+  TemporaryDirectory dir;
+  const auto path = dir.path() / "null";
+
+  SetupReconciler reconciler;
+  ASSERT_EQ(SetupReconciler::Result::created, reconciler.ensure_node(path.string(), fifo_node(0666)));
+  const auto inode = inode_of(path);
+
+  struct stat st;
+  ASSERT_EQ(0, ::lstat(path.c_str(), &st));
+  ASSERT_TRUE(S_ISFIFO(st.st_mode));
+  // The mode must not be affected by the umask.
+  ASSERT_EQ(0666u, st.st_mode & 07777);
+
+  ASSERT_EQ(SetupReconciler::Result::unchanged, reconciler.ensure_node(path.string(), fifo_node(0666)));
+  ASSERT_EQ(inode, inode_of(path));
+
+  ASSERT_EQ(SetupReconciler::Result::updated, reconciler.ensure_node(path.string(), fifo_node(0600)));
+  ASSERT_EQ(inode, inode_of(path));
+  ASSERT_EQ(0, ::lstat(path.c_str(), &st));
+  ASSERT_EQ(0600u, st.st_mode & 07777);
+}
+
+TEST(SetupReconciler, RecreatesNodesOfWrongType) {
+  TemporaryDirectory dir;
+  const auto path = dir.path() / "tty";
+
+  write_file(path, "not a node");
+  fs::create_directories(dir.path() / "console" / "nested");
+
+  SetupReconciler reconciler;
+  ASSERT_EQ(SetupReconciler::Result::created, reconciler.ensure_node(path.string(), fifo_node(0666)));
+  ASSERT_EQ(SetupReconciler::Result::created,
+            reconciler.ensure_node((dir.path() / "console").string(), fifo_node(0600)));
+
+  struct stat st;
+  ASSERT_EQ(0, ::lstat(path.c_str(), &st));
+  ASSERT_TRUE(S_ISFIFO(st.st_mode));
+  ASSERT_EQ(0, ::lstat((dir.path() / "console").c_str(), &st));
+  ASSERT_TRUE(S_ISFIFO(st.st_mode));
+}
+
+TEST(SetupReconciler, RemovesStaleEntries) {
+  TemporaryDirectory dir;
+
+  SetupReconciler reconciler;
+  reconciler.ensure_node((dir.path() / "null").string(), fifo_node(0666));
+  reconciler.ensure_node((dir.path() / "binder").string(), fifo_node(0666));
+  fs::create_directories(dir.path() / "old" / "nested");
+
+  reconciler.remove_stale_entries(dir.path().string(), {"null"});
+
+  ASSERT_TRUE(fs::exists(dir.path() / "null"));
+  ASSERT_FALSE(fs::exists(dir.path() / "binder"));
+  ASSERT_FALSE(fs::exists(dir.path() / "old"));
+  ASSERT_EQ(2u, reconciler.statistics().removed);
+}
+
+TEST(SetupReconciler, SecondPassOverUnchangedTreeTouchesNothing) {
+  TemporaryDirectory dir;
+  const auto devices_dir = dir.path() / "devices";
+  const auto ip_conf_path = dir.path() / "data" / "misc" / "ethernet" / "ipconfig.txt";
+  fs::create_directories(devices_dir);
+  fs::create_directories(ip_conf_path.parent_path());
+
+  const std::set<std::string> devices{"console", "full", "null", "random", "tty", "urandom", "zero"};
+
+  auto setup = [&]() {
+    SetupReconciler reconciler;
+    reconciler.remove_stale_entries(devices_dir.string(), devices);
+    for (const auto &device : devices)
+      reconciler.ensure_node((devices_dir / device).string(), fifo_node(0666));
+    reconciler.ensure_file_content(ip_conf_path.string(), "static ip config");
+    return reconciler.statistics();
+  };
+
+  const auto first = setup();
+  ASSERT_EQ(devices.size() + 1, first.created);
+
+  const auto second = setup();
+  ASSERT_EQ(0u, second.created);
+  ASSERT_EQ(0u, second.updated);
+  ASSERT_EQ(0u, second.removed);
+  ASSERT_EQ(devices.size() + 1, second.unchanged);
+}
+}  // namespace container
+}  // namespace anbox
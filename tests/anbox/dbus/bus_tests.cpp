@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/dbus/bus.h"
+#include "anbox/runtime.h"
+#include "anbox/utils.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const char *test_interface{"org.anbox.Test"};
+constexpr const char *test_path{"/org/anbox/Test"};
+constexpr const std::chrono::seconds max_wait_time{5};
+
+// Runs a private dbus-daemon for the duration of a test and points the
+// session bus address of the test process to it.
+class PrivateSessionBus {
+ public:
+  PrivateSessionBus() {
+    char tmpl[] = "/tmp/anbox-dbus-XXXXXX";
+    dir_ = ::mkdtemp(tmpl);
+
+    int fds[2];
+    if (::pipe(fds) < 0)
+      return;
+
+    pid_ = ::fork();
+    if (pid_ == 0) {
+      ::close(fds[0]);
+      const auto address = anbox::utils::string_format("--address=unix:path=%s/bus", dir_.string());
+      const auto print_address = anbox::utils::string_format("--print-address=%d", fds[1]);
+      ::execlp("dbus-daemon", "dbus-daemon", "--session", "--nofork", "--nopidfile",
+               address.c_str(), print_address.c_str(), nullptr);
+      ::_exit(EXIT_FAILURE);
+    }
+    ::close(fds[1]);
+
+    std::string address;
+    char c = 0;
+    while (::read(fds[0], &c, 1) == 1 && c != '\n')
+      address.push_back(c);
+    ::close(fds[0]);
+
+    if (address.empty())
+      return;
+
+    ::setenv("DBUS_SESSION_BUS_ADDRESS", address.c_str(), 1);
+    available_ = true;
+  }
+
+  ~PrivateSessionBus() {
+    if (pid_ > 0) {
+      ::kill(pid_, SIGTERM);
+      ::waitpid(pid_, nullptr, 0);
+    }
+    fs::remove_all(dir_);
+  }
+
+  bool available() const { return available_; }
+
+ private:
+  fs::path dir_;
+  pid_t pid_ = -1;
+  bool available_ = false;
+};
+
+struct Notification {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool received = false;
+  bool failed = false;
+  std::thread::id thread;
+  std::chrono::steady_clock::time_point time;
+
+  void notify(bool with_error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    received = true;
+    failed = with_error;
+    thread = std::this_thread::get_id();
+    time = std::chrono::steady_clock::now();
+    cond.notify_all();
+  }
+
+  bool wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cond.wait_for(lock, max_wait_time, [&]() { return received; });
+  }
+
+  static int handler(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+    (void) ret_error;
+    static_cast<Notification*>(userdata)->notify(sd_bus_message_get_error(m) != nullptr);
+    return 0;
+  }
+};
+}  // namespace
+
+namespace anbox {
+namespace dbus {
+TEST(Bus, ProcessesIncomingMessagesOnRuntime) {
+  PrivateSessionBus session_bus;
+  if (!session_bus.available()) {
+    std::cout << "dbus-daemon is not available, skipping test" << std::endl;
+    return;
+  }
+
+  auto rt = Runtime::create(2);
+  rt->start();
+
+  auto bus = std::make_shared<Bus>(Bus::Type::Session);
+
+  Notification notification;
+  sd_bus_slot *slot = nullptr;
+  bus->dispatch([&](sd_bus *b) {
+    const auto match = utils::string_format("type='signal',interface='%s'", test_interface);
+    ASSERT_GE(sd_bus_add_match(b, &slot, match.c_str(), &Notification::handler, &notification), 0);
+  });
+  bus->run_async(rt->service());
+
+  Bus sender(Bus::Type::Session);
+  ASSERT_GE(sd_bus_emit_signal(sender.raw(), test_path, test_interface, "Ping", ""), 0);
+  ASSERT_GE(sd_bus_flush(sender.raw()), 0);
+
+  ASSERT_TRUE(notification.wait());
+  ASSERT_FALSE(notification.failed);
+  ASSERT_NE(std::this_thread::get_id(), notification.thread);
+
+  bus->dispatch([&](sd_bus*) { sd_bus_slot_unref(slot); });
+  bus->stop();
+  rt->stop();
+}
+
+TEST(Bus, MethodCallTimesOutWithoutPolling) {
+  PrivateSessionBus session_bus;
+  if (!session_bus.available()) {
+    std::cout << "dbus-daemon is not available, skipping test" << std::endl;
+    return;
+  }
+
+  auto rt = Runtime::create(2);
+  rt->start();
+
+  auto bus = std::make_shared<Bus>(Bus::Type::Session);
+  bus->run_async(rt->service());
+
+  // Nobody processes messages for this connection so calls to it can
+  // only complete through their timeout.
+  Bus unresponsive(Bus::Type::Session);
+  const char *unique_name = nullptr;
+  ASSERT_GE(sd_bus_get_unique_name(unresponsive.raw(), &unique_name), 0);
+
+  const auto timeout = std::chrono::milliseconds{200};
+
+  Notification notification;
+  sd_bus_slot *slot = nullptr;
+  std::chrono::steady_clock::time_point start;
+  bus->dispatch([&](sd_bus *b) {
+    sd_bus_message *m = nullptr;
+    ASSERT_GE(sd_bus_message_new_method_call(b, &m, unique_name, test_path, test_interface, "Ping"), 0);
+    start = std::chrono::steady_clock::now();
+    ASSERT_GE(sd_bus_call_async(b, &slot, m, &Notification::handler, &notification,
+                                std::chrono::duration_cast<std::chrono::microseconds>(timeout).count()), 0);
+    sd_bus_message_unref(m);
+  });
+
+  ASSERT_TRUE(notification.wait());
+  ASSERT_TRUE(notification.failed);
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(notification.time - start);
+  std::cout << "Method call timed out after " << elapsed.count() << " ms" << std::endl;
+  ASSERT_GE(elapsed, timeout);
+  // Without the timer we would only notice the timeout with the next
+  // message on the bus, which never comes.
+  ASSERT_LT(elapsed, timeout + std::chrono::milliseconds{300});
+
+  bus->dispatch([&](sd_bus*) { sd_bus_slot_unref(slot); });
+  bus->stop();
+  rt->stop();
+}
+
+TEST(Bus, StopsWithoutDelay) {
+  PrivateSessionBus session_bus;
+  if (!session_bus.available()) {
+    std::cout << "dbus-daemon is not available, skipping test" << std::endl;
+    return;
+  }
+
+  auto rt = Runtime::create(2);
+  rt->start();
+
+  auto bus = std::make_shared<Bus>(Bus::Type::Session);
+  bus->run_async(rt->service());
+
+  // Let the bus go idle first.
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+  const auto start = std::chrono::steady_clock::now();
+  bus->stop();
+  bus.reset();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << "Bus stopped after "
+            << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+            << " us" << std::endl;
+  ASSERT_LT(elapsed, std::chrono::milliseconds{50});
+
+  rt->stop();
+}
+}  // namespace dbus
+}  // namespace anbox
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/buffer_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace anbox {
+namespace graphics {
+TEST(BufferPool, SmallBuffersUseInplaceStorage) {
+  BufferPool pool;
+  const size_t size = Buffer::kSmallSize;
+  auto buffer = pool.acquire(size);
+  ASSERT_EQ(size, buffer.size());
+  ASSERT_FALSE(buffer.isAllocated());
+  pool.release(std::move(buffer));
+
+  const auto stats = pool.statistics();
+  ASSERT_EQ(1, stats.acquired);
+  ASSERT_EQ(0, stats.allocations);
+  ASSERT_EQ(0, stats.released);
+  ASSERT_EQ(0, stats.cached_buffers);
+}
+
+TEST(BufferPool, ReleasedBuffersAreReused) {
+  BufferPool pool;
+
+  auto buffer = pool.acquire(3000);
+  ASSERT_EQ(3000, buffer.size());
+  ASSERT_TRUE(buffer.isAllocated());
+  const auto storage = buffer.data();
+  pool.release(std::move(buffer));
+  ASSERT_TRUE(buffer.empty());
+
+  auto stats = pool.statistics();
+  ASSERT_EQ(1, stats.allocations);
+  ASSERT_EQ(1, stats.cached_buffers);
+  ASSERT_EQ(4096, stats.cached_bytes);
+
+  // Anything within the same size class is served from the cache.
+  auto other = pool.acquire(2049);
+  ASSERT_EQ(2049, other.size());
+  ASSERT_EQ(storage, other.data());
+
+  stats = pool.statistics();
+  ASSERT_EQ(1, stats.allocations);
+  ASSERT_EQ(1, stats.reuses);
+  ASSERT_EQ(0, stats.cached_buffers);
+  ASSERT_EQ(0, stats.cached_bytes);
+}
+
+TEST(BufferPool, CopiesDataIntoAcquiredBuffer) {
+  BufferPool pool;
+  std::vector<char> data(10000);
+  for (size_t n = 0; n < data.size(); n++)
+    data[n] = static_cast<char>(n);
+
+  const auto buffer = pool.acquire(data.data(), data.size());
+  ASSERT_EQ(data.size(), buffer.size());
+  ASSERT_TRUE(std::equal(data.begin(), data.end(), buffer.begin()));
+}
+
+TEST(BufferPool, DoesNotCacheHugeBuffers) {
+  BufferPool pool;
+  auto buffer = pool.acquire(BufferPool::max_class_size + 1);
+  pool.release(std::move(buffer));
+
+  const auto stats = pool.statistics();
+  ASSERT_EQ(1, stats.allocations);
+  ASSERT_EQ(1, stats.discarded);
+  ASSERT_EQ(0, stats.cached_buffers);
+}
+
+TEST(BufferPool, LimitsNumberOfCachedBuffersPerClass) {
+  BufferPool pool(2);
+  auto a = pool.acquire(5000);
+  auto b = pool.acquire(5000);
+  auto c = pool.acquire(5000);
+  pool.release(std::move(a));
+  pool.release(std::move(b));
+  pool.release(std::move(c));
+
+  const auto stats = pool.statistics();
+  ASSERT_EQ(3, stats.allocations);
+  ASSERT_EQ(2, stats.cached_buffers);
+  ASSERT_EQ(1, stats.discarded);
+}
+
+TEST(BufferPool, ReusesEveryCachedBufferOfAClass) {
+  BufferPool pool;
+  const size_t count = 8;
+
+  // Enough buffers for the cache of a class to grow a few times.
+  std::vector<Buffer> buffers;
+  for (size_t n = 0; n < count; n++)
+    buffers.push_back(pool.acquire(2000));
+  for (auto &buffer : buffers)
+    pool.release(std::move(buffer));
+  buffers.clear();
+
+  auto stats = pool.statistics();
+  ASSERT_EQ(count, stats.allocations);
+  ASSERT_EQ(count, stats.cached_buffers);
+
+  for (size_t n = 0; n < count; n++) {
+    buffers.push_back(pool.acquire(2000));
+    ASSERT_TRUE(buffers.back().isAllocated());
+  }
+
+  stats = pool.statistics();
+  ASSERT_EQ(count, stats.allocations);
+  ASSERT_EQ(count, stats.reuses);
+  ASSERT_EQ(0, stats.cached_buffers);
+  ASSERT_EQ(0, stats.cached_bytes);
+}
+
+// Simulates the socket read path handing chunks over to a render thread
+// through a BufferQueue and reports the number of heap allocations needed
+// per MB of transferred data with and without the pool.
+TEST(BufferPool, AllocationsPerMegabyteTransferred) {
+  const size_t total_bytes{64 * 1024 * 1024};
+  const size_t chunk_sizes[] = {128, 700, 4096, 8192, 65536, 256 * 1024, 1500};
+
+  auto run = [&](BufferPool *pool, std::uint64_t *allocations) {
+    BufferQueue queue(16);
+    std::mutex lock;
+    std::vector<char> data(256 * 1024, 0x42);
+
+    std::thread consumer([&] {
+      size_t received = 0;
+      while (received < total_bytes) {
+        std::unique_lock<std::mutex> l(lock);
+        Buffer buffer;
+        if (queue.pop_locked(&buffer, l) != 0)
+          break;
+        l.unlock();
+        received += buffer.size();
+        if (pool)
+          pool->release(std::move(buffer));
+      }
+    });
+
+    size_t sent = 0;
+    size_t n = 0;
+    while (sent < total_bytes) {
+      const auto size = std::min(chunk_sizes[n++ % (sizeof(chunk_sizes) / sizeof(chunk_sizes[0]))],
+                                 total_bytes - sent);
+      Buffer buffer;
+      if (pool) {
+        buffer = pool->acquire(data.data(), size);
+      } else {
+        buffer = Buffer{data.data(), data.data() + size};
+        if (buffer.isAllocated())
+          (*allocations)++;
+      }
+      std::unique_lock<std::mutex> l(lock);
+      ASSERT_EQ(0, queue.push_locked(std::move(buffer), l));
+      sent += size;
+    }
+
+    consumer.join();
+    if (pool)
+      *allocations = pool->statistics().allocations;
+  };
+
+  const auto megabytes = total_bytes / (1024 * 1024);
+
+  std::uint64_t heap_allocations = 0;
+  auto start = std::chrono::steady_clock::now();
+  run(nullptr, &heap_allocations);
+  const auto heap_duration = std::chrono::steady_clock::now() - start;
+
+  BufferPool pool;
+  std::uint64_t pool_allocations = 0;
+  start = std::chrono::steady_clock::now();
+  run(&pool, &pool_allocations);
+  const auto pool_duration = std::chrono::steady_clock::now() - start;
+
+  std::cout << "Without pool: " << static_cast<double>(heap_allocations) / megabytes
+            << " allocations/MB in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(heap_duration).count() << "ms" << std::endl
+            << "With pool:    " << static_cast<double>(pool_allocations) / megabytes
+            << " allocations/MB in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(pool_duration).count() << "ms" << std::endl;
+
+  // With the queue holding at most 16 buffers in flight the pool can never
+  // need more than that per size class.
+  ASSERT_LT(pool_allocations, heap_allocations);
+  ASSERT_LE(pool_allocations, 7 * 18);
+}
+}  // namespace graphics
+}  // namespace anbox
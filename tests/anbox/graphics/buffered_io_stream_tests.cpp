@@ -33,6 +33,7 @@ class MockSocketMessenger :
   MOCK_CONST_METHOD0(local_port, unsigned short());
   MOCK_METHOD0(set_no_delay, void());
   MOCK_METHOD0(close, void());
+  MOCK_METHOD3(send_file, void(int, off_t, size_t));
 
   // anbox::network::MessageSender
   MOCK_METHOD2(send, void(char const*, size_t));
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/testing/swiftshader_context.h"
+
+#include "GLESv2Decoder.h"
+
+#include "external/android-emugl/host/include/OpenGLESDispatch/GLESv2Dispatch.h"
+
+#include <GLES2/gl2.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace {
+constexpr const int surface_width{256};
+constexpr const int surface_height{256};
+
+// A single draw as the guest encoder sends it for client side arrays:
+// tightly packed positions and colors plus optional immediate indices.
+struct RecordedDraw {
+  GLenum mode;
+  GLsizei count;
+  std::vector<GLfloat> positions;
+  std::vector<GLubyte> colors;
+  std::vector<GLushort> indices;
+};
+
+using Recording = std::vector<RecordedDraw>;
+
+void add_quad(Recording &recording, float x, float y, float size, uint32_t color, bool indexed) {
+  RecordedDraw draw;
+  draw.positions = {x, y, x + size, y, x + size, y + size, x, y + size};
+  for (int n = 0; n < 4; n++) {
+    for (int c = 0; c < 4; c++)
+      draw.colors.push_back((color >> (c * 8)) & 0xff);
+  }
+  if (indexed) {
+    draw.mode = GL_TRIANGLES;
+    draw.indices = {0, 1, 2, 0, 2, 3};
+    draw.count = 6;
+  } else {
+    draw.mode = GL_TRIANGLE_FAN;
+    draw.count = 4;
+  }
+  recording.push_back(draw);
+}
+
+// A dense strip covering the whole surface which is too large to be
+// streamed and has to go through the copying path.
+void add_mesh(Recording &recording, int columns, uint32_t color) {
+  RecordedDraw draw;
+  draw.mode = GL_TRIANGLE_STRIP;
+  for (int n = 0; n <= columns; n++) {
+    const float x = -1.0f + 2.0f * n / columns;
+    draw.positions.insert(draw.positions.end(), {x, -1.0f, x, 1.0f});
+    for (int v = 0; v < 2; v++) {
+      for (int c = 0; c < 4; c++)
+        draw.colors.push_back((color >> (c * 8)) & 0xff);
+    }
+  }
+  draw.count = static_cast<GLsizei>(draw.positions.size() / 2);
+  recording.push_back(draw);
+}
+
+// Resembles what a UI toolkit rendering without buffer objects sends for
+// a frame: a background followed by lots of small widgets.
+Recording record_frame() {
+  Recording recording;
+  add_mesh(recording, 4096, 0xff202020);
+  uint32_t color = 0xff0000ff;
+  for (int row = 0; row < 16; row++) {
+    for (int column = 0; column < 16; column++) {
+      color = color * 1103515245 + 12345;
+      add_quad(recording, -1.0f + column * 0.125f, -1.0f + row * 0.125f, 0.1f,
+               color | 0xff000000, (row + column) % 2 == 0);
+    }
+  }
+  return recording;
+}
+
+const char *vertex_shader =
+    "attribute vec2 position;\n"
+    "attribute vec4 color;\n"
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(position, 0.0, 1.0);\n"
+    "  v_color = color;\n"
+    "}\n";
+
+const char *fragment_shader =
+    "precision mediump float;\n"
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "  gl_FragColor = v_color;\n"
+    "}\n";
+
+GLuint create_program(GLESv2Decoder &dec) {
+  const auto compile = [&](GLenum type, const char *source) {
+    const auto shader = dec.glCreateShader(type);
+    dec.glShaderSource(shader, 1, &source, nullptr);
+    dec.glCompileShader(shader);
+    return shader;
+  };
+  const auto program = dec.glCreateProgram();
+  dec.glAttachShader(program, compile(GL_VERTEX_SHADER, vertex_shader));
+  dec.glAttachShader(program, compile(GL_FRAGMENT_SHADER, fragment_shader));
+  dec.glBindAttribLocation(program, 0, "position");
+  dec.glBindAttribLocation(program, 1, "color");
+  dec.glLinkProgram(program);
+  return program;
+}
+
+// Feeds the recording through the decoder entry points in the same order
+// the guest encoder emits them.
+void replay(GLESv2Decoder &dec, const Recording &recording) {
+  for (const auto &draw : recording) {
+    dec.glBindBuffer(GL_ARRAY_BUFFER, 0);
+    dec.glVertexAttribPointerData(&dec, 0, 2, GL_FLOAT, GL_FALSE, 0,
+                                  const_cast<GLfloat*>(draw.positions.data()),
+                                  draw.positions.size() * sizeof(GLfloat));
+    dec.glVertexAttribPointerData(&dec, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0,
+                                  const_cast<GLubyte*>(draw.colors.data()),
+                                  draw.colors.size());
+    if (draw.indices.empty())
+      dec.glDrawArrays(draw.mode, 0, draw.count);
+    else
+      dec.glDrawElementsData(&dec, draw.mode, draw.count, GL_UNSIGNED_SHORT,
+                             const_cast<GLushort*>(draw.indices.data()),
+                             draw.indices.size() * sizeof(GLushort));
+  }
+}
+
+class ClientArrayStream : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(context.initialize());
+    dec.initGL(gles2_dispatch_get_proc_func, nullptr);
+    dec.setContextData(&context_data);
+
+    program = create_program(dec);
+    dec.glUseProgram(program);
+    dec.glEnableVertexAttribArray(0);
+    dec.glEnableVertexAttribArray(1);
+  }
+
+  void TearDown() override {
+    dec.glDeleteProgram(program);
+  }
+
+  std::vector<uint32_t> render(const Recording &recording) {
+    dec.glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    dec.glClear(GL_COLOR_BUFFER_BIT);
+    replay(dec, recording);
+
+    std::vector<uint32_t> pixels(surface_width * surface_height);
+    dec.glReadPixels(0, 0, surface_width, surface_height, GL_RGBA,
+                     GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+  }
+
+  double draws_per_second(const Recording &recording) {
+    // Warm up so shader compilation and buffer allocation is not measured.
+    for (int n = 0; n < 5; n++)
+      replay(dec, recording);
+    dec.glFinish();
+
+    const auto duration = std::chrono::seconds{1};
+    const auto start = std::chrono::steady_clock::now();
+    auto now = start;
+    std::uint64_t draws = 0;
+    while (now - start < duration) {
+      replay(dec, recording);
+      dec.glFinish();
+      draws += recording.size();
+      now = std::chrono::steady_clock::now();
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(now - start);
+    return draws / elapsed.count();
+  }
+
+  anbox::testing::SwiftShaderContext context{surface_width, surface_height};
+  GLDecoderContextData context_data;
+  GLESv2Decoder dec;
+  GLuint program = 0;
+};
+}  // namespace
+
+TEST_F(ClientArrayStream, MatchesCopyingPath_requires_swiftshader) {
+  const auto recording = record_frame();
+
+  context_data.setStreamingEnabled(false);
+  const auto copied = render(recording);
+  context_data.setStreamingEnabled(true);
+  const auto streamed = render(recording);
+
+  ASSERT_EQ(GL_NO_ERROR, dec.glGetError());
+  ASSERT_EQ(copied, streamed);
+
+  // The background mesh is too large to be streamed and must show up
+  // between the quads.
+  ASSERT_EQ(0xff202020, streamed[surface_width - 1]);
+}
+
+TEST_F(ClientArrayStream, RestoresBufferBindings_requires_swiftshader) {
+  render(record_frame());
+
+  GLint array_buffer = -1, element_array_buffer = -1;
+  dec.glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &array_buffer);
+  dec.glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_array_buffer);
+  ASSERT_EQ(0, array_buffer);
+  ASSERT_EQ(0, element_array_buffer);
+  ASSERT_EQ(GL_NO_ERROR, dec.glGetError());
+}
+
+TEST_F(ClientArrayStream, WrapsAroundRing_requires_swiftshader) {
+  const auto recording = record_frame();
+  const auto expected = render(recording);
+
+  // Replaying the frame many times cycles through all ring buffers
+  // several times, the output must not change.
+  for (int n = 0; n < 50; n++)
+    replay(dec, recording);
+  ASSERT_EQ(expected, render(recording));
+  ASSERT_EQ(GL_NO_ERROR, dec.glGetError());
+}
+
+TEST_F(ClientArrayStream, ReleasesRingBuffers_requires_swiftshader) {
+  const auto recording = record_frame();
+  const auto expected = render(recording);
+  ASSERT_TRUE(context_data.hasStreamBuffers());
+
+  context_data.releaseStreamBuffers(&dec);
+  ASSERT_FALSE(context_data.hasStreamBuffers());
+  ASSERT_EQ(GL_NO_ERROR, dec.glGetError());
+
+  // The ring is created again for the next frame.
+  ASSERT_EQ(expected, render(recording));
+  ASSERT_TRUE(context_data.hasStreamBuffers());
+}
+
+TEST_F(ClientArrayStream, DrawsPerSecond_requires_swiftshader) {
+  Recording recording;
+  for (int n = 0; n < 256; n++)
+    add_quad(recording, -1.0f + (n % 16) * 0.125f, -1.0f + (n / 16) * 0.125f,
+             0.1f, 0xff00ff00, n % 2 == 0);
+
+  context_data.setStreamingEnabled(false);
+  const auto copied = draws_per_second(recording);
+  context_data.setStreamingEnabled(true);
+  const auto streamed = draws_per_second(recording);
+
+  std::cout << "ClientArrayStream: " << copied << " draws/s copied, "
+            << streamed << " draws/s streamed" << std::endl;
+  RecordProperty("copied_draws_per_second", static_cast<int>(copied));
+  RecordProperty("streamed_draws_per_second", static_cast<int>(streamed));
+
+  ASSERT_EQ(GL_NO_ERROR, dec.glGetError());
+}
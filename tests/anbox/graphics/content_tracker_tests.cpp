@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/emugl/ContentTracker.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace {
+constexpr const std::chrono::milliseconds no_wait{0};
+constexpr const std::chrono::milliseconds short_wait{20};
+// Long enough to never run out on a loaded machine.
+constexpr const std::chrono::milliseconds long_wait{10000};
+
+const std::string layer{"org.anbox.test"};
+
+// The render thread of the app which produces the layer content and
+// lags behind the compositor.
+class Producer {
+ public:
+  Producer(ContentTracker &tracker, ContentTracker::HandleType buffer,
+           const std::chrono::milliseconds &delay)
+      : thread_([&tracker, buffer, delay, this]() {
+          std::this_thread::sleep_for(delay);
+          flushed = true;
+          tracker.contentUpdated(buffer);
+        }) {}
+
+  ~Producer() { thread_.join(); }
+
+  std::atomic<bool> flushed{false};
+
+ private:
+  std::thread thread_;
+};
+}  // namespace
+
+TEST(ContentTracker, WaitsForTheFirstWriteIntoABuffer) {
+  ContentTracker tracker;
+  Producer producer(tracker, 1, short_wait);
+
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 1}}, long_wait));
+  ASSERT_TRUE(producer.flushed);
+  ASSERT_EQ(1, tracker.sequence(1));
+}
+
+TEST(ContentTracker, WaitsForTheFlushOfAQueuedBuffer) {
+  ContentTracker tracker;
+
+  // Three buffers the app cycles through, all composed once already.
+  for (ContentTracker::HandleType buffer = 1; buffer <= 3; buffer++) {
+    tracker.contentUpdated(buffer);
+    ASSERT_TRUE(tracker.waitForLayers({{layer, buffer}}, no_wait));
+  }
+
+  // SurfaceFlinger posts the first buffer again before the render
+  // thread of the app has flushed the new frame into it.
+  Producer producer(tracker, 1, short_wait);
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 1}}, long_wait));
+  ASSERT_TRUE(producer.flushed);
+}
+
+TEST(ContentTracker, DoesNotWaitForRepostedBuffers) {
+  ContentTracker tracker;
+  tracker.contentUpdated(1);
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 1}}, no_wait));
+
+  // Other layers changed but this one still shows the same frame.
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 1}}, long_wait));
+  ASSERT_LT(std::chrono::steady_clock::now() - start, long_wait / 2);
+}
+
+TEST(ContentTracker, GivesUpOnContentWhichNeverComes) {
+  ContentTracker tracker;
+  tracker.contentUpdated(1);
+  tracker.contentUpdated(2);
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 1}}, no_wait));
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 2}}, no_wait));
+
+  ASSERT_FALSE(tracker.waitForLayers({{layer, 1}}, short_wait));
+
+  // What we composed counts, so we don't wait for the same buffer again.
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 1}}, no_wait));
+}
+
+TEST(ContentTracker, TimeoutIsSharedByAllLayers) {
+  ContentTracker tracker;
+
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_FALSE(tracker.waitForLayers({{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}}, short_wait));
+  ASSERT_LT(std::chrono::steady_clock::now() - start, 3 * short_wait);
+}
+
+TEST(ContentTracker, LayersAreTrackedIndependently) {
+  ContentTracker tracker;
+  tracker.contentUpdated(1);
+  tracker.contentUpdated(2);
+  ASSERT_TRUE(tracker.waitForLayers({{"a", 1}, {"b", 2}}, no_wait));
+
+  tracker.contentUpdated(3);
+  ASSERT_TRUE(tracker.waitForLayers({{"a", 1}, {"b", 3}}, no_wait));
+  ASSERT_FALSE(tracker.waitForLayers({{"a", 2}, {"b", 3}}, no_wait));
+}
+
+TEST(ContentTracker, DestroyedBuffersEndTheWait) {
+  ContentTracker tracker;
+
+  std::thread destroyer([&]() {
+    std::this_thread::sleep_for(short_wait);
+    tracker.remove(1);
+  });
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(tracker.waitForLayers({{layer, 1}}, long_wait));
+  ASSERT_LT(std::chrono::steady_clock::now() - start, long_wait / 2);
+  destroyer.join();
+
+  ASSERT_EQ(0, tracker.sequence(1));
+}
+
+TEST(ContentTracker, ReleasesTheDecodeLockWhileWaiting) {
+  ContentTracker tracker;
+  std::mutex decode_lock;
+
+  // The compositor composes while it decodes rcPostAllLayersDone on its
+  // render thread, the app's render thread needs the same lock to decode
+  // the flush the compositor waits for.
+  std::unique_lock<std::mutex> compositor(decode_lock);
+  std::thread app([&]() {
+    std::this_thread::sleep_for(short_wait);
+    std::lock_guard<std::mutex> l(decode_lock);
+    tracker.contentUpdated(1);
+  });
+
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(tracker.waitForLayers({{layer, 1}}, long_wait, &compositor));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, long_wait / 2);
+  EXPECT_TRUE(compositor.owns_lock());
+  compositor.unlock();
+  app.join();
+}
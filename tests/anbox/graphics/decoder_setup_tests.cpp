@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/testing/swiftshader_context.h"
+
+#include "GLESv1Decoder.h"
+#include "GLESv2Decoder.h"
+
+#include "external/android-emugl/host/include/OpenGLESDispatch/GLESv1Dispatch.h"
+#include "external/android-emugl/host/include/OpenGLESDispatch/GLESv2Dispatch.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+namespace {
+// All tests use these lookup functions so the process wide tables the
+// decoders share are resolved through them.
+std::atomic<int> gles1_lookups{0};
+std::atomic<int> gles2_lookups{0};
+
+void *count_gles1_lookups(const char *name, void *user_data) {
+  gles1_lookups++;
+  return gles1_dispatch_get_proc_func(name, user_data);
+}
+
+void *count_gles2_lookups(const char *name, void *user_data) {
+  gles2_lookups++;
+  return gles2_dispatch_get_proc_func(name, user_data);
+}
+
+template<typename Setup>
+double microseconds_per_connection(Setup setup) {
+  constexpr const int connections{1000};
+  const auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < connections; n++)
+    setup();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(elapsed).count() / connections;
+}
+}  // namespace
+
+TEST(DecoderSetup, ResolvesEntryPointsOncePerProcess_requires_swiftshader) {
+  anbox::testing::SwiftShaderContext context{16, 16};
+  ASSERT_TRUE(context.initialize());
+
+  GLESv2Decoder first;
+  first.initGL(count_gles2_lookups, nullptr);
+  const auto lookups = gles2_lookups.load();
+
+  GLESv2Decoder second;
+  second.initGL(count_gles2_lookups, nullptr);
+  ASSERT_EQ(lookups, gles2_lookups.load());
+
+  ASSERT_NE(nullptr, second.glDrawArrays);
+  ASSERT_EQ(first.glDrawArrays, second.glDrawArrays);
+  ASSERT_EQ(first.glGetError, second.glGetError);
+  // Entry points the decoder implements itself are still its own.
+  ASSERT_EQ(first.glShaderString, second.glShaderString);
+  ASSERT_NE(reinterpret_cast<void*>(second.glShaderString),
+            gles2_dispatch_get_proc_func("glShaderString", nullptr));
+}
+
+TEST(DecoderSetup, OtherLookupFunctionsAreNotShared_requires_swiftshader) {
+  anbox::testing::SwiftShaderContext context{16, 16};
+  ASSERT_TRUE(context.initialize());
+
+  GLESv2Decoder shared;
+  shared.initGL(count_gles2_lookups, nullptr);
+
+  GLESv2Decoder own;
+  own.initGL([](const char*, void*) -> void* { return nullptr; }, nullptr);
+  ASSERT_EQ(nullptr, own.glDrawArrays);
+  ASSERT_NE(nullptr, shared.glDrawArrays);
+}
+
+TEST(DecoderSetup, ConnectionSetupTime_requires_swiftshader) {
+  anbox::testing::SwiftShaderContext context{16, 16};
+  ASSERT_TRUE(context.initialize());
+
+  // What every connection paid before: both APIs resolved by name.
+  const auto resolved = microseconds_per_connection([]() {
+    std::unique_ptr<GLESv1Decoder> gles1{new GLESv1Decoder};
+    std::unique_ptr<GLESv2Decoder> gles2{new GLESv2Decoder};
+    gles1->initDispatchByName(gles1_dispatch_get_proc_func, nullptr);
+    gles2->initDispatchByName(gles2_dispatch_get_proc_func, nullptr);
+  });
+
+  // A connection using only GLESv2 now copies the shared table.
+  const auto shared = microseconds_per_connection([]() {
+    std::unique_ptr<GLESv2Decoder> gles2{new GLESv2Decoder};
+    gles2->initGL(count_gles2_lookups, nullptr);
+  });
+
+  // And one using both copies two of them.
+  const auto shared_both = microseconds_per_connection([]() {
+    std::unique_ptr<GLESv1Decoder> gles1{new GLESv1Decoder};
+    std::unique_ptr<GLESv2Decoder> gles2{new GLESv2Decoder};
+    gles1->initGL(count_gles1_lookups, nullptr);
+    gles2->initGL(count_gles2_lookups, nullptr);
+  });
+
+  std::cout << "DecoderSetup: resolving both APIs " << resolved
+            << "us/connection, shared GLESv2 table " << shared
+            << "us/connection, shared tables for both APIs " << shared_both
+            << "us/connection" << std::endl;
+  RecordProperty("resolved_ns_per_connection", static_cast<int>(resolved * 1000));
+  RecordProperty("shared_ns_per_connection", static_cast<int>(shared * 1000));
+
+  ASSERT_LT(shared_both, resolved);
+}
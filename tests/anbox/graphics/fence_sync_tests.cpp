@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/emugl/FenceSync.h"
+#include "anbox/graphics/emugl/TextureDraw.h"
+#include "anbox/testing/swiftshader_context.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr const int surface_width{512};
+constexpr const int surface_height{512};
+constexpr const unsigned int render_threads{4};
+constexpr const unsigned int draws_per_frame{10};
+
+GLuint create_texture() {
+  std::vector<uint32_t> pixels(surface_width * surface_height, 0xff0000ff);
+  GLuint texture = 0;
+  s_gles2.glGenTextures(1, &texture);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surface_width, surface_height, 0,
+                       GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  return texture;
+}
+
+struct Result {
+  double finishing_fps = 0.0;
+  double other_fps = 0.0;
+};
+
+// Runs several render threads like the ones serving guest applications.
+// The first one finishes every frame, the others only flush.
+Result run_render_threads(bool use_fence) {
+  std::atomic<bool> running{true};
+  std::atomic<unsigned int> ready{0};
+  std::vector<std::uint64_t> frames(render_threads, 0);
+  std::vector<std::thread> threads;
+
+  for (unsigned int n = 0; n < render_threads; n++) {
+    threads.push_back(std::thread([&, n]() {
+      anbox::testing::SwiftShaderContext context{surface_width, surface_height};
+      if (!context.initialize()) {
+        ready++;
+        return;
+      }
+
+      TextureDraw draw(context.display());
+      const auto texture = create_texture();
+
+      ready++;
+      while (running) {
+        for (unsigned int d = 0; d < draws_per_frame; d++)
+          draw.draw(texture);
+
+        if (n > 0)
+          s_gles2.glFlush();
+        else if (!use_fence || !finishCurrentContext())
+          s_gles2.glFinish();
+
+        frames[n]++;
+      }
+
+      s_gles2.glFinish();
+      s_gles2.glDeleteTextures(1, &texture);
+    }));
+  }
+
+  while (ready < render_threads)
+    std::this_thread::yield();
+
+  const auto duration = std::chrono::seconds{2};
+  std::this_thread::sleep_for(duration);
+  running = false;
+  for (auto &t : threads)
+    t.join();
+
+  Result result;
+  result.finishing_fps = frames[0] / static_cast<double>(duration.count());
+  for (unsigned int n = 1; n < render_threads; n++)
+    result.other_fps += frames[n];
+  result.other_fps /= duration.count() * (render_threads - 1);
+  return result;
+}
+}  // namespace
+
+TEST(FenceSync, FailsWithoutCurrentContext) {
+  // Callers have to fall back to glFinish in this case.
+  ASSERT_FALSE(finishCurrentContext());
+}
+
+TEST(FenceSync, FinishesCurrentContext_requires_swiftshader) {
+  anbox::testing::SwiftShaderContext context{surface_width, surface_height};
+  ASSERT_TRUE(context.initialize());
+
+  TextureDraw draw(context.display());
+  const auto texture = create_texture();
+  ASSERT_TRUE(draw.draw(texture));
+
+  ASSERT_EQ(fenceSyncSupported(context.display()), finishCurrentContext());
+
+  uint32_t pixel = 0;
+  s_gles2.glReadPixels(surface_width / 2, surface_height / 2, 1, 1, GL_RGBA,
+                       GL_UNSIGNED_BYTE, &pixel);
+  ASSERT_EQ(0xff0000ff, pixel);
+  ASSERT_EQ(GL_NO_ERROR, s_gles2.glGetError());
+
+  s_gles2.glDeleteTextures(1, &texture);
+}
+
+TEST(FenceSync, ConcurrentRenderThreads_requires_swiftshader) {
+  const auto with_finish = run_render_threads(false);
+  const auto with_fence = run_render_threads(true);
+
+  std::cout << "FenceSync: glFinish: " << with_finish.finishing_fps << " frames/s finishing thread, "
+            << with_finish.other_fps << " frames/s other threads" << std::endl
+            << "FenceSync: fence:    " << with_fence.finishing_fps << " frames/s finishing thread, "
+            << with_fence.other_fps << " frames/s other threads" << std::endl;
+
+  RecordProperty("finish_other_fps", static_cast<int>(with_finish.other_fps));
+  RecordProperty("fence_other_fps", static_cast<int>(with_fence.other_fps));
+
+  ASSERT_GT(with_finish.finishing_fps, 0);
+  ASSERT_GT(with_fence.finishing_fps, 0);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/frame_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <iostream>
+
+namespace anbox {
+namespace graphics {
+namespace {
+using ms = std::chrono::milliseconds;
+
+// Feeds frames presented at the given offsets from a fixed start, each
+// posted 4 ms before being presented and taking 1 ms to compose.
+void present_frames(FrameStats &stats, const std::string &name, const std::vector<int> &offsets_ms) {
+  const auto start = FrameStats::Clock::now();
+  for (const auto &offset : offsets_ms) {
+    const auto presented = start + ms{offset};
+    stats.record_frame(FrameStats::Source::Window, name, presented - ms{4}, presented, ms{1});
+  }
+}
+}  // namespace
+
+TEST(FrameStats, SmoothFramesHaveNoJank) {
+  FrameStats stats;
+  present_frames(stats, "org.anbox.smooth", {0, 16, 32, 48, 64, 80});
+
+  const auto summaries = stats.summaries();
+  ASSERT_EQ(1u, summaries.size());
+  const auto &summary = summaries[0];
+  ASSERT_EQ("org.anbox.smooth", summary.name);
+  ASSERT_EQ(FrameStats::Source::Window, summary.source);
+  ASSERT_EQ(6u, summary.frames);
+  ASSERT_EQ(0u, summary.late_frames);
+  ASSERT_EQ(0u, summary.dropped_frames);
+  ASSERT_EQ(std::chrono::microseconds{4000}, summary.average_latency);
+  ASSERT_EQ(std::chrono::microseconds{4000}, summary.max_latency);
+  ASSERT_EQ(std::chrono::microseconds{1000}, summary.average_composition);
+
+  // All five intervals fall into the <17 ms bucket.
+  ASSERT_EQ(5u, summary.intervals[1]);
+}
+
+TEST(FrameStats, CountsLateAndDroppedFrames) {
+  FrameStats stats;
+  // The third frame comes 50 ms, three refresh periods, after the second.
+  present_frames(stats, "org.anbox.janky", {0, 16, 66, 82});
+
+  const auto summary = stats.summaries()[0];
+  ASSERT_EQ(4u, summary.frames);
+  ASSERT_EQ(1u, summary.late_frames);
+  ASSERT_EQ(2u, summary.dropped_frames);
+  // <17 ms twice, 50 ms lands in the <100 ms bucket.
+  ASSERT_EQ(2u, summary.intervals[1]);
+  ASSERT_EQ(1u, summary.intervals[5]);
+}
+
+TEST(FrameStats, IdleGapsAreNotJank) {
+  FrameStats stats;
+  present_frames(stats, "org.anbox.idle", {0, 16, 2016, 2032});
+
+  const auto summary = stats.summaries()[0];
+  ASSERT_EQ(4u, summary.frames);
+  ASSERT_EQ(0u, summary.late_frames);
+  ASSERT_EQ(0u, summary.dropped_frames);
+}
+
+TEST(FrameStats, KeepsSourcesApart) {
+  FrameStats stats;
+  present_frames(stats, "org.anbox.a", {0, 16});
+  present_frames(stats, "org.anbox.b", {0});
+
+  const auto now = FrameStats::Clock::now();
+  stats.record_frame(FrameStats::Source::Display, "0", now, now, ms{2});
+
+  const auto summaries = stats.summaries();
+  ASSERT_EQ(3u, summaries.size());
+
+  std::size_t windows = 0;
+  for (const auto &summary : summaries) {
+    if (summary.source == FrameStats::Source::Window)
+      windows++;
+  }
+  ASSERT_EQ(2u, windows);
+
+  const auto dump = stats.dump();
+  ASSERT_NE(std::string::npos, dump.find("window org.anbox.a"));
+  ASSERT_NE(std::string::npos, dump.find("display 0"));
+
+  stats.reset();
+  ASSERT_TRUE(stats.summaries().empty());
+}
+
+TEST(FrameStats, RecordingCost) {
+  FrameStats stats;
+  const auto iterations = 100000;
+  const std::string name{"org.anbox.benchmark"};
+
+  auto presented = FrameStats::Clock::now();
+  const auto start = FrameStats::Clock::now();
+  for (int n = 0; n < iterations; n++) {
+    presented += ms{16};
+    stats.record_frame(FrameStats::Source::Window, name, presented - ms{4}, presented, ms{1});
+  }
+  const auto elapsed = FrameStats::Clock::now() - start;
+
+  const auto per_frame = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+  std::cout << "Recording a frame costs " << per_frame << " ns" << std::endl;
+  RecordProperty("ns_per_frame", static_cast<int>(per_frame));
+
+  ASSERT_EQ(static_cast<std::uint64_t>(iterations), stats.summaries()[0].frames);
+}
+}  // namespace graphics
+}  // namespace anbox
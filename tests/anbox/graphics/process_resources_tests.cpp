@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/emugl/ProcessResources.h"
+
+#include <map>
+
+namespace {
+// Mirrors the color buffer reference counting the Renderer does for
+// every guest connection, without needing any GL.
+class Host {
+ public:
+  typedef ProcessResources::HandleType HandleType;
+
+  // A guest connection as served by a RenderThread. Going out of scope
+  // without closing its references is what happens when the guest
+  // process crashes or gets killed.
+  class Connection {
+   public:
+    Connection(Host &host, uint32_t process = 0) : host_(host), process_(process) {
+      if (process_ == 0)
+        process_ = host_.processes.createProcess();
+      else if (!host_.processes.addConnection(process_))
+        process_ = 0;
+    }
+
+    ~Connection() {
+      host_.processes.removeConnection(process_, [this](HandleType cb, uint32_t references) {
+        auto c = host_.refcounts.find(cb);
+        if (c == host_.refcounts.end())
+          return false;
+        if (references >= c->second) {
+          host_.refcounts.erase(c);
+          return true;
+        }
+        c->second -= references;
+        return false;
+      });
+    }
+
+    uint32_t process() const { return process_; }
+
+    HandleType create() {
+      const auto cb = ++host_.next_handle;
+      host_.refcounts[cb] = 1;
+      host_.processes.addReference(process_, cb);
+      return cb;
+    }
+
+    void open(HandleType cb) {
+      host_.refcounts[cb]++;
+      host_.processes.addReference(process_, cb);
+    }
+
+    void close(HandleType cb) {
+      host_.processes.removeReference(process_, cb);
+      if (--host_.refcounts[cb] == 0)
+        host_.refcounts.erase(cb);
+    }
+
+   private:
+    Host &host_;
+    uint32_t process_;
+  };
+
+  bool alive(HandleType cb) const { return refcounts.find(cb) != refcounts.end(); }
+
+  ProcessResources processes;
+  std::map<HandleType, uint32_t> refcounts;
+  HandleType next_handle = 0;
+};
+}  // namespace
+
+TEST(ProcessResources, ReclaimsReferencesOfDisconnectedProcess) {
+  Host host;
+  Host::HandleType first, second;
+  {
+    Host::Connection connection(host);
+    first = connection.create();
+    second = connection.create();
+    connection.open(first);
+    connection.create();
+    connection.close(host.next_handle);
+  }
+
+  ASSERT_FALSE(host.alive(first));
+  ASSERT_FALSE(host.alive(second));
+  ASSERT_TRUE(host.refcounts.empty());
+
+  const auto stats = host.processes.stats();
+  ASSERT_EQ(0, stats.processes);
+  ASSERT_EQ(0, stats.references);
+  ASSERT_EQ(1, stats.leaking_processes);
+  ASSERT_EQ(3, stats.reclaimed_references);
+  ASSERT_EQ(2, stats.reclaimed_color_buffers);
+}
+
+TEST(ProcessResources, CleanExitIsNotCountedAsLeak) {
+  Host host;
+  {
+    Host::Connection connection(host);
+    const auto cb = connection.create();
+    connection.open(cb);
+    connection.close(cb);
+    connection.close(cb);
+  }
+
+  const auto stats = host.processes.stats();
+  ASSERT_EQ(0, stats.leaking_processes);
+  ASSERT_EQ(0, stats.reclaimed_references);
+  ASSERT_TRUE(host.refcounts.empty());
+}
+
+TEST(ProcessResources, KeepsBuffersSharedWithLiveProcess) {
+  Host host;
+  Host::Connection consumer(host);
+
+  Host::HandleType cb;
+  {
+    Host::Connection producer(host);
+    cb = producer.create();
+    consumer.open(cb);
+  }
+
+  // The producer is gone but the consumer still uses the buffer.
+  ASSERT_TRUE(host.alive(cb));
+  ASSERT_EQ(1, host.refcounts[cb]);
+  ASSERT_EQ(1, host.processes.stats().reclaimed_references);
+  ASSERT_EQ(0, host.processes.stats().reclaimed_color_buffers);
+
+  consumer.close(cb);
+  ASSERT_FALSE(host.alive(cb));
+}
+
+TEST(ProcessResources, WaitsForLastConnectionOfProcess) {
+  Host host;
+  Host::HandleType cb;
+  std::unique_ptr<Host::Connection> anchor(new Host::Connection(host));
+  {
+    Host::Connection render_thread(host, anchor->process());
+    ASSERT_EQ(anchor->process(), render_thread.process());
+    cb = render_thread.create();
+  }
+
+  // A thread of the process exiting doesn't mean the process is gone.
+  ASSERT_TRUE(host.alive(cb));
+  ASSERT_EQ(1, host.processes.stats().processes);
+  ASSERT_EQ(1, host.processes.stats().references);
+
+  anchor.reset();
+  ASSERT_FALSE(host.alive(cb));
+  ASSERT_EQ(0, host.processes.stats().processes);
+}
+
+TEST(ProcessResources, ReferencesClosedByOtherProcessAreNotDroppedTwice) {
+  Host host;
+  Host::Connection consumer(host);
+
+  Host::HandleType cb;
+  {
+    Host::Connection producer(host);
+    cb = producer.create();
+    consumer.open(cb);
+    // SurfaceFlinger style hand over: the consumer drops the reference
+    // the producer took.
+    consumer.close(cb);
+    consumer.close(cb);
+    ASSERT_FALSE(host.alive(cb));
+  }
+
+  // The reclaimed reference points to a buffer which doesn't exist
+  // anymore, which must be harmless.
+  ASSERT_TRUE(host.refcounts.empty());
+  ASSERT_EQ(0, host.processes.stats().reclaimed_color_buffers);
+}
+
+TEST(ProcessResources, UnknownProcessIsNotTracked) {
+  Host host;
+  Host::HandleType cb;
+  {
+    Host::Connection connection(host, 42);
+    ASSERT_EQ(0, connection.process());
+    cb = connection.create();
+  }
+
+  // Without a process we can't tell whether somebody else still uses
+  // the buffer, so it has to stay.
+  ASSERT_TRUE(host.alive(cb));
+  ASSERT_EQ(0, host.processes.stats().leaking_processes);
+}
+
+TEST(ProcessResources, ReclaimsManyAbruptlyDisconnectedProcesses) {
+  Host host;
+  Host::Connection system_server(host);
+
+  for (int n = 0; n < 100; n++) {
+    Host::Connection app(host);
+    for (int b = 0; b < 3; b++) {
+      const auto cb = app.create();
+      // Every other buffer is also shown by a long running process.
+      if (b == 0)
+        system_server.open(cb);
+    }
+  }
+
+  ASSERT_EQ(100, host.refcounts.size());
+  const auto stats = host.processes.stats();
+  ASSERT_EQ(1, stats.processes);
+  ASSERT_EQ(100, stats.references);
+  ASSERT_EQ(100, stats.leaking_processes);
+  ASSERT_EQ(300, stats.reclaimed_references);
+  ASSERT_EQ(200, stats.reclaimed_color_buffers);
+}
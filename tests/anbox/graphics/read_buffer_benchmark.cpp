@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Compares the decode throughput of the mirrored ReadBuffer with the
+// compacting buffer it replaced. Not a test, it is built next to the
+// tests but ctest doesn't run it.
+
+#include "anbox/graphics/emugl/ReadBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+// Serves a prepared byte stream in chunks of at most chunk_size bytes like
+// a socket would.
+class FakeStream : public IOStream {
+ public:
+  FakeStream(const std::vector<std::uint8_t> &data, size_t chunk_size)
+      : IOStream(0), data_(data), chunk_size_(chunk_size) {}
+
+  void *allocBuffer(size_t) override { return nullptr; }
+  size_t commitBuffer(size_t) override { return 0; }
+  void forceStop() override {}
+
+  const unsigned char *read(void *buf, size_t *inout_len) override {
+    if (position_ == data_.size())
+      return nullptr;
+
+    const auto len = std::min<size_t>({*inout_len, chunk_size_, data_.size() - position_});
+    memcpy(buf, data_.data() + position_, len);
+    position_ += len;
+    *inout_len = len;
+    return static_cast<const unsigned char*>(buf);
+  }
+
+ private:
+  const std::vector<std::uint8_t> &data_;
+  size_t chunk_size_;
+  size_t position_ = 0;
+};
+
+// The buffer as it was before: compacting with memmove before every read
+// and growing by realloc without ever shrinking again.
+class CompactingReadBuffer {
+ public:
+  CompactingReadBuffer(size_t size)
+      : m_buf(static_cast<unsigned char*>(malloc(size))), m_readPtr(m_buf), m_size(size) {}
+  ~CompactingReadBuffer() { free(m_buf); }
+
+  int getData(IOStream *stream) {
+    if ((m_validData > 0) && (m_readPtr > m_buf)) {
+      memmove(m_buf, m_readPtr, m_validData);
+      moved_bytes += m_validData;
+    }
+    size_t len = m_size - m_validData;
+    if (len == 0) {
+      m_size *= 2;
+      m_buf = static_cast<unsigned char*>(realloc(m_buf, m_size));
+      len = m_size - m_validData;
+    }
+    m_readPtr = m_buf;
+    if (NULL != stream->read(m_buf + m_validData, &len)) {
+      m_validData += len;
+      return len;
+    }
+    return -1;
+  }
+  unsigned char *buf() { return m_readPtr; }
+  size_t validData() { return m_validData; }
+  void consume(size_t amount) {
+    m_validData -= amount;
+    m_readPtr += amount;
+  }
+  size_t size() const { return m_size; }
+
+  size_t moved_bytes = 0;
+
+ private:
+  unsigned char *m_buf;
+  unsigned char *m_readPtr;
+  size_t m_size;
+  size_t m_validData = 0;
+};
+
+void append_command(std::vector<std::uint8_t> &stream, std::uint32_t size) {
+  const auto offset = stream.size();
+  stream.resize(offset + size, 0x42);
+  memcpy(stream.data() + offset, &size, sizeof(size));
+}
+
+// Decodes like the GL decoders do: only complete commands are consumed,
+// everything else stays in the buffer until more data arrived.
+template <typename Buffer>
+size_t decode_all(Buffer &buffer, IOStream *stream) {
+  size_t commands = 0;
+  while (buffer.getData(stream) > 0) {
+    while (buffer.validData() >= sizeof(std::uint32_t)) {
+      std::uint32_t size = 0;
+      memcpy(&size, buffer.buf(), sizeof(size));
+      if (buffer.validData() < size)
+        break;
+      buffer.consume(size);
+      commands++;
+    }
+  }
+  return commands;
+}
+
+template <typename Buffer>
+double decode_ms(Buffer &buffer, const std::vector<std::uint8_t> &data, size_t chunk_size) {
+  FakeStream stream(data, chunk_size);
+  const auto start = std::chrono::steady_clock::now();
+  decode_all(buffer, &stream);
+  return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+      std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+int main() {
+  // Mostly small GL calls with a texture upload every now and then.
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<std::uint32_t> small_size(16, 512);
+  std::uniform_int_distribution<std::uint32_t> large_size(256 * 1024, 8 * 1024 * 1024);
+
+  std::vector<std::uint8_t> data;
+  size_t num_commands = 0;
+  while (data.size() < 192 * 1024 * 1024) {
+    append_command(data, num_commands % 2000 == 1999 ? large_size(generator) : small_size(generator));
+    num_commands++;
+  }
+  // Some quiet time at the end so the buffer can settle again.
+  for (size_t n = 0; n < 150000; n++, num_commands++)
+    append_command(data, small_size(generator));
+
+  const size_t initial_size = 4 * 1024 * 1024;
+  const size_t chunk_size = 128 * 1024;
+
+  CompactingReadBuffer compacting(initial_size);
+  const auto compacting_ms = decode_ms(compacting, data, chunk_size);
+
+  ReadBuffer buffer(initial_size);
+  const auto ring_ms = decode_ms(buffer, data, chunk_size);
+
+  std::cout << "Decoded " << num_commands << " commands (" << data.size() / (1024 * 1024) << " MB)" << std::endl
+            << "  compacting: " << compacting_ms << " ms, "
+            << compacting.moved_bytes / (1024 * 1024) << " MB moved, "
+            << compacting.size() / 1024 << " KB buffer left" << std::endl
+            << "  ring:       " << ring_ms << " ms, "
+            << buffer.size() / 1024 << " KB buffer left" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/ReadBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+// Serves a prepared byte stream in chunks of at most chunk_size bytes like
+// a socket would.
+class FakeStream : public IOStream {
+ public:
+  FakeStream(const std::vector<std::uint8_t> &data, size_t chunk_size)
+      : IOStream(0), data_(data), chunk_size_(chunk_size) {}
+
+  void *allocBuffer(size_t) override { return nullptr; }
+  size_t commitBuffer(size_t) override { return 0; }
+  void forceStop() override {}
+
+  const unsigned char *read(void *buf, size_t *inout_len) override {
+    if (position_ == data_.size())
+      return nullptr;
+
+    const auto len = std::min<size_t>({*inout_len, chunk_size_, data_.size() - position_});
+    memcpy(buf, data_.data() + position_, len);
+    position_ += len;
+    *inout_len = len;
+    return static_cast<const unsigned char*>(buf);
+  }
+
+ private:
+  const std::vector<std::uint8_t> &data_;
+  size_t chunk_size_;
+  size_t position_ = 0;
+};
+
+// Serves a prepared byte stream with a given size for every read, the
+// last size is used for all remaining reads.
+class ScriptedStream : public IOStream {
+ public:
+  ScriptedStream(const std::vector<std::uint8_t> &data, const std::vector<size_t> &read_sizes)
+      : IOStream(0), data_(data), read_sizes_(read_sizes) {}
+
+  void *allocBuffer(size_t) override { return nullptr; }
+  size_t commitBuffer(size_t) override { return 0; }
+  void forceStop() override {}
+
+  const unsigned char *read(void *buf, size_t *inout_len) override {
+    if (position_ == data_.size())
+      return nullptr;
+
+    const auto read_size = read_sizes_[std::min(reads_++, read_sizes_.size() - 1)];
+    const auto len = std::min<size_t>({*inout_len, read_size, data_.size() - position_});
+    memcpy(buf, data_.data() + position_, len);
+    position_ += len;
+    *inout_len = len;
+    return static_cast<const unsigned char*>(buf);
+  }
+
+ private:
+  const std::vector<std::uint8_t> &data_;
+  std::vector<size_t> read_sizes_;
+  size_t reads_ = 0;
+  size_t position_ = 0;
+};
+
+// Every command starts with its total size followed by a payload where
+// each byte is derived from the command index so corrupted or reordered
+// data gets noticed.
+void append_command(std::vector<std::uint8_t> &stream, std::uint32_t size, std::uint32_t index) {
+  const auto offset = stream.size();
+  stream.resize(offset + size);
+  memcpy(stream.data() + offset, &size, sizeof(size));
+  for (size_t n = sizeof(size); n < size; n++)
+    stream[offset + n] = static_cast<std::uint8_t>(index + n);
+}
+
+bool command_is_intact(const std::uint8_t *data, std::uint32_t size, std::uint32_t index) {
+  for (size_t n = sizeof(size); n < size; n++) {
+    if (data[n] != static_cast<std::uint8_t>(index + n))
+      return false;
+  }
+  return true;
+}
+
+// Decodes like the GL decoders do: only complete commands are consumed,
+// everything else stays in the buffer until more data arrived.
+template <typename Buffer>
+size_t decode_all(Buffer &buffer, IOStream *stream, bool &valid) {
+  size_t commands = 0;
+  valid = true;
+  while (buffer.getData(stream) > 0) {
+    while (buffer.validData() >= sizeof(std::uint32_t)) {
+      std::uint32_t size = 0;
+      memcpy(&size, buffer.buf(), sizeof(size));
+      if (buffer.validData() < size)
+        break;
+
+      if (!command_is_intact(buffer.buf(), size, commands))
+        valid = false;
+
+      buffer.consume(size);
+      commands++;
+    }
+  }
+  return commands;
+}
+}  // namespace
+
+TEST(ReadBuffer, DecodesCommandsAcrossTheWrapPoint) {
+  std::vector<std::uint8_t> data;
+  const size_t num_commands = 1000;
+  for (size_t n = 0; n < num_commands; n++)
+    append_command(data, 1000 + n % 7, n);
+
+  FakeStream stream(data, 3000);
+  ReadBuffer buffer(4096);
+  ASSERT_TRUE(buffer.mirrored());
+
+  bool valid = false;
+  ASSERT_EQ(num_commands, decode_all(buffer, &stream, valid));
+  ASSERT_TRUE(valid);
+  ASSERT_EQ(0u, buffer.validData());
+  ASSERT_EQ(4096u, buffer.size());
+}
+
+TEST(ReadBuffer, KeepsWrappedLeftoversIntact) {
+  std::vector<std::uint8_t> data;
+  append_command(data, 40000, 0);
+  append_command(data, 22000, 1);
+  append_command(data, 5000, 2);
+
+  // After the second read the partial third command crosses the end of
+  // the ring and is small enough to be considered for compaction.
+  ScriptedStream stream(data, {60000, 6000, 64 * 1024});
+  ReadBuffer buffer(64 * 1024);
+  ASSERT_TRUE(buffer.mirrored());
+  ASSERT_EQ(64u * 1024u, buffer.size());
+
+  bool valid = false;
+  ASSERT_EQ(3u, decode_all(buffer, &stream, valid));
+  ASSERT_TRUE(valid);
+  ASSERT_EQ(0u, buffer.validData());
+}
+
+TEST(ReadBuffer, CompactsLeftoversWhichDontWrap) {
+  std::vector<std::uint8_t> data;
+  size_t num_commands = 0;
+  for (size_t n = 0; n < 200; n++)
+    append_command(data, 700 + n % 13, num_commands++);
+
+  // Uneven reads leave small partial commands at varying offsets.
+  ScriptedStream stream(data, {5000, 3333, 1234, 7777});
+  ReadBuffer buffer(16 * 1024);
+
+  bool valid = false;
+  ASSERT_EQ(num_commands, decode_all(buffer, &stream, valid));
+  ASSERT_TRUE(valid);
+}
+
+TEST(ReadBuffer, GrowsForLargeCommandsAndShrinksAfterwards) {
+  std::vector<std::uint8_t> data;
+  size_t num_commands = 0;
+  append_command(data, 16, num_commands++);
+  append_command(data, 256 * 1024, num_commands++);
+  // The buffer only shrinks after a few times its size went through it
+  // without another large command.
+  for (size_t n = 0; n < 40000; n++)
+    append_command(data, 64, num_commands++);
+
+  FakeStream stream(data, 4096);
+  ReadBuffer buffer(4096);
+
+  size_t max_size = 0;
+  size_t commands = 0;
+  while (buffer.getData(&stream) > 0) {
+    max_size = std::max(max_size, buffer.size());
+    while (buffer.validData() >= sizeof(std::uint32_t)) {
+      std::uint32_t size = 0;
+      memcpy(&size, buffer.buf(), sizeof(size));
+      if (buffer.validData() < size)
+        break;
+      buffer.consume(size);
+      commands++;
+    }
+  }
+
+  ASSERT_EQ(num_commands, commands);
+  ASSERT_GE(max_size, 256u * 1024u);
+  ASSERT_EQ(4096u, buffer.size());
+}
+
+TEST(ReadBuffer, SettlesAfterBurstsOfLargeCommands) {
+  // Mostly small GL calls with a texture upload every now and then.
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<std::uint32_t> small_size(16, 512);
+  std::uniform_int_distribution<std::uint32_t> large_size(256 * 1024, 2 * 1024 * 1024);
+
+  std::vector<std::uint8_t> data;
+  size_t num_commands = 0;
+  while (data.size() < 24 * 1024 * 1024) {
+    const auto size = num_commands % 500 == 499 ? large_size(generator) : small_size(generator);
+    append_command(data, size, num_commands++);
+  }
+  // Some quiet time at the end so the buffer can settle again.
+  const auto burst_end = data.size();
+  while (data.size() - burst_end < 24 * 1024 * 1024)
+    append_command(data, small_size(generator), num_commands++);
+
+  const size_t initial_size = 1024 * 1024;
+  ReadBuffer buffer(initial_size);
+  FakeStream stream(data, 128 * 1024);
+
+  bool valid = false;
+  ASSERT_EQ(num_commands, decode_all(buffer, &stream, valid));
+  ASSERT_TRUE(valid);
+  ASSERT_EQ(initial_size, buffer.size());
+}
@@ -18,12 +18,230 @@
 #include <gtest/gtest.h>
 
 #include "anbox/graphics/emugl/DisplayManager.h"
+#include "anbox/graphics/emugl/ReadBuffer.h"
+#include "anbox/graphics/emugl/RenderControl.h"
+
+#include "external/android-emugl/shared/OpenglCodecCommon/ChecksumCalculatorThreadInfo.h"
+
+// Generated with emugl at build time
+#include "renderControl_opcodes.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <GLES/gl.h>
 
 extern int rcGetDisplayWidth(uint32_t display_id);
 extern int rcGetDisplayHeight(uint32_t display_id);
 
+namespace {
+constexpr const uint32_t window_surface{1};
+constexpr const uint32_t color_buffer{2};
+
+// Host side of a guest connection which talks over a plain socket
+// instead of the qemu pipe.
+class SocketStream : public IOStream {
+ public:
+  explicit SocketStream(int fd) : IOStream(4096), fd_(fd) {}
+
+  void *allocBuffer(size_t minSize) override {
+    buffer_.resize(minSize);
+    return buffer_.data();
+  }
+
+  size_t commitBuffer(size_t size) override {
+    return ::write(fd_, buffer_.data(), size) == static_cast<ssize_t>(size) ? size : 0;
+  }
+
+  const unsigned char *read(void *buf, size_t *inout_len) override {
+    const auto r = ::read(fd_, buf, *inout_len);
+    if (r <= 0)
+      return nullptr;
+    *inout_len = r;
+    return static_cast<const unsigned char*>(buf);
+  }
+
+  void forceStop() override { ::shutdown(fd_, SHUT_RDWR); }
+
+ private:
+  int fd_;
+  std::vector<unsigned char> buffer_;
+};
+
+std::atomic<unsigned int> async_flushes{0};
+rcFlushWindowColorBufferAsync_server_proc_t real_flush_async = nullptr;
+
+void counting_flush_async(uint32_t windowSurface) {
+  async_flushes++;
+  real_flush_async(windowSurface);
+}
+
+// Runs the renderControl decoder like a RenderThread does but without
+// any GL so only the cost of the protocol itself is measured.
+class Host {
+ public:
+  Host() {
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
+    thread_ = std::thread([this]() {
+      ChecksumCalculatorThreadInfo checksum_info;
+      renderControl_decoder_context_t decoder;
+      initRenderControlContext(&decoder);
+      real_flush_async = decoder.rcFlushWindowColorBufferAsync;
+      decoder.rcFlushWindowColorBufferAsync = counting_flush_async;
+
+      SocketStream stream(fds_[1]);
+      ReadBuffer buffer(64 * 1024);
+      while (buffer.getData(&stream) > 0) {
+        size_t last = 0;
+        while ((last = decoder.decode(buffer.buf(), buffer.validData(), &stream)) > 0)
+          buffer.consume(last);
+      }
+    });
+  }
+
+  ~Host() {
+    ::shutdown(fds_[0], SHUT_RDWR);
+    thread_.join();
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+  }
+
+  int guest_fd() const { return fds_[0]; }
+
+ private:
+  int fds_[2];
+  std::thread thread_;
+};
+
+// Encodes calls the same way the generated guest encoder does.
+class Guest {
+ public:
+  explicit Guest(int fd) : fd_(fd) {}
+
+  void call(uint32_t opcode, const std::vector<uint32_t> &args) {
+    const uint32_t size = 8 + args.size() * sizeof(uint32_t);
+    append(opcode);
+    append(size);
+    for (const auto &arg : args)
+      append(arg);
+  }
+
+  void flush() {
+    ASSERT_EQ(static_cast<ssize_t>(buffer_.size()), ::write(fd_, buffer_.data(), buffer_.size()));
+    buffer_.clear();
+  }
+
+  int reply() {
+    flush();
+    int value = 0;
+    EXPECT_EQ(static_cast<ssize_t>(sizeof(value)), ::read(fd_, &value, sizeof(value)));
+    return value;
+  }
+
+  // Does what eglSwapBuffers does on the guest side.
+  void swap_buffers(bool async) {
+    if (async) {
+      call(OP_rcFlushWindowColorBufferAsync, {window_surface});
+      flush();
+    } else {
+      call(OP_rcFlushWindowColorBuffer, {window_surface});
+      reply();
+    }
+    call(OP_rcSetWindowColorBuffer, {window_surface, color_buffer});
+  }
+
+ private:
+  void append(uint32_t value) {
+    const auto ptr = reinterpret_cast<const unsigned char*>(&value);
+    buffer_.insert(buffer_.end(), ptr, ptr + sizeof(value));
+  }
+
+  int fd_;
+  std::vector<unsigned char> buffer_;
+};
+
+double measure_frames_per_second(bool async) {
+  Host host;
+  Guest guest(host.guest_fd());
+
+  const unsigned int frames = 5000;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned int n = 0; n < frames; n++)
+    guest.swap_buffers(async);
+  // Wait for the host to catch up so we measure until the last frame
+  // was decoded and not only until it was sent.
+  guest.call(OP_rcFlushWindowColorBuffer, {window_surface});
+  guest.reply();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+      std::chrono::steady_clock::now() - start);
+
+  return frames / elapsed.count();
+}
+}  // namespace
+
 TEST(RenderControl, WidthHeightAreCorrectlyAssigned) {
   anbox::graphics::emugl::DisplayInfo::get()->set_resolution(640, 480);
   ASSERT_EQ(rcGetDisplayWidth(0), 640);
   ASSERT_EQ(rcGetDisplayHeight(0), 480);
 }
+
+TEST(RenderControl, AdvertisesFeatures) {
+  renderControl_decoder_context_t decoder;
+  initRenderControlContext(&decoder);
+
+  const auto size = decoder.rcGetGLString(GL_EXTENSIONS, nullptr, 0);
+  ASSERT_LT(size, 0);
+  std::vector<char> extensions(-size);
+  ASSERT_EQ(-size, decoder.rcGetGLString(GL_EXTENSIONS, extensions.data(), extensions.size()));
+  ASSERT_NE(nullptr, std::strstr(extensions.data(), "ANDROID_EMU_async_frame_commands"));
+  ASSERT_NE(nullptr, std::strstr(extensions.data(), "ANDROID_EMU_process_tracking"));
+  // Only a hardware renderer converts YUV color buffers.
+  ASSERT_EQ(nullptr, std::strstr(extensions.data(), "ANDROID_EMU_yuv_color_buffers"));
+}
+
+TEST(RenderControl, ProcessIdWithoutRendererIsIgnored) {
+  Host host;
+  Guest guest(host.guest_fd());
+
+  // Connections of guests which can't be tracked still have to work.
+  guest.call(OP_rcSetProcessId, {1});
+  guest.call(OP_rcFlushWindowColorBuffer, {window_surface});
+  ASSERT_EQ(-1, guest.reply());
+}
+
+TEST(RenderControl, AsyncFlushesAreDecodedInStreamOrder) {
+  async_flushes = 0;
+
+  Host host;
+  Guest guest(host.guest_fd());
+
+  for (unsigned int n = 0; n < 100; n++)
+    guest.swap_buffers(true);
+
+  // The reply of a synchronous call can only arrive once everything sent
+  // before it was processed. Without a renderer every flush fails, which
+  // the synchronous call has to report.
+  guest.call(OP_rcFlushWindowColorBuffer, {window_surface});
+  ASSERT_EQ(-1, guest.reply());
+  ASSERT_EQ(100, async_flushes);
+}
+
+TEST(RenderControl, FramesPerSecondWithAndWithoutRoundTrip) {
+  const auto sync_fps = measure_frames_per_second(false);
+  const auto async_fps = measure_frames_per_second(true);
+
+  std::cout << "RenderControl: " << sync_fps << " frames/s with a round trip per frame, "
+            << async_fps << " frames/s without" << std::endl;
+  RecordProperty("sync_frames_per_second", static_cast<int>(sync_fps));
+  RecordProperty("async_frames_per_second", static_cast<int>(async_fps));
+
+  EXPECT_GT(async_fps, sync_fps);
+}
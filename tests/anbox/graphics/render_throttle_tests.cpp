@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/common/thread_topology.h"
+#include "anbox/graphics/render_throttle.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace anbox::graphics;
+
+namespace {
+constexpr const anbox::wm::Task::Id foreground_task{1};
+constexpr const anbox::wm::Task::Id background_task{2};
+
+// Simulates the render thread of an application which needs a few
+// milliseconds of CPU time per frame and renders as fast as it can.
+class SyntheticLoad {
+ public:
+  SyntheticLoad(const std::shared_ptr<RenderThrottle> &throttle,
+                std::uint32_t color_buffer)
+      : throttle_(throttle), color_buffer_(color_buffer) {}
+
+  ~SyntheticLoad() { stop(); }
+
+  void start() {
+    thread_ = std::thread([this]() {
+      auto connection = throttle_->connect("render-test");
+      // Let the compositor know about our buffer before rendering for real.
+      connection->frame_flushed(color_buffer_);
+      connection->wait_for_next_frame();
+      ready_ = true;
+
+      while (running_) {
+        const auto busy_until = std::chrono::steady_clock::now() + std::chrono::milliseconds{2};
+        while (std::chrono::steady_clock::now() < busy_until)
+          ;
+        connection->frame_flushed(color_buffer_);
+        connection->wait_for_next_frame();
+        frames_++;
+      }
+    });
+
+    while (!ready_)
+      std::this_thread::yield();
+  }
+
+  void stop() {
+    running_ = false;
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  std::uint64_t frames() const { return frames_; }
+
+ private:
+  std::shared_ptr<RenderThrottle> throttle_;
+  std::uint32_t color_buffer_;
+  std::thread thread_;
+  std::atomic<bool> ready_{false};
+  std::atomic<bool> running_{true};
+  std::atomic<std::uint64_t> frames_{0};
+};
+
+double measure_fps(const SyntheticLoad &load, const std::chrono::milliseconds &duration) {
+  const auto start_frames = load.frames();
+  const auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(duration);
+  const auto frames = load.frames() - start_frames;
+  const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+      std::chrono::steady_clock::now() - start);
+  return frames / elapsed.count();
+}
+}  // namespace
+
+TEST(RenderThrottle, DefaultCaps) {
+  auto throttle = std::make_shared<RenderThrottle>();
+  throttle->set_task_state(foreground_task, RenderThrottle::State::Foreground);
+  throttle->set_task_state(background_task, RenderThrottle::State::Background);
+  throttle->set_task_state(3, RenderThrottle::State::Hidden);
+
+  EXPECT_EQ(0u, throttle->frame_rate_cap(foreground_task));
+  EXPECT_EQ(30u, throttle->frame_rate_cap(background_task));
+  EXPECT_EQ(5u, throttle->frame_rate_cap(3));
+  // Tasks we don't know anything about are not throttled.
+  EXPECT_EQ(RenderThrottle::State::Foreground, throttle->task_state(4));
+  EXPECT_EQ(0u, throttle->frame_rate_cap(4));
+}
+
+TEST(RenderThrottle, PackageCapAppliesInEveryState) {
+  auto throttle = std::make_shared<RenderThrottle>();
+  throttle->set_task_package(foreground_task, "com.example.game");
+  throttle->set_frame_rate_cap("com.example.game", 45);
+  EXPECT_EQ(45u, throttle->frame_rate_cap(foreground_task));
+
+  // The stricter cap wins.
+  throttle->set_task_state(foreground_task, RenderThrottle::State::Background);
+  EXPECT_EQ(30u, throttle->frame_rate_cap(foreground_task));
+
+  throttle->set_frame_rate_cap(RenderThrottle::State::Background, 0);
+  EXPECT_EQ(45u, throttle->frame_rate_cap(foreground_task));
+}
+
+TEST(RenderThrottle, ConfigureFromSpec) {
+  auto throttle = std::make_shared<RenderThrottle>();
+  throttle->configure("background=20;hidden=0;com.example.game=10");
+
+  throttle->set_task_state(background_task, RenderThrottle::State::Background);
+  EXPECT_EQ(20u, throttle->frame_rate_cap(background_task));
+
+  throttle->set_task_state(background_task, RenderThrottle::State::Hidden);
+  EXPECT_EQ(0u, throttle->frame_rate_cap(background_task));
+
+  throttle->set_task_package(foreground_task, "com.example.game");
+  EXPECT_EQ(10u, throttle->frame_rate_cap(foreground_task));
+
+  EXPECT_THROW(throttle->configure("background"), std::runtime_error);
+  EXPECT_THROW(throttle->configure("hidden=-1"), std::runtime_error);
+  EXPECT_THROW(throttle->configure("=5"), std::runtime_error);
+  EXPECT_THROW(throttle->configure("background=fast"), std::runtime_error);
+  // Nothing changes with an invalid specification.
+  throttle->set_task_state(background_task, RenderThrottle::State::Background);
+  EXPECT_EQ(20u, throttle->frame_rate_cap(background_task));
+}
+
+TEST(RenderThrottle, LearnsTaskFromPresentedBuffers) {
+  auto throttle = std::make_shared<RenderThrottle>();
+  auto first = throttle->connect("render-0");
+  auto second = throttle->connect("render-1");
+
+  first->frame_flushed(10);
+  second->frame_flushed(20);
+  EXPECT_EQ(0, throttle->task_for_connection(*first));
+
+  throttle->buffers_presented(foreground_task, {10});
+  throttle->buffers_presented(background_task, {20, 30});
+  EXPECT_EQ(foreground_task, throttle->task_for_connection(*first));
+  EXPECT_EQ(background_task, throttle->task_for_connection(*second));
+
+  throttle->remove_task(background_task);
+  EXPECT_EQ(0, throttle->task_for_connection(*second));
+
+  // Buffers of disconnected threads are forgotten.
+  second.reset();
+  throttle->buffers_presented(foreground_task, {20});
+  EXPECT_EQ(foreground_task, throttle->task_for_connection(*first));
+}
+
+TEST(RenderThrottle, ForgetsClosedBuffers) {
+  auto throttle = std::make_shared<RenderThrottle>();
+  auto connection = throttle->connect("render-0");
+
+  connection->frame_flushed(10);
+  throttle->buffer_closed(10);
+
+  // A buffer which reuses the handle isn't rendered by the connection.
+  throttle->buffers_presented(background_task, {10});
+  EXPECT_EQ(0, throttle->task_for_connection(*connection));
+}
+
+TEST(RenderThrottle, ForegroundHoldsFrameRateWhileBackgroundIsThrottled) {
+  auto throttle = std::make_shared<RenderThrottle>();
+  throttle->set_frame_rate_cap(RenderThrottle::State::Background, 20);
+
+  SyntheticLoad foreground{throttle, 1};
+  SyntheticLoad background{throttle, 2};
+  foreground.start();
+  background.start();
+
+  // Measure how fast the foreground load renders without any throttling.
+  const auto unthrottled_fps = measure_fps(foreground, std::chrono::milliseconds{500});
+
+  throttle->buffers_presented(foreground_task, {1});
+  throttle->buffers_presented(background_task, {2});
+  throttle->set_task_state(foreground_task, RenderThrottle::State::Foreground);
+  throttle->set_task_state(background_task, RenderThrottle::State::Background);
+
+  // Let the background load settle on the cap.
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+  const auto duration = std::chrono::seconds{1};
+  const auto start_fg = foreground.frames();
+  const auto start_bg = background.frames();
+  const auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(duration);
+  const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+      std::chrono::steady_clock::now() - start).count();
+  const auto foreground_fps = (foreground.frames() - start_fg) / elapsed;
+  const auto background_fps = (background.frames() - start_bg) / elapsed;
+
+  std::cout << "RenderThrottle: foreground " << foreground_fps << " fps (unthrottled "
+            << unthrottled_fps << " fps), background " << background_fps << " fps" << std::endl;
+
+  // The frame rate of the focused application must not suffer.
+  EXPECT_GT(foreground_fps, unthrottled_fps * 0.75);
+  // The background one is held at its cap with some room for scheduling.
+  EXPECT_LE(background_fps, 22);
+  EXPECT_GE(background_fps, 10);
+}
+
+TEST(RenderThrottle, FocusChangeReleasesWaitingThread) {
+  auto throttle = std::make_shared<RenderThrottle>();
+  throttle->set_frame_rate_cap(RenderThrottle::State::Hidden, 1);
+
+  SyntheticLoad load{throttle, 1};
+  throttle->set_task_state(background_task, RenderThrottle::State::Hidden);
+  load.start();
+  throttle->buffers_presented(background_task, {1});
+
+  // Wait until the load is held back at one frame per second.
+  std::this_thread::sleep_for(std::chrono::milliseconds{1200});
+  EXPECT_LE(measure_fps(load, std::chrono::milliseconds{500}), 4);
+
+  // Focusing the window must not leave the thread sleeping until its
+  // hidden frame is due.
+  throttle->set_task_state(background_task, RenderThrottle::State::Foreground);
+  EXPECT_GT(measure_fps(load, std::chrono::milliseconds{300}), 50);
+}
+
+TEST(RenderThrottle, RefocusedThreadGetsItsPriorityBack) {
+  using anbox::common::ThreadClass;
+  using anbox::common::ThreadTopology;
+
+  auto throttle = std::make_shared<RenderThrottle>();
+  // Only the thread class matters here, don't let the caps slow us down.
+  throttle->set_frame_rate_cap(RenderThrottle::State::Hidden, 0);
+  throttle->set_task_state(background_task, RenderThrottle::State::Hidden);
+
+  int initial_nice = 0;
+  int hidden_nice = 0;
+  int refocused_nice = 0;
+  std::thread thread([&]() {
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    ThreadTopology::instance().apply(ThreadClass::Render, "render-test");
+    initial_nice = getpriority(PRIO_PROCESS, tid);
+
+    auto connection = throttle->connect("render-test");
+    connection->frame_flushed(1);
+    throttle->buffers_presented(background_task, {1});
+    connection->wait_for_next_frame();
+    hidden_nice = getpriority(PRIO_PROCESS, tid);
+
+    throttle->set_task_state(background_task, RenderThrottle::State::Foreground);
+    connection->frame_flushed(1);
+    connection->wait_for_next_frame();
+    refocused_nice = getpriority(PRIO_PROCESS, tid);
+  });
+  thread.join();
+
+  const auto &topology = ThreadTopology::instance();
+  // Whether the hidden thread was demoted depends on our privileges but
+  // never at the price of staying demoted.
+  if (topology.can_switch(ThreadClass::Background, ThreadClass::Render))
+    EXPECT_EQ(topology.policy(ThreadClass::Background).nice, hidden_nice);
+  else
+    EXPECT_EQ(initial_nice, hidden_nice);
+  EXPECT_EQ(initial_nice, refocused_nice);
+}
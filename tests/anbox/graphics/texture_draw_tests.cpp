@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/emugl/TextureDraw.h"
+#include "anbox/testing/swiftshader_context.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace {
+constexpr const int surface_width{512};
+constexpr const int surface_height{512};
+
+GLuint create_texture() {
+  std::vector<uint32_t> pixels(surface_width * surface_height, 0xff00ff00);
+  GLuint texture = 0;
+  s_gles2.glGenTextures(1, &texture);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surface_width, surface_height, 0,
+                       GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  return texture;
+}
+}  // namespace
+
+TEST(TextureDraw, FillsFramebufferWithTexture_requires_swiftshader) {
+  anbox::testing::SwiftShaderContext context{surface_width, surface_height};
+  ASSERT_TRUE(context.initialize());
+
+  TextureDraw draw(context.display());
+  const auto texture = create_texture();
+  ASSERT_TRUE(draw.draw(texture));
+
+  uint32_t pixel = 0;
+  s_gles2.glReadPixels(surface_width / 2, surface_height / 2, 1, 1, GL_RGBA,
+                       GL_UNSIGNED_BYTE, &pixel);
+  ASSERT_EQ(0xff00ff00, pixel);
+  ASSERT_EQ(GL_NO_ERROR, s_gles2.glGetError());
+
+  s_gles2.glDeleteTextures(1, &texture);
+}
+
+TEST(TextureDraw, DrawsPerSecond_requires_swiftshader) {
+  anbox::testing::SwiftShaderContext context{surface_width, surface_height};
+  ASSERT_TRUE(context.initialize());
+
+  TextureDraw draw(context.display());
+  const auto texture = create_texture();
+
+  // Warm up so shader compilation and first-use costs are not measured.
+  for (int n = 0; n < 10; n++)
+    ASSERT_TRUE(draw.draw(texture));
+  s_gles2.glFinish();
+
+  const auto duration = std::chrono::seconds{2};
+  const auto start = std::chrono::steady_clock::now();
+  auto now = start;
+  std::uint64_t draws = 0;
+  while (now - start < duration) {
+    for (int n = 0; n < 10; n++)
+      draw.draw(texture);
+    // Draws are only queued by the driver so we have to wait for them
+    // to complete to get a meaningful number.
+    s_gles2.glFinish();
+    draws += 10;
+    now = std::chrono::steady_clock::now();
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(now - start);
+  const auto draws_per_second = draws / elapsed.count();
+  std::cout << "TextureDraw: " << draws << " draws in " << elapsed.count()
+            << "s (" << draws_per_second << " draws/s, "
+            << surface_width << "x" << surface_height << ")" << std::endl;
+  RecordProperty("draws_per_second", static_cast<int>(draws_per_second));
+
+  ASSERT_EQ(GL_NO_ERROR, s_gles2.glGetError());
+  s_gles2.glDeleteTextures(1, &texture);
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/emugl/ColorBuffer.h"
+#include "anbox/graphics/emugl/TextureDraw.h"
+#include "anbox/graphics/emugl/YUVConverter.h"
+#include "anbox/testing/swiftshader_context.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace {
+constexpr const int surface_width{64};
+constexpr const int surface_height{64};
+
+// Renders with whatever context the test made current.
+class TestHelper : public ColorBuffer::Helper {
+ public:
+  explicit TestHelper(EGLDisplay display) : draw_{display} {}
+
+  bool setupContext() override { return true; }
+  void teardownContext() override {}
+  TextureDraw* getTextureDraw() const override { return &draw_; }
+
+ private:
+  mutable TextureDraw draw_;
+};
+
+struct YUV {
+  uint8_t y, u, v;
+};
+
+// Same BT.601 video range conversion the host does in its shader.
+uint32_t to_rgba(const YUV &yuv) {
+  const float y = 1.164383f * (yuv.y - 16);
+  const float u = yuv.u - 128.0f;
+  const float v = yuv.v - 128.0f;
+  auto clamp = [](float c) {
+    return static_cast<uint32_t>(std::min(255.0f, std::max(0.0f, c)) + 0.5f);
+  };
+  return clamp(y + 1.596027f * v) |
+         clamp(y - 0.391762f * u - 0.812968f * v) << 8 |
+         clamp(y + 2.017232f * u) << 16 |
+         0xff000000;
+}
+
+// Fills each quadrant of a tightly packed frame with a different color.
+std::vector<uint8_t> create_frame(GLenum format, int width, int height, const YUV colors[4]) {
+  std::vector<uint8_t> frame(YUVConverter::frameSize(format, width, height));
+  const int cw = width / 2, ch = height / 2;
+  uint8_t *y_plane = frame.data();
+  uint8_t *chroma = y_plane + width * height;
+  auto color_at = [&](int x, int y) {
+    return colors[(y >= height / 2 ? 2 : 0) + (x >= width / 2 ? 1 : 0)];
+  };
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++)
+      y_plane[y * width + x] = color_at(x, y).y;
+  }
+  for (int y = 0; y < ch; y++) {
+    for (int x = 0; x < cw; x++) {
+      const auto color = color_at(x * 2, y * 2);
+      if (format == GL_NV21_ANBOX) {
+        chroma[(y * cw + x) * 2] = color.v;
+        chroma[(y * cw + x) * 2 + 1] = color.u;
+      } else {
+        chroma[y * cw + x] = color.v;
+        chroma[cw * ch + y * cw + x] = color.u;
+      }
+    }
+  }
+  return frame;
+}
+
+bool near(uint32_t expected, uint32_t actual) {
+  for (int c = 0; c < 32; c += 8) {
+    const int diff = static_cast<int>((expected >> c) & 0xff) - static_cast<int>((actual >> c) & 0xff);
+    if (std::abs(diff) > 3)
+      return false;
+  }
+  return true;
+}
+
+void check_conversion(GLenum format) {
+  anbox::testing::SwiftShaderContext context{surface_width, surface_height};
+  ASSERT_TRUE(context.initialize());
+
+  TestHelper helper{context.display()};
+  std::unique_ptr<ColorBuffer> cb{ColorBuffer::create(
+      context.display(), surface_width, surface_height, format, false, &helper)};
+  ASSERT_NE(nullptr, cb);
+
+  const YUV colors[4] = {{81, 90, 240}, {145, 54, 34}, {41, 240, 110}, {235, 128, 128}};
+  auto frame = create_frame(format, surface_width, surface_height, colors);
+  cb->subUpdate(0, 0, surface_width, surface_height, format, GL_UNSIGNED_BYTE, frame.data());
+
+  std::vector<uint32_t> pixels(surface_width * surface_height);
+  cb->readPixels(0, 0, surface_width, surface_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  ASSERT_EQ(GL_NO_ERROR, s_gles2.glGetError());
+
+  // The first row of the frame has to end up
+  // in the first row of the buffer, just like with RGBA updates.
+  const int qx = surface_width / 4, qy = surface_height / 4;
+  const int points[4][2] = {{qx, qy}, {3 * qx, qy}, {qx, 3 * qy}, {3 * qx, 3 * qy}};
+  for (int n = 0; n < 4; n++) {
+    const auto actual = pixels[points[n][1] * surface_width + points[n][0]];
+    EXPECT_TRUE(near(to_rgba(colors[n]), actual))
+        << std::hex << "quadrant " << n << " expected 0x" << to_rgba(colors[n])
+        << " got 0x" << actual;
+  }
+}
+
+// Uploads |frames| of |width|x|height| and returns the achieved frames per second.
+double measure_uploads(ColorBuffer *cb, GLenum format, int width, int height, const std::vector<uint8_t> &frame) {
+  // Warm up so texture allocation and shader compilation are not measured.
+  for (int n = 0; n < 3; n++)
+    cb->subUpdate(0, 0, width, height, format, GL_UNSIGNED_BYTE, const_cast<uint8_t*>(frame.data()));
+  s_gles2.glFinish();
+
+  const auto duration = std::chrono::seconds{1};
+  const auto start = std::chrono::steady_clock::now();
+  auto now = start;
+  std::uint64_t uploads = 0;
+  while (now - start < duration) {
+    cb->subUpdate(0, 0, width, height, format, GL_UNSIGNED_BYTE, const_cast<uint8_t*>(frame.data()));
+    // Uploads and conversions are queued, wait for them to be done.
+    s_gles2.glFinish();
+    uploads++;
+    now = std::chrono::steady_clock::now();
+  }
+  const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(now - start);
+  return uploads / elapsed.count();
+}
+}  // namespace
+
+TEST(YUVColorBuffer, ConvertsYV12_requires_swiftshader) {
+  check_conversion(GL_YV12_ANBOX);
+}
+
+TEST(YUVColorBuffer, ConvertsNV21_requires_swiftshader) {
+  check_conversion(GL_NV21_ANBOX);
+}
+
+TEST(YUVColorBuffer, RejectsOddSizes) {
+  // Checked before any GL call is made, so no context is needed.
+  ASSERT_EQ(nullptr, ColorBuffer::create(EGL_NO_DISPLAY, 63, 64, GL_YV12_ANBOX, false, nullptr));
+  ASSERT_EQ(nullptr, ColorBuffer::create(EGL_NO_DISPLAY, 64, 63, GL_NV21_ANBOX, false, nullptr));
+}
+
+TEST(YUVColorBuffer, UploadsPerSecond_requires_swiftshader) {
+  constexpr const int width{1280};
+  constexpr const int height{720};
+  anbox::testing::SwiftShaderContext context{surface_width, surface_height};
+  ASSERT_TRUE(context.initialize());
+
+  TestHelper helper{context.display()};
+  std::unique_ptr<ColorBuffer> rgba{ColorBuffer::create(
+      context.display(), width, height, GL_RGBA, false, &helper)};
+  std::unique_ptr<ColorBuffer> yv12{ColorBuffer::create(
+      context.display(), width, height, GL_YV12_ANBOX, false, &helper)};
+  ASSERT_NE(nullptr, rgba);
+  ASSERT_NE(nullptr, yv12);
+
+  const std::vector<uint8_t> rgba_frame(width * height * 4, 0x80);
+  const YUV colors[4] = {{81, 90, 240}, {145, 54, 34}, {41, 240, 110}, {235, 128, 128}};
+  const auto yuv_frame = create_frame(GL_YV12_ANBOX, width, height, colors);
+
+  const auto rgba_fps = measure_uploads(rgba.get(), GL_RGBA, width, height, rgba_frame);
+  const auto yv12_fps = measure_uploads(yv12.get(), GL_YV12_ANBOX, width, height, yuv_frame);
+
+  std::cout << "YUVColorBuffer: " << width << "x" << height << " RGBA "
+            << rgba_frame.size() << " bytes/frame " << rgba_fps << " frames/s, YV12 "
+            << yuv_frame.size() << " bytes/frame " << yv12_fps << " frames/s" << std::endl;
+  RecordProperty("rgba_uploads_per_second", static_cast<int>(rgba_fps));
+  RecordProperty("yv12_uploads_per_second", static_cast<int>(yv12_fps));
+
+  ASSERT_EQ(rgba_frame.size() * 3 / 8, yuv_frame.size());
+  ASSERT_EQ(GL_NO_ERROR, s_gles2.glGetError());
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/platform/null/platform.h"
+
+#include <vector>
+
+using namespace anbox::platform;
+
+namespace {
+class FakeClipboardSource : public Clipboard::Source {
+ public:
+  std::string read_text() override {
+    reads++;
+    return text;
+  }
+
+  void write_text(const std::string &t) override {
+    writes++;
+    text = t;
+  }
+
+  std::string text;
+  int reads = 0;
+  int writes = 0;
+};
+}  // namespace
+
+TEST(Clipboard, GuestReadsDoNotQueryHost) {
+  auto source = std::make_shared<FakeClipboardSource>();
+  source->text = "from host";
+
+  NullPlatform platform{source};
+  platform.host_clipboard_changed();
+  ASSERT_EQ(1, source->reads);
+
+  for (int n = 0; n < 100; n++)
+    ASSERT_EQ("from host", platform.get_clipboard_data().text);
+  ASSERT_EQ(1, source->reads);
+}
+
+TEST(Clipboard, HostChangesReachGuest) {
+  auto source = std::make_shared<FakeClipboardSource>();
+  NullPlatform platform{source};
+
+  source->text = "first";
+  platform.host_clipboard_changed();
+  ASSERT_EQ("first", platform.get_clipboard_data().text);
+
+  source->text = "second";
+  ASSERT_EQ("first", platform.get_clipboard_data().text);
+  platform.host_clipboard_changed();
+  ASSERT_EQ("second", platform.get_clipboard_data().text);
+}
+
+TEST(Clipboard, ReportsHostChanges) {
+  auto source = std::make_shared<FakeClipboardSource>();
+  Clipboard clipboard{source};
+
+  std::vector<std::string> reported;
+  clipboard.set_observer([&](const std::string &text) { reported.push_back(text); });
+
+  source->text = "first";
+  clipboard.host_changed();
+  clipboard.host_changed();
+  source->text = "second";
+  clipboard.host_changed();
+
+  // The guest's own changes are not reported back.
+  ASSERT_TRUE(clipboard.set_from_guest("from guest"));
+  clipboard.host_changed();
+  clipboard.sync_to_host();
+  clipboard.host_changed();
+
+  ASSERT_EQ((std::vector<std::string>{"first", "second"}), reported);
+}
+
+TEST(Clipboard, GuestChangesReachHost) {
+  auto source = std::make_shared<FakeClipboardSource>();
+  NullPlatform platform{source};
+
+  platform.set_clipboard_data(BasePlatform::ClipboardData{"from guest"});
+  ASSERT_EQ(1, source->writes);
+  ASSERT_EQ("from guest", source->text);
+  ASSERT_EQ("from guest", platform.get_clipboard_data().text);
+}
+
+TEST(Clipboard, PendingGuestChangeWinsOverHostRefresh) {
+  auto source = std::make_shared<FakeClipboardSource>();
+  source->text = "old host";
+  Clipboard clipboard{source};
+
+  ASSERT_TRUE(clipboard.set_from_guest("from guest"));
+  clipboard.host_changed();
+  ASSERT_EQ("from guest", clipboard.text());
+
+  clipboard.sync_to_host();
+  ASSERT_EQ("from guest", source->text);
+
+  // Syncing only happens once per guest change.
+  clipboard.sync_to_host();
+  ASSERT_EQ(1, source->writes);
+}
+
+TEST(Clipboard, OversizedHostTextIsDropped) {
+  auto source = std::make_shared<FakeClipboardSource>();
+  NullPlatform platform{source};
+
+  source->text = "small";
+  platform.host_clipboard_changed();
+  ASSERT_EQ("small", platform.get_clipboard_data().text);
+
+  source->text = std::string(Clipboard::max_text_size + 1, 'a');
+  platform.host_clipboard_changed();
+  ASSERT_TRUE(platform.get_clipboard_data().text.empty());
+}
+
+TEST(Clipboard, OversizedGuestTextIsRejected) {
+  auto source = std::make_shared<FakeClipboardSource>();
+  source->text = "host";
+  Clipboard clipboard{source};
+  clipboard.host_changed();
+
+  ASSERT_FALSE(clipboard.set_from_guest(std::string(Clipboard::max_text_size + 1, 'a')));
+  ASSERT_EQ("host", clipboard.text());
+  clipboard.sync_to_host();
+  ASSERT_EQ(0, source->writes);
+}
+
+TEST(Clipboard, WithoutSourceStaysInGuest) {
+  NullPlatform platform;
+  platform.host_clipboard_changed();
+  ASSERT_TRUE(platform.get_clipboard_data().text.empty());
+
+  platform.set_clipboard_data(BasePlatform::ClipboardData{"in guest"});
+  ASSERT_EQ("in guest", platform.get_clipboard_data().text);
+}
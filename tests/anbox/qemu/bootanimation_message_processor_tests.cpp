@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/local_socket_messenger.h"
+#include "anbox/qemu/bootanimation_message_processor.h"
+#include "anbox/utils.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include <signal.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+// Everything the messenger uses to push data into a socket goes through
+// one of these. We route them to the kernel ourself so that we can count
+// how many system calls a transfer takes.
+namespace {
+std::atomic<std::uint64_t> num_write_syscalls{0};
+}  // namespace
+
+extern "C" ssize_t sendmsg(int fd, const struct msghdr *msg, int flags) {
+  num_write_syscalls++;
+  return ::syscall(SYS_sendmsg, fd, msg, flags);
+}
+
+extern "C" ssize_t send(int fd, const void *buf, size_t len, int flags) {
+  num_write_syscalls++;
+  return ::syscall(SYS_sendto, fd, buf, len, flags, nullptr, 0);
+}
+
+extern "C" ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count) {
+  num_write_syscalls++;
+  return ::syscall(SYS_sendfile, out_fd, in_fd, offset, count);
+}
+
+namespace {
+constexpr const size_t animation_size{8 * 1024 * 1024};
+
+struct TransferResult {
+  std::chrono::microseconds duration;
+  std::uint64_t syscalls;
+};
+
+class BootAnimationTransfer {
+ public:
+  BootAnimationTransfer() : path_{fs::temp_directory_path() / fs::unique_path()} {
+    std::ofstream out(path_.string(), std::ofstream::binary);
+    std::vector<char> data(animation_size);
+    for (size_t n = 0; n < data.size(); n++)
+      data[n] = static_cast<char>(n * 7);
+    out.write(data.data(), data.size());
+  }
+
+  ~BootAnimationTransfer() {
+    fs::remove(path_);
+  }
+
+  std::string path() const { return path_.string(); }
+
+  // Runs the given transfer against a connected socket pair with the
+  // other end being drained, like the guest does.
+  template <typename Transfer>
+  TransferResult run(const Transfer &transfer) {
+    boost::asio::io_service io_service;
+    auto host = std::make_shared<boost::asio::local::stream_protocol::socket>(io_service);
+    boost::asio::local::stream_protocol::socket guest(io_service);
+    boost::asio::local::connect_pair(*host, guest);
+
+    auto messenger = std::make_shared<anbox::network::LocalSocketMessenger>(host);
+
+    size_t received = 0;
+    bool content_matches = true;
+    std::thread reader([&]() {
+      std::vector<char> buffer(64 * 1024);
+      while (received < animation_size) {
+        const auto bytes_read = ::read(guest.native_handle(), buffer.data(), buffer.size());
+        if (bytes_read <= 0)
+          break;
+        for (ssize_t n = 0; n < bytes_read; n++) {
+          if (buffer[n] != static_cast<char>((received + n) * 7))
+            content_matches = false;
+        }
+        received += bytes_read;
+      }
+    });
+
+    const auto syscalls_before = num_write_syscalls.load();
+    const auto start = std::chrono::steady_clock::now();
+    transfer(messenger);
+    reader.join();
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(animation_size, received);
+    EXPECT_TRUE(content_matches);
+
+    return {std::chrono::duration_cast<std::chrono::microseconds>(duration),
+            num_write_syscalls.load() - syscalls_before};
+  }
+
+ private:
+  fs::path path_;
+};
+
+void print_result(const std::string &name, const TransferResult &result) {
+  std::cout << name << ": " << animation_size << " bytes in "
+            << result.duration.count() << " us with "
+            << result.syscalls << " write syscalls" << std::endl;
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(BootAnimationMessageProcessor, SendsIconWithFewSyscalls) {
+  BootAnimationTransfer transfer;
+
+  // This is what we did before: copying the file through userspace in
+  // small chunks.
+  const auto chunked = transfer.run([&](const std::shared_ptr<network::SocketMessenger> &messenger) {
+    std::ifstream icon_file(transfer.path(), std::ifstream::binary);
+    std::array<char, 1024> buffer;
+    while (icon_file.read(buffer.data(), buffer.size()))
+      messenger->send(buffer.data(), icon_file.gcount());
+  });
+
+  const auto processed = transfer.run([&](const std::shared_ptr<network::SocketMessenger> &messenger) {
+    BootAnimationMessageProcessor processor(messenger, transfer.path());
+    const std::string command{"retrieve-icon"};
+    const auto message = utils::string_format("%04x%s", command.size(), command);
+    processor.process_data(std::vector<std::uint8_t>(message.begin(), message.end()));
+  });
+
+  print_result("chunked", chunked);
+  print_result("processor", processed);
+  RecordProperty("chunked_us", static_cast<int>(chunked.duration.count()));
+  RecordProperty("processor_us", static_cast<int>(processed.duration.count()));
+  RecordProperty("chunked_syscalls", static_cast<int>(chunked.syscalls));
+  RecordProperty("processor_syscalls", static_cast<int>(processed.syscalls));
+
+  ASSERT_GE(chunked.syscalls, animation_size / 1024);
+  // The kernel moves as much as fits into the socket buffer with every
+  // call, so this only depends on how fast the other side drains it.
+  ASSERT_LT(processed.syscalls * 16, chunked.syscalls);
+}
+
+TEST(BootAnimationMessageProcessor, SendsNothingForMissingIcon) {
+  boost::asio::io_service io_service;
+  auto host = std::make_shared<boost::asio::local::stream_protocol::socket>(io_service);
+  boost::asio::local::stream_protocol::socket guest(io_service);
+  boost::asio::local::connect_pair(*host, guest);
+
+  auto messenger = std::make_shared<network::LocalSocketMessenger>(host);
+  BootAnimationMessageProcessor processor(messenger, "/nonexistent/boot-icon.png");
+
+  const std::string message{"000dretrieve-icon"};
+  ASSERT_TRUE(processor.process_data(std::vector<std::uint8_t>(message.begin(), message.end())));
+
+  boost::asio::socket_base::bytes_readable available{true};
+  guest.io_control(available);
+  ASSERT_EQ(0u, available.get());
+}
+
+TEST(BootAnimationMessageProcessor, SurvivesDisconnectedGuest) {
+  BootAnimationTransfer transfer;
+
+  boost::asio::io_service io_service;
+  auto host = std::make_shared<boost::asio::local::stream_protocol::socket>(io_service);
+  boost::asio::local::stream_protocol::socket guest(io_service);
+  boost::asio::local::connect_pair(*host, guest);
+  guest.close();
+
+  // Without blocking SIGPIPE the default action would kill us here.
+  auto messenger = std::make_shared<network::LocalSocketMessenger>(host);
+  BootAnimationMessageProcessor processor(messenger, transfer.path());
+  const std::string message{"000dretrieve-icon"};
+  ASSERT_TRUE(processor.process_data(std::vector<std::uint8_t>(message.begin(), message.end())));
+
+  // Nothing is left behind for whoever unblocks the signal next.
+  sigset_t pending;
+  sigpending(&pending);
+  ASSERT_EQ(0, sigismember(&pending, SIGPIPE));
+}
+}  // namespace qemu
+}  // namespace anbox
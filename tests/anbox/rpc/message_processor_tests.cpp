@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/message_sender.h"
+#include "anbox/rpc/channel.h"
+#include "anbox/rpc/message_processor.h"
+#include "anbox/rpc/pending_call_cache.h"
+#include "anbox/utils.h"
+
+#include "anbox_bridge.pb.h"
+#include "anbox_rpc.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+namespace {
+std::atomic<bool> count_allocations{false};
+std::atomic<std::uint64_t> allocations{0};
+}  // namespace
+
+// Counts every heap allocation made while count_allocations is set so we
+// can tell how many a single message costs.
+void *operator new(std::size_t size) {
+  if (count_allocations)
+    allocations++;
+  if (auto ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+constexpr const unsigned int window_count{16};
+constexpr const unsigned int iterations{100};
+
+class AllocationCounter {
+ public:
+  AllocationCounter() {
+    allocations = 0;
+    count_allocations = true;
+  }
+  ~AllocationCounter() { count_allocations = false; }
+
+  std::uint64_t count() const { return allocations; }
+};
+
+// Keeps the last message it was asked to send.
+class RecordingSender : public anbox::network::MessageSender {
+ public:
+  void send(char const *data, size_t length) override {
+    message.assign(data, data + length);
+  }
+
+  ssize_t send_raw(char const *data, size_t length) override {
+    (void)data;
+    return length;
+  }
+
+  std::vector<std::uint8_t> message;
+};
+
+// Handles window state updates the same way the platform message
+// processor does.
+class WindowStateProcessor : public anbox::rpc::MessageProcessor {
+ public:
+  WindowStateProcessor(const std::shared_ptr<anbox::network::MessageSender> &sender,
+                       const std::shared_ptr<anbox::rpc::PendingCallCache> &pending_calls,
+                       bool reuse_events)
+      : anbox::rpc::MessageProcessor(sender, pending_calls), reuse_events_(reuse_events) {}
+
+  void process_event_sequence(const std::string &raw_events) override {
+    if (reuse_events_) {
+      ASSERT_TRUE(events_.ParseFromString(raw_events));
+      windows += events_.window_state_update().windows_size();
+    } else {
+      anbox::protobuf::bridge::EventSequence events;
+      ASSERT_TRUE(events.ParseFromString(raw_events));
+      windows += events.window_state_update().windows_size();
+    }
+  }
+
+  std::uint64_t windows = 0;
+
+ private:
+  bool reuse_events_;
+  anbox::protobuf::bridge::EventSequence events_;
+};
+
+anbox::protobuf::bridge::EventSequence make_window_state_update() {
+  anbox::protobuf::bridge::EventSequence seq;
+  auto event = seq.mutable_window_state_update();
+  for (unsigned int n = 0; n < window_count; n++) {
+    auto window = event->add_windows();
+    window->set_display_id(0);
+    window->set_has_surface(true);
+    // Long enough to not fit into the small string buffer.
+    window->set_package_name(anbox::utils::string_format("com.example.application%d", n));
+    window->set_frame_left(n * 10);
+    window->set_frame_top(n * 10);
+    window->set_frame_right(n * 10 + 640);
+    window->set_frame_bottom(n * 10 + 480);
+    window->set_task_id(n);
+    window->set_stack_id(2);
+  }
+  return seq;
+}
+
+double receive_allocations_per_message(bool reuse_events) {
+  const auto pending_calls = std::make_shared<anbox::rpc::PendingCallCache>();
+  const auto sender = std::make_shared<RecordingSender>();
+  anbox::rpc::Channel channel(pending_calls, sender);
+  channel.send_event(make_window_state_update());
+  const auto message = sender->message;
+
+  WindowStateProcessor processor(sender, pending_calls, reuse_events);
+  // Warm up so buffers reach their final size.
+  processor.process_data(message);
+
+  std::uint64_t count = 0;
+  {
+    AllocationCounter counter;
+    for (unsigned int n = 0; n < iterations; n++)
+      processor.process_data(message);
+    count = counter.count();
+  }
+
+  EXPECT_EQ((iterations + 1) * window_count, processor.windows);
+  return static_cast<double>(count) / iterations;
+}
+}  // namespace
+
+TEST(MessageProcessor, WindowStateUpdateAllocations) {
+  const auto fresh = receive_allocations_per_message(false);
+  const auto reused = receive_allocations_per_message(true);
+
+  std::cout << "WindowStateUpdate with " << window_count << " windows: "
+            << fresh << " allocations per message with fresh messages, "
+            << reused << " when reusing them" << std::endl;
+  RecordProperty("allocations_fresh", static_cast<int>(fresh));
+  RecordProperty("allocations_reused", static_cast<int>(reused));
+
+  // Everything the rpc layer parses into is reused so once warmed up
+  // nothing should need to be allocated anymore.
+  ASSERT_EQ(0, reused);
+  ASSERT_LT(reused, fresh);
+}
+
+TEST(Channel, SendEventDoesNotAllocateOnceWarmedUp) {
+  const auto pending_calls = std::make_shared<anbox::rpc::PendingCallCache>();
+  const auto sender = std::make_shared<RecordingSender>();
+  anbox::rpc::Channel channel(pending_calls, sender);
+
+  const auto seq = make_window_state_update();
+  channel.send_event(seq);
+  const auto first_message = sender->message;
+
+  std::uint64_t count = 0;
+  {
+    AllocationCounter counter;
+    for (unsigned int n = 0; n < iterations; n++)
+      channel.send_event(seq);
+    count = counter.count();
+  }
+
+  ASSERT_EQ(first_message, sender->message);
+  ASSERT_EQ(0u, count);
+}
+
+TEST(MessageProcessor, ProcessesMessagesSplitAcrossReads) {
+  const auto pending_calls = std::make_shared<anbox::rpc::PendingCallCache>();
+  const auto sender = std::make_shared<RecordingSender>();
+  anbox::rpc::Channel channel(pending_calls, sender);
+  channel.send_event(make_window_state_update());
+  const auto message = sender->message;
+
+  std::vector<std::uint8_t> data;
+  for (unsigned int n = 0; n < 3; n++)
+    data.insert(data.end(), message.begin(), message.end());
+
+  WindowStateProcessor processor(sender, pending_calls, true);
+  // Feed the data in chunks which split both headers and message bodies.
+  const size_t chunk_size = 3;
+  for (size_t offset = 0; offset < data.size(); offset += chunk_size) {
+    const auto end = std::min(data.size(), offset + chunk_size);
+    processor.process_data(std::vector<std::uint8_t>(data.begin() + offset, data.begin() + end));
+  }
+
+  ASSERT_EQ(3 * window_count, processor.windows);
+}